@@ -11,6 +11,7 @@
 #include <cstring>
 #include <iomanip> // std::get_time
 #include <iterator> // std::size
+#include <limits>
 #include <mutex>
 #include <sstream> // std::istringstream
 #include <string_view>
@@ -41,6 +42,7 @@
 #include <netinet/in.h>
 #include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include <dirent.h>
@@ -111,6 +113,19 @@ void net_buffer_init(NETSOCKET_BUFFER *buffer);
 void net_buffer_reinit(NETSOCKET_BUFFER *buffer);
 void net_buffer_simple(NETSOCKET_BUFFER *buffer, char **buf, int *size);
 
+#if defined(CONF_PLATFORM_LINUX)
+// outgoing packets that are sent together with sendmmsg by net_udp_flush
+typedef struct
+{
+	int size;
+	int fds[VLEN];
+	struct mmsghdr msgs[VLEN];
+	struct iovec iovecs[VLEN];
+	char bufs[VLEN][PACKETSIZE];
+	struct sockaddr_storage sockaddrs[VLEN];
+} NETSOCKET_SEND_QUEUE;
+#endif
+
 struct NETSOCKET_INTERNAL
 {
 	int type;
@@ -118,10 +133,16 @@ struct NETSOCKET_INTERNAL
 	int ipv6sock;
 	int web_ipv4sock;
 	int web_ipv6sock;
+	// pipe that interrupts net_socket_read_wait, see net_socket_read_wait_interruptible
+	int wakeup_read;
+	int wakeup_write;
 
 	NETSOCKET_BUFFER buffer;
+#if defined(CONF_PLATFORM_LINUX)
+	NETSOCKET_SEND_QUEUE *send_queue;
+#endif
 };
-static NETSOCKET_INTERNAL invalid_socket = {NETTYPE_INVALID, -1, -1, -1, -1};
+static NETSOCKET_INTERNAL invalid_socket = {NETTYPE_INVALID, -1, -1, -1, -1, -1, -1};
 
 std::atomic_bool dbg_assert_failing = false;
 DBG_ASSERT_HANDLER dbg_assert_handler;
@@ -398,6 +419,38 @@ int64_t io_length(IOHANDLE io)
 	return length;
 }
 
+void *io_map(IOHANDLE io, int64_t length)
+{
+	if(length <= 0 || (uint64_t)length > std::numeric_limits<size_t>::max())
+	{
+		return nullptr;
+	}
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno((FILE *)io));
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if(mapping == nullptr)
+	{
+		return nullptr;
+	}
+	// the view keeps the mapping alive
+	void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, length);
+	CloseHandle(mapping);
+	return data;
+#else
+	void *data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno((FILE *)io), 0);
+	return data == MAP_FAILED ? nullptr : data;
+#endif
+}
+
+void io_unmap(void *data, int64_t length)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, length);
+#endif
+}
+
 unsigned io_write(IOHANDLE io, const void *buffer, unsigned size)
 {
 	return fwrite(buffer, 1, size, (FILE *)io);
@@ -1545,6 +1598,8 @@ static void priv_net_close_socket(int sock)
 
 static void priv_net_close_all_sockets(NETSOCKET sock)
 {
+	net_udp_set_send_batching(sock, false);
+
 	if(sock->ipv4sock >= 0)
 	{
 		priv_net_close_socket(sock->ipv4sock);
@@ -1577,6 +1632,14 @@ static void priv_net_close_all_sockets(NETSOCKET sock)
 	}
 #endif
 
+#if defined(CONF_FAMILY_UNIX)
+	if(sock->wakeup_read >= 0)
+	{
+		close(sock->wakeup_read);
+		close(sock->wakeup_write);
+	}
+#endif
+
 	free(sock);
 }
 
@@ -1594,7 +1657,7 @@ std::string windows_format_system_message(unsigned long error)
 }
 #endif
 
-static int priv_net_create_socket(int domain, int type, const NETADDR *bindaddr)
+static int priv_net_create_socket(int domain, int type, const NETADDR *bindaddr, bool reuse_port = false)
 {
 	int sock = socket(domain, type, 0);
 	if(sock < 0)
@@ -1625,6 +1688,19 @@ static int priv_net_create_socket(int domain, int type, const NETADDR *bindaddr)
 	}
 #endif
 
+	if(reuse_port)
+	{
+#if defined(SO_REUSEPORT)
+		int reuse = 1;
+		if(setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char *)&reuse, sizeof(reuse)) != 0)
+		{
+			log_error("net", "Setting SO_REUSEPORT failed with domain %d and type %d (%s)", domain, type, net_error_message().c_str());
+		}
+#else
+		log_error("net", "SO_REUSEPORT is not supported on this platform");
+#endif
+	}
+
 	// Set to IPv6-only if that's what we are creating, to ensure that dual-stack does not block the same IPv4 port.
 #if defined(IPV6_V6ONLY)
 	if(domain == AF_INET6)
@@ -1669,7 +1745,7 @@ int net_socket_type(NETSOCKET sock)
 	return sock->type;
 }
 
-NETSOCKET net_udp_create(NETADDR bindaddr)
+NETSOCKET net_udp_create(NETADDR bindaddr, bool reuse_port)
 {
 	NETSOCKET sock = (NETSOCKET_INTERNAL *)malloc(sizeof(*sock));
 	*sock = invalid_socket;
@@ -1678,7 +1754,7 @@ NETSOCKET net_udp_create(NETADDR bindaddr)
 	{
 		NETADDR bindaddr_ipv4 = bindaddr;
 		bindaddr_ipv4.type = NETTYPE_IPV4;
-		const int socket = priv_net_create_socket(AF_INET, SOCK_DGRAM, &bindaddr_ipv4);
+		const int socket = priv_net_create_socket(AF_INET, SOCK_DGRAM, &bindaddr_ipv4, reuse_port);
 		if(socket >= 0)
 		{
 			sock->type |= NETTYPE_IPV4;
@@ -1722,7 +1798,7 @@ NETSOCKET net_udp_create(NETADDR bindaddr)
 	{
 		NETADDR bindaddr_ipv6 = bindaddr;
 		bindaddr_ipv6.type = NETTYPE_IPV6;
-		const int socket = priv_net_create_socket(AF_INET6, SOCK_DGRAM, &bindaddr_ipv6);
+		const int socket = priv_net_create_socket(AF_INET6, SOCK_DGRAM, &bindaddr_ipv6, reuse_port);
 		if(socket >= 0)
 		{
 			sock->type |= NETTYPE_IPV6;
@@ -1779,10 +1855,65 @@ NETSOCKET net_udp_create(NETADDR bindaddr)
 	return sock;
 }
 
+#if defined(CONF_PLATFORM_LINUX)
+static bool priv_net_udp_queue(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
+{
+	NETSOCKET_SEND_QUEUE *queue = sock->send_queue;
+	if(size > PACKETSIZE)
+		return false;
+
+	int fd;
+	socklen_t namelen;
+	if(addr->type == NETTYPE_IPV4 && sock->ipv4sock >= 0)
+	{
+		fd = sock->ipv4sock;
+		namelen = sizeof(sockaddr_in);
+	}
+	else if(addr->type == NETTYPE_IPV6 && sock->ipv6sock >= 0)
+	{
+		fd = sock->ipv6sock;
+		namelen = sizeof(sockaddr_in6);
+	}
+	else
+	{
+		// broadcasts, websockets and errors take the direct path
+		return false;
+	}
+
+	if(queue->size == VLEN)
+		net_udp_flush(sock);
+
+	const int i = queue->size++;
+	queue->fds[i] = fd;
+	if(fd == sock->ipv4sock)
+		netaddr_to_sockaddr_in(addr, (sockaddr_in *)&queue->sockaddrs[i]);
+	else
+		netaddr_to_sockaddr_in6(addr, (sockaddr_in6 *)&queue->sockaddrs[i]);
+	queue->msgs[i].msg_hdr.msg_namelen = namelen;
+	queue->iovecs[i].iov_len = size;
+	mem_copy(queue->bufs[i], data, size);
+	return true;
+}
+#endif
+
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
 {
 	int d = -1;
 
+#if defined(CONF_PLATFORM_LINUX)
+	if(sock->send_queue)
+	{
+		if(priv_net_udp_queue(sock, addr, data, size))
+		{
+			network_stats.sent_bytes += size;
+			network_stats.sent_packets++;
+			return size;
+		}
+		// keep the packet order for packets that cannot be queued
+		net_udp_flush(sock);
+	}
+#endif
+
 	if(addr->type & NETTYPE_IPV4)
 	{
 		if(sock->ipv4sock >= 0)
@@ -1882,6 +2013,68 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 	return d;
 }
 
+void net_udp_set_send_batching(NETSOCKET sock, bool enable)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	if(enable && !sock->send_queue)
+	{
+		NETSOCKET_SEND_QUEUE *queue = (NETSOCKET_SEND_QUEUE *)calloc(1, sizeof(*queue));
+		for(int i = 0; i < VLEN; ++i)
+		{
+			queue->iovecs[i].iov_base = queue->bufs[i];
+			queue->msgs[i].msg_hdr.msg_iov = &(queue->iovecs[i]);
+			queue->msgs[i].msg_hdr.msg_iovlen = 1;
+			queue->msgs[i].msg_hdr.msg_name = &(queue->sockaddrs[i]);
+		}
+		sock->send_queue = queue;
+	}
+	else if(!enable && sock->send_queue)
+	{
+		net_udp_flush(sock);
+		free(sock->send_queue);
+		sock->send_queue = nullptr;
+	}
+#endif
+}
+
+int net_udp_flush(NETSOCKET sock)
+{
+	int sent = 0;
+#if defined(CONF_PLATFORM_LINUX)
+	NETSOCKET_SEND_QUEUE *queue = sock->send_queue;
+	if(!queue)
+		return 0;
+
+	int start = 0;
+	while(start < queue->size)
+	{
+		// sendmmsg only takes one socket, IPv4 and IPv6 packets are sent in separate runs
+		int end = start + 1;
+		while(end < queue->size && queue->fds[end] == queue->fds[start])
+			end++;
+
+		while(start < end)
+		{
+			const int result = sendmmsg(queue->fds[start], &queue->msgs[start], end - start, 0);
+			network_stats.sent_batches++;
+			if(result > 0)
+			{
+				network_stats.sent_batched_packets += result;
+				sent += result;
+				start += result;
+			}
+			else
+			{
+				// like a failed sendto, only drop the packet that could not be sent
+				start++;
+			}
+		}
+	}
+	queue->size = 0;
+#endif
+	return sent;
+}
+
 void net_buffer_init(NETSOCKET_BUFFER *buffer)
 {
 #if defined(CONF_PLATFORM_LINUX)
@@ -2832,6 +3025,13 @@ int net_socket_read_wait(NETSOCKET sock, std::chrono::nanoseconds nanoseconds)
 	{
 		return 0;
 	}
+#if defined(CONF_FAMILY_UNIX)
+	if(sock->wakeup_read >= 0)
+	{
+		FD_SET(sock->wakeup_read, &readfds);
+		maxfd = std::max(maxfd, sock->wakeup_read);
+	}
+#endif
 
 	struct timeval tv;
 	tv.tv_sec = microseconds / 1000000;
@@ -2839,6 +3039,16 @@ int net_socket_read_wait(NETSOCKET sock, std::chrono::nanoseconds nanoseconds)
 	// don't care about writefds and exceptfds
 	select(maxfd + 1, &readfds, nullptr, nullptr, &tv);
 
+#if defined(CONF_FAMILY_UNIX)
+	if(sock->wakeup_read >= 0 && FD_ISSET(sock->wakeup_read, &readfds))
+	{
+		char aBuf[64];
+		while(read(sock->wakeup_read, aBuf, sizeof(aBuf)) > 0)
+		{
+		}
+		return 1;
+	}
+#endif
 	if(sock->ipv4sock >= 0 && FD_ISSET(sock->ipv4sock, &readfds))
 	{
 		return 1;
@@ -2860,6 +3070,53 @@ int net_socket_read_wait(NETSOCKET sock, std::chrono::nanoseconds nanoseconds)
 	return 0;
 }
 
+bool net_socket_read_wait_interruptible(NETSOCKET sock)
+{
+#if defined(CONF_FAMILY_UNIX)
+	if(sock->wakeup_read >= 0)
+	{
+		return true;
+	}
+	int fds[2];
+	if(pipe(fds) != 0)
+	{
+		log_error("net", "Creating the wakeup pipe failed (%d '%s')", errno, strerror(errno));
+		return false;
+	}
+	// both ends are non-blocking, a full pipe already wakes the waiting thread
+	int mode = 1;
+	for(int fd : fds)
+	{
+		if(ioctl(fd, FIONBIO, &mode) == -1)
+		{
+			log_error("net", "Setting non-blocking mode for the wakeup pipe failed (%d '%s')", errno, strerror(errno));
+			close(fds[0]);
+			close(fds[1]);
+			return false;
+		}
+	}
+	sock->wakeup_read = fds[0];
+	sock->wakeup_write = fds[1];
+	return true;
+#else
+	return false;
+#endif
+}
+
+void net_socket_read_wait_interrupt(NETSOCKET sock)
+{
+#if defined(CONF_FAMILY_UNIX)
+	if(sock->wakeup_write >= 0)
+	{
+		const char byte = 0;
+		if(write(sock->wakeup_write, &byte, 1) < 0)
+		{
+			// the pipe is full, the waiting thread wakes up anyway
+		}
+	}
+#endif
+}
+
 int64_t time_timestamp()
 {
 	return time(nullptr);
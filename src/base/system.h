@@ -364,6 +364,34 @@ int64_t io_tell(IOHANDLE io);
  */
 int64_t io_length(IOHANDLE io);
 
+/**
+ * Maps the beginning of a file into memory. The mapping is private: it can be
+ * written to, but the changes are neither written back to the file nor visible
+ * to other mappings.
+ *
+ * @ingroup File-IO
+ *
+ * @param io Handle to a file opened for reading.
+ * @param length Number of bytes to map, at most the length of the file.
+ *
+ * @return Pointer to the mapped data, or `nullptr` if the file could not be
+ *         mapped, in which case it should be read instead.
+ *
+ * @remark The mapping stays valid after the file was closed and must be
+ *         released with @link io_unmap @endlink.
+ */
+void *io_map(IOHANDLE io, int64_t length);
+
+/**
+ * Releases a mapping created with @link io_map @endlink.
+ *
+ * @ingroup File-IO
+ *
+ * @param data Pointer returned by @link io_map @endlink.
+ * @param length Length that was passed to @link io_map @endlink.
+ */
+void io_unmap(void *data, int64_t length);
+
 /**
  * Writes data from a buffer to a file.
  *
@@ -985,6 +1013,33 @@ int net_would_block();
  */
 int net_socket_read_wait(NETSOCKET sock, std::chrono::nanoseconds nanoseconds);
 
+/**
+ * Lets other threads interrupt @link net_socket_read_wait @endlink on the
+ * socket with @link net_socket_read_wait_interrupt @endlink.
+ *
+ * @ingroup Network-General
+ *
+ * @param sock Socket to make interruptible.
+ *
+ * @return `true` on success, `false` on failure or if the platform doesn't support it.
+ *
+ * @remark Only one thread may wait on an interruptible socket.
+ */
+bool net_socket_read_wait_interruptible(NETSOCKET sock);
+
+/**
+ * Makes the current or the next @link net_socket_read_wait @endlink on the
+ * socket return `1`.
+ *
+ * @ingroup Network-General
+ *
+ * @param sock Socket that was made interruptible with @link net_socket_read_wait_interruptible @endlink,
+ *        does nothing otherwise.
+ *
+ * @remark This function is thread-safe.
+ */
+void net_socket_read_wait_interrupt(NETSOCKET sock);
+
 /**
  * @defgroup Network-UDP UDP Networking
  *
@@ -1009,10 +1064,13 @@ int net_socket_type(NETSOCKET sock);
  * @ingroup Network-UDP
  *
  * @param bindaddr Address to bind the socket to.
+ * @param reuse_port Whether to set `SO_REUSEPORT`, so that several sockets
+ *        which all set it can be bound to the same address. The kernel then
+ *        distributes the incoming packets between them by the sender address.
  *
  * @return On success it returns an handle to the socket. On failure it returns `nullptr`.
  */
-NETSOCKET net_udp_create(NETADDR bindaddr);
+NETSOCKET net_udp_create(NETADDR bindaddr, bool reuse_port = false);
 
 /**
  * Sends a packet over an UDP socket.
@@ -1028,6 +1086,34 @@ NETSOCKET net_udp_create(NETADDR bindaddr);
  */
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size);
 
+/**
+ * Makes @link net_udp_send @endlink queue packets instead of sending them
+ * right away. The queued packets are sent with as few system calls as
+ * possible by @link net_udp_flush @endlink, which must be called regularly.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ * @param enable Whether to queue packets. Disabling it flushes the queue.
+ *
+ * @remark Only has an effect on Linux, broadcasts and websocket packets are never queued.
+ * @remark The queue is also flushed when it is full and when the socket is closed.
+ */
+void net_udp_set_send_batching(NETSOCKET sock, bool enable);
+
+/**
+ * Sends the packets queued by @link net_udp_send @endlink.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ *
+ * @return The number of packets that were sent.
+ *
+ * @see net_udp_set_send_batching
+ */
+int net_udp_flush(NETSOCKET sock);
+
 /**
  * Receives a packet over an UDP socket.
  *
@@ -28,4 +28,46 @@ public:
 	}
 };
 
+/**
+ * Bounded lock-free queue for exactly one thread pushing and one thread
+ * popping at a time.
+ */
+template<typename T, unsigned Capacity>
+class CSpscQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+	T m_aItems[Capacity] = {};
+	// on separate cache lines, so that the threads do not invalidate each other's
+	alignas(64) std::atomic<unsigned> m_Head{0};
+	alignas(64) std::atomic<unsigned> m_Tail{0};
+
+public:
+	/**
+	 * @return `false` if the queue is full.
+	 */
+	bool TryPush(const T &Item)
+	{
+		const unsigned Tail = m_Tail.load(std::memory_order_relaxed);
+		if(Tail - m_Head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		m_aItems[Tail % Capacity] = Item;
+		m_Tail.store(Tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @return `false` if the queue is empty.
+	 */
+	bool TryPop(T *pItem)
+	{
+		const unsigned Head = m_Head.load(std::memory_order_acquire);
+		if(Head == m_Tail.load(std::memory_order_acquire))
+			return false;
+		*pItem = m_aItems[Head % Capacity];
+		m_Head.store(Head + 1, std::memory_order_release);
+		return true;
+	}
+};
+
 #endif // BASE_TL_THREADING_H
@@ -94,6 +94,9 @@ typedef struct NETSTATS
 	uint64_t sent_bytes;
 	uint64_t recv_packets;
 	uint64_t recv_bytes;
+	// number of sendmmsg calls and the packets sent with them, see net_udp_flush
+	uint64_t sent_batches;
+	uint64_t sent_batched_packets;
 } NETSTATS;
 
 #if defined(CONF_FAMILY_WINDOWS)
@@ -7,6 +7,7 @@
 
 #include <engine/graphics.h>
 #include <engine/shared/config.h>
+#include <engine/shared/sound_mix.h>
 #include <engine/storage.h>
 
 #include "sound.h"
@@ -31,6 +32,7 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 
 	// acquire lock while we are mixing
 	m_SoundLock.lock();
+	ProcessVoiceCommands();
 
 	const int MasterVol = m_SoundVolume.load(std::memory_order_relaxed);
 
@@ -40,11 +42,8 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 			continue;
 
 		// mix voice
-		int *pOut = m_pMixBuffer;
-
-		const int Step = Voice.m_pSample->m_Channels; // setup input sources
-		short *pInL = &Voice.m_pSample->m_pData[Voice.m_Tick * Step];
-		short *pInR = &Voice.m_pSample->m_pData[Voice.m_Tick * Step + 1];
+		const int Channels = Voice.m_pSample->m_Channels;
+		const short *pSamples = &Voice.m_pSample->m_pData[Voice.m_Tick * Channels];
 
 		unsigned End = Voice.m_pSample->m_NumFrames - Voice.m_Tick;
 
@@ -55,10 +54,6 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 		if(Frames < End)
 			End = Frames;
 
-		// check if we have a mono sound
-		if(Voice.m_pSample->m_Channels == 1)
-			pInR = pInL;
-
 		// volume calculation
 		if(Voice.m_Flags & ISound::FLAG_POS && Voice.m_pChannel->m_Pan)
 		{
@@ -131,15 +126,10 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 			}
 		}
 
-		// process all frames
-		for(unsigned s = 0; s < End; s++)
-		{
-			*pOut++ += (*pInL) * VolumeL;
-			*pOut++ += (*pInR) * VolumeR;
-			pInL += Step;
-			pInR += Step;
-			Voice.m_Tick++;
-		}
+		// process all frames, inaudible voices only advance
+		if(VolumeL || VolumeR)
+			MixVoice(m_pMixBuffer, pSamples, Channels, End, VolumeL, VolumeR);
+		Voice.m_Tick += End;
 
 		// free voice if not used any more
 		if(Voice.m_Tick == Voice.m_pSample->m_NumFrames)
@@ -157,8 +147,7 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 	m_SoundLock.unlock();
 
 	// clamp accumulated values
-	for(unsigned i = 0; i < Frames * 2; i++)
-		pFinalOut[i] = std::clamp<int>(((m_pMixBuffer[i] * MasterVol) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+	ClampMix(pFinalOut, m_pMixBuffer, Frames * 2, MasterVol);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(pFinalOut, sizeof(short), Frames * 2);
@@ -636,6 +625,7 @@ void CSound::UnloadSample(int SampleId)
 
 	dbg_assert(SampleId >= 0 && SampleId < NUM_SAMPLES, "SampleId invalid");
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample &Sample = m_aSamples[SampleId];
 
 	if(Sample.IsLoaded())
@@ -676,6 +666,7 @@ float CSound::GetSampleCurrentTime(int SampleId)
 	dbg_assert(SampleId >= 0 && SampleId < NUM_SAMPLES, "SampleId invalid");
 
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	CSample *pSample = &m_aSamples[SampleId];
 	for(auto &Voice : m_aVoices)
@@ -694,6 +685,7 @@ void CSound::SetSampleCurrentTime(int SampleId, float Time)
 	dbg_assert(SampleId >= 0 && SampleId < NUM_SAMPLES, "SampleId invalid");
 
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	CSample *pSample = &m_aSamples[SampleId];
 	for(auto &Voice : m_aVoices)
@@ -723,82 +715,116 @@ void CSound::SetListenerPosition(vec2 Position)
 	m_ListenerPositionY.store(Position.y, std::memory_order_relaxed);
 }
 
-void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
+void CSound::PostVoiceCommand(const CVoiceCommand &Command)
 {
-	if(!Voice.IsValid())
+	if(m_VoiceCommands.TryPush(Command))
 		return;
 
-	int VoiceId = Voice.Id();
-
+	// the mixer is behind, catch up here
 	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
+	ProcessVoiceCommands();
+	ApplyVoiceCommand(Command);
+}
 
-	Volume = std::clamp(Volume, 0.0f, 1.0f);
-	m_aVoices[VoiceId].m_Vol = (int)(Volume * 255.0f);
+void CSound::ProcessVoiceCommands()
+{
+	CVoiceCommand Command;
+	while(m_VoiceCommands.TryPop(&Command))
+		ApplyVoiceCommand(Command);
 }
 
-void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
+void CSound::ApplyVoiceCommand(const CVoiceCommand &Command)
 {
-	if(!Voice.IsValid())
+	CVoice &Voice = m_aVoices[Command.m_VoiceId];
+	if(Voice.m_Age != Command.m_Age)
 		return;
 
-	int VoiceId = Voice.Id();
+	switch(Command.m_Type)
+	{
+	case CVoiceCommand::SET_VOLUME:
+		Voice.m_Vol = (int)(Command.m_aArgs[0] * 255.0f);
+		break;
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
+	case CVoiceCommand::SET_FALLOFF:
+		Voice.m_Falloff = Command.m_aArgs[0];
+		break;
 
-	Falloff = std::clamp(Falloff, 0.0f, 1.0f);
-	m_aVoices[VoiceId].m_Falloff = Falloff;
+	case CVoiceCommand::SET_POSITION:
+		Voice.m_Position = vec2(Command.m_aArgs[0], Command.m_aArgs[1]);
+		break;
+
+	case CVoiceCommand::SET_TIME_OFFSET:
+	{
+		if(!Voice.m_pSample)
+			return;
+
+		int Tick = 0;
+		bool IsLooping = Voice.m_Flags & ISound::FLAG_LOOP;
+		uint64_t TickOffset = Voice.m_pSample->m_Rate * Command.m_aArgs[0];
+		if(Voice.m_pSample->m_NumFrames > 0 && IsLooping)
+			Tick = TickOffset % Voice.m_pSample->m_NumFrames;
+		else
+			Tick = std::clamp(TickOffset, (uint64_t)0, (uint64_t)Voice.m_pSample->m_NumFrames);
+
+		// at least 200msec off, else depend on buffer size
+		float Threshold = maximum(0.2f * Voice.m_pSample->m_Rate, (float)m_MaxFrames);
+		if(absolute(Voice.m_Tick - Tick) > Threshold)
+		{
+			// take care of looping (modulo!)
+			if(!(IsLooping && (minimum(Voice.m_Tick, Tick) + Voice.m_pSample->m_NumFrames - maximum(Voice.m_Tick, Tick)) <= Threshold))
+			{
+				Voice.m_Tick = Tick;
+			}
+		}
+		break;
+	}
+
+	case CVoiceCommand::SET_CIRCLE:
+		Voice.m_Shape = ISound::SHAPE_CIRCLE;
+		Voice.m_Circle.m_Radius = Command.m_aArgs[0];
+		break;
+
+	case CVoiceCommand::SET_RECTANGLE:
+		Voice.m_Shape = ISound::SHAPE_RECTANGLE;
+		Voice.m_Rectangle.m_Width = Command.m_aArgs[0];
+		Voice.m_Rectangle.m_Height = Command.m_aArgs[1];
+		break;
+
+	default:
+		dbg_assert(false, "unknown voice command");
+	}
 }
 
-void CSound::SetVoicePosition(CVoiceHandle Voice, vec2 Position)
+void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
 {
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceId = Voice.Id();
+	PostVoiceCommand({CVoiceCommand::SET_VOLUME, Voice.Id(), Voice.Age(), {std::clamp(Volume, 0.0f, 1.0f)}});
+}
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
+void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
+{
+	if(!Voice.IsValid())
 		return;
 
-	m_aVoices[VoiceId].m_Position = Position;
+	PostVoiceCommand({CVoiceCommand::SET_FALLOFF, Voice.Id(), Voice.Age(), {std::clamp(Falloff, 0.0f, 1.0f)}});
 }
 
-void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
+void CSound::SetVoicePosition(CVoiceHandle Voice, vec2 Position)
 {
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceId = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
+	PostVoiceCommand({CVoiceCommand::SET_POSITION, Voice.Id(), Voice.Age(), {Position.x, Position.y}});
+}
 
-	if(!m_aVoices[VoiceId].m_pSample)
+void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
+{
+	if(!Voice.IsValid())
 		return;
 
-	int Tick = 0;
-	bool IsLooping = m_aVoices[VoiceId].m_Flags & ISound::FLAG_LOOP;
-	uint64_t TickOffset = m_aVoices[VoiceId].m_pSample->m_Rate * TimeOffset;
-	if(m_aVoices[VoiceId].m_pSample->m_NumFrames > 0 && IsLooping)
-		Tick = TickOffset % m_aVoices[VoiceId].m_pSample->m_NumFrames;
-	else
-		Tick = std::clamp(TickOffset, (uint64_t)0, (uint64_t)m_aVoices[VoiceId].m_pSample->m_NumFrames);
-
-	// at least 200msec off, else depend on buffer size
-	float Threshold = maximum(0.2f * m_aVoices[VoiceId].m_pSample->m_Rate, (float)m_MaxFrames);
-	if(absolute(m_aVoices[VoiceId].m_Tick - Tick) > Threshold)
-	{
-		// take care of looping (modulo!)
-		if(!(IsLooping && (minimum(m_aVoices[VoiceId].m_Tick, Tick) + m_aVoices[VoiceId].m_pSample->m_NumFrames - maximum(m_aVoices[VoiceId].m_Tick, Tick)) <= Threshold))
-		{
-			m_aVoices[VoiceId].m_Tick = Tick;
-		}
-	}
+	PostVoiceCommand({CVoiceCommand::SET_TIME_OFFSET, Voice.Id(), Voice.Age(), {TimeOffset}});
 }
 
 void CSound::SetVoiceCircle(CVoiceHandle Voice, float Radius)
@@ -806,14 +832,7 @@ void CSound::SetVoiceCircle(CVoiceHandle Voice, float Radius)
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceId = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
-
-	m_aVoices[VoiceId].m_Shape = ISound::SHAPE_CIRCLE;
-	m_aVoices[VoiceId].m_Circle.m_Radius = maximum(0.0f, Radius);
+	PostVoiceCommand({CVoiceCommand::SET_CIRCLE, Voice.Id(), Voice.Age(), {maximum(0.0f, Radius)}});
 }
 
 void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
@@ -821,20 +840,13 @@ void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceId = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
-
-	m_aVoices[VoiceId].m_Shape = ISound::SHAPE_RECTANGLE;
-	m_aVoices[VoiceId].m_Rectangle.m_Width = maximum(0.0f, Width);
-	m_aVoices[VoiceId].m_Rectangle.m_Height = maximum(0.0f, Height);
+	PostVoiceCommand({CVoiceCommand::SET_RECTANGLE, Voice.Id(), Voice.Age(), {maximum(0.0f, Width), maximum(0.0f, Height)}});
 }
 
 ISound::CVoiceHandle CSound::Play(int ChannelId, int SampleId, int Flags, float Volume, vec2 Position)
 {
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 
 	// search for voice
 	int VoiceId = -1;
@@ -894,6 +906,7 @@ void CSound::Pause(int SampleId)
 
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample *pSample = &m_aSamples[SampleId];
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	for(auto &Voice : m_aVoices)
@@ -912,6 +925,7 @@ void CSound::Stop(int SampleId)
 
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample *pSample = &m_aSamples[SampleId];
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	for(auto &Voice : m_aVoices)
@@ -931,6 +945,7 @@ void CSound::StopAll()
 {
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	for(auto &Voice : m_aVoices)
 	{
 		if(Voice.m_pSample)
@@ -952,6 +967,7 @@ void CSound::StopVoice(CVoiceHandle Voice)
 	int VoiceId = Voice.Id();
 
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	if(m_aVoices[VoiceId].m_Age != Voice.Age())
 		return;
 
@@ -963,6 +979,7 @@ bool CSound::IsPlaying(int SampleId)
 {
 	dbg_assert(SampleId >= 0 && SampleId < NUM_SAMPLES, "SampleId invalid");
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	const CSample *pSample = &m_aSamples[SampleId];
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	return std::any_of(std::begin(m_aVoices), std::end(m_aVoices), [pSample](const auto &Voice) { return Voice.m_pSample == pSample; });
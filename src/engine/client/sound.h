@@ -4,6 +4,7 @@
 #define ENGINE_CLIENT_SOUND_H
 
 #include <base/lock.h>
+#include <base/tl/threading.h>
 
 #include <engine/sound.h>
 
@@ -60,6 +61,25 @@ struct CVoice
 	};
 };
 
+// a voice update of the game thread, applied when the voices are locked next
+struct CVoiceCommand
+{
+	enum
+	{
+		SET_VOLUME,
+		SET_FALLOFF,
+		SET_POSITION,
+		SET_TIME_OFFSET,
+		SET_CIRCLE,
+		SET_RECTANGLE,
+	};
+
+	int m_Type;
+	int m_VoiceId;
+	int m_Age;
+	float m_aArgs[2];
+};
+
 class CSound : public IEngineSound
 {
 	enum
@@ -67,6 +87,7 @@ class CSound : public IEngineSound
 		NUM_SAMPLES = 512,
 		NUM_VOICES = 256,
 		NUM_CHANNELS = 16,
+		NUM_VOICE_COMMANDS = 1024,
 	};
 
 	bool m_SoundEnabled = false;
@@ -79,6 +100,8 @@ class CSound : public IEngineSound
 	CVoice m_aVoices[NUM_VOICES] GUARDED_BY(m_SoundLock) = {{nullptr}};
 	CChannel m_aChannels[NUM_CHANNELS] GUARDED_BY(m_SoundLock) = {{255, 0}};
 	int m_NextVoice GUARDED_BY(m_SoundLock) = 0;
+	// posted by the voice setters without the lock, only popped with it
+	CSpscQueue<CVoiceCommand, NUM_VOICE_COMMANDS> m_VoiceCommands;
 	uint32_t m_MaxFrames = 0;
 
 	// This is not an std::atomic<vec2> as this would require linking with
@@ -101,6 +124,10 @@ class CSound : public IEngineSound
 
 	void UpdateVolume();
 
+	void PostVoiceCommand(const CVoiceCommand &Command) REQUIRES(!m_SoundLock);
+	void ProcessVoiceCommands() REQUIRES(m_SoundLock);
+	void ApplyVoiceCommand(const CVoiceCommand &Command) REQUIRES(m_SoundLock);
+
 public:
 	int Init() override REQUIRES(!m_SoundLock);
 	int Update() override;
@@ -20,6 +20,7 @@
 #include <generated/protocolglue.h>
 
 struct CAntibotRoundData;
+class CSnapshotItemBuffer;
 
 // When recording a demo on the server, the ClientId -1 is used
 enum
@@ -244,6 +245,17 @@ public:
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
+	/**
+	 * Redirects SnapNewItem into the given buffer instead of the snapshot
+	 * that is currently being built, until called with `nullptr`.
+	 */
+	virtual void SnapSetCapture(CSnapshotItemBuffer *pBuffer) = 0;
+	/**
+	 * Adds the captured items [First, First + Num) of the buffer to the
+	 * snapshot that is currently being built.
+	 */
+	virtual void SnapAddCaptured(const CSnapshotItemBuffer *pBuffer, int First, int Num) = 0;
+
 	enum
 	{
 		RCON_CID_SERV = -1,
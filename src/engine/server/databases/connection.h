@@ -4,7 +4,11 @@
 #include "connection_pool.h"
 
 #include <engine/shared/protocol.h>
+
+#include <list>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 enum
 {
@@ -14,7 +18,71 @@ enum
 
 class IConsole;
 
-// can hold one PreparedStatement with Results
+// Prepared statements of one connection by their SQL text. When there are
+// more than `Capacity` statements, the least recently used ones are dropped.
+// The most recently used statement is always kept, because it is the one
+// the connection currently works with.
+template<typename TStmt, typename TDeleter>
+class CStatementCache
+{
+public:
+	using CStmtPtr = std::unique_ptr<TStmt, TDeleter>;
+
+	explicit CStatementCache(int Capacity) :
+		m_Capacity(Capacity) {}
+
+	// returns nullptr if the statement is not cached, otherwise marks it as
+	// the most recently used one
+	TStmt *Find(const char *pSql)
+	{
+		auto It = m_Index.find(pSql);
+		if(It == m_Index.end())
+			return nullptr;
+		m_Statements.splice(m_Statements.begin(), m_Statements, It->second);
+		return It->second->second.get();
+	}
+
+	TStmt *Add(const char *pSql, CStmtPtr pStmt)
+	{
+		m_Statements.emplace_front(pSql, std::move(pStmt));
+		m_Index[m_Statements.front().first] = m_Statements.begin();
+		while((int)m_Statements.size() > 1 && (int)m_Statements.size() > m_Capacity)
+		{
+			m_Index.erase(m_Statements.back().first);
+			m_Statements.pop_back();
+		}
+		return m_Statements.front().second.get();
+	}
+
+	void Remove(const TStmt *pStmt)
+	{
+		for(auto It = m_Statements.begin(); It != m_Statements.end(); ++It)
+		{
+			if(It->second.get() == pStmt)
+			{
+				m_Index.erase(It->first);
+				m_Statements.erase(It);
+				return;
+			}
+		}
+	}
+
+	void Clear()
+	{
+		m_Index.clear();
+		m_Statements.clear();
+	}
+
+	int Size() const { return m_Statements.size(); }
+
+private:
+	int m_Capacity;
+	std::list<std::pair<std::string, CStmtPtr>> m_Statements;
+	std::unordered_map<std::string, typename std::list<std::pair<std::string, CStmtPtr>>::iterator> m_Index;
+};
+
+// can hold one PreparedStatement with Results, previously prepared
+// statements are kept in a cache and reused when the same SQL is prepared again
 class IDbConnection
 {
 public:
@@ -42,6 +110,8 @@ public:
 	virtual const char *MedianMapTime(char *pBuffer, int BufferSize) const = 0;
 	virtual const char *False() const = 0;
 	virtual const char *True() const = 0;
+	// starts a transaction that is going to write
+	virtual const char *BeginTransaction() const = 0;
 
 	// tries to allocate the connection from the pool established
 	//
@@ -51,6 +121,7 @@ public:
 	virtual void Disconnect() = 0;
 
 	// ? for Placeholders, connection has to be established, can overwrite previous prepared statements
+	// and resets the statement if it was prepared before
 	//
 	// returns true on success
 	virtual bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize) = 0;
@@ -66,6 +137,12 @@ public:
 	// Print expanded sql statement
 	virtual void Print() = 0;
 
+	// executes a statement without parameters or results, for the
+	// transaction and savepoint statements that can't be prepared
+	//
+	// returns true on success
+	virtual bool Execute(const char *pQuery, char *pError, int ErrorSize) = 0;
+
 	// executes the query and returns if a result row exists and selects it
 	// when called multiple times the next row is selected
 	//
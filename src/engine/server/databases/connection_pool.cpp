@@ -6,6 +6,7 @@
 #include <cstring>
 #include <engine/console.h>
 
+#include <algorithm>
 #include <chrono>
 #include <iterator>
 #include <memory>
@@ -65,6 +66,7 @@ struct CSqlExecData
 
 	std::unique_ptr<const ISqlData> m_pThreadData;
 	const char *m_pName;
+	std::chrono::nanoseconds m_QueuedAt;
 };
 
 CSqlExecData::CSqlExecData(
@@ -73,7 +75,8 @@ CSqlExecData::CSqlExecData(
 	const char *pName) :
 	m_Mode(READ_ACCESS),
 	m_pThreadData(std::move(pThreadData)),
-	m_pName(pName)
+	m_pName(pName),
+	m_QueuedAt(time_get_nanoseconds())
 {
 	m_Ptr.m_pReadFunc = pFunc;
 }
@@ -84,7 +87,8 @@ CSqlExecData::CSqlExecData(
 	const char *pName) :
 	m_Mode(WRITE_ACCESS),
 	m_pThreadData(std::move(pThreadData)),
-	m_pName(pName)
+	m_pName(pName),
+	m_QueuedAt(time_get_nanoseconds())
 {
 	m_Ptr.m_pWriteFunc = pFunc;
 }
@@ -94,7 +98,8 @@ CSqlExecData::CSqlExecData(
 	const char aFileName[64]) :
 	m_Mode(ADD_SQLITE),
 	m_pThreadData(nullptr),
-	m_pName("add sqlite server")
+	m_pName("add sqlite server"),
+	m_QueuedAt(time_get_nanoseconds())
 {
 	m_Ptr.m_Sqlite.m_Mode = m;
 	str_copy(m_Ptr.m_Sqlite.m_FileName, aFileName);
@@ -103,7 +108,8 @@ CSqlExecData::CSqlExecData(CDbConnectionPool::Mode m,
 	const CMysqlConfig *pMysqlConfig) :
 	m_Mode(ADD_MYSQL),
 	m_pThreadData(nullptr),
-	m_pName("add mysql server")
+	m_pName("add mysql server"),
+	m_QueuedAt(time_get_nanoseconds())
 {
 	m_Ptr.m_Mysql.m_Mode = m;
 	mem_copy(&m_Ptr.m_Mysql.m_Config, pMysqlConfig, sizeof(m_Ptr.m_Mysql.m_Config));
@@ -112,21 +118,103 @@ CSqlExecData::CSqlExecData(CDbConnectionPool::Mode m,
 CSqlExecData::CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m) :
 	m_Mode(PRINT),
 	m_pThreadData(nullptr),
-	m_pName("print database server")
+	m_pName("print database server"),
+	m_QueuedAt(time_get_nanoseconds())
 {
 	m_Ptr.m_Print.m_pConsole = pConsole;
 	m_Ptr.m_Print.m_Mode = m;
 }
 
+void CDbConnectionPool::CSharedData::CLatencies::Add(std::chrono::nanoseconds Latency)
+{
+	const int64_t Milliseconds = Latency / 1ms;
+	int Bucket = 0;
+	while(Bucket < NUM_BUCKETS - 1 && (int64_t{1} << Bucket) <= Milliseconds)
+		Bucket++;
+	m_aBuckets[Bucket]++;
+	m_Count++;
+	m_Total += Latency;
+	m_Max = std::max(m_Max, Latency);
+}
+
+void CDbConnectionPool::CSharedData::CBatchSizes::Add(int Size)
+{
+	m_NumBatches++;
+	m_NumWrites += Size;
+	m_Max = std::max(m_Max, Size);
+}
+
 void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
 {
+	if(DatabaseMode == Mode::READ)
+	{
+		StartReadWorkers();
+		if(!m_vpReadWorkerThreads.empty())
+		{
+			AddReadQuery(std::make_unique<CSqlExecData>(pConsole, DatabaseMode));
+			return;
+		}
+	}
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pConsole, DatabaseMode);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
 }
 
+void CDbConnectionPool::PrintLatencies(IConsole *pConsole)
+{
+	const CLockScope LockScope(m_pShared->m_LatencyLock);
+	if(m_pShared->m_Latencies.empty())
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "No queries completed yet");
+		return;
+	}
+	for(const auto &[Name, Latencies] : m_pShared->m_Latencies)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf), "%s: %d queries, avg %.2fms, max %.2fms |",
+			Name.c_str(), Latencies.m_Count,
+			std::chrono::duration<double, std::milli>(Latencies.m_Total).count() / Latencies.m_Count,
+			std::chrono::duration<double, std::milli>(Latencies.m_Max).count());
+		for(int i = 0; i < CSharedData::CLatencies::NUM_BUCKETS; i++)
+		{
+			if(Latencies.m_aBuckets[i] == 0)
+				continue;
+			char aBucket[32];
+			if(i < CSharedData::CLatencies::NUM_BUCKETS - 1)
+				str_format(aBucket, sizeof(aBucket), " <%dms: %d", 1 << i, Latencies.m_aBuckets[i]);
+			else
+				str_format(aBucket, sizeof(aBucket), " >=%dms: %d", 1 << (i - 1), Latencies.m_aBuckets[i]);
+			str_append(aBuf, aBucket);
+		}
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+	for(Mode DatabaseMode : {Mode::WRITE, Mode::WRITE_BACKUP})
+	{
+		const CSharedData::CBatchSizes &BatchSizes = m_pShared->m_aBatchSizes[DatabaseMode];
+		if(BatchSizes.m_NumBatches == 0)
+			continue;
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%s transactions: %d with %d writes, avg %.2f writes, max %d writes",
+			DatabaseMode == Mode::WRITE ? "write" : "write backup",
+			BatchSizes.m_NumBatches, BatchSizes.m_NumWrites,
+			(float)BatchSizes.m_NumWrites / BatchSizes.m_NumBatches, BatchSizes.m_Max);
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+}
+
+int CDbConnectionPool::MaxWriteBatch(Mode DatabaseMode) const
+{
+	const CLockScope LockScope(m_pShared->m_LatencyLock);
+	return m_pShared->m_aBatchSizes[DatabaseMode].m_Max;
+}
+
 void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFileName[64])
 {
+	if(DatabaseMode == Mode::READ)
+	{
+		const CLockScope LockScope(m_pShared->m_ReadLock);
+		m_pShared->m_vpReadServers.push_back(std::make_unique<CSqlExecData>(DatabaseMode, aFileName));
+	}
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, aFileName);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
@@ -134,6 +222,11 @@ void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFi
 
 void CDbConnectionPool::RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig)
 {
+	if(DatabaseMode == Mode::READ)
+	{
+		const CLockScope LockScope(m_pShared->m_ReadLock);
+		m_pShared->m_vpReadServers.push_back(std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig));
+	}
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
@@ -144,11 +237,26 @@ void CDbConnectionPool::Execute(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
+	StartReadWorkers();
+	if(!m_vpReadWorkerThreads.empty())
+	{
+		AddReadQuery(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
+		return;
+	}
 	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
 }
 
+void CDbConnectionPool::AddReadQuery(std::unique_ptr<CSqlExecData> pQuery)
+{
+	{
+		const CLockScope LockScope(m_pShared->m_ReadLock);
+		m_pShared->m_ReadQueries.push_back(std::move(pQuery));
+	}
+	m_pShared->m_NumRead.Signal();
+}
+
 void CDbConnectionPool::ExecuteWrite(
 	FWrite pFunc,
 	std::unique_ptr<const ISqlData> pSqlRequestData,
@@ -166,6 +274,9 @@ void CDbConnectionPool::OnShutdown()
 	m_Shutdown = true;
 	m_pShared->m_Shutdown.store(true);
 	m_pShared->m_NumBackup.Signal();
+	// the read workers dismiss the remaining read queries and stop
+	for(size_t i = 0; i < m_vpReadWorkerThreads.size(); i++)
+		AddReadQuery(nullptr);
 	int i = 0;
 	while(m_pShared->m_Shutdown.load())
 	{
@@ -230,9 +341,32 @@ void CBackup::ProcessQueries()
 		}
 		else if(pThreadData->m_Mode == CSqlExecData::WRITE_ACCESS && m_pWriteBackup.get())
 		{
-			bool Success = CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, Write::BACKUP_FIRST);
-			if(m_DebugSql || !Success)
-				dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", JobNum, pThreadData->m_pName, Success);
+			// the writes that are already queued behind this one go into the same transaction
+			const int FirstJobNum = JobNum;
+			std::vector<CSqlExecData *> vpBatch = {pThreadData};
+			while((int)vpBatch.size() < g_Config.m_SvSqlWriteBatch && m_pShared->m_NumBackup.GetApproximateValue() > 0)
+			{
+				CSqlExecData *pNext = m_pShared->m_aQueries[(JobNum + 1) % std::size(m_pShared->m_aQueries)].get();
+				if(pNext == nullptr || pNext->m_Mode != CSqlExecData::WRITE_ACCESS)
+					break;
+				m_pShared->m_NumBackup.Wait();
+				vpBatch.push_back(pNext);
+				JobNum++;
+			}
+			std::vector<bool> vSuccess;
+			CDbConnectionPool::ExecWriteBatch(m_pWriteBackup.get(), vpBatch, Write::BACKUP_FIRST, vSuccess);
+			for(size_t i = 0; i < vpBatch.size(); i++)
+			{
+				if(m_DebugSql || !vSuccess[i])
+					dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", FirstJobNum + (int)i, vpBatch[i]->m_pName, (int)vSuccess[i]);
+			}
+			{
+				const CLockScope LockScope(m_pShared->m_LatencyLock);
+				m_pShared->m_aBatchSizes[CDbConnectionPool::Mode::WRITE_BACKUP].Add(vpBatch.size());
+			}
+			// the worker may only move the writes once they are committed to the backup database
+			for(size_t i = 1; i < vpBatch.size(); i++)
+				m_pShared->m_NumWorker.Signal();
 		}
 		m_pShared->m_NumWorker.Signal();
 	}
@@ -252,6 +386,8 @@ public:
 
 private:
 	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
+	// executes the write and the ones already queued behind it in one transaction
+	void ProcessWrites(std::unique_ptr<CSqlExecData> pFirst, int *pJobNum, bool *pFailMode);
 
 	bool m_DebugSql;
 
@@ -304,28 +440,7 @@ void CWorker::ProcessQueries()
 		{
 		case CSqlExecData::READ_ACCESS:
 		{
-			for(size_t i = 0; i < m_vpReadConnections.size(); i++)
-			{
-				if(m_pShared->m_Shutdown)
-				{
-					dbg_msg("sql", "[%i] %s dismissed read request during shutdown", JobNum, pThreadData->m_pName);
-					break;
-				}
-				if(FailMode)
-				{
-					dbg_msg("sql", "[%i] %s dismissed read request during FailMode", JobNum, pThreadData->m_pName);
-					break;
-				}
-				int CurServer = (ReadServer + i) % (int)m_vpReadConnections.size();
-				if(CDbConnectionPool::ExecSqlFunc(m_vpReadConnections[CurServer].get(), pThreadData.get(), Write::NORMAL))
-				{
-					ReadServer = CurServer;
-					if(m_DebugSql)
-						dbg_msg("sql", "[%i] %s done on read database %d", JobNum, pThreadData->m_pName, CurServer);
-					Success = true;
-					break;
-				}
-			}
+			Success = CDbConnectionPool::ExecReadFunc(m_pShared.get(), m_vpReadConnections, &ReadServer, FailMode, pThreadData.get(), JobNum, m_DebugSql);
 			if(!Success)
 			{
 				FailMode = true;
@@ -333,32 +448,9 @@ void CWorker::ProcessQueries()
 		}
 		break;
 		case CSqlExecData::WRITE_ACCESS:
-		{
-			if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
-			}
-			else if(FailMode && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
-			}
-			else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData.get(), Write::NORMAL))
-			{
-				if(m_DebugSql)
-					dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
-				Success = true;
-			}
-			// enter fail mode if not successful
-			FailMode = FailMode || !Success;
-			const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
-			if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData.get(), w))
-			{
-				if(m_DebugSql)
-					dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
-				Success = true;
-			}
-		}
-		break;
+			// completes the writes itself, because the following ones are grouped with it
+			ProcessWrites(std::move(pThreadData), &JobNum, &FailMode);
+			continue;
 		case CSqlExecData::ADD_MYSQL:
 		{
 			auto pMysql = CreateMysqlConnection(pThreadData->m_Ptr.m_Mysql.m_Config);
@@ -406,12 +498,89 @@ void CWorker::ProcessQueries()
 		}
 		if(!Success)
 			dbg_msg("sql", "[%i] %s failed on all databases", JobNum, pThreadData->m_pName);
-		if(pThreadData->m_pThreadData != nullptr && pThreadData->m_pThreadData->m_pResult != nullptr)
+		CDbConnectionPool::Complete(m_pShared.get(), pThreadData.get(), Success);
+	}
+}
+
+void CWorker::ProcessWrites(std::unique_ptr<CSqlExecData> pFirst, int *pJobNum, bool *pFailMode)
+{
+	const int FirstJobNum = *pJobNum;
+	std::vector<std::unique_ptr<CSqlExecData>> vpBatch;
+	std::vector<CSqlExecData *> vpWrites;
+	vpWrites.push_back(pFirst.get());
+	vpBatch.push_back(std::move(pFirst));
+	while((int)vpBatch.size() < g_Config.m_SvSqlWriteBatch && m_pShared->m_NumWorker.GetApproximateValue() > 0)
+	{
+		std::unique_ptr<CSqlExecData> &pNext = m_pShared->m_aQueries[(*pJobNum + 1) % std::size(m_pShared->m_aQueries)];
+		if(pNext == nullptr || pNext->m_Mode != CSqlExecData::WRITE_ACCESS)
+			break;
+		m_pShared->m_NumWorker.Wait();
+		vpWrites.push_back(pNext.get());
+		vpBatch.push_back(std::move(pNext));
+		(*pJobNum)++;
+	}
+
+	std::vector<bool> vSuccess(vpBatch.size(), false);
+	if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
+	{
+		dbg_msg("sql", "[%i] %d writes skipped to backup database during shutdown", FirstJobNum, (int)vpBatch.size());
+	}
+	else if(*pFailMode && m_pWriteBackup != nullptr)
+	{
+		dbg_msg("sql", "[%i] %d writes skipped to backup database during FailMode", FirstJobNum, (int)vpBatch.size());
+	}
+	else
+	{
+		CDbConnectionPool::ExecWriteBatch(m_pWriteConnection.get(), vpWrites, Write::NORMAL, vSuccess);
+		{
+			const CLockScope LockScope(m_pShared->m_LatencyLock);
+			m_pShared->m_aBatchSizes[CDbConnectionPool::Mode::WRITE].Add(vpBatch.size());
+		}
+		for(size_t i = 0; i < vpBatch.size(); i++)
 		{
-			pThreadData->m_pThreadData->m_pResult->m_Success = Success;
-			pThreadData->m_pThreadData->m_pResult->m_Completed.store(true);
+			if(m_DebugSql && vSuccess[i])
+				dbg_msg("sql", "[%i] %s done on write database", FirstJobNum + (int)i, vpBatch[i]->m_pName);
+		}
+	}
+	// enter fail mode if not successful
+	*pFailMode = *pFailMode || std::find(vSuccess.begin(), vSuccess.end(), false) != vSuccess.end();
+
+	if(m_pWriteBackup)
+	{
+		const std::vector<bool> vWritten = vSuccess;
+		for(const Write w : {Write::NORMAL_SUCCEEDED, Write::NORMAL_FAILED})
+		{
+			std::vector<CSqlExecData *> vpMoves;
+			std::vector<size_t> vIndices;
+			for(size_t i = 0; i < vpBatch.size(); i++)
+			{
+				if(vWritten[i] == (w == Write::NORMAL_SUCCEEDED))
+				{
+					vpMoves.push_back(vpBatch[i].get());
+					vIndices.push_back(i);
+				}
+			}
+			if(vpMoves.empty())
+				continue;
+			std::vector<bool> vMoved;
+			CDbConnectionPool::ExecWriteBatch(m_pWriteBackup.get(), vpMoves, w, vMoved);
+			for(size_t i = 0; i < vpMoves.size(); i++)
+			{
+				if(!vMoved[i])
+					continue;
+				if(m_DebugSql)
+					dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", FirstJobNum + (int)vIndices[i], vpMoves[i]->m_pName);
+				vSuccess[vIndices[i]] = true;
+			}
 		}
 	}
+
+	for(size_t i = 0; i < vpBatch.size(); i++)
+	{
+		if(!vSuccess[i])
+			dbg_msg("sql", "[%i] %s failed on all databases", FirstJobNum + (int)i, vpBatch[i]->m_pName);
+		CDbConnectionPool::Complete(m_pShared.get(), vpBatch[i].get(), vSuccess[i]);
+	}
 }
 
 void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
@@ -439,6 +608,137 @@ void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
 	}
 }
 
+static std::unique_ptr<IDbConnection> CreateConnection(const CSqlExecData *pServer)
+{
+	if(pServer->m_Mode == CSqlExecData::ADD_MYSQL)
+		return CreateMysqlConnection(pServer->m_Ptr.m_Mysql.m_Config);
+	return CreateSqliteConnection(pServer->m_Ptr.m_Sqlite.m_FileName, true);
+}
+
+// The read workers execute the read queries in parallel to the writes. Each
+// of them has its own connections, so that queries don't wait for each other.
+class CReadWorker
+{
+public:
+	CReadWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared, int DebugSql) :
+		m_DebugSql(DebugSql), m_pShared(std::move(pShared)) {}
+	static void Start(void *pUser);
+	void ProcessQueries();
+
+private:
+	void Print(IConsole *pConsole);
+
+	bool m_DebugSql;
+
+	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
+
+	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
+};
+
+/* static */
+void CReadWorker::Start(void *pUser)
+{
+	CReadWorker *pThis = (CReadWorker *)pUser;
+	pThis->ProcessQueries();
+	delete pThis;
+}
+
+void CReadWorker::ProcessQueries()
+{
+	// remember last working server and try to connect to it first
+	int ReadServer = 0;
+	// enter fail mode when a sql request fails, skip read requests until
+	// the queue is empty
+	bool FailMode = false;
+	for(int JobNum = 0;; JobNum++)
+	{
+		if(FailMode && m_pShared->m_NumRead.GetApproximateValue() == 0)
+		{
+			FailMode = false;
+		}
+		m_pShared->m_NumRead.Wait();
+		std::unique_ptr<CSqlExecData> pThreadData;
+		{
+			const CLockScope LockScope(m_pShared->m_ReadLock);
+			pThreadData = std::move(m_pShared->m_ReadQueries.front());
+			m_pShared->m_ReadQueries.pop_front();
+			// servers that were added since the last query
+			for(size_t i = m_vpReadConnections.size(); i < m_pShared->m_vpReadServers.size(); i++)
+				m_vpReadConnections.push_back(CreateConnection(m_pShared->m_vpReadServers[i].get()));
+		}
+		if(pThreadData == nullptr)
+		{
+			return;
+		}
+		bool Success = true;
+		if(pThreadData->m_Mode == CSqlExecData::PRINT)
+		{
+			Print(pThreadData->m_Ptr.m_Print.m_pConsole);
+		}
+		else
+		{
+			Success = CDbConnectionPool::ExecReadFunc(m_pShared.get(), m_vpReadConnections, &ReadServer, FailMode, pThreadData.get(), JobNum, m_DebugSql);
+			if(!Success)
+			{
+				FailMode = true;
+				dbg_msg("sql", "[%i] %s failed on all databases", JobNum, pThreadData->m_pName);
+			}
+		}
+		CDbConnectionPool::Complete(m_pShared.get(), pThreadData.get(), Success);
+	}
+}
+
+void CReadWorker::Print(IConsole *pConsole)
+{
+	for(auto &pReadConnection : m_vpReadConnections)
+		pReadConnection->Print(pConsole, "Read");
+	if(m_vpReadConnections.empty())
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+}
+
+/* static */
+bool CDbConnectionPool::ExecReadFunc(CSharedData *pShared, std::vector<std::unique_ptr<IDbConnection>> &vpReadConnections, int *pReadServer, bool FailMode, CSqlExecData *pData, int JobNum, bool DebugSql)
+{
+	for(size_t i = 0; i < vpReadConnections.size(); i++)
+	{
+		if(pShared->m_Shutdown)
+		{
+			dbg_msg("sql", "[%i] %s dismissed read request during shutdown", JobNum, pData->m_pName);
+			break;
+		}
+		if(FailMode)
+		{
+			dbg_msg("sql", "[%i] %s dismissed read request during FailMode", JobNum, pData->m_pName);
+			break;
+		}
+		int CurServer = (*pReadServer + i) % (int)vpReadConnections.size();
+		if(ExecSqlFunc(vpReadConnections[CurServer].get(), pData, Write::NORMAL))
+		{
+			*pReadServer = CurServer;
+			if(DebugSql)
+				dbg_msg("sql", "[%i] %s done on read database %d", JobNum, pData->m_pName, CurServer);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* static */
+void CDbConnectionPool::Complete(CSharedData *pShared, CSqlExecData *pData, bool Success)
+{
+	if(pData->m_Mode == CSqlExecData::READ_ACCESS || pData->m_Mode == CSqlExecData::WRITE_ACCESS)
+	{
+		const std::chrono::nanoseconds Latency = time_get_nanoseconds() - pData->m_QueuedAt;
+		const CLockScope LockScope(pShared->m_LatencyLock);
+		pShared->m_Latencies[pData->m_pName].Add(Latency);
+	}
+	if(pData->m_pThreadData != nullptr && pData->m_pThreadData->m_pResult != nullptr)
+	{
+		pData->m_pThreadData->m_pResult->m_Success = Success;
+		pData->m_pThreadData->m_pResult->m_Completed.store(true);
+	}
+}
+
 /* static */
 bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pData, Write w)
 {
@@ -473,6 +773,56 @@ bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pD
 	return Success;
 }
 
+/* static */
+void CDbConnectionPool::ExecWriteBatch(IDbConnection *pConnection, const std::vector<CSqlExecData *> &vpBatch, Write w, std::vector<bool> &vSuccess)
+{
+	vSuccess.assign(vpBatch.size(), false);
+	if(vpBatch.size() == 1)
+	{
+		vSuccess[0] = ExecSqlFunc(pConnection, vpBatch[0], w);
+		return;
+	}
+	if(pConnection == nullptr)
+	{
+		dbg_msg("sql", "No database given");
+		return;
+	}
+	char aError[256] = "unknown error";
+	if(!pConnection->Connect(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "failed connecting to db: %s", aError);
+		return;
+	}
+	bool Committed = pConnection->Execute(pConnection->BeginTransaction(), aError, sizeof(aError));
+	for(size_t i = 0; Committed && i < vpBatch.size(); i++)
+	{
+		CSqlExecData *pData = vpBatch[i];
+		dbg_assert(pData->m_Mode == CSqlExecData::WRITE_ACCESS, "only writes can be batched");
+		if(!pConnection->Execute("SAVEPOINT ddnet_batch_write", aError, sizeof(aError)))
+		{
+			Committed = false;
+			break;
+		}
+		vSuccess[i] = pData->m_Ptr.m_pWriteFunc(pConnection, pData->m_pThreadData.get(), w, aError, sizeof(aError));
+		if(!vSuccess[i])
+		{
+			dbg_msg("sql", "%s failed: %s", pData->m_pName, aError);
+			Committed = pConnection->Execute("ROLLBACK TO SAVEPOINT ddnet_batch_write", aError, sizeof(aError));
+		}
+		Committed = Committed && pConnection->Execute("RELEASE SAVEPOINT ddnet_batch_write", aError, sizeof(aError));
+	}
+	Committed = Committed && pConnection->Execute("COMMIT", aError, sizeof(aError));
+	if(!Committed)
+	{
+		dbg_msg("sql", "failed writing %d queries in one transaction: %s", (int)vpBatch.size(), aError);
+		char aRollbackError[256];
+		if(!pConnection->Execute("ROLLBACK", aRollbackError, sizeof(aRollbackError)))
+			dbg_msg("sql", "failed rolling back: %s", aRollbackError);
+		vSuccess.assign(vpBatch.size(), false);
+	}
+	pConnection->Disconnect();
+}
+
 CDbConnectionPool::CDbConnectionPool()
 {
 	m_pShared = std::make_shared<CSharedData>();
@@ -487,4 +837,15 @@ CDbConnectionPool::~CDbConnectionPool()
 		thread_wait(m_pWorkerThread);
 	if(m_pBackupThread)
 		thread_wait(m_pBackupThread);
+	for(void *pThread : m_vpReadWorkerThreads)
+		thread_wait(pThread);
+}
+
+void CDbConnectionPool::StartReadWorkers()
+{
+	if(m_ReadWorkersStarted || m_Shutdown)
+		return;
+	m_ReadWorkersStarted = true;
+	for(int i = 0; i < g_Config.m_SvSqlReadWorkers; i++)
+		m_vpReadWorkerThreads.push_back(thread_init(CReadWorker::Start, new CReadWorker(m_pShared, g_Config.m_DbgSql), "database read worker thread"));
 }
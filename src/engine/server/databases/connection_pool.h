@@ -2,8 +2,13 @@
 #define ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
 
 #include <atomic>
+#include <base/lock.h>
 #include <base/tl/threading.h>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 class IDbConnection;
@@ -77,6 +82,11 @@ public:
 	};
 
 	void Print(IConsole *pConsole, Mode DatabaseMode);
+	// prints how long the queries took from being queued to completion and
+	// how many writes were grouped into one transaction
+	void PrintLatencies(IConsole *pConsole);
+	// the largest number of writes committed in one transaction so far
+	int MaxWriteBatch(Mode DatabaseMode) const;
 
 	void RegisterSqliteDatabase(Mode DatabaseMode, const char FileName[64]);
 	void RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig);
@@ -96,9 +106,23 @@ public:
 
 	friend class CWorker;
 	friend class CBackup;
+	friend class CReadWorker;
 
 private:
 	static bool ExecSqlFunc(IDbConnection *pConnection, struct CSqlExecData *pData, Write w);
+	// executes the writes in one transaction with a savepoint for each, so
+	// that a failing write only undoes its own statements. All of them fail
+	// if the transaction can't be committed. Sets `vSuccess[i]` for `vpBatch[i]`.
+	// Only tested on SQLite, the MySQL path with `START TRANSACTION` and the
+	// savepoints was never run against a server.
+	static void ExecWriteBatch(IDbConnection *pConnection, const std::vector<struct CSqlExecData *> &vpBatch, Write w, std::vector<bool> &vSuccess);
+	struct CSharedData;
+	// tries the read servers starting with the last working one
+	static bool ExecReadFunc(CSharedData *pShared, std::vector<std::unique_ptr<IDbConnection>> &vpReadConnections, int *pReadServer, bool FailMode, struct CSqlExecData *pData, int JobNum, bool DebugSql);
+	static void Complete(CSharedData *pShared, struct CSqlExecData *pData, bool Success);
+
+	void StartReadWorkers();
+	void AddReadQuery(std::unique_ptr<struct CSqlExecData> pQuery);
 
 	// Only the main thread accesses this variable. It points to the index,
 	// where the next query is added to the queue.
@@ -123,11 +147,55 @@ private:
 
 		// spsc queue with additional backup worker to look at queries first.
 		std::unique_ptr<struct CSqlExecData> m_aQueries[512];
+
+		// Read queries don't need to be ordered with the writes, so they
+		// are taken from this queue by the read workers if there are any.
+		// A null query stops one read worker.
+		CLock m_ReadLock;
+		CSemaphore m_NumRead;
+		std::deque<std::unique_ptr<struct CSqlExecData>> m_ReadQueries GUARDED_BY(m_ReadLock);
+		// every read worker has its own connection to each of these servers
+		std::vector<std::unique_ptr<const struct CSqlExecData>> m_vpReadServers GUARDED_BY(m_ReadLock);
+
+		// latencies of the completed queries by their name, bucket `i`
+		// counts the queries that took less than `2^i` milliseconds, the
+		// last bucket the ones that took longer
+		class CLatencies
+		{
+		public:
+			enum
+			{
+				NUM_BUCKETS = 16,
+			};
+			int m_aBuckets[NUM_BUCKETS] = {};
+			int m_Count = 0;
+			std::chrono::nanoseconds m_Total{0};
+			std::chrono::nanoseconds m_Max{0};
+
+			void Add(std::chrono::nanoseconds Latency);
+		};
+		CLock m_LatencyLock;
+		std::map<std::string, CLatencies> m_Latencies GUARDED_BY(m_LatencyLock);
+
+		// number of writes per transaction on the WRITE and WRITE_BACKUP databases
+		class CBatchSizes
+		{
+		public:
+			int m_NumBatches = 0;
+			int m_NumWrites = 0;
+			int m_Max = 0;
+
+			void Add(int Size);
+		};
+		CBatchSizes m_aBatchSizes[NUM_MODES] GUARDED_BY(m_LatencyLock);
 	};
 
 	std::shared_ptr<CSharedData> m_pShared;
 	void *m_pWorkerThread = nullptr;
 	void *m_pBackupThread = nullptr;
+	// started with the first read query, so that the config is loaded
+	bool m_ReadWorkersStarted = false;
+	std::vector<void *> m_vpReadWorkerThreads;
 };
 
 #endif // ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
@@ -7,6 +7,7 @@
 
 #include <base/tl/threading.h>
 #include <engine/console.h>
+#include <engine/shared/config.h>
 
 #include <atomic>
 #include <memory>
@@ -78,6 +79,7 @@ public:
 	const char *MedianMapTime(char *pBuffer, int BufferSize) const override;
 	const char *False() const override { return "FALSE"; }
 	const char *True() const override { return "TRUE"; }
+	const char *BeginTransaction() const override { return "START TRANSACTION"; }
 
 	bool Connect(char *pError, int ErrorSize) override;
 	void Disconnect() override;
@@ -94,6 +96,7 @@ public:
 	void Print() override {}
 	bool Step(bool *pEnd, char *pError, int ErrorSize) override;
 	bool ExecuteUpdate(int *pNumUpdated, char *pError, int ErrorSize) override;
+	bool Execute(const char *pQuery, char *pError, int ErrorSize) override;
 
 	bool IsNull(int Col) override;
 	float GetFloat(int Col) override;
@@ -114,6 +117,10 @@ private:
 	char m_aErrorDetail[128];
 	void StoreErrorMysql(const char *pContext);
 	void StoreErrorStmt(const char *pContext);
+	void StoreErrorStmt(MYSQL_STMT *pStmt, const char *pContext);
+	// removes the current statement from the cache after it failed, it
+	// might have been invalidated by a reconnect
+	void DropStatement();
 	bool ConnectImpl();
 	bool PrepareAndExecuteStatement(const char *pStmt);
 	//static void DeleteResult(MYSQL_RES *pResult);
@@ -129,7 +136,11 @@ private:
 	bool m_NewQuery = false;
 	bool m_HaveConnection = false;
 	MYSQL m_Mysql;
-	std::unique_ptr<MYSQL_STMT, CStmtDeleter> m_pStmt = nullptr;
+	// statements are only valid on the connection they were prepared on
+	unsigned long m_ConnectionId = 0;
+	CStatementCache<MYSQL_STMT, CStmtDeleter> m_Statements;
+	// the statement from m_Statements that was prepared last
+	MYSQL_STMT *m_pStmt = nullptr;
 	std::vector<MYSQL_BIND> m_vStmtParameters;
 	std::vector<UParameterExtra> m_vStmtParameterExtras;
 
@@ -146,6 +157,7 @@ void CMysqlConnection::CStmtDeleter::operator()(MYSQL_STMT *pStmt) const
 
 CMysqlConnection::CMysqlConnection(CMysqlConfig Config) :
 	IDbConnection(Config.m_aPrefix),
+	m_Statements(g_Config.m_SvSqlStatementCache),
 	m_Config(Config),
 	m_InUse(false)
 {
@@ -159,6 +171,8 @@ CMysqlConnection::CMysqlConnection(CMysqlConfig Config) :
 
 CMysqlConnection::~CMysqlConnection()
 {
+	m_pStmt = nullptr;
+	m_Statements.Clear();
 	mysql_close(&m_Mysql);
 	g_MysqlNumConnections -= 1;
 }
@@ -170,19 +184,37 @@ void CMysqlConnection::StoreErrorMysql(const char *pContext)
 
 void CMysqlConnection::StoreErrorStmt(const char *pContext)
 {
-	str_format(m_aErrorDetail, sizeof(m_aErrorDetail), "(%s:stmt:%d): %s", pContext, mysql_stmt_errno(m_pStmt.get()), mysql_stmt_error(m_pStmt.get()));
+	StoreErrorStmt(m_pStmt, pContext);
+}
+
+void CMysqlConnection::StoreErrorStmt(MYSQL_STMT *pStmt, const char *pContext)
+{
+	str_format(m_aErrorDetail, sizeof(m_aErrorDetail), "(%s:stmt:%d): %s", pContext, mysql_stmt_errno(pStmt), mysql_stmt_error(pStmt));
+}
+
+void CMysqlConnection::DropStatement()
+{
+	m_Statements.Remove(m_pStmt);
+	m_pStmt = nullptr;
 }
 
 bool CMysqlConnection::PrepareAndExecuteStatement(const char *pStmt)
 {
-	if(mysql_stmt_prepare(m_pStmt.get(), pStmt, str_length(pStmt)))
+	// only used while connecting, so the statement isn't cached
+	std::unique_ptr<MYSQL_STMT, CStmtDeleter> pSetupStmt(mysql_stmt_init(&m_Mysql));
+	if(!pSetupStmt)
 	{
-		StoreErrorStmt("prepare");
+		StoreErrorMysql("stmt_init");
 		return false;
 	}
-	if(mysql_stmt_execute(m_pStmt.get()))
+	if(mysql_stmt_prepare(pSetupStmt.get(), pStmt, str_length(pStmt)))
 	{
-		StoreErrorStmt("execute");
+		StoreErrorStmt(pSetupStmt.get(), "prepare");
+		return false;
+	}
+	if(mysql_stmt_execute(pSetupStmt.get()))
+	{
+		StoreErrorStmt(pSetupStmt.get(), "execute");
 		return false;
 	}
 	return true;
@@ -220,24 +252,34 @@ bool CMysqlConnection::ConnectImpl()
 {
 	if(m_HaveConnection)
 	{
-		if(m_pStmt && mysql_stmt_free_result(m_pStmt.get()))
+		if(m_pStmt && mysql_stmt_free_result(m_pStmt))
 		{
 			StoreErrorStmt("free_result");
 			dbg_msg("mysql", "can't free last result %s", m_aErrorDetail);
 		}
 		if(!mysql_select_db(&m_Mysql, m_Config.m_aDatabase))
 		{
+			// MYSQL_OPT_RECONNECT silently reconnects, which drops the prepared statements
+			if(mysql_thread_id(&m_Mysql) != m_ConnectionId)
+			{
+				m_pStmt = nullptr;
+				m_Statements.Clear();
+				m_ConnectionId = mysql_thread_id(&m_Mysql);
+			}
 			// Success.
 			return true;
 		}
 		StoreErrorMysql("select_db");
 		dbg_msg("mysql", "ping error, trying to reconnect %s", m_aErrorDetail);
+		m_pStmt = nullptr;
+		m_Statements.Clear();
 		mysql_close(&m_Mysql);
 		mem_zero(&m_Mysql, sizeof(m_Mysql));
 		mysql_init(&m_Mysql);
 	}
 
 	m_pStmt = nullptr;
+	m_Statements.Clear();
 	unsigned int OptConnectTimeout = 60;
 	unsigned int OptReadTimeout = 60;
 	unsigned int OptWriteTimeout = 120;
@@ -258,8 +300,7 @@ bool CMysqlConnection::ConnectImpl()
 		return false;
 	}
 	m_HaveConnection = true;
-
-	m_pStmt = std::unique_ptr<MYSQL_STMT, CStmtDeleter>(mysql_stmt_init(&m_Mysql));
+	m_ConnectionId = mysql_thread_id(&m_Mysql);
 
 	// Apparently MYSQL_SET_CHARSET_NAME is not enough
 	if(!PrepareAndExecuteStatement("SET CHARACTER SET utf8mb4"))
@@ -319,14 +360,32 @@ void CMysqlConnection::Disconnect()
 
 bool CMysqlConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
 {
-	if(mysql_stmt_prepare(m_pStmt.get(), pStmt, str_length(pStmt)))
+	// discards the rows of the last query that weren't fetched
+	if(m_pStmt && mysql_stmt_free_result(m_pStmt))
 	{
-		StoreErrorStmt("prepare");
-		str_copy(pError, m_aErrorDetail, ErrorSize);
-		return false;
+		StoreErrorStmt("free_result");
+		dbg_msg("mysql", "can't free last result %s", m_aErrorDetail);
+	}
+	m_pStmt = m_Statements.Find(pStmt);
+	if(m_pStmt == nullptr)
+	{
+		std::unique_ptr<MYSQL_STMT, CStmtDeleter> pNewStmt(mysql_stmt_init(&m_Mysql));
+		if(!pNewStmt)
+		{
+			StoreErrorMysql("stmt_init");
+			str_copy(pError, m_aErrorDetail, ErrorSize);
+			return false;
+		}
+		if(mysql_stmt_prepare(pNewStmt.get(), pStmt, str_length(pStmt)))
+		{
+			StoreErrorStmt(pNewStmt.get(), "prepare");
+			str_copy(pError, m_aErrorDetail, ErrorSize);
+			return false;
+		}
+		m_pStmt = m_Statements.Add(pStmt, std::move(pNewStmt));
 	}
 	m_NewQuery = true;
-	unsigned NumParameters = mysql_stmt_param_count(m_pStmt.get());
+	unsigned NumParameters = mysql_stmt_param_count(m_pStmt);
 	m_vStmtParameters.resize(NumParameters);
 	m_vStmtParameterExtras.resize(NumParameters);
 	if(NumParameters)
@@ -444,20 +503,21 @@ bool CMysqlConnection::Step(bool *pEnd, char *pError, int ErrorSize)
 	if(m_NewQuery)
 	{
 		m_NewQuery = false;
-		if(mysql_stmt_bind_param(m_pStmt.get(), m_vStmtParameters.data()))
+		if(mysql_stmt_bind_param(m_pStmt, m_vStmtParameters.data()))
 		{
 			StoreErrorStmt("bind_param");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return false;
 		}
-		if(mysql_stmt_execute(m_pStmt.get()))
+		if(mysql_stmt_execute(m_pStmt))
 		{
 			StoreErrorStmt("execute");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
+			DropStatement();
 			return false;
 		}
 	}
-	int Result = mysql_stmt_fetch(m_pStmt.get());
+	int Result = mysql_stmt_fetch(m_pStmt);
 	if(Result == 1)
 	{
 		StoreErrorStmt("fetch");
@@ -475,25 +535,43 @@ bool CMysqlConnection::ExecuteUpdate(int *pNumUpdated, char *pError, int ErrorSi
 	if(m_NewQuery)
 	{
 		m_NewQuery = false;
-		if(mysql_stmt_bind_param(m_pStmt.get(), m_vStmtParameters.data()))
+		if(mysql_stmt_bind_param(m_pStmt, m_vStmtParameters.data()))
 		{
 			StoreErrorStmt("bind_param");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return false;
 		}
-		if(mysql_stmt_execute(m_pStmt.get()))
+		if(mysql_stmt_execute(m_pStmt))
 		{
 			StoreErrorStmt("execute");
 			str_copy(pError, m_aErrorDetail, ErrorSize);
+			DropStatement();
 			return false;
 		}
-		*pNumUpdated = mysql_stmt_affected_rows(m_pStmt.get());
+		*pNumUpdated = mysql_stmt_affected_rows(m_pStmt);
 		return true;
 	}
 	str_copy(pError, "tried to execute update without query", ErrorSize);
 	return false;
 }
 
+bool CMysqlConnection::Execute(const char *pQuery, char *pError, int ErrorSize)
+{
+	// the rows of the last query that weren't fetched block the connection
+	if(m_pStmt && mysql_stmt_free_result(m_pStmt))
+	{
+		StoreErrorStmt("free_result");
+		dbg_msg("mysql", "can't free last result %s", m_aErrorDetail);
+	}
+	if(mysql_real_query(&m_Mysql, pQuery, str_length(pQuery)))
+	{
+		StoreErrorMysql("real_query");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		return false;
+	}
+	return true;
+}
+
 bool CMysqlConnection::IsNull(int Col)
 {
 	Col -= 1;
@@ -508,7 +586,7 @@ bool CMysqlConnection::IsNull(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:null");
 		dbg_assert(false, "Error in IsNull: error fetching column %s", m_aErrorDetail);
@@ -531,7 +609,7 @@ float CMysqlConnection::GetFloat(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:float");
 		dbg_assert(false, "Error in GetFloat: error fetching column %s", m_aErrorDetail);
@@ -555,7 +633,7 @@ int CMysqlConnection::GetInt(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:int");
 		dbg_assert(false, "Error in GetInt: error fetching column %s", m_aErrorDetail);
@@ -579,7 +657,7 @@ int64_t CMysqlConnection::GetInt64(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:int64");
 		dbg_assert(false, "Error in GetInt64: error fetching column %s", m_aErrorDetail);
@@ -610,7 +688,7 @@ void CMysqlConnection::GetString(int Col, char *pBuffer, int BufferSize)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = &Error;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:string");
 		dbg_assert(false, "Error in GetString: error fetching column %s", m_aErrorDetail);
@@ -635,7 +713,7 @@ int CMysqlConnection::GetBlob(int Col, unsigned char *pBuffer, int BufferSize)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = &Error;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
 		StoreErrorStmt("fetch_column:blob");
 		dbg_assert(false, "Error in GetBlob: error fetching column %s", m_aErrorDetail);
@@ -4,6 +4,7 @@
 
 #include <base/math.h>
 #include <engine/console.h>
+#include <engine/shared/config.h>
 
 #include <atomic>
 
@@ -26,6 +27,9 @@ public:
 	// > the identifiers refer to the columns rather than Boolean constants.
 	const char *False() const override { return "0"; }
 	const char *True() const override { return "1"; }
+	// takes the write lock right away, a deferred transaction can't upgrade
+	// its read lock once another connection wrote in the meantime
+	const char *BeginTransaction() const override { return "BEGIN IMMEDIATE"; }
 
 	bool Connect(char *pError, int ErrorSize) override;
 	void Disconnect() override;
@@ -42,6 +46,7 @@ public:
 	void Print() override;
 	bool Step(bool *pEnd, char *pError, int ErrorSize) override;
 	bool ExecuteUpdate(int *pNumUpdated, char *pError, int ErrorSize) override;
+	bool Execute(const char *pQuery, char *pError, int ErrorSize) override;
 
 	bool IsNull(int Col) override;
 	float GetFloat(int Col) override;
@@ -57,15 +62,21 @@ public:
 	bool CreateFailsafeTables();
 
 private:
+	class CStmtDeleter
+	{
+	public:
+		void operator()(sqlite3_stmt *pStmt) const { sqlite3_finalize(pStmt); }
+	};
+
 	// copy of config vars
 	char m_aFilename[IO_MAX_PATH_LENGTH];
 	bool m_Setup;
 
 	sqlite3 *m_pDb;
+	CStatementCache<sqlite3_stmt, CStmtDeleter> m_Statements;
+	// the statement from m_Statements that was prepared last
 	sqlite3_stmt *m_pStmt;
 	bool m_Done; // no more rows available for Step
-	// returns false, if the query succeeded
-	bool Execute(const char *pQuery, char *pError, int ErrorSize);
 	// returns true on failure
 	bool ConnectImpl(char *pError, int ErrorSize);
 
@@ -80,6 +91,7 @@ CSqliteConnection::CSqliteConnection(const char *pFilename, bool Setup) :
 	IDbConnection("record"),
 	m_Setup(Setup),
 	m_pDb(nullptr),
+	m_Statements(g_Config.m_SvSqlStatementCache),
 	m_pStmt(nullptr),
 	m_Done(true),
 	m_InUse(false)
@@ -89,8 +101,8 @@ CSqliteConnection::CSqliteConnection(const char *pFilename, bool Setup) :
 
 CSqliteConnection::~CSqliteConnection()
 {
-	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
+	m_Statements.Clear();
+	m_pStmt = nullptr;
 	sqlite3_close(m_pDb);
 	m_pDb = nullptr;
 }
@@ -142,8 +154,9 @@ bool CSqliteConnection::ConnectImpl(char *pError, int ErrorSize)
 		return false;
 	}
 
-	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors
-	sqlite3_busy_timeout(m_pDb, -1);
+	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors,
+	// a timeout of zero or less would disable the waiting
+	sqlite3_busy_timeout(m_pDb, 60 * 1000);
 
 	if(m_Setup)
 	{
@@ -182,8 +195,9 @@ bool CSqliteConnection::ConnectImpl(char *pError, int ErrorSize)
 
 void CSqliteConnection::Disconnect()
 {
+	// a statement that isn't reset keeps its read transaction open
 	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
+		sqlite3_reset(m_pStmt);
 	m_pStmt = nullptr;
 	m_InUse.store(false);
 }
@@ -191,17 +205,33 @@ void CSqliteConnection::Disconnect()
 bool CSqliteConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
 {
 	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
-	m_pStmt = nullptr;
-	int Result = sqlite3_prepare_v2(
-		m_pDb,
-		pStmt,
-		-1, // pStmt can be any length
-		&m_pStmt,
-		nullptr);
-	if(FormatError(Result, pError, ErrorSize))
+		sqlite3_reset(m_pStmt);
+	m_pStmt = m_Statements.Find(pStmt);
+	if(m_pStmt != nullptr)
 	{
-		return false;
+		// strings and blobs are bound without copying them, don't keep
+		// pointers to the buffers of the last query around
+		sqlite3_clear_bindings(m_pStmt);
+	}
+	else
+	{
+		sqlite3_stmt *pNewStmt = nullptr;
+		int Result = sqlite3_prepare_v2(
+			m_pDb,
+			pStmt,
+			-1, // pStmt can be any length
+			&pNewStmt,
+			nullptr);
+		if(FormatError(Result, pError, ErrorSize))
+		{
+			return false;
+		}
+		if(pNewStmt == nullptr)
+		{
+			str_copy(pError, "empty statement", ErrorSize);
+			return false;
+		}
+		m_pStmt = m_Statements.Add(pStmt, CStatementCache<sqlite3_stmt, CStmtDeleter>::CStmtPtr(pNewStmt));
 	}
 	m_Done = false;
 	return true;
@@ -362,6 +392,9 @@ const char *CSqliteConnection::MedianMapTime(char *pBuffer, int BufferSize) cons
 
 bool CSqliteConnection::Execute(const char *pQuery, char *pError, int ErrorSize)
 {
+	// statements in progress prevent committing or rolling back
+	if(m_pStmt != nullptr)
+		sqlite3_reset(m_pStmt);
 	char *pErrorMsg;
 	int Result = sqlite3_exec(m_pDb, pQuery, nullptr, nullptr, &pErrorMsg);
 	if(Result != SQLITE_OK)
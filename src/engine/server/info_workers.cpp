@@ -0,0 +1,204 @@
+#include "info_workers.h"
+
+#include <base/system.h>
+
+#include <engine/shared/masterserver.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol7.h>
+#include <engine/shared/protocolglue.h>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+void AddServerInfoHeader(CPacker *pPacker, int Type, int Token, bool First)
+{
+	if(Type == SERVERINFO_EXTENDED)
+	{
+		if(First)
+			pPacker->AddRaw(SERVERBROWSE_INFO_EXTENDED, sizeof(SERVERBROWSE_INFO_EXTENDED));
+		else
+			pPacker->AddRaw(SERVERBROWSE_INFO_EXTENDED_MORE, sizeof(SERVERBROWSE_INFO_EXTENDED_MORE));
+	}
+	else if(Type == SERVERINFO_64_LEGACY)
+	{
+		pPacker->AddRaw(SERVERBROWSE_INFO_64_LEGACY, sizeof(SERVERBROWSE_INFO_64_LEGACY));
+	}
+	else if(Type == SERVERINFO_VANILLA || Type == SERVERINFO_INGAME)
+	{
+		pPacker->AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
+	}
+	else
+	{
+		dbg_assert(false, "unknown serverinfo type");
+	}
+
+	char aBuf[16];
+	str_format(aBuf, sizeof(aBuf), "%d", Token);
+	pPacker->AddString(aBuf, 0);
+}
+
+bool CInfoWorkers::CRateLimit::Allow()
+{
+	const int64_t Now = time_get();
+	int64_t SecondStart = m_SecondStart.load();
+	if(Now > SecondStart + time_freq() && m_SecondStart.compare_exchange_strong(SecondStart, Now))
+		m_Count.store(0);
+	const int Limit = m_Limit.load();
+	return ++m_Count <= Limit || Limit == 0;
+}
+
+CInfoWorkers::~CInfoWorkers()
+{
+	Stop();
+}
+
+bool CInfoWorkers::Start(NETADDR BindAddr, int NumWorkers, CNetServer *pNetServer)
+{
+	dbg_assert(!IsRunning(), "info workers already running");
+	m_pNetServer = pNetServer;
+	m_Stopping = false;
+	{
+		const CLockScope LockScope(m_InfoLock);
+		m_pInfo = nullptr;
+	}
+
+	for(int i = 0; i < NumWorkers; i++)
+	{
+		NETSOCKET Socket = net_udp_create(BindAddr, true);
+		if(!Socket)
+		{
+			for(auto &pWorker : m_vpWorkers)
+				net_udp_close(pWorker->m_Socket);
+			m_vpWorkers.clear();
+			return false;
+		}
+		auto pWorker = std::make_unique<CWorker>();
+		pWorker->m_pOwner = this;
+		pWorker->m_Socket = Socket;
+		pWorker->m_pThread = nullptr;
+		m_vpWorkers.push_back(std::move(pWorker));
+	}
+
+	// only start the threads once all sockets exist
+	for(auto &pWorker : m_vpWorkers)
+		pWorker->m_pThread = thread_init(WorkerThread, pWorker.get(), "info worker");
+	return true;
+}
+
+void CInfoWorkers::Stop()
+{
+	m_Stopping = true;
+	for(auto &pWorker : m_vpWorkers)
+	{
+		thread_wait(pWorker->m_pThread);
+		net_udp_close(pWorker->m_Socket);
+	}
+	m_vpWorkers.clear();
+}
+
+void CInfoWorkers::SetServerInfo(std::shared_ptr<const CServerInfo> pInfo)
+{
+	const CLockScope LockScope(m_InfoLock);
+	m_pInfo = std::move(pInfo);
+}
+
+void CInfoWorkers::SetLimits(int InfoPerSecond, int HandshakesPerSecond)
+{
+	m_InfoLimit.m_Limit = InfoPerSecond;
+	m_HandshakeLimit.m_Limit = HandshakesPerSecond;
+}
+
+void CInfoWorkers::WorkerThread(void *pUser)
+{
+	CWorker *pWorker = static_cast<CWorker *>(pUser);
+	CInfoWorkers *pThis = pWorker->m_pOwner;
+	while(!pThis->m_Stopping)
+	{
+		// the timeout only bounds how long stopping takes
+		if(!net_socket_read_wait(pWorker->m_Socket, 100ms))
+			continue;
+
+		NETADDR Addr;
+		unsigned char *pData;
+		int Bytes;
+		while((Bytes = net_udp_recv(pWorker->m_Socket, &Addr, &pData)) > 0)
+			pThis->OnPacket(pWorker->m_Socket, Addr, pData, Bytes);
+	}
+}
+
+void CInfoWorkers::OnPacket(NETSOCKET Socket, NETADDR &Addr, unsigned char *pData, int Size)
+{
+	CNetPacketConstruct Packet;
+	bool Sixup = false;
+	SECURITY_TOKEN SecurityToken;
+	SECURITY_TOKEN ResponseToken = NET_SECURITY_TOKEN_UNKNOWN;
+	if(CNetBase::UnpackPacket(pData, Size, &Packet, Sixup, &SecurityToken, &ResponseToken) != 0)
+		return;
+
+	if(Packet.m_Flags & NET_PACKETFLAG_CONNLESS)
+	{
+		// 0.7 requests need the per-address tokens of the game thread
+		if(!Sixup && AnswerServerInfo(Socket, Addr, Packet.m_aChunkData, Packet.m_DataSize, Packet.m_Flags & NET_PACKETFLAG_EXTENDED, Packet.m_aExtraData))
+			return;
+	}
+	else if(Packet.m_Flags & NET_PACKETFLAG_CONTROL && Packet.m_DataSize >= 1)
+	{
+		const int ControlMsg = Packet.m_aChunkData[0];
+		const bool Handshake = Sixup ?
+					       ControlMsg == protocol7::NET_CTRLMSG_CONNECT || ControlMsg == protocol7::NET_CTRLMSG_TOKEN :
+					       ControlMsg == NET_CTRLMSG_CONNECT;
+		if(Handshake && !m_HandshakeLimit.Allow())
+			return;
+	}
+
+	m_pNetServer->ForwardPacket(Addr, pData, Size);
+}
+
+bool CInfoWorkers::AnswerServerInfo(NETSOCKET Socket, NETADDR &Addr, const unsigned char *pData, int Size, bool Extended, const unsigned char *pExtraData)
+{
+	int Type;
+	int ExtraToken = 0;
+	if(Size >= (int)sizeof(SERVERBROWSE_GETINFO) + 1 &&
+		mem_comp(pData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)) == 0)
+	{
+		if(Extended)
+		{
+			Type = SERVERINFO_EXTENDED;
+			ExtraToken = (pExtraData[0] << 8) | pExtraData[1];
+		}
+		else
+			Type = SERVERINFO_VANILLA;
+	}
+	else if(Size >= (int)sizeof(SERVERBROWSE_GETINFO_64_LEGACY) + 1 &&
+		mem_comp(pData, SERVERBROWSE_GETINFO_64_LEGACY, sizeof(SERVERBROWSE_GETINFO_64_LEGACY)) == 0)
+	{
+		Type = SERVERINFO_64_LEGACY;
+	}
+	else
+	{
+		return false;
+	}
+
+	std::shared_ptr<const CServerInfo> pInfo;
+	{
+		const CLockScope LockScope(m_InfoLock);
+		pInfo = m_pInfo;
+	}
+	if(!pInfo)
+		return false;
+
+	const int Token = pData[sizeof(SERVERBROWSE_GETINFO)] | (ExtraToken << 8);
+	const bool SendClients = m_InfoLimit.Allow();
+	const std::vector<std::vector<uint8_t>> &vChunks = pInfo->m_avChunks[Type * 2 + SendClients];
+	CPacker Packer;
+	for(const auto &vChunk : vChunks)
+	{
+		Packer.Reset();
+		AddServerInfoHeader(&Packer, Type, Token, &vChunk == &vChunks.front());
+		Packer.AddRaw(vChunk.data(), vChunk.size());
+		CNetBase::SendPacketConnless(Socket, &Addr, Packer.Data(), Packer.Size(), false, nullptr);
+	}
+	return true;
+}
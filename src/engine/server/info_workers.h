@@ -0,0 +1,109 @@
+#ifndef ENGINE_SERVER_INFO_WORKERS_H
+#define ENGINE_SERVER_INFO_WORKERS_H
+
+#include <base/lock.h>
+#include <base/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class CNetServer;
+class CPacker;
+
+/**
+ * Adds the type specific header of a server info packet.
+ *
+ * @param pPacker Packer to add the header to.
+ * @param Type One of the `SERVERINFO_*` types.
+ * @param Token Token of the request.
+ * @param First Whether this is the first packet of the server info.
+ */
+void AddServerInfoHeader(CPacker *pPacker, int Type, int Token, bool First);
+
+/**
+ * Extra sockets bound to the server address with `SO_REUSEPORT`, each read
+ * by its own thread. The kernel distributes the incoming packets between
+ * these sockets and the one of the @link CNetServer @endlink.
+ *
+ * The threads answer server info requests from the cache that the game thread
+ * publishes with @link SetServerInfo @endlink and drop connection attempts
+ * above a limit. All other packets are forwarded to the @link CNetServer
+ * @endlink.
+ */
+class CInfoWorkers
+{
+public:
+	/**
+	 * The serialized server info, one list of chunks per info type and
+	 * whether the clients are included, like the caches of the server.
+	 */
+	class CServerInfo
+	{
+	public:
+		std::vector<std::vector<uint8_t>> m_avChunks[3 * 2];
+	};
+
+	CInfoWorkers() = default;
+	~CInfoWorkers();
+	CInfoWorkers(const CInfoWorkers &) = delete;
+
+	/**
+	 * @param BindAddr Address of the @link CNetServer @endlink, its socket
+	 * must have been created with `SO_REUSEPORT`.
+	 * @param NumWorkers Number of threads.
+	 * @param pNetServer Where the packets that are not handled are forwarded to.
+	 *
+	 * @return `false` if not all sockets could be created, no thread is started then.
+	 */
+	bool Start(NETADDR BindAddr, int NumWorkers, CNetServer *pNetServer) REQUIRES(!m_InfoLock);
+	void Stop();
+	bool IsRunning() const { return !m_vpWorkers.empty(); }
+
+	void SetServerInfo(std::shared_ptr<const CServerInfo> pInfo) REQUIRES(!m_InfoLock);
+
+	/**
+	 * @param InfoPerSecond Server info requests per second that are answered
+	 * including the clients, `0` for no limit.
+	 * @param HandshakesPerSecond Connection attempts per second that are
+	 * forwarded, `0` for no limit.
+	 */
+	void SetLimits(int InfoPerSecond, int HandshakesPerSecond);
+
+private:
+	class CWorker
+	{
+	public:
+		CInfoWorkers *m_pOwner;
+		NETSOCKET m_Socket;
+		void *m_pThread;
+	};
+
+	// counts the events of the current second for all threads
+	class CRateLimit
+	{
+		std::atomic<int64_t> m_SecondStart{0};
+		std::atomic_int m_Count{0};
+
+	public:
+		std::atomic_int m_Limit{0};
+		bool Allow();
+	};
+
+	std::vector<std::unique_ptr<CWorker>> m_vpWorkers;
+	CNetServer *m_pNetServer = nullptr;
+	std::atomic_bool m_Stopping{false};
+
+	CLock m_InfoLock;
+	std::shared_ptr<const CServerInfo> m_pInfo GUARDED_BY(m_InfoLock);
+
+	CRateLimit m_InfoLimit;
+	CRateLimit m_HandshakeLimit;
+
+	static void WorkerThread(void *pUser);
+	void OnPacket(NETSOCKET Socket, NETADDR &Addr, unsigned char *pData, int Size) REQUIRES(!m_InfoLock);
+	bool AnswerServerInfo(NETSOCKET Socket, NETADDR &Addr, const unsigned char *pData, int Size, bool Extended, const unsigned char *pExtraData) REQUIRES(!m_InfoLock);
+};
+
+#endif
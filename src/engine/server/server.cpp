@@ -236,6 +236,9 @@ CServer::CServer()
 	m_aDemoRecorder[RECORDER_MANUAL] = CDemoRecorder(&m_SnapshotDelta, false);
 	m_aDemoRecorder[RECORDER_AUTO] = CDemoRecorder(&m_SnapshotDelta, false);
 
+	sphore_init(&m_SnapshotPackSemaphore);
+	m_vSnapshotPackBatches.resize(1);
+
 	m_pGameServer = nullptr;
 
 	m_CurrentGameTick = MIN_TICK;
@@ -293,6 +296,8 @@ CServer::~CServer()
 
 	delete m_pRegister;
 	delete m_pConnectionPool;
+
+	sphore_destroy(&m_SnapshotPackSemaphore);
 }
 
 const char *CServer::DnsblStateStr(EDnsblState State)
@@ -995,6 +1000,7 @@ void CServer::DoSnapshot()
 	}
 
 	// create snapshots for all clients
+	int NumPacks = 0;
 	for(int i = 0; i < MaxClients(); i++)
 	{
 		// client must be ingame to receive snapshots
@@ -1030,8 +1036,6 @@ void CServer::DoSnapshot()
 				m_aDemoRecorder[i].RecordSnapshot(Tick(), aData, SnapshotSize);
 			}
 
-			int Crc = pData->Crc();
-
 			// remove old snapshots
 			// keep 3 seconds worth of snapshots
 			m_aClients[i].m_Snapshots.PurgeUntil(m_CurrentGameTick - TickSpeed() * 3);
@@ -1039,78 +1043,143 @@ void CServer::DoSnapshot()
 			// save the snapshot
 			m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData, 0, nullptr);
 
-			// find snapshot that we can perform delta against
-			int DeltaTick = -1;
-			const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
+			// the delta is created after all snapshots of this tick are built
+			CSnapshotPack Pack;
+			Pack.m_ClientId = i;
+			Pack.m_pData = m_aClients[i].m_Snapshots.m_pLast->m_pSnap;
+			CSnapshotPackBatch &Batch = m_vSnapshotPackBatches[NumPacks % m_vSnapshotPackBatches.size()];
+			Batch.m_vPacks.push_back(Pack);
+			NumPacks++;
+		}
+	}
+
+	// create and compress the deltas, spreading the batches over the job pool
+	// while the main thread takes care of the first one
+	m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, false);
+	m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, false);
+	m_SnapshotDeltaSixup.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, true);
+	m_SnapshotDeltaSixup.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, true);
+
+	int NumJobs = 0;
+	for(size_t b = 1; b < m_vSnapshotPackBatches.size(); b++)
+	{
+		if(m_vSnapshotPackBatches[b].m_vPacks.empty())
+			break;
+		m_SnapshotJobPool.Add(std::make_shared<CSnapshotPackJob>(this, &m_vSnapshotPackBatches[b]));
+		NumJobs++;
+	}
+	PackSnapshots(&m_vSnapshotPackBatches[0]);
+	for(int j = 0; j < NumJobs; j++)
+		sphore_wait(&m_SnapshotPackSemaphore);
+
+	// networking is not thread-safe, send in client order on the main thread
+	for(int p = 0; p < NumPacks; p++)
+	{
+		const CSnapshotPackBatch &Batch = m_vSnapshotPackBatches[p % m_vSnapshotPackBatches.size()];
+		const CSnapshotPack &Pack = Batch.m_vPacks[p / m_vSnapshotPackBatches.size()];
+		SendSnapshot(Pack, Batch.m_vData.data() + Pack.m_DataOffset);
+	}
+	for(auto &Batch : m_vSnapshotPackBatches)
+		Batch.m_vPacks.clear();
+
+	if(IsGlobalSnap)
+	{
+		GameServer()->OnPostGlobalSnap();
+	}
+}
+
+void CServer::CSnapshotPackJob::Run()
+{
+	m_pServer->PackSnapshots(m_pBatch);
+	sphore_signal(&m_pServer->m_SnapshotPackSemaphore);
+}
+
+void CServer::PackSnapshots(CSnapshotPackBatch *pBatch)
+{
+	pBatch->m_vData.clear();
+	for(CSnapshotPack &Pack : pBatch->m_vPacks)
+	{
+		CClient &Client = m_aClients[Pack.m_ClientId];
+		Pack.m_Crc = Pack.m_pData->Crc();
+
+		// find snapshot that we can perform delta against
+		Pack.m_DeltaTick = -1;
+		const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
+		{
+			int DeltashotSize = Client.m_Snapshots.Get(Client.m_LastAckedSnapshot, nullptr, &pDeltashot, nullptr);
+			if(DeltashotSize >= 0)
+				Pack.m_DeltaTick = Client.m_LastAckedSnapshot;
+			else
 			{
-				int DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, nullptr, &pDeltashot, nullptr);
-				if(DeltashotSize >= 0)
-					DeltaTick = m_aClients[i].m_LastAckedSnapshot;
-				else
-				{
-					// no acked package found, force client to recover rate
-					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
-						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
-				}
+				// no acked package found, force client to recover rate
+				if(Client.m_SnapRate == CClient::SNAPRATE_FULL)
+					Client.m_SnapRate = CClient::SNAPRATE_RECOVER;
 			}
+		}
 
-			// create delta
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, m_aClients[i].m_Sixup);
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, m_aClients[i].m_Sixup);
-			char aDeltaData[CSnapshot::MAX_SIZE];
-			int DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+		// create delta
+		const CSnapshotDelta &Delta = Client.m_Sixup ? m_SnapshotDeltaSixup : m_SnapshotDelta;
+		int DeltaSize = Delta.CreateDelta(pDeltashot, Pack.m_pData, pBatch->m_aDeltaData);
 
-			if(DeltaSize)
-			{
-				// compress it
-				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+		// compress it
+		Pack.m_DataOffset = pBatch->m_vData.size();
+		Pack.m_DataSize = 0;
+		if(DeltaSize)
+		{
+			pBatch->m_vData.resize(Pack.m_DataOffset + CSnapshot::MAX_SIZE);
+			Pack.m_DataSize = CVariableInt::Compress(pBatch->m_aDeltaData, DeltaSize, pBatch->m_vData.data() + Pack.m_DataOffset, CSnapshot::MAX_SIZE);
+			pBatch->m_vData.resize(Pack.m_DataOffset + Pack.m_DataSize);
+		}
+	}
+}
 
-				char aCompData[CSnapshot::MAX_SIZE];
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
-				int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
+void CServer::SendSnapshot(const CSnapshotPack &Pack, const char *pData)
+{
+	const int ClientId = Pack.m_ClientId;
+	const int DeltaTick = Pack.m_DeltaTick;
+	const int Crc = Pack.m_Crc;
 
-				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
-				{
-					int Chunk = Left < MaxSize ? Left : MaxSize;
-					Left -= Chunk;
+	if(Pack.m_DataSize)
+	{
+		const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+		const int SnapshotSize = Pack.m_DataSize;
+		int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
 
-					if(NumPackets == 1)
-					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-					else
-					{
-						CMsgPacker Msg(NETMSG_SNAP, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-				}
+		for(int n = 0, Left = SnapshotSize; Left > 0; n++)
+		{
+			int Chunk = Left < MaxSize ? Left : MaxSize;
+			Left -= Chunk;
+
+			if(NumPackets == 1)
+			{
+				CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
+				Msg.AddInt(m_CurrentGameTick);
+				Msg.AddInt(m_CurrentGameTick - DeltaTick);
+				Msg.AddInt(Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pData[n * MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientId);
 			}
 			else
 			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+				CMsgPacker Msg(NETMSG_SNAP, true);
 				Msg.AddInt(m_CurrentGameTick);
 				Msg.AddInt(m_CurrentGameTick - DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				Msg.AddInt(NumPackets);
+				Msg.AddInt(n);
+				Msg.AddInt(Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pData[n * MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientId);
 			}
 		}
 	}
-
-	if(IsGlobalSnap)
+	else
 	{
-		GameServer()->OnPostGlobalSnap();
+		CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+		Msg.AddInt(m_CurrentGameTick);
+		Msg.AddInt(m_CurrentGameTick - DeltaTick);
+		SendMsg(&Msg, MSGFLAG_FLUSH, ClientId);
 	}
 }
 
@@ -2502,19 +2571,10 @@ void CServer::CacheServerInfoSixup(CCache *pCache, bool SendClients, int MaxCons
 void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool SendClients)
 {
 	CPacker p;
-	char aBuf[128];
 	p.Reset();
 
 	CCache *pCache = &m_aServerInfoCache[GetCacheIndex(Type, SendClients)];
 
-#define ADD_RAW(p, x) (p).AddRaw(x, sizeof(x))
-#define ADD_INT(p, x) \
-	do \
-	{ \
-		str_format(aBuf, sizeof(aBuf), "%d", x); \
-		(p).AddString(aBuf, 0); \
-	} while(0)
-
 	CNetChunk Packet;
 	Packet.m_ClientId = -1;
 	Packet.m_Address = *pAddr;
@@ -2523,29 +2583,7 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool Sen
 	for(const auto &Chunk : pCache->m_vCache)
 	{
 		p.Reset();
-		if(Type == SERVERINFO_EXTENDED)
-		{
-			if(&Chunk == &pCache->m_vCache.front())
-				p.AddRaw(SERVERBROWSE_INFO_EXTENDED, sizeof(SERVERBROWSE_INFO_EXTENDED));
-			else
-				p.AddRaw(SERVERBROWSE_INFO_EXTENDED_MORE, sizeof(SERVERBROWSE_INFO_EXTENDED_MORE));
-			ADD_INT(p, Token);
-		}
-		else if(Type == SERVERINFO_64_LEGACY)
-		{
-			ADD_RAW(p, SERVERBROWSE_INFO_64_LEGACY);
-			ADD_INT(p, Token);
-		}
-		else if(Type == SERVERINFO_VANILLA || Type == SERVERINFO_INGAME)
-		{
-			ADD_RAW(p, SERVERBROWSE_INFO);
-			ADD_INT(p, Token);
-		}
-		else
-		{
-			dbg_assert(false, "unknown serverinfo type");
-		}
-
+		AddServerInfoHeader(&p, Type, Token, &Chunk == &pCache->m_vCache.front());
 		p.AddRaw(Chunk.m_vData.data(), Chunk.m_vData.size());
 		Packet.m_pData = p.Data();
 		Packet.m_DataSize = p.Size();
@@ -2697,6 +2735,15 @@ void CServer::UpdateServerInfo(bool Resend)
 	for(int i = 0; i < 2; i++)
 		CacheServerInfoSixup(&m_aSixupServerInfoCache[i], i, MAX_CLIENTS);
 
+	if(m_InfoWorkers.IsRunning())
+	{
+		auto pInfo = std::make_shared<CInfoWorkers::CServerInfo>();
+		for(int i = 0; i < 3 * 2; i++)
+			for(const auto &Chunk : m_aServerInfoCache[i].m_vCache)
+				pInfo->m_avChunks[i].push_back(Chunk.m_vData);
+		m_InfoWorkers.SetServerInfo(std::move(pInfo));
+	}
+
 	if(Resend)
 	{
 		for(int i = 0; i < MaxClients(); ++i)
@@ -2725,7 +2772,7 @@ void CServer::PumpNetwork(bool PacketWaiting)
 
 	m_NetServer.Update();
 
-	if(PacketWaiting)
+	if(PacketWaiting || m_NetServer.HasForwardedPackets())
 	{
 		// process packets
 		ResponseToken = NET_SECURITY_TOKEN_UNKNOWN;
@@ -3048,7 +3095,23 @@ int CServer::Run()
 	BindAddr.type = Config()->m_SvIpv4Only ? NETTYPE_IPV4 : NETTYPE_ALL;
 
 	int Port = Config()->m_SvPort;
-	for(BindAddr.port = Port != 0 ? Port : 8303; !m_NetServer.Open(BindAddr, &m_ServerBan, Config()->m_SvMaxClients, Config()->m_SvMaxClientsPerIp); BindAddr.port++)
+	// sharing the port with SO_REUSEPORT could silently split the traffic with
+	// another server when searching for a free port
+	bool InfoWorkers = Config()->m_SvInfoWorkers > 0;
+	if(InfoWorkers && Port == 0)
+	{
+		log_warn("server", "sv_info_workers needs sv_port to be set");
+		InfoWorkers = false;
+	}
+#if !defined(CONF_FAMILY_UNIX)
+	// the packets forwarded by the info workers could not wake up the game thread
+	if(InfoWorkers)
+	{
+		log_warn("server", "sv_info_workers is only supported on Unix");
+		InfoWorkers = false;
+	}
+#endif
+	for(BindAddr.port = Port != 0 ? Port : 8303; !m_NetServer.Open(BindAddr, &m_ServerBan, Config()->m_SvMaxClients, Config()->m_SvMaxClientsPerIp, InfoWorkers); BindAddr.port++)
 	{
 		if(Port != 0 || BindAddr.port >= 8310)
 		{
@@ -3060,6 +3123,17 @@ int CServer::Run()
 	if(Port == 0)
 		log_info("server", "using port %d", BindAddr.port);
 
+	m_NetServer.SetSendBatching(Config()->m_SvSendBatching);
+
+	if(InfoWorkers)
+	{
+		m_InfoWorkers.SetLimits(Config()->m_SvServerInfoPerSecond, Config()->m_SvInfoWorkersHandshakesPerSecond);
+		if(m_InfoWorkers.Start(BindAddr, Config()->m_SvInfoWorkers, &m_NetServer))
+			log_info("server", "answering server info requests on %d extra threads", Config()->m_SvInfoWorkers);
+		else
+			log_error("server", "couldn't create the sockets for sv_info_workers");
+	}
+
 #if defined(CONF_UPNP)
 	m_UPnP.Open(BindAddr);
 #endif
@@ -3079,6 +3153,10 @@ int CServer::Run()
 
 	m_Fifo.Init(Console(), Config()->m_SvInputFifo, CFGFLAG_SERVER);
 
+	if(Config()->m_SvSnapshotThreads > 0)
+		m_SnapshotJobPool.Init(Config()->m_SvSnapshotThreads);
+	m_vSnapshotPackBatches.resize(Config()->m_SvSnapshotThreads + 1);
+
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", Config()->m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
@@ -3269,6 +3347,8 @@ int CServer::Run()
 
 				// master server stuff
 				m_pRegister->Update();
+				if(m_InfoWorkers.IsRunning())
+					m_InfoWorkers.SetLimits(Config()->m_SvServerInfoPerSecond, Config()->m_SvInfoWorkersHandshakesPerSecond);
 
 				if(m_ServerInfoNeedsUpdate)
 					UpdateServerInfo();
@@ -3358,6 +3438,9 @@ int CServer::Run()
 				m_ReloadedWhenEmpty = false;
 			}
 
+			// send everything queued during this tick before waiting
+			m_NetServer.Flush();
+
 			// wait for incoming data
 			if(NonActive && Config()->m_SvShutdownWhenEmpty)
 			{
@@ -3403,6 +3486,8 @@ int CServer::Run()
 	m_Econ.Shutdown();
 	m_Fifo.Shutdown();
 	Engine()->ShutdownJobs();
+	if(Config()->m_SvSnapshotThreads > 0)
+		m_SnapshotJobPool.Shutdown();
 
 	GameServer()->OnShutdown(nullptr);
 	m_pMap->Unload();
@@ -3411,6 +3496,7 @@ int CServer::Run()
 #if defined(CONF_UPNP)
 	m_UPnP.Shutdown();
 #endif
+	m_InfoWorkers.Stop();
 	m_NetServer.Close();
 
 	return ErrorShutdown();
@@ -3739,7 +3825,8 @@ void CServer::DemoRecorder_HandleAutoStart()
 			m_apCurrentMapData[MAP_TYPE_SIX],
 			nullptr,
 			nullptr,
-			nullptr);
+			nullptr,
+			Config()->m_SvDemoAsync);
 
 		if(Config()->m_SvAutoDemoMax)
 		{
@@ -3779,7 +3866,8 @@ void CServer::StartRecord(int ClientId)
 			m_apCurrentMapData[MAP_TYPE_SIX],
 			nullptr,
 			nullptr,
-			nullptr);
+			nullptr,
+			Config()->m_SvDemoAsync);
 	}
 }
 
@@ -3841,7 +3929,8 @@ void CServer::ConRecord(IConsole::IResult *pResult, void *pUser)
 		pServer->m_apCurrentMapData[MAP_TYPE_SIX],
 		nullptr,
 		nullptr,
-		nullptr);
+		nullptr,
+		pServer->Config()->m_SvDemoAsync);
 }
 
 void CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
@@ -3994,6 +4083,12 @@ void CServer::ConDumpSqlServers(IConsole::IResult *pResult, void *pUserData)
 	}
 }
 
+void CServer::ConDumpSqlLatencies(IConsole::IResult *pResult, void *pUserData)
+{
+	CServer *pSelf = (CServer *)pUserData;
+	pSelf->DbPool()->PrintLatencies(pSelf->Console());
+}
+
 void CServer::ConReloadAnnouncement(IConsole::IResult *pResult, void *pUserData)
 {
 	CServer *pThis = static_cast<CServer *>(pUserData);
@@ -4276,6 +4371,7 @@ void CServer::RegisterCommands()
 
 	Console()->Register("add_sqlserver", "s['r'|'w'] s[Database] s[Prefix] s[User] s[Password] s[IP] i[Port] ?i[SetUpDatabase ?]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAddSqlServer, this, "add a sqlserver");
 	Console()->Register("dump_sqlservers", "s['r'|'w']", CFGFLAG_SERVER, ConDumpSqlServers, this, "dumps all sqlservers readservers = r, writeservers = w");
+	Console()->Register("dump_sqllatencies", "", CFGFLAG_SERVER, ConDumpSqlLatencies, this, "dumps how long the sql queries took by query type and how many writes were committed together");
 
 	Console()->Register("auth_add", "s[ident] s[level] r[pw]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAdd, this, "Add a rcon key");
 	Console()->Register("auth_add_p", "s[ident] s[level] s[hash] s[salt]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAddHashed, this, "Add a prehashed rcon key");
@@ -4332,12 +4428,27 @@ void CServer::SnapFreeId(int Id)
 void *CServer::SnapNewItem(int Type, int Id, int Size)
 {
 	dbg_assert(Id >= -1 && Id <= 0xffff, "incorrect id");
-	return Id < 0 ? nullptr : m_SnapshotBuilder.NewItem(Type, Id, Size);
+	if(Id < 0)
+		return nullptr;
+	if(m_pSnapCapture)
+		return m_pSnapCapture->NewItem(Type, Id, Size);
+	return m_SnapshotBuilder.NewItem(Type, Id, Size);
+}
+
+void CServer::SnapSetCapture(CSnapshotItemBuffer *pBuffer)
+{
+	m_pSnapCapture = pBuffer;
+}
+
+void CServer::SnapAddCaptured(const CSnapshotItemBuffer *pBuffer, int First, int Num)
+{
+	pBuffer->AddToBuilder(&m_SnapshotBuilder, First, Num);
 }
 
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
+	m_SnapshotDeltaSixup.SetStaticsize(ItemType, Size);
 }
 
 CServer *CreateServer() { return new CServer(); }
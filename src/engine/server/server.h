@@ -12,6 +12,7 @@
 #include <engine/shared/econ.h>
 #include <engine/shared/fifo.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
 #include <engine/shared/protocol.h>
@@ -24,6 +25,7 @@
 
 #include "antibot.h"
 #include "authmanager.h"
+#include "info_workers.h"
 #include "name_ban.h"
 #include "snap_id_pool.h"
 
@@ -214,9 +216,50 @@ public:
 	int m_aIdMap[MAX_CLIENTS * VANILLA_MAX_CLIENTS];
 
 	CSnapshotDelta m_SnapshotDelta;
+	CSnapshotDelta m_SnapshotDeltaSixup;
 	CSnapshotBuilder m_SnapshotBuilder;
+	CSnapshotItemBuffer *m_pSnapCapture = nullptr;
+
+	class CSnapshotPack
+	{
+	public:
+		int m_ClientId;
+		const CSnapshot *m_pData;
+		int m_Crc;
+		int m_DeltaTick;
+		int m_DataOffset;
+		int m_DataSize;
+	};
+
+	// snapshots of one tick that are delta compressed together, either on
+	// the main thread or on m_SnapshotJobPool
+	class CSnapshotPackBatch
+	{
+	public:
+		std::vector<CSnapshotPack> m_vPacks;
+		std::vector<char> m_vData;
+		char m_aDeltaData[CSnapshot::MAX_SIZE];
+	};
+
+	class CSnapshotPackJob : public IJob
+	{
+		CServer *m_pServer;
+		CSnapshotPackBatch *m_pBatch;
+
+		void Run() override;
+
+	public:
+		CSnapshotPackJob(CServer *pServer, CSnapshotPackBatch *pBatch) :
+			m_pServer(pServer), m_pBatch(pBatch) {}
+	};
+
+	CJobPool m_SnapshotJobPool;
+	SEMAPHORE m_SnapshotPackSemaphore;
+	std::vector<CSnapshotPackBatch> m_vSnapshotPackBatches;
+
 	CSnapIdPool m_IdPool;
 	CNetServer m_NetServer;
+	CInfoWorkers m_InfoWorkers;
 	CEcon m_Econ;
 	CFifo m_Fifo;
 	CServerBan m_ServerBan;
@@ -337,6 +380,8 @@ public:
 	int SendMsg(CMsgPacker *pMsg, int Flags, int ClientId) override;
 
 	void DoSnapshot();
+	void PackSnapshots(CSnapshotPackBatch *pBatch);
+	void SendSnapshot(const CSnapshotPack &Pack, const char *pData);
 
 	static int NewClientCallback(int ClientId, void *pUser, bool Sixup);
 	static int NewClientNoAuthCallback(int ClientId, void *pUser);
@@ -451,6 +496,7 @@ public:
 	// console commands for sqlmasters
 	static void ConAddSqlServer(IConsole::IResult *pResult, void *pUserData);
 	static void ConDumpSqlServers(IConsole::IResult *pResult, void *pUserData);
+	static void ConDumpSqlLatencies(IConsole::IResult *pResult, void *pUserData);
 
 	static void ConReloadAnnouncement(IConsole::IResult *pResult, void *pUserData);
 	static void ConReloadMaplist(IConsole::IResult *pResult, void *pUserData);
@@ -482,6 +528,8 @@ public:
 	int SnapNewId() override;
 	void SnapFreeId(int Id) override;
 	void *SnapNewItem(int Type, int Id, int Size) override;
+	void SnapSetCapture(CSnapshotItemBuffer *pBuffer) override;
+	void SnapAddCaptured(const CSnapshotItemBuffer *pBuffer, int First, int Num) override;
 	void SnapSetStaticsize(int ItemType, int Size) override;
 
 	// DDRace
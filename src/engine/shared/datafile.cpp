@@ -12,8 +12,12 @@
 
 #include "uuid_manager.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <limits>
+#include <numeric>
+#include <thread>
 #include <unordered_set>
 
 #include <zlib.h>
@@ -128,17 +132,65 @@ public:
 class CDatafile
 {
 public:
-	IOHANDLE m_File;
-	unsigned m_FileSize;
+	IOHANDLE m_File = nullptr;
+	unsigned m_FileSize = 0;
+	// the whole file, mapped or read into memory if it cannot be mapped
+	unsigned char *m_pFileData = nullptr;
+	bool m_Mapped = false;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
 	CDatafileHeader m_Header;
 	int m_DataStartOffset;
-	void **m_ppDataPtrs;
-	int *m_pDataSizes;
+	void **m_ppDataPtrs = nullptr;
+	int *m_pDataSizes = nullptr;
 	char *m_pData;
 
+	CDatafile() = default;
+	CDatafile(const CDatafile &) = delete;
+
+	~CDatafile()
+	{
+		if(m_ppDataPtrs != nullptr)
+		{
+			for(int i = 0; i < m_Header.m_NumRawData; i++)
+			{
+				FreeData(i);
+			}
+		}
+		free(m_ppDataPtrs);
+		free(m_pDataSizes);
+		if(m_Mapped)
+		{
+			io_unmap(m_pFileData, m_FileSize);
+		}
+		else
+		{
+			free(m_pFileData);
+		}
+		if(m_File)
+		{
+			io_close(m_File);
+		}
+	}
+
+	bool IsFileData(const void *pData) const
+	{
+		const uintptr_t Data = reinterpret_cast<uintptr_t>(pData);
+		const uintptr_t FileData = reinterpret_cast<uintptr_t>(m_pFileData);
+		return Data >= FileData && Data < FileData + m_FileSize;
+	}
+
+	// data pointing into the file is not owned
+	void FreeData(int Index)
+	{
+		if(!IsFileData(m_ppDataPtrs[Index]))
+		{
+			free(m_ppDataPtrs[Index]);
+		}
+		m_ppDataPtrs[Index] = nullptr;
+	}
+
 	int GetFileDataSize(int Index) const
 	{
 		dbg_assert(Index >= 0 && Index < m_Header.m_NumRawData, "Index invalid: %d", Index);
@@ -213,41 +265,18 @@ public:
 				return nullptr;
 			}
 
-			// read the compressed data
-			void *pCompressedData = malloc(DataSize);
-			if(pCompressedData == nullptr)
-			{
-				log_error("datafile", "out of memory. could not allocate memory for compressed data. index=%d size=%d", Index, DataSize);
-				m_ppDataPtrs[Index] = nullptr;
-				m_pDataSizes[Index] = -1;
-				return nullptr;
-			}
-			unsigned ActualDataSize = 0;
-			if(io_seek(m_File, m_DataStartOffset + m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-			{
-				ActualDataSize = io_read(m_File, pCompressedData, DataSize);
-			}
-			if(DataSize != ActualDataSize)
-			{
-				log_error("datafile", "truncation error. could not read all compressed data. index=%d wanted=%d got=%d", Index, DataSize, ActualDataSize);
-				free(pCompressedData);
-				m_ppDataPtrs[Index] = nullptr;
-				m_pDataSizes[Index] = -1;
-				return nullptr;
-			}
+			const unsigned char *pCompressedData = m_pFileData + m_DataStartOffset + m_Info.m_pDataOffsets[Index];
 
 			// decompress the data
 			m_ppDataPtrs[Index] = static_cast<char *>(malloc(OriginalUncompressedSize));
 			if(m_ppDataPtrs[Index] == nullptr)
 			{
-				free(pCompressedData);
 				log_error("datafile", "out of memory. could not allocate memory for uncompressed data. index=%d size=%d", Index, OriginalUncompressedSize);
 				m_pDataSizes[Index] = -1;
 				return nullptr;
 			}
 			unsigned long UncompressedSize = OriginalUncompressedSize;
-			const int Result = uncompress(static_cast<Bytef *>(m_ppDataPtrs[Index]), &UncompressedSize, static_cast<Bytef *>(pCompressedData), DataSize);
-			free(pCompressedData);
+			const int Result = uncompress(static_cast<Bytef *>(m_ppDataPtrs[Index]), &UncompressedSize, pCompressedData, DataSize);
 			if(Result != Z_OK || UncompressedSize != OriginalUncompressedSize)
 			{
 				log_error("datafile", "failed to uncompress data. index=%d result=%d wanted=%d got=%ld", Index, Result, OriginalUncompressedSize, UncompressedSize);
@@ -261,25 +290,28 @@ public:
 		else
 		{
 			log_trace("datafile", "loading data. index=%d size=%d", Index, DataSize);
-			m_ppDataPtrs[Index] = malloc(DataSize);
-			if(m_ppDataPtrs[Index] == nullptr)
-			{
-				log_error("datafile", "out of memory. could not allocate memory for uncompressed data. index=%d size=%d", Index, DataSize);
-				m_pDataSizes[Index] = -1;
-				return nullptr;
-			}
-			unsigned ActualDataSize = 0;
-			if(io_seek(m_File, m_DataStartOffset + m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
+			unsigned char *pFileData = m_pFileData + m_DataStartOffset + m_Info.m_pDataOffsets[Index];
+			// uncompressed data is used from the file directly, unless swapping it
+			// in place would be repeated after UnloadData or it is misaligned
+#if defined(CONF_ARCH_ENDIAN_BIG)
+			const bool Copy = true;
+#else
+			const bool Copy = reinterpret_cast<uintptr_t>(pFileData) % sizeof(int) != 0;
+#endif
+			if(Copy)
 			{
-				ActualDataSize = io_read(m_File, m_ppDataPtrs[Index], DataSize);
+				m_ppDataPtrs[Index] = malloc(DataSize);
+				if(m_ppDataPtrs[Index] == nullptr)
+				{
+					log_error("datafile", "out of memory. could not allocate memory for uncompressed data. index=%d size=%d", Index, DataSize);
+					m_pDataSizes[Index] = -1;
+					return nullptr;
+				}
+				mem_copy(m_ppDataPtrs[Index], pFileData, DataSize);
 			}
-			if(DataSize != ActualDataSize)
+			else
 			{
-				log_error("datafile", "truncation error. could not read all uncompressed data. index=%d wanted=%d got=%d", Index, DataSize, ActualDataSize);
-				free(m_ppDataPtrs[Index]);
-				m_ppDataPtrs[Index] = nullptr;
-				m_pDataSizes[Index] = -1;
-				return nullptr;
+				m_ppDataPtrs[Index] = pFileData;
 			}
 			m_pDataSizes[Index] = DataSize;
 		}
@@ -455,46 +487,58 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		return false;
 	}
 
-	// determine size and hashes of the file and store them
-	int64_t FileSize = 0;
-	unsigned Crc = 0;
-	SHA256_DIGEST Sha256;
+	// map the whole file or read it in one pass if that fails
+	const int64_t FileSize = io_length(File);
+	if(FileSize < (int64_t)sizeof(CDatafileHeader))
+	{
+		io_close(File);
+		log_error("datafile", "could not read file header. file truncated or not a datafile.");
+		return false;
+	}
+	constexpr int64_t MaxFileSize = (int64_t)2 * 1024 * 1024 * 1024 - 1;
+	if(FileSize > MaxFileSize)
+	{
+		io_close(File);
+		log_error("datafile", "file too large. file_size=%" PRId64 " max=%" PRId64, FileSize, MaxFileSize);
+		return false;
+	}
+
+	CDatafile *pTmpDataFile = new CDatafile;
+	pTmpDataFile->m_File = File;
+	pTmpDataFile->m_FileSize = FileSize;
+	pTmpDataFile->m_pFileData = static_cast<unsigned char *>(io_map(File, FileSize));
+	pTmpDataFile->m_Mapped = pTmpDataFile->m_pFileData != nullptr;
+	if(!pTmpDataFile->m_Mapped)
 	{
-		SHA256_CTX Sha256Ctxt;
-		sha256_init(&Sha256Ctxt);
-		unsigned char aBuffer[64 * 1024];
-		while(true)
+		pTmpDataFile->m_pFileData = static_cast<unsigned char *>(malloc(FileSize));
+		if(pTmpDataFile->m_pFileData == nullptr)
 		{
-			const unsigned Bytes = io_read(File, aBuffer, sizeof(aBuffer));
-			if(Bytes == 0)
-				break;
-			FileSize += Bytes;
-			Crc = crc32(Crc, aBuffer, Bytes);
-			sha256_update(&Sha256Ctxt, aBuffer, Bytes);
+			delete pTmpDataFile;
+			log_error("datafile", "out of memory. could not allocate memory for datafile. file_size=%" PRId64, FileSize);
+			return false;
 		}
-		Sha256 = sha256_finish(&Sha256Ctxt);
-		if(io_seek(File, 0, IOSEEK_START) != 0)
+		const unsigned ReadSize = io_read(File, pTmpDataFile->m_pFileData, FileSize);
+		if((int64_t)ReadSize != FileSize)
 		{
-			io_close(File);
-			log_error("datafile", "could not seek to start after calculating hashes");
+			delete pTmpDataFile;
+			log_error("datafile", "truncation error. could not read file. wanted=%" PRId64 " got=%d", FileSize, ReadSize);
 			return false;
 		}
 	}
 
+	// hash the file before anything is swapped in place or handed out
+	pTmpDataFile->m_Crc = crc32(0, pTmpDataFile->m_pFileData, FileSize);
+	pTmpDataFile->m_Sha256 = sha256(pTmpDataFile->m_pFileData, FileSize);
+
 	// read header
 	CDatafileHeader Header;
-	if(io_read(File, &Header, sizeof(Header)) != sizeof(Header))
-	{
-		io_close(File);
-		log_error("datafile", "could not read file header. file truncated or not a datafile.");
-		return false;
-	}
+	mem_copy(&Header, pTmpDataFile->m_pFileData, sizeof(Header));
 
 	// check header magic
 	if((Header.m_aId[0] != 'A' || Header.m_aId[1] != 'T' || Header.m_aId[2] != 'A' || Header.m_aId[3] != 'D') &&
 		(Header.m_aId[0] != 'D' || Header.m_aId[1] != 'A' || Header.m_aId[2] != 'T' || Header.m_aId[3] != 'A'))
 	{
-		io_close(File);
+		delete pTmpDataFile;
 		log_error("datafile", "wrong header magic. magic=%x%x%x%x", Header.m_aId[0], Header.m_aId[1], Header.m_aId[2], Header.m_aId[3]);
 		return false;
 	}
@@ -504,7 +548,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	// check header version
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
-		io_close(File);
+		delete pTmpDataFile;
 		log_error("datafile", "unsupported header version. version=%d", Header.m_Version);
 		return false;
 	}
@@ -518,7 +562,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		Header.m_ItemSize % sizeof(int) != 0 ||
 		Header.m_DataSize < 0)
 	{
-		io_close(File);
+		delete pTmpDataFile;
 		log_error("datafile", "invalid header information. num_types=%d num_items=%d num_data=%d item_size=%d data_size=%d",
 			Header.m_NumItemTypes, Header.m_NumItems, Header.m_NumRawData, Header.m_ItemSize, Header.m_DataSize);
 		return false;
@@ -544,7 +588,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 
 	if((int64_t)sizeof(Header) + Size + (int64_t)Header.m_DataSize != FileSize)
 	{
-		io_close(File);
+		delete pTmpDataFile;
 		log_error("datafile", "invalid header data size or truncated file. data_size=%d file_size=%" PRId64, Header.m_DataSize, FileSize);
 		return false;
 	}
@@ -559,7 +603,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		}
 		else
 		{
-			io_close(File);
+			delete pTmpDataFile;
 			log_error("datafile", "invalid header size or truncated file. size=%" PRId64 " actual=%" PRId64, HeaderFileSize, FileSize);
 			return false;
 		}
@@ -576,53 +620,27 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		}
 		else
 		{
-			io_close(File);
+			delete pTmpDataFile;
 			log_error("datafile", "invalid header swaplen or truncated file. swaplen=%" PRId64 " actual=%" PRId64, HeaderSwaplen, FileSizeSwaplen);
 			return false;
 		}
 	}
 
-	constexpr int64_t MaxAllocSize = (int64_t)2 * 1024 * 1024 * 1024;
-	int64_t AllocSize = Size;
-	AllocSize += sizeof(CDatafile); // add space for info structure
-	AllocSize += (int64_t)Header.m_NumRawData * sizeof(void *); // add space for data pointers
-	AllocSize += (int64_t)Header.m_NumRawData * sizeof(int); // add space for data sizes
-	if(AllocSize > MaxAllocSize)
-	{
-		io_close(File);
-		log_error("datafile", "file too large. alloc_size=%" PRId64 " max=%" PRId64, AllocSize, MaxAllocSize);
-		return false;
-	}
-
-	CDatafile *pTmpDataFile = static_cast<CDatafile *>(malloc(AllocSize));
-	if(pTmpDataFile == nullptr)
-	{
-		io_close(File);
-		log_error("datafile", "out of memory. could not allocate memory for datafile. alloc_size=%" PRId64, AllocSize);
-		return false;
-	}
 	pTmpDataFile->m_Header = Header;
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
-	pTmpDataFile->m_ppDataPtrs = (void **)(pTmpDataFile + 1);
-	pTmpDataFile->m_pDataSizes = (int *)(pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
-	pTmpDataFile->m_pData = (char *)(pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
-	pTmpDataFile->m_File = File;
-	pTmpDataFile->m_FileSize = FileSize;
-	pTmpDataFile->m_Sha256 = Sha256;
-	pTmpDataFile->m_Crc = Crc;
-
-	// clear the data pointers and sizes
-	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData * sizeof(void *));
-	mem_zero(pTmpDataFile->m_pDataSizes, Header.m_NumRawData * sizeof(int));
+	pTmpDataFile->m_pData = (char *)(pTmpDataFile->m_pFileData + sizeof(CDatafileHeader));
 
-	// read types, offsets, sizes and item data
-	const unsigned ReadSize = io_read(pTmpDataFile->m_File, pTmpDataFile->m_pData, Size);
-	if((int64_t)ReadSize != Size)
+	// the data pointers and sizes start cleared
+	if(Header.m_NumRawData > 0)
 	{
-		io_close(pTmpDataFile->m_File);
-		free(pTmpDataFile);
-		log_error("datafile", "truncation error. could not read all item data. wanted=%" PRId64 " got=%d", Size, ReadSize);
-		return false;
+		pTmpDataFile->m_ppDataPtrs = static_cast<void **>(calloc(Header.m_NumRawData, sizeof(void *)));
+		pTmpDataFile->m_pDataSizes = static_cast<int *>(calloc(Header.m_NumRawData, sizeof(int)));
+		if(pTmpDataFile->m_ppDataPtrs == nullptr || pTmpDataFile->m_pDataSizes == nullptr)
+		{
+			delete pTmpDataFile;
+			log_error("datafile", "out of memory. could not allocate memory for data pointers. num_data=%d", Header.m_NumRawData);
+			return false;
+		}
 	}
 
 	// The swap len also includes the size of the header (without the size offset), but the header was already swapped above.
@@ -647,8 +665,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 
 	if(!pTmpDataFile->Validate())
 	{
-		io_close(pTmpDataFile->m_File);
-		free(pTmpDataFile);
+		delete pTmpDataFile;
 		return false;
 	}
 
@@ -665,13 +682,7 @@ void CDataFileReader::Close()
 		return;
 	}
 
-	for(int i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
-	{
-		free(m_pDataFile->m_ppDataPtrs[i]);
-	}
-
-	io_close(m_pDataFile->m_File);
-	free(m_pDataFile);
+	delete m_pDataFile;
 	m_pDataFile = nullptr;
 }
 
@@ -736,7 +747,7 @@ void CDataFileReader::ReplaceData(int Index, char *pData, size_t Size)
 	dbg_assert(m_pDataFile != nullptr, "File not open");
 	dbg_assert(Index >= 0 && Index < m_pDataFile->m_Header.m_NumRawData, "Index invalid: %d", Index);
 
-	free(m_pDataFile->m_ppDataPtrs[Index]);
+	m_pDataFile->FreeData(Index);
 	m_pDataFile->m_ppDataPtrs[Index] = pData;
 	m_pDataFile->m_pDataSizes[Index] = Size;
 }
@@ -748,8 +759,7 @@ void CDataFileReader::UnloadData(int Index)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return;
 
-	free(m_pDataFile->m_ppDataPtrs[Index]);
-	m_pDataFile->m_ppDataPtrs[Index] = nullptr;
+	m_pDataFile->FreeData(Index);
 	m_pDataFile->m_pDataSizes[Index] = 0;
 }
 
@@ -924,8 +934,10 @@ CDataFileWriter::~CDataFileWriter()
 {
 	if(m_File)
 	{
+		// not finished, the target is left as it was
 		io_close(m_File);
 		m_File = nullptr;
+		fs_remove(m_aTmpPath);
 	}
 
 	for(CItemInfo &ItemInfo : m_vItems)
@@ -943,8 +955,15 @@ CDataFileWriter::~CDataFileWriter()
 bool CDataFileWriter::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
 {
 	dbg_assert(!m_File, "File already open");
-	m_File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, StorageType);
-	return m_File != nullptr;
+	// the file is written next to the target and renamed over it in Finish,
+	// readers may have the old file mapped into memory
+	char aTmpFilename[IO_MAX_PATH_LENGTH];
+	IStorage::FormatTmpPath(aTmpFilename, sizeof(aTmpFilename), pFilename);
+	m_File = pStorage->OpenFile(aTmpFilename, IOFLAG_WRITE, StorageType, m_aTmpPath, sizeof(m_aTmpPath));
+	if(!m_File)
+		return false;
+	str_truncate(m_aPath, sizeof(m_aPath), m_aTmpPath, str_length(m_aTmpPath) - (str_length(aTmpFilename) - str_length(pFilename)));
+	return true;
 }
 
 int CDataFileWriter::GetTypeFromIndex(int Index) const
@@ -1105,21 +1124,73 @@ static int CompressionLevelToZlib(CDataFileWriter::ECompressionLevel Compression
 	}
 }
 
-void CDataFileWriter::Finish()
+void CDataFileWriter::CompressData(CDataInfo *pDataInfo)
+{
+	unsigned long CompressedSize = compressBound(pDataInfo->m_UncompressedSize);
+	pDataInfo->m_pCompressedData = malloc(CompressedSize);
+	const int Result = compress2(static_cast<Bytef *>(pDataInfo->m_pCompressedData), &CompressedSize, static_cast<Bytef *>(pDataInfo->m_pUncompressedData), pDataInfo->m_UncompressedSize, CompressionLevelToZlib(pDataInfo->m_CompressionLevel));
+	pDataInfo->m_CompressedSize = CompressedSize;
+	free(pDataInfo->m_pUncompressedData);
+	pDataInfo->m_pUncompressedData = nullptr;
+	dbg_assert(Result == Z_OK, "datafile zlib compression failed with error %d", Result);
+}
+
+void CDataFileWriter::Finish(int NumThreads)
 {
 	dbg_assert((bool)m_File, "File not open");
 
 	// Compress data. This takes the majority of the time when saving a datafile,
-	// so it's delayed until the end so it can be off-loaded to another thread.
-	for(CDataInfo &DataInfo : m_vDatas)
+	// so it's delayed until the end so it can be off-loaded to other threads.
+	// Each data is still compressed by one compress2 call, so the file does not
+	// depend on the number of threads.
+	if(NumThreads <= 0)
 	{
-		unsigned long CompressedSize = compressBound(DataInfo.m_UncompressedSize);
-		DataInfo.m_pCompressedData = malloc(CompressedSize);
-		const int Result = compress2(static_cast<Bytef *>(DataInfo.m_pCompressedData), &CompressedSize, static_cast<Bytef *>(DataInfo.m_pUncompressedData), DataInfo.m_UncompressedSize, CompressionLevelToZlib(DataInfo.m_CompressionLevel));
-		DataInfo.m_CompressedSize = CompressedSize;
-		free(DataInfo.m_pUncompressedData);
-		DataInfo.m_pUncompressedData = nullptr;
-		dbg_assert(Result == Z_OK, "datafile zlib compression failed with error %d", Result);
+		NumThreads = std::thread::hardware_concurrency();
+	}
+	int64_t TotalUncompressedSize = 0;
+	for(const CDataInfo &DataInfo : m_vDatas)
+	{
+		TotalUncompressedSize += DataInfo.m_UncompressedSize;
+	}
+	// starting threads is not worth it for small files
+	if(TotalUncompressedSize < 256 * 1024)
+	{
+		NumThreads = 1;
+	}
+	NumThreads = std::clamp<int>(NumThreads, 1, m_vDatas.size());
+
+	if(NumThreads <= 1)
+	{
+		for(CDataInfo &DataInfo : m_vDatas)
+		{
+			CompressData(&DataInfo);
+		}
+	}
+	else
+	{
+		// the largest data usually dominates, so start with it
+		std::vector<int> vOrder(m_vDatas.size());
+		std::iota(vOrder.begin(), vOrder.end(), 0);
+		std::stable_sort(vOrder.begin(), vOrder.end(), [&](int Left, int Right) {
+			return m_vDatas[Left].m_UncompressedSize > m_vDatas[Right].m_UncompressedSize;
+		});
+		std::atomic<size_t> Next{0};
+		const auto &&CompressNext = [&]() {
+			for(size_t Index = Next++; Index < vOrder.size(); Index = Next++)
+			{
+				CompressData(&m_vDatas[vOrder[Index]]);
+			}
+		};
+		std::vector<std::thread> vThreads;
+		for(int i = 1; i < NumThreads; i++)
+		{
+			vThreads.emplace_back(CompressNext);
+		}
+		CompressNext();
+		for(std::thread &Thread : vThreads)
+		{
+			Thread.join();
+		}
 	}
 
 	// Calculate total size of items
@@ -1245,4 +1316,9 @@ void CDataFileWriter::Finish()
 
 	io_close(m_File);
 	m_File = nullptr;
+	if(fs_rename(m_aTmpPath, m_aPath) != 0)
+	{
+		log_error("datafile", "failed to replace '%s'", m_aPath);
+		fs_remove(m_aTmpPath);
+	}
 }
@@ -6,6 +6,7 @@
 #include <engine/storage.h>
 
 #include <base/hash.h>
+#include <base/system.h>
 #include <base/types.h>
 
 #include "uuid_manager.h"
@@ -104,6 +105,9 @@ private:
 	};
 
 	IOHANDLE m_File;
+	// the file is written to a temporary file and renamed to the target in Finish
+	char m_aPath[IO_MAX_PATH_LENGTH];
+	char m_aTmpPath[IO_MAX_PATH_LENGTH];
 	std::map<uint16_t, CItemTypeInfo, std::less<>> m_ItemTypes; // item types must be sorted in ascending order
 	std::vector<CItemInfo> m_vItems;
 	std::vector<CDataInfo> m_vDatas;
@@ -111,6 +115,7 @@ private:
 
 	int GetTypeFromIndex(int Index) const;
 	int GetExtendedItemTypeIndex(int Type, const CUuid *pUuid);
+	static void CompressData(CDataInfo *pDataInfo);
 
 public:
 	CDataFileWriter();
@@ -118,6 +123,8 @@ public:
 	{
 		m_File = Other.m_File;
 		Other.m_File = nullptr;
+		str_copy(m_aPath, Other.m_aPath);
+		str_copy(m_aTmpPath, Other.m_aTmpPath);
 		m_ItemTypes = std::move(Other.m_ItemTypes);
 		m_vItems = std::move(Other.m_vItems);
 		m_vDatas = std::move(Other.m_vDatas);
@@ -130,7 +137,14 @@ public:
 	int AddData(size_t Size, const void *pData, ECompressionLevel CompressionLevel = COMPRESSION_DEFAULT);
 	int AddDataSwapped(size_t Size, const void *pData);
 	int AddDataString(const char *pStr);
-	void Finish();
+	/**
+	 * Compresses the data, writes the file and closes it.
+	 *
+	 * @param NumThreads Maximum number of threads that compress the data,
+	 * `1` to compress on the calling thread, `0` for one per core. The file
+	 * is the same for any number of threads.
+	 */
+	void Finish(int NumThreads = 1);
 };
 
 #endif
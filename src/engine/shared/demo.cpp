@@ -1,8 +1,10 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/lock.h>
 #include <base/log.h>
 #include <base/math.h>
 #include <base/system.h>
+#include <base/tl/threading.h>
 
 #include <engine/console.h>
 #include <engine/storage.h>
@@ -18,6 +20,10 @@
 #include "network.h"
 #include "snapshot.h"
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+
 const CUuid SHA256_EXTENSION =
 	{{0x6b, 0xe6, 0xda, 0x4a, 0xce, 0xbd, 0x38, 0x0c,
 		0x9b, 0x5b, 0x12, 0x89, 0xc8, 0x42, 0xd7, 0x80}};
@@ -41,6 +47,91 @@ bool CDemoHeader::Valid() const
 	       mem_has_null(m_aTimestamp, sizeof(m_aTimestamp)) && str_utf8_check(m_aTimestamp);
 }
 
+class CDemoRecorder::CAsync
+{
+	class CWriter;
+
+	CDemoRecorder *m_pRecorder;
+	CWriter *m_pWriter;
+	// shared with the other recordings using the same delta, only read
+	const CSnapshotDelta *m_pSnapshotDelta;
+
+	CLock m_Lock;
+	CSemaphore m_Drained;
+	CSemaphore m_Stopped;
+	// records of a CHeader followed by the data padded to 4 bytes
+	std::vector<unsigned char> m_vQueue GUARDED_BY(m_Lock);
+	// whether the writer thread will still look at the queue
+	bool m_Scheduled GUARDED_BY(m_Lock) = false;
+	bool m_Stopping GUARDED_BY(m_Lock) = false;
+
+	class CHeader
+	{
+	public:
+		int m_Type;
+		int m_Tick;
+		int m_Size;
+	};
+
+	void Process() REQUIRES(!m_Lock);
+
+public:
+	// recording waits for the writer thread if more data is queued, the
+	// writer thread holds at most the same amount while processing it
+	static constexpr size_t MAX_QUEUED_BYTES = 1024 * 1024;
+
+	CAsync(CDemoRecorder *pRecorder);
+	~CAsync();
+
+	const CSnapshotDelta *SnapshotDelta() const { return m_pSnapshotDelta; }
+	void Push(int Type, int Tick, const void *pData, int Size, CQueueStats *pStats) REQUIRES(!m_Lock);
+	void Stop() REQUIRES(!m_Lock);
+};
+
+// One thread for all asynchronous recordings, which exists while any of them
+// is recording. It processes the queues in the order they got data.
+class CDemoRecorder::CAsync::CWriter
+{
+	class CDeltaCopy
+	{
+	public:
+		const CSnapshotDelta *m_pSource;
+		std::unique_ptr<CSnapshotDelta> m_pDelta;
+		int m_NumUsers;
+	};
+
+	static CLock ms_InstanceLock;
+	static CWriter *ms_pInstance GUARDED_BY(ms_InstanceLock);
+	int m_NumUsers GUARDED_BY(ms_InstanceLock) = 0;
+	// the demo sizes of the events differ from the ones sent to the clients,
+	// which the recording thread keeps changing in the original delta
+	std::vector<CDeltaCopy> m_vDeltaCopies GUARDED_BY(ms_InstanceLock);
+
+	void *m_pThread;
+	CLock m_Lock;
+	CSemaphore m_Pending;
+	std::deque<CAsync *> m_Scheduled GUARDED_BY(m_Lock);
+	bool m_Stopping GUARDED_BY(m_Lock) = false;
+
+	CWriter()
+	{
+		m_pThread = thread_init(WorkerThread, this, "demo recorder");
+	}
+	~CWriter();
+
+	static void WorkerThread(void *pUser);
+	void Run() REQUIRES(!m_Lock);
+
+public:
+	static CWriter *Acquire(const CSnapshotDelta *pSource, const CSnapshotDelta **ppSnapshotDelta) REQUIRES(!ms_InstanceLock);
+	static void Release(const CSnapshotDelta *pSnapshotDelta) REQUIRES(!ms_InstanceLock);
+
+	void Schedule(CAsync *pAsync) REQUIRES(!m_Lock);
+};
+
+CLock CDemoRecorder::CAsync::CWriter::ms_InstanceLock;
+CDemoRecorder::CAsync::CWriter *CDemoRecorder::CAsync::CWriter::ms_pInstance = nullptr;
+
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData)
 {
 	m_File = nullptr;
@@ -48,17 +139,19 @@ CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapDat
 	m_pfnFilter = nullptr;
 	m_pUser = nullptr;
 	m_LastTickMarker = -1;
+	m_FirstTick = -1;
+	m_LastTick = -1;
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_NoMapData = NoMapData;
 }
 
 CDemoRecorder::~CDemoRecorder()
 {
-	dbg_assert(m_File == 0, "Demo recorder was not stopped");
+	dbg_assert(m_File == 0 && m_pAsync == nullptr, "Demo recorder was not stopped");
 }
 
 // Record
-int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned Crc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser)
+int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned Crc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser, bool Async)
 {
 	dbg_assert(m_File == 0, "Demo recorder already recording");
 
@@ -202,7 +295,10 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
+	m_LastTick = -1;
 	m_NumTimelineMarkers = 0;
+	m_vKeyFrames.clear();
+	m_QueueStats = CQueueStats();
 
 	if(m_pConsole)
 	{
@@ -217,6 +313,11 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 	m_File = DemoFile;
 	str_copy(m_aCurrentFilename, pFilename);
 
+	if(Async)
+	{
+		m_pAsync = new CAsync(this);
+	}
+
 	return 0;
 }
 
@@ -243,43 +344,41 @@ enum
 	CHUNKMASK_TYPE = 0x60,
 	CHUNKMASK_SIZE = 0x1f,
 
+	CHUNKTYPE_KEYFRAME_INDEX = 0,
 	CHUNKTYPE_SNAPSHOT = 1,
 	CHUNKTYPE_MESSAGE = 2,
 	CHUNKTYPE_DELTA = 3,
 };
 
-void CDemoRecorder::WriteTickMarker(int Tick, bool Keyframe)
-{
-	if(m_LastTickMarker == -1 || Tick - m_LastTickMarker > CHUNKMASK_TICK || Keyframe)
-	{
-		unsigned char aChunk[sizeof(int32_t) + 1];
-		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER;
-		uint_to_bytes_be(aChunk + 1, Tick);
+/*
+	Keyframe index
+
+	Written after the last tick when the recording is stopped, as chunks of
+	type CHUNKTYPE_KEYFRAME_INDEX that players without support skip. Each
+	chunk contains the number of keyframes in it followed by the tick and
+	the file position of each keyframe, as differences to the previous one.
+
+	The last chunk is followed by a footer that is part of its data but
+	not of the compressed stream, so it is ignored when decompressing:
+		16	= KEYFRAME_INDEX_EXTENSION
+		8	= File position of the first index chunk
+		4	= First tick
+		4	= Last tick
+*/
 
-		if(Keyframe)
-			aChunk[0] |= CHUNKTICKFLAG_KEYFRAME;
+// "6288b2f2-7304-33e4-830c-e3b1c0f6b26f"
+// "demoitem-keyframe-index@ddnet.tw"
+static const CUuid KEYFRAME_INDEX_EXTENSION =
+	{{0x62, 0x88, 0xb2, 0xf2, 0x73, 0x04, 0x33, 0xe4,
+		0x83, 0x0c, 0xe3, 0xb1, 0xc0, 0xf6, 0xb2, 0x6f}};
 
-		io_write(m_File, aChunk, sizeof(aChunk));
-	}
-	else
-	{
-		unsigned char aChunk[1];
-		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | CHUNKTICKFLAG_TICK_COMPRESSED | (Tick - m_LastTickMarker);
-		io_write(m_File, aChunk, sizeof(aChunk));
-	}
+static constexpr int KEYFRAME_INDEX_FOOTER_SIZE = sizeof(KEYFRAME_INDEX_EXTENSION.m_aData) + 8 + 4 + 4;
+static constexpr int KEYFRAME_INDEX_MAX_PER_CHUNK = 2048;
 
-	m_LastTickMarker = Tick;
-	if(m_FirstTick < 0)
-		m_FirstTick = Tick;
-}
-
-void CDemoRecorder::Write(int Type, const void *pData, int Size)
+static bool WriteChunk(IOHANDLE File, int Type, const void *pData, int Size, const void *pRawData = nullptr, int RawSize = 0)
 {
-	if(!m_File)
-		return;
-
 	if(Size > 64 * 1024)
-		return;
+		return false;
 
 	/* pad the data with 0 so we get an alignment of 4,
 	else the compression won't work and miss some bytes */
@@ -290,18 +389,25 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		aBuffer2[Size++] = 0;
 	Size = CVariableInt::Compress(aBuffer2, Size, aBuffer, sizeof(aBuffer)); // buffer2 -> buffer
 	if(Size < 0)
-		return;
+		return false;
 
 	Size = CNetBase::Compress(aBuffer, Size, aBuffer2, sizeof(aBuffer2)); // buffer -> buffer2
-	if(Size < 0)
-		return;
+	if(Size < 0 || Size + RawSize > (int)sizeof(aBuffer2))
+		return false;
+
+	// not compressed, after the end of the compressed data
+	if(RawSize > 0)
+	{
+		mem_copy(aBuffer2 + Size, pRawData, RawSize);
+		Size += RawSize;
+	}
 
 	unsigned char aChunk[3];
 	aChunk[0] = ((Type & 0x3) << 5);
 	if(Size < 30)
 	{
 		aChunk[0] |= Size;
-		io_write(m_File, aChunk, 1);
+		io_write(File, aChunk, 1);
 	}
 	else
 	{
@@ -309,21 +415,291 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		{
 			aChunk[0] |= 30;
 			aChunk[1] = Size & 0xff;
-			io_write(m_File, aChunk, 2);
+			io_write(File, aChunk, 2);
 		}
 		else
 		{
 			aChunk[0] |= 31;
 			aChunk[1] = Size & 0xff;
 			aChunk[2] = Size >> 8;
-			io_write(m_File, aChunk, 3);
+			io_write(File, aChunk, 3);
+		}
+	}
+
+	return io_write(File, aBuffer2, Size) == (unsigned)Size;
+}
+
+// Offset must be the current file position, the end of the demo
+static bool WriteKeyFrameIndex(IOHANDLE File, int64_t Offset, const std::vector<CDemoKeyFrame> &vKeyFrames, int FirstTick, int LastTick)
+{
+	if(vKeyFrames.empty())
+		return false;
+
+	unsigned char aFooter[KEYFRAME_INDEX_FOOTER_SIZE];
+	mem_copy(aFooter, KEYFRAME_INDEX_EXTENSION.m_aData, sizeof(KEYFRAME_INDEX_EXTENSION.m_aData));
+	uint_to_bytes_be(aFooter + 16, (uint64_t)Offset >> 32);
+	uint_to_bytes_be(aFooter + 20, (uint64_t)Offset & 0xffffffff);
+	uint_to_bytes_be(aFooter + 24, FirstTick);
+	uint_to_bytes_be(aFooter + 28, LastTick);
+
+	int aData[1 + 2 * KEYFRAME_INDEX_MAX_PER_CHUNK];
+	int64_t PrevFilepos = 0;
+	int PrevTick = 0;
+	for(size_t Start = 0; Start < vKeyFrames.size(); Start += KEYFRAME_INDEX_MAX_PER_CHUNK)
+	{
+		const int Num = minimum<size_t>(vKeyFrames.size() - Start, KEYFRAME_INDEX_MAX_PER_CHUNK);
+		aData[0] = Num;
+		for(int i = 0; i < Num; i++)
+		{
+			const CDemoKeyFrame &KeyFrame = vKeyFrames[Start + i];
+			aData[1 + 2 * i] = KeyFrame.m_Tick - PrevTick;
+			aData[2 + 2 * i] = KeyFrame.m_Filepos - PrevFilepos;
+			PrevTick = KeyFrame.m_Tick;
+			PrevFilepos = KeyFrame.m_Filepos;
+		}
+		const bool Last = Start + Num == vKeyFrames.size();
+		if(!WriteChunk(File, CHUNKTYPE_KEYFRAME_INDEX, aData, (1 + 2 * Num) * sizeof(int), Last ? aFooter : nullptr, Last ? sizeof(aFooter) : 0))
+			return false;
+	}
+	return true;
+}
+
+CDemoRecorder::CAsync::CWriter::~CWriter()
+{
+	{
+		const CLockScope LockScope(m_Lock);
+		m_Stopping = true;
+	}
+	m_Pending.Signal();
+	thread_wait(m_pThread);
+}
+
+CDemoRecorder::CAsync::CWriter *CDemoRecorder::CAsync::CWriter::Acquire(const CSnapshotDelta *pSource, const CSnapshotDelta **ppSnapshotDelta)
+{
+	const CLockScope LockScope(ms_InstanceLock);
+	if(!ms_pInstance)
+		ms_pInstance = new CWriter();
+	ms_pInstance->m_NumUsers++;
+
+	auto It = std::find_if(ms_pInstance->m_vDeltaCopies.begin(), ms_pInstance->m_vDeltaCopies.end(), [&](const CDeltaCopy &Copy) { return Copy.m_pSource == pSource; });
+	if(It == ms_pInstance->m_vDeltaCopies.end())
+	{
+		std::unique_ptr<CSnapshotDelta> pDelta = std::make_unique<CSnapshotDelta>(*pSource);
+		pDelta->SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, true);
+		pDelta->SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, true);
+		ms_pInstance->m_vDeltaCopies.push_back({pSource, std::move(pDelta), 0});
+		It = ms_pInstance->m_vDeltaCopies.end() - 1;
+	}
+	It->m_NumUsers++;
+	*ppSnapshotDelta = It->m_pDelta.get();
+	return ms_pInstance;
+}
+
+void CDemoRecorder::CAsync::CWriter::Release(const CSnapshotDelta *pSnapshotDelta)
+{
+	CWriter *pStop = nullptr;
+	{
+		const CLockScope LockScope(ms_InstanceLock);
+		auto It = std::find_if(ms_pInstance->m_vDeltaCopies.begin(), ms_pInstance->m_vDeltaCopies.end(), [&](const CDeltaCopy &Copy) { return Copy.m_pDelta.get() == pSnapshotDelta; });
+		dbg_assert(It != ms_pInstance->m_vDeltaCopies.end(), "Demo recorder delta not found");
+		if(--It->m_NumUsers == 0)
+			ms_pInstance->m_vDeltaCopies.erase(It);
+		if(--ms_pInstance->m_NumUsers == 0)
+		{
+			pStop = ms_pInstance;
+			ms_pInstance = nullptr;
+		}
+	}
+	// the thread has nothing to do anymore, all recordings were stopped
+	delete pStop;
+}
+
+void CDemoRecorder::CAsync::CWriter::Schedule(CAsync *pAsync)
+{
+	{
+		const CLockScope LockScope(m_Lock);
+		m_Scheduled.push_back(pAsync);
+	}
+	m_Pending.Signal();
+}
+
+void CDemoRecorder::CAsync::CWriter::WorkerThread(void *pUser)
+{
+	static_cast<CWriter *>(pUser)->Run();
+}
+
+void CDemoRecorder::CAsync::CWriter::Run()
+{
+	while(true)
+	{
+		m_Pending.Wait();
+		CAsync *pAsync;
+		{
+			const CLockScope LockScope(m_Lock);
+			if(m_Scheduled.empty())
+			{
+				if(m_Stopping)
+					break;
+				continue;
+			}
+			pAsync = m_Scheduled.front();
+			m_Scheduled.pop_front();
 		}
+		pAsync->Process();
+	}
+}
+
+CDemoRecorder::CAsync::CAsync(CDemoRecorder *pRecorder) :
+	m_pRecorder(pRecorder)
+{
+	m_pWriter = CWriter::Acquire(pRecorder->m_pSnapshotDelta, &m_pSnapshotDelta);
+}
+
+CDemoRecorder::CAsync::~CAsync()
+{
+	CWriter::Release(m_pSnapshotDelta);
+}
+
+void CDemoRecorder::CAsync::Push(int Type, int Tick, const void *pData, int Size, CQueueStats *pStats)
+{
+	const CHeader Header = {Type, Tick, Size};
+	const size_t PaddedSize = (Size + 3) & ~3;
+	const size_t RecordSize = sizeof(Header) + PaddedSize;
+	int64_t StallStart = 0;
+	bool Schedule = false;
+	while(true)
+	{
+		{
+			const CLockScope LockScope(m_Lock);
+			// an empty queue always takes the record, so that it cannot wait forever
+			if(m_vQueue.empty() || m_vQueue.size() + RecordSize <= MAX_QUEUED_BYTES)
+			{
+				const size_t Pos = m_vQueue.size();
+				m_vQueue.resize(Pos + RecordSize, 0);
+				mem_copy(&m_vQueue[Pos], &Header, sizeof(Header));
+				mem_copy(&m_vQueue[Pos + sizeof(Header)], pData, Size);
+				pStats->m_MaxQueuedBytes = maximum<int>(pStats->m_MaxQueuedBytes, m_vQueue.size());
+				Schedule = !m_Scheduled;
+				m_Scheduled = true;
+				break;
+			}
+		}
+		if(StallStart == 0)
+		{
+			StallStart = time_get_nanoseconds().count();
+			pStats->m_NumStalls++;
+		}
+		m_Drained.Wait();
+	}
+	if(StallStart != 0)
+	{
+		pStats->m_StallTime += time_get_nanoseconds().count() - StallStart;
+	}
+	if(Schedule)
+		m_pWriter->Schedule(this);
+}
+
+void CDemoRecorder::CAsync::Stop()
+{
+	bool Schedule;
+	{
+		const CLockScope LockScope(m_Lock);
+		m_Stopping = true;
+		Schedule = !m_Scheduled;
+		m_Scheduled = true;
+	}
+	if(Schedule)
+		m_pWriter->Schedule(this);
+	m_Stopped.Wait();
+}
+
+void CDemoRecorder::CAsync::Process()
+{
+	// swapped with the queue, so that recording can continue while this is processed
+	std::vector<unsigned char> vData;
+	bool Stopping;
+	{
+		const CLockScope LockScope(m_Lock);
+		std::swap(vData, m_vQueue);
+		m_Scheduled = false;
+		Stopping = m_Stopping;
 	}
+	m_Drained.Signal();
 
-	io_write(m_File, aBuffer2, Size);
+	size_t Pos = 0;
+	while(Pos < vData.size())
+	{
+		CHeader Header;
+		mem_copy(&Header, &vData[Pos], sizeof(Header));
+		const unsigned char *pData = &vData[Pos + sizeof(Header)];
+		if(Header.m_Type == CHUNKTYPE_SNAPSHOT)
+			m_pRecorder->DoRecordSnapshot(Header.m_Tick, pData, Header.m_Size);
+		else
+			m_pRecorder->Write(Header.m_Type, pData, Header.m_Size);
+		Pos += sizeof(Header) + ((Header.m_Size + 3) & ~3);
+	}
+
+	// nothing is pushed after stopping, this is the end of the queue
+	if(Stopping)
+		m_Stopped.Signal();
+}
+
+void CDemoRecorder::StopAsync()
+{
+	if(!m_pAsync)
+		return;
+	m_pAsync->Stop();
+	delete m_pAsync;
+	m_pAsync = nullptr;
+}
+
+void CDemoRecorder::WriteTickMarker(int Tick, bool Keyframe)
+{
+	if(m_LastTickMarker == -1 || Tick - m_LastTickMarker > CHUNKMASK_TICK || Keyframe)
+	{
+		if(Keyframe)
+			m_vKeyFrames.emplace_back(io_tell(m_File), Tick);
+
+		unsigned char aChunk[sizeof(int32_t) + 1];
+		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER;
+		uint_to_bytes_be(aChunk + 1, Tick);
+
+		if(Keyframe)
+			aChunk[0] |= CHUNKTICKFLAG_KEYFRAME;
+
+		io_write(m_File, aChunk, sizeof(aChunk));
+	}
+	else
+	{
+		unsigned char aChunk[1];
+		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | CHUNKTICKFLAG_TICK_COMPRESSED | (Tick - m_LastTickMarker);
+		io_write(m_File, aChunk, sizeof(aChunk));
+	}
+
+	m_LastTickMarker = Tick;
+}
+
+void CDemoRecorder::Write(int Type, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	WriteChunk(m_File, Type, pData, Size);
 }
 
 void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+	m_LastTick = Tick;
+
+	if(m_pAsync)
+		m_pAsync->Push(CHUNKTYPE_SNAPSHOT, Tick, pData, Size, &m_QueueStats);
+	else
+		DoRecordSnapshot(Tick, pData, Size);
+}
+
+void CDemoRecorder::DoRecordSnapshot(int Tick, const void *pData, int Size)
 {
 	if(m_LastKeyFrame == -1 || (Tick - m_LastKeyFrame) > SERVER_TICK_SPEED * 5)
 	{
@@ -343,9 +719,18 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 
 		// create delta
 		char aDeltaData[CSnapshot::MAX_SIZE + sizeof(int)];
-		m_pSnapshotDelta->SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, true);
-		m_pSnapshotDelta->SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, true);
-		const int DeltaSize = m_pSnapshotDelta->CreateDelta((CSnapshot *)m_aLastSnapshotData, (CSnapshot *)pData, &aDeltaData);
+		const CSnapshotDelta *pSnapshotDelta;
+		if(m_pAsync)
+		{
+			pSnapshotDelta = m_pAsync->SnapshotDelta();
+		}
+		else
+		{
+			m_pSnapshotDelta->SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, true);
+			m_pSnapshotDelta->SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, true);
+			pSnapshotDelta = m_pSnapshotDelta;
+		}
+		const int DeltaSize = pSnapshotDelta->CreateDelta((CSnapshot *)m_aLastSnapshotData, (CSnapshot *)pData, &aDeltaData);
 		if(DeltaSize)
 		{
 			// record delta
@@ -364,7 +749,10 @@ void CDemoRecorder::RecordMessage(const void *pData, int Size)
 			return;
 		}
 	}
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	if(m_pAsync)
+		m_pAsync->Push(CHUNKTYPE_MESSAGE, -1, pData, Size, &m_QueueStats);
+	else
+		Write(CHUNKTYPE_MESSAGE, pData, Size);
 }
 
 int CDemoRecorder::Stop(IDemoRecorder::EStopMode Mode, const char *pTargetFilename)
@@ -372,8 +760,21 @@ int CDemoRecorder::Stop(IDemoRecorder::EStopMode Mode, const char *pTargetFilena
 	if(!m_File)
 		return -1;
 
+	// write everything that is still queued
+	if(m_pAsync)
+	{
+		StopAsync();
+		log_debug("demo_recorder", "Queue of '%s' held up to %d bytes, recording waited %d times for %.3fms in total",
+			m_aCurrentFilename, m_QueueStats.m_MaxQueuedBytes, m_QueueStats.m_NumStalls, m_QueueStats.m_StallTime / 1e6);
+	}
+
 	if(Mode == IDemoRecorder::EStopMode::KEEP_FILE)
 	{
+		// add the keyframe index to the end
+		const int64_t IndexOffset = io_tell(m_File);
+		if(IndexOffset >= 0)
+			WriteKeyFrameIndex(m_File, IndexOffset, m_vKeyFrames, m_FirstTick, m_LastTick);
+
 		// add the demo length to the header
 		io_seek(m_File, offsetof(CDemoHeader, m_aLength), IOSEEK_START);
 		unsigned char aLength[sizeof(int32_t)];
@@ -395,6 +796,7 @@ int CDemoRecorder::Stop(IDemoRecorder::EStopMode Mode, const char *pTargetFilena
 
 	io_close(m_File);
 	m_File = nullptr;
+	m_vKeyFrames.clear();
 
 	if(Mode == IDemoRecorder::EStopMode::REMOVE_FILE)
 	{
@@ -435,9 +837,9 @@ int CDemoRecorder::Stop(IDemoRecorder::EStopMode Mode, const char *pTargetFilena
 
 void CDemoRecorder::AddDemoMarker()
 {
-	if(m_LastTickMarker < 0)
+	if(m_LastTick < 0)
 		return;
-	AddDemoMarker(m_LastTickMarker);
+	AddDemoMarker(m_LastTick);
 }
 
 void CDemoRecorder::AddDemoMarker(int Tick)
@@ -503,6 +905,8 @@ void CDemoPlayer::Construct(class CSnapshotDelta *pSnapshotDelta, bool UseVideo)
 
 	m_aFilename[0] = '\0';
 	m_aErrorMessage[0] = '\0';
+	m_KeyFrameIndex = false;
+	m_KeyFramesComplete = false;
 }
 
 void CDemoPlayer::SetListener(IListener *pListener)
@@ -652,6 +1056,88 @@ CDemoPlayer::EScanFileResult CDemoPlayer::ScanFile()
 	return ResetToStartPosition(m_vKeyFrames.empty() ? EScanFileResult::ERROR_UNRECOVERABLE : EScanFileResult::SUCCESS);
 }
 
+bool CDemoPlayer::ReadKeyFrameIndex()
+{
+	const int64_t StartPos = io_tell(m_File);
+	const int64_t FileSize = io_length(m_File);
+	if(StartPos < 0 || FileSize < StartPos + KEYFRAME_INDEX_FOOTER_SIZE)
+	{
+		io_seek(m_File, StartPos, IOSEEK_START);
+		return false;
+	}
+
+	const auto &&Fail = [&]() {
+		m_vKeyFrames.clear();
+		m_Info.m_Info.m_FirstTick = -1;
+		m_Info.m_Info.m_LastTick = -1;
+		io_seek(m_File, StartPos, IOSEEK_START);
+		return false;
+	};
+
+	unsigned char aFooter[KEYFRAME_INDEX_FOOTER_SIZE];
+	if(io_seek(m_File, FileSize - KEYFRAME_INDEX_FOOTER_SIZE, IOSEEK_START) != 0 ||
+		io_read(m_File, aFooter, sizeof(aFooter)) != sizeof(aFooter) ||
+		mem_comp(aFooter, KEYFRAME_INDEX_EXTENSION.m_aData, sizeof(KEYFRAME_INDEX_EXTENSION.m_aData)) != 0)
+	{
+		return Fail();
+	}
+	const int64_t IndexOffset = ((int64_t)bytes_be_to_uint(aFooter + 16) << 32) | bytes_be_to_uint(aFooter + 20);
+	const int FirstTick = bytes_be_to_uint(aFooter + 24);
+	const int LastTick = bytes_be_to_uint(aFooter + 28);
+	if(IndexOffset <= StartPos || IndexOffset >= FileSize || io_seek(m_File, IndexOffset, IOSEEK_START) != 0)
+	{
+		return Fail();
+	}
+
+	int64_t Filepos = 0;
+	int Tick = 0;
+	int ChunkTick = -1;
+	while(true)
+	{
+		int ChunkType, ChunkSize;
+		const EReadChunkHeaderResult Result = ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick);
+		if(Result == CHUNKHEADER_EOF)
+			break;
+		if(Result == CHUNKHEADER_ERROR || ChunkType != CHUNKTYPE_KEYFRAME_INDEX ||
+			io_read(m_File, m_aCompressedSnapshotData, ChunkSize) != (unsigned)ChunkSize)
+		{
+			return Fail();
+		}
+
+		int DataSize = CNetBase::Decompress(m_aCompressedSnapshotData, ChunkSize, m_aDecompressedSnapshotData, sizeof(m_aDecompressedSnapshotData));
+		if(DataSize < 0)
+			return Fail();
+		DataSize = CVariableInt::Decompress(m_aDecompressedSnapshotData, DataSize, m_aChunkData, sizeof(m_aChunkData));
+		if(DataSize < (int)sizeof(int))
+			return Fail();
+
+		const int *pData = (const int *)m_aChunkData;
+		const int Num = pData[0];
+		if(Num <= 0 || Num > (int)(DataSize / sizeof(int) - 1) / 2)
+			return Fail();
+		for(int i = 0; i < Num; i++)
+		{
+			Tick += pData[1 + 2 * i];
+			Filepos += pData[2 + 2 * i];
+			// keyframes must be in order and point into the demo data
+			if(Filepos < StartPos || Filepos >= IndexOffset || Tick < FirstTick || Tick > LastTick ||
+				(!m_vKeyFrames.empty() && (Filepos <= m_vKeyFrames.back().m_Filepos || Tick <= m_vKeyFrames.back().m_Tick)))
+			{
+				return Fail();
+			}
+			m_vKeyFrames.emplace_back(Filepos, Tick);
+		}
+	}
+
+	if(m_vKeyFrames.empty() || io_seek(m_File, StartPos, IOSEEK_START) != 0)
+	{
+		return Fail();
+	}
+	m_Info.m_Info.m_FirstTick = FirstTick;
+	m_Info.m_Info.m_LastTick = LastTick;
+	return true;
+}
+
 void CDemoPlayer::DoTick()
 {
 	// update ticks
@@ -865,13 +1351,25 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 		}
 	}
 
-	// Scan the file for interesting points
-	if(ScanFile() == EScanFileResult::ERROR_UNRECOVERABLE)
+	m_KeyFrameIndex = ReadKeyFrameIndex();
+	if(m_KeyFrameIndex)
 	{
-		Stop("Error scanning demo file");
-		return -1;
+		// the index is only written when the recording is stopped
+		m_KeyFramesComplete = true;
+		m_Info.m_LiveStateUpdating = false;
+	}
+	else
+	{
+		// Scan the file for interesting points
+		const EScanFileResult ScanResult = ScanFile();
+		if(ScanResult == EScanFileResult::ERROR_UNRECOVERABLE)
+		{
+			Stop("Error scanning demo file");
+			return -1;
+		}
+		m_KeyFramesComplete = ScanResult == EScanFileResult::SUCCESS;
+		m_Info.m_LiveStateUpdating = true;
 	}
-	m_Info.m_LiveStateUpdating = true;
 
 	// reset slice markers
 	g_Config.m_ClDemoSliceBegin = -1;
@@ -1254,6 +1752,8 @@ void CDemoPlayer::Stop(const char *pErrorMessage)
 	io_close(m_File);
 	m_File = nullptr;
 	m_vKeyFrames.clear();
+	m_KeyFrameIndex = false;
+	m_KeyFramesComplete = false;
 	str_copy(m_aFilename, "");
 	str_copy(m_aErrorMessage, pErrorMessage);
 }
@@ -1449,3 +1949,44 @@ bool CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int
 	DemoRecorder.Stop(IDemoRecorder::EStopMode::KEEP_FILE);
 	return true;
 }
+
+bool CDemoEditor::AddKeyFrameIndex(const char *pDemo)
+{
+	CDemoPlayer DemoPlayer(m_pSnapshotDelta, false);
+	if(DemoPlayer.Load(m_pStorage, m_pConsole, pDemo, IStorage::TYPE_SAVE_OR_ABSOLUTE) == -1)
+		return false;
+
+	if(DemoPlayer.HasKeyFrameIndex())
+	{
+		DemoPlayer.Stop();
+		return true;
+	}
+	if(!DemoPlayer.KeyFramesComplete())
+	{
+		// an index after trailing garbage could never be reached during playback
+		log_error_color(DEMO_PRINT_COLOR, "demo_editor", "Demo '%s' is truncated or corrupted", pDemo);
+		DemoPlayer.Stop();
+		return false;
+	}
+
+	const std::vector<CDemoKeyFrame> vKeyFrames = DemoPlayer.KeyFrames();
+	const int FirstTick = DemoPlayer.Info()->m_Info.m_FirstTick;
+	const int LastTick = DemoPlayer.Info()->m_Info.m_LastTick;
+	DemoPlayer.Stop();
+
+	IOHANDLE File = m_pStorage->OpenFile(pDemo, IOFLAG_APPEND, IStorage::TYPE_SAVE_OR_ABSOLUTE);
+	if(!File)
+	{
+		log_error_color(DEMO_PRINT_COLOR, "demo_editor", "Could not open demo '%s' for writing", pDemo);
+		return false;
+	}
+	const int64_t IndexOffset = io_length(File);
+	const bool Success = IndexOffset >= 0 && io_seek(File, 0, IOSEEK_END) == 0 &&
+			     WriteKeyFrameIndex(File, IndexOffset, vKeyFrames, FirstTick, LastTick);
+	if(io_close(File) != 0 || !Success)
+	{
+		log_error_color(DEMO_PRINT_COLOR, "demo_editor", "Error writing keyframe index to demo '%s'", pDemo);
+		return false;
+	}
+	return true;
+}
@@ -15,8 +15,34 @@
 
 typedef std::function<void()> TUpdateIntraTimesFunc;
 
+class CDemoKeyFrame
+{
+public:
+	int64_t m_Filepos;
+	int m_Tick;
+
+	CDemoKeyFrame(int64_t Filepos, int Tick) :
+		m_Filepos(Filepos), m_Tick(Tick)
+	{
+	}
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
+public:
+	// statistics of the queue to the worker thread of an asynchronous recording
+	class CQueueStats
+	{
+	public:
+		int m_MaxQueuedBytes = 0;
+		// how often recording had to wait for the worker thread because the queue was full
+		int m_NumStalls = 0;
+		int64_t m_StallTime = 0;
+	};
+
+private:
+	class CAsync;
+
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
 
@@ -24,7 +50,13 @@ class CDemoRecorder : public IDemoRecorder
 	char m_aCurrentFilename[IO_MAX_PATH_LENGTH];
 	int m_LastTickMarker;
 	int m_LastKeyFrame;
+	// first and last recorded tick, also known before the worker thread wrote them
 	int m_FirstTick;
+	int m_LastTick;
+
+	// only set while recording asynchronously
+	CAsync *m_pAsync = nullptr;
+	CQueueStats m_QueueStats;
 
 	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	class CSnapshotDelta *m_pSnapshotDelta;
@@ -32,6 +64,9 @@ class CDemoRecorder : public IDemoRecorder
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
 
+	// written to the end of the file on stop, for seeking without a scan
+	std::vector<CDemoKeyFrame> m_vKeyFrames;
+
 	bool m_NoMapData;
 
 	DEMOFUNC_FILTER m_pfnFilter;
@@ -39,13 +74,20 @@ class CDemoRecorder : public IDemoRecorder
 
 	void WriteTickMarker(int Tick, bool Keyframe);
 	void Write(int Type, const void *pData, int Size);
+	void DoRecordSnapshot(int Tick, const void *pData, int Size);
+	void StopAsync();
 
 public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false);
 	CDemoRecorder() = default;
 	~CDemoRecorder() override;
 
-	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned MapCrc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser);
+	/**
+	 * @param Async Whether to create the deltas, compress and write the data
+	 * on the worker thread shared by all asynchronous recordings. Recording
+	 * then only copies the data to a queue of bounded size.
+	 */
+	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned MapCrc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser, bool Async = false);
 	int Stop(IDemoRecorder::EStopMode Mode, const char *pTargetFilename = "") override;
 
 	void AddDemoMarker();
@@ -57,7 +99,8 @@ public:
 	bool IsRecording() const override { return m_File != nullptr; }
 	const char *CurrentFilename() const override { return m_aCurrentFilename; }
 
-	int Length() const override { return (m_LastTickMarker - m_FirstTick) / SERVER_TICK_SPEED; }
+	int Length() const override { return (m_LastTick - m_FirstTick) / SERVER_TICK_SPEED; }
+	const CQueueStats &QueueStats() const { return m_QueueStats; }
 };
 
 class CDemoPlayer : public IDemoPlayer
@@ -101,24 +144,14 @@ private:
 	TUpdateIntraTimesFunc m_UpdateIntraTimesFunc;
 
 	// Playback
-	class CKeyFrame
-	{
-	public:
-		int64_t m_Filepos;
-		int m_Tick;
-
-		CKeyFrame(int64_t Filepos, int Tick) :
-			m_Filepos(Filepos), m_Tick(Tick)
-		{
-		}
-	};
-
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
 	int64_t m_MapOffset;
 	char m_aFilename[IO_MAX_PATH_LENGTH];
 	char m_aErrorMessage[256];
-	std::vector<CKeyFrame> m_vKeyFrames;
+	std::vector<CDemoKeyFrame> m_vKeyFrames;
+	bool m_KeyFrameIndex;
+	bool m_KeyFramesComplete;
 	CMapInfo m_MapInfo;
 	int m_SpeedIndex;
 
@@ -156,6 +189,7 @@ private:
 		ERROR_UNRECOVERABLE,
 	};
 	EScanFileResult ScanFile();
+	bool ReadKeyFrameIndex();
 	void UpdateTimes();
 
 	int64_t Time();
@@ -196,6 +230,12 @@ public:
 	const CPlaybackInfo *Info() const { return &m_Info; }
 	bool IsPlaying() const override { return m_File != nullptr; }
 	const CMapInfo *GetMapInfo() const { return &m_MapInfo; }
+
+	const std::vector<CDemoKeyFrame> &KeyFrames() const { return m_vKeyFrames; }
+	// whether the keyframes were read from the index at the end of the demo
+	bool HasKeyFrameIndex() const { return m_KeyFrameIndex; }
+	// whether the keyframes were read from the index or the whole file was scanned without errors
+	bool KeyFramesComplete() const { return m_KeyFramesComplete; }
 };
 
 class CDemoEditor : public IDemoEditor
@@ -207,6 +247,15 @@ class CDemoEditor : public IDemoEditor
 public:
 	virtual void Init(class CSnapshotDelta *pSnapshotDelta, class IConsole *pConsole, class IStorage *pStorage);
 	bool Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser) override;
+	/**
+	 * Appends the keyframe index to a demo that was recorded without one,
+	 * so that it can be loaded without scanning it.
+	 *
+	 * @param pDemo Filename of the demo, relative to the save directory or absolute.
+	 *
+	 * @return `true` if the demo has an index now.
+	 */
+	bool AddKeyFrameIndex(const char *pDemo);
 };
 
 #endif
@@ -0,0 +1,185 @@
+#include "gzip.h"
+
+#include <zlib.h>
+
+CGzipWriter::CGzipWriter() = default;
+
+CGzipWriter::~CGzipWriter()
+{
+	Close();
+}
+
+bool CGzipWriter::Open(IOHANDLE File, int Level)
+{
+	dbg_assert(!m_File, "gzip writer already open");
+	m_pStream = new z_stream;
+	mem_zero(m_pStream, sizeof(*m_pStream));
+	// 16 selects the gzip header instead of the zlib one
+	if(deflateInit2(m_pStream, Level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		delete m_pStream;
+		m_pStream = nullptr;
+		io_close(File);
+		return false;
+	}
+	m_File = File;
+	m_Error = 0;
+	{
+		const CLockScope LockScope(m_Lock);
+		m_vPending.clear();
+		m_Closing = false;
+	}
+	m_pThread = thread_init(WorkerThread, this, "gzip writer");
+	return true;
+}
+
+void CGzipWriter::Write(const void *pData, unsigned Size)
+{
+	if(Size == 0)
+		return;
+	{
+		const CLockScope LockScope(m_Lock);
+		const unsigned char *pBytes = static_cast<const unsigned char *>(pData);
+		m_vPending.insert(m_vPending.end(), pBytes, pBytes + Size);
+	}
+	m_Pending.Signal();
+}
+
+void CGzipWriter::Close()
+{
+	if(!m_File)
+		return;
+	{
+		const CLockScope LockScope(m_Lock);
+		m_Closing = true;
+	}
+	m_Pending.Signal();
+	thread_wait(m_pThread);
+	m_pThread = nullptr;
+
+	deflateEnd(m_pStream);
+	delete m_pStream;
+	m_pStream = nullptr;
+	if(io_close(m_File) != 0 && !m_Error)
+		m_Error = Z_ERRNO;
+	m_File = nullptr;
+}
+
+void CGzipWriter::WorkerThread(void *pUser)
+{
+	static_cast<CGzipWriter *>(pUser)->Run();
+}
+
+void CGzipWriter::Run()
+{
+	// swapped with the pending data, so that the main thread can keep
+	// appending while this one compresses
+	std::vector<unsigned char> vData;
+	bool Closing = false;
+	while(!Closing)
+	{
+		m_Pending.Wait();
+		{
+			const CLockScope LockScope(m_Lock);
+			std::swap(vData, m_vPending);
+			Closing = m_Closing;
+		}
+		if(!m_Error && (!vData.empty() || Closing))
+			Deflate(vData.data(), vData.size(), Closing);
+		vData.clear();
+	}
+}
+
+bool CGzipWriter::Deflate(const void *pData, unsigned Size, bool Finish)
+{
+	unsigned char aOutput[64 * 1024];
+	m_pStream->next_in = (Bytef *)pData;
+	m_pStream->avail_in = Size;
+	do
+	{
+		m_pStream->next_out = aOutput;
+		m_pStream->avail_out = sizeof(aOutput);
+		const int Result = deflate(m_pStream, Finish ? Z_FINISH : Z_NO_FLUSH);
+		if(Result == Z_STREAM_ERROR)
+		{
+			m_Error = Result;
+			return false;
+		}
+		const unsigned Have = sizeof(aOutput) - m_pStream->avail_out;
+		if(Have && io_write(m_File, aOutput, Have) != Have)
+		{
+			m_Error = Z_ERRNO;
+			return false;
+		}
+	} while(m_pStream->avail_out == 0);
+	return true;
+}
+
+CGzipReader::CGzipReader() = default;
+
+CGzipReader::~CGzipReader()
+{
+	Close();
+}
+
+bool CGzipReader::Open(IOHANDLE File)
+{
+	dbg_assert(!m_File, "gzip reader already open");
+	m_pStream = new z_stream;
+	mem_zero(m_pStream, sizeof(*m_pStream));
+	if(inflateInit2(m_pStream, 15 + 16) != Z_OK)
+	{
+		delete m_pStream;
+		m_pStream = nullptr;
+		io_close(File);
+		return false;
+	}
+	m_File = File;
+	m_End = false;
+	return true;
+}
+
+int CGzipReader::Read(void *pBuffer, unsigned Size)
+{
+	if(!m_File || m_End)
+		return 0;
+	m_pStream->next_out = (Bytef *)pBuffer;
+	m_pStream->avail_out = Size;
+	while(m_pStream->avail_out > 0)
+	{
+		if(m_pStream->avail_in == 0)
+		{
+			const unsigned Read = io_read(m_File, m_aInput, sizeof(m_aInput));
+			if(Read == 0)
+			{
+				// also the end of files that were not closed properly
+				m_End = true;
+				break;
+			}
+			m_pStream->next_in = m_aInput;
+			m_pStream->avail_in = Read;
+		}
+		const int Result = inflate(m_pStream, Z_NO_FLUSH);
+		if(Result == Z_STREAM_END)
+		{
+			// continue with the next concatenated gzip stream, if any
+			inflateReset(m_pStream);
+		}
+		else if(Result != Z_OK && Result != Z_BUF_ERROR)
+		{
+			return -1;
+		}
+	}
+	return Size - m_pStream->avail_out;
+}
+
+void CGzipReader::Close()
+{
+	if(!m_File)
+		return;
+	inflateEnd(m_pStream);
+	delete m_pStream;
+	m_pStream = nullptr;
+	io_close(m_File);
+	m_File = nullptr;
+}
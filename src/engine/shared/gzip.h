@@ -0,0 +1,101 @@
+#ifndef ENGINE_SHARED_GZIP_H
+#define ENGINE_SHARED_GZIP_H
+
+#include <base/lock.h>
+#include <base/system.h>
+#include <base/tl/threading.h>
+
+#include <atomic>
+#include <vector>
+
+struct z_stream_s;
+
+/**
+ * Writes a gzip file. The data is compressed and written to the file on a
+ * worker thread, so `Write` only copies it.
+ *
+ * @see CGzipReader
+ */
+class CGzipWriter
+{
+	IOHANDLE m_File = nullptr;
+	void *m_pThread = nullptr;
+	z_stream_s *m_pStream = nullptr;
+
+	CLock m_Lock;
+	CSemaphore m_Pending;
+	// data that was written but not yet compressed
+	std::vector<unsigned char> m_vPending GUARDED_BY(m_Lock);
+	bool m_Closing GUARDED_BY(m_Lock) = false;
+	std::atomic_int m_Error{0};
+
+	static void WorkerThread(void *pUser);
+	void Run() REQUIRES(!m_Lock);
+	bool Deflate(const void *pData, unsigned Size, bool Finish);
+
+public:
+	CGzipWriter();
+	~CGzipWriter();
+	CGzipWriter(const CGzipWriter &) = delete;
+
+	/**
+	 * Starts writing a gzip file.
+	 *
+	 * @param File File handle opened for writing, the writer takes ownership.
+	 * @param Level zlib compression level, -1 for the default.
+	 *
+	 * @return `true` on success, the file is closed otherwise.
+	 */
+	bool Open(IOHANDLE File, int Level = -1) REQUIRES(!m_Lock);
+
+	/**
+	 * Queues data for compression.
+	 */
+	void Write(const void *pData, unsigned Size) REQUIRES(!m_Lock);
+
+	/**
+	 * @return `0` if everything so far was compressed and written, an error
+	 * code otherwise.
+	 */
+	int Error() const { return m_Error.load(); }
+
+	/**
+	 * Compresses the remaining data, finishes the gzip stream, waits for the
+	 * worker thread and closes the file.
+	 */
+	void Close() REQUIRES(!m_Lock);
+};
+
+/**
+ * Reads gzip files like the ones written by @link CGzipWriter @endlink, also
+ * if several gzip streams were concatenated.
+ */
+class CGzipReader
+{
+	IOHANDLE m_File = nullptr;
+	z_stream_s *m_pStream = nullptr;
+	unsigned char m_aInput[64 * 1024];
+	bool m_End = false;
+
+public:
+	CGzipReader();
+	~CGzipReader();
+	CGzipReader(const CGzipReader &) = delete;
+
+	/**
+	 * @param File File handle opened for reading, the reader takes ownership.
+	 */
+	bool Open(IOHANDLE File);
+
+	/**
+	 * Reads uncompressed data.
+	 *
+	 * @return The number of bytes read, `0` at the end of the file, `-1` if
+	 * the file is corrupted.
+	 */
+	int Read(void *pBuffer, unsigned Size);
+
+	void Close();
+};
+
+#endif
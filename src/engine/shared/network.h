@@ -6,10 +6,12 @@
 #include "ringbuffer.h"
 #include "stun.h"
 
+#include <base/lock.h>
 #include <base/types.h>
 
 #include <array>
 #include <optional>
+#include <vector>
 
 class CHuffman;
 class CNetBan;
@@ -434,6 +436,20 @@ class CNetServer
 
 	CNetRecvUnpacker m_RecvUnpacker;
 
+	// packets that arrived on other sockets bound to the same address, see ForwardPacket
+	class CForwardedPacket
+	{
+	public:
+		NETADDR m_Addr;
+		int m_Size;
+		unsigned char m_aData[NET_MAX_PACKETSIZE];
+	};
+	CLock m_ForwardedLock;
+	std::vector<CForwardedPacket> m_vForwardedPending GUARDED_BY(m_ForwardedLock);
+	std::vector<CForwardedPacket> m_vForwarded;
+	size_t m_ForwardedPos = 0;
+	int RecvForwarded(NETADDR *pAddr, unsigned char **ppData) REQUIRES(!m_ForwardedLock);
+
 	void OnTokenCtrlMsg(NETADDR &Addr, int ControlMsg, const CNetPacketConstruct &Packet);
 	int OnSixupCtrlMsg(NETADDR &Addr, CNetChunk *pChunk, int ControlMsg, const CNetPacketConstruct &Packet, SECURITY_TOKEN &ResponseToken, SECURITY_TOKEN Token);
 	void OnPreConnMsg(NETADDR &Addr, CNetPacketConstruct &Packet);
@@ -452,13 +468,22 @@ public:
 	int SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_NEWCLIENT_NOAUTH pfnNewClientNoAuth, NETFUNC_CLIENTREJOIN pfnClientRejoin, NETFUNC_DELCLIENT pfnDelClient, void *pUser);
 
 	//
-	bool Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp);
+	bool Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp, bool ReusePort = false);
 	void Close();
 
 	//
-	int Recv(CNetChunk *pChunk, SECURITY_TOKEN *pResponseToken);
+	int Recv(CNetChunk *pChunk, SECURITY_TOKEN *pResponseToken) REQUIRES(!m_ForwardedLock);
 	int Send(CNetChunk *pChunk);
 	void Update();
+	void SetSendBatching(bool Enable);
+	void Flush();
+
+	// at most this many forwarded packets wait for Recv, more are dropped
+	static constexpr size_t MAX_FORWARDED_PACKETS = 1024;
+	// thread-safe, the packet is handled by Recv as if it arrived on this
+	// socket, and a net_socket_read_wait on the socket returns
+	void ForwardPacket(const NETADDR &Addr, const unsigned char *pData, int Size) REQUIRES(!m_ForwardedLock);
+	bool HasForwardedPackets() REQUIRES(!m_ForwardedLock);
 
 	//
 	void Drop(int ClientId, const char *pReason);
@@ -37,16 +37,24 @@ const unsigned char g_aDummyMapData[] = {
 	0x78, 0x9C, 0x63, 0x64, 0x60, 0x60, 0x60, 0x44, 0xC2, 0x00, 0x00, 0x38,
 	0x00, 0x05};
 
-bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp)
+bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp, bool ReusePort)
 {
 	// zero out the whole structure
 	this->~CNetServer();
 	new(this) CNetServer{};
 
 	// open socket
-	m_Socket = net_udp_create(BindAddr);
+	m_Socket = net_udp_create(BindAddr, ReusePort);
 	if(!m_Socket)
 		return false;
+	// packets forwarded from the other sockets must wake up the game thread
+	if(ReusePort && !net_socket_read_wait_interruptible(m_Socket))
+	{
+		dbg_msg("netserver", "failed to create the wakeup pipe of the socket");
+		net_udp_close(m_Socket);
+		m_Socket = nullptr;
+		return false;
+	}
 
 	m_Address = BindAddr;
 	m_pNetBan = pNetBan;
@@ -93,6 +101,16 @@ void CNetServer::Close()
 	m_Socket = nullptr;
 }
 
+void CNetServer::SetSendBatching(bool Enable)
+{
+	net_udp_set_send_batching(m_Socket, Enable);
+}
+
+void CNetServer::Flush()
+{
+	net_udp_flush(m_Socket);
+}
+
 void CNetServer::Drop(int ClientId, const char *pReason)
 {
 	// TODO: insert lots of checks here
@@ -595,6 +613,8 @@ int CNetServer::Recv(CNetChunk *pChunk, SECURITY_TOKEN *pResponseToken)
 		// TODO: empty the recvinfo
 		unsigned char *pData;
 		int Bytes = net_udp_recv(m_Socket, &Addr, &pData);
+		if(Bytes <= 0)
+			Bytes = RecvForwarded(&Addr, &pData);
 
 		// no more packets for now
 		if(Bytes <= 0)
@@ -678,6 +698,53 @@ int CNetServer::Recv(CNetChunk *pChunk, SECURITY_TOKEN *pResponseToken)
 	return 0;
 }
 
+void CNetServer::ForwardPacket(const NETADDR &Addr, const unsigned char *pData, int Size)
+{
+	dbg_assert(Size > 0 && Size <= NET_MAX_PACKETSIZE, "invalid forwarded packet size %d", Size);
+	bool Wakeup;
+	{
+		const CLockScope LockScope(m_ForwardedLock);
+		// like a full socket buffer
+		if(m_vForwardedPending.size() >= MAX_FORWARDED_PACKETS)
+			return;
+		// the game thread takes all pending packets at once, so it only
+		// needs to be woken up for the first one
+		Wakeup = m_vForwardedPending.empty();
+		CForwardedPacket &Packet = m_vForwardedPending.emplace_back();
+		Packet.m_Addr = Addr;
+		Packet.m_Size = Size;
+		mem_copy(Packet.m_aData, pData, Size);
+	}
+	if(Wakeup)
+		net_socket_read_wait_interrupt(m_Socket);
+}
+
+bool CNetServer::HasForwardedPackets()
+{
+	if(m_ForwardedPos < m_vForwarded.size())
+		return true;
+	const CLockScope LockScope(m_ForwardedLock);
+	return !m_vForwardedPending.empty();
+}
+
+int CNetServer::RecvForwarded(NETADDR *pAddr, unsigned char **ppData)
+{
+	if(m_ForwardedPos >= m_vForwarded.size())
+	{
+		// take all pending packets at once, keeping both allocations
+		m_vForwarded.clear();
+		m_ForwardedPos = 0;
+		const CLockScope LockScope(m_ForwardedLock);
+		std::swap(m_vForwarded, m_vForwardedPending);
+		if(m_vForwarded.empty())
+			return 0;
+	}
+	CForwardedPacket &Packet = m_vForwarded[m_ForwardedPos++];
+	*pAddr = Packet.m_Addr;
+	*ppData = Packet.m_aData;
+	return Packet.m_Size;
+}
+
 int CNetServer::Send(CNetChunk *pChunk)
 {
 	if(pChunk->m_DataSize >= NET_MAX_PAYLOAD)
@@ -4,7 +4,9 @@
 #include "compression.h"
 #include "uuid_manager.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <iterator>
 #include <limits>
 
 #include <base/math.h>
@@ -13,6 +15,15 @@
 #include <generated/protocol7.h>
 #include <generated/protocolglue.h>
 
+// SSE2 is part of amd64 and NEON of arm64, so neither needs a runtime check
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SNAPSHOT_DELTA_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SNAPSHOT_DELTA_NEON 1
+#endif
+
 // CSnapshot
 
 const CSnapshotItem *CSnapshot::GetItem(int Index) const
@@ -183,37 +194,49 @@ static inline size_t CalcHashId(int Key)
 	return Hash % HASHLIST_SIZE;
 }
 
-static void GenerateHash(CItemList *pHashlist, const CSnapshot *pSnapshot)
+static int GetItemIndexHashed(int Key, size_t HashId, const CItemList *pHashlist)
+{
+	for(int i = 0; i < pHashlist[HashId].m_Num; i++)
+	{
+		if(pHashlist[HashId].m_aKeys[i] == Key)
+			return pHashlist[HashId].m_aIndex[i];
+	}
+
+	return -1;
+}
+
+static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
+{
+	return GetItemIndexHashed(Key, CalcHashId(Key), pHashlist);
+}
+
+// returns false if an item didn't fit into its bucket or has the key of
+// an earlier item, i.e. the hash list can't find every item
+static bool GenerateHash(CItemList *pHashlist, const CSnapshot *pSnapshot)
 {
 	for(int i = 0; i < HASHLIST_SIZE; i++)
 		pHashlist[i].m_Num = 0;
 
+	bool Complete = true;
 	for(int i = 0; i < pSnapshot->NumItems(); i++)
 	{
 		int Key = pSnapshot->GetItem(i)->Key();
 		size_t HashId = CalcHashId(Key);
 		if(pHashlist[HashId].m_Num < HASHLIST_BUCKET_SIZE)
 		{
+			if(Complete && GetItemIndexHashed(Key, HashId, pHashlist) != -1)
+				Complete = false;
 			pHashlist[HashId].m_aIndex[pHashlist[HashId].m_Num] = i;
 			pHashlist[HashId].m_aKeys[pHashlist[HashId].m_Num] = Key;
 			pHashlist[HashId].m_Num++;
 		}
+		else
+			Complete = false;
 	}
+	return Complete;
 }
 
-static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
-{
-	size_t HashId = CalcHashId(Key);
-	for(int i = 0; i < pHashlist[HashId].m_Num; i++)
-	{
-		if(pHashlist[HashId].m_aKeys[i] == Key)
-			return pHashlist[HashId].m_aIndex[i];
-	}
-
-	return -1;
-}
-
-int CSnapshotDelta::DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
+int CSnapshotDelta::DiffItemScalar(const int *pPast, const int *pCurrent, int *pOut, int Size)
 {
 	int Needed = 0;
 	while(Size)
@@ -230,21 +253,56 @@ int CSnapshotDelta::DiffItem(const int *pPast, const int *pCurrent, int *pOut, i
 	return Needed;
 }
 
-void CSnapshotDelta::UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, uint64_t *pDataRate)
+int CSnapshotDelta::DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
+{
+	int Needed = 0;
+#if defined(SNAPSHOT_DELTA_SSE2)
+	__m128i NeededVec = _mm_setzero_si128();
+	for(; Size >= 4; Size -= 4)
+	{
+		const __m128i Diff = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)pCurrent), _mm_loadu_si128((const __m128i *)pPast));
+		_mm_storeu_si128((__m128i *)pOut, Diff);
+		NeededVec = _mm_or_si128(NeededVec, Diff);
+		pOut += 4;
+		pPast += 4;
+		pCurrent += 4;
+	}
+	NeededVec = _mm_or_si128(NeededVec, _mm_shuffle_epi32(NeededVec, _MM_SHUFFLE(1, 0, 3, 2)));
+	NeededVec = _mm_or_si128(NeededVec, _mm_shuffle_epi32(NeededVec, _MM_SHUFFLE(2, 3, 0, 1)));
+	Needed = _mm_cvtsi128_si32(NeededVec);
+#elif defined(SNAPSHOT_DELTA_NEON)
+	uint32x4_t NeededVec = vdupq_n_u32(0);
+	for(; Size >= 4; Size -= 4)
+	{
+		const uint32x4_t Diff = vsubq_u32(vld1q_u32((const uint32_t *)pCurrent), vld1q_u32((const uint32_t *)pPast));
+		vst1q_u32((uint32_t *)pOut, Diff);
+		NeededVec = vorrq_u32(NeededVec, Diff);
+		pOut += 4;
+		pPast += 4;
+		pCurrent += 4;
+	}
+	const uint32x2_t NeededHalf = vorr_u32(vget_low_u32(NeededVec), vget_high_u32(NeededVec));
+	Needed = (int)(vget_lane_u32(NeededHalf, 0) | vget_lane_u32(NeededHalf, 1));
+#endif
+	return Needed | DiffItemScalar(pPast, pCurrent, pOut, Size);
+}
+
+static uint64_t DiffDataRate(int Diff)
+{
+	if(Diff == 0)
+		return 1;
+	unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
+	unsigned char *pEnd = CVariableInt::Pack(aBuf, Diff, sizeof(aBuf));
+	return (uint64_t)(pEnd - (unsigned char *)aBuf) * 8;
+}
+
+void CSnapshotDelta::UndiffItemScalar(const int *pPast, const int *pDiff, int *pOut, int Size, uint64_t *pDataRate)
 {
 	while(Size)
 	{
 		// addition with wrapping by casting to unsigned
 		*pOut = (unsigned)*pPast + (unsigned)*pDiff;
-
-		if(*pDiff == 0)
-			*pDataRate += 1;
-		else
-		{
-			unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
-			unsigned char *pEnd = CVariableInt::Pack(aBuf, *pDiff, sizeof(aBuf));
-			*pDataRate += (uint64_t)(pEnd - (unsigned char *)aBuf) * 8;
-		}
+		*pDataRate += DiffDataRate(*pDiff);
 
 		pOut++;
 		pPast++;
@@ -253,6 +311,42 @@ void CSnapshotDelta::UndiffItem(const int *pPast, const int *pDiff, int *pOut, i
 	}
 }
 
+void CSnapshotDelta::UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, uint64_t *pDataRate)
+{
+	// most fields of an updated item don't change, only look at the
+	// packed size of a diff if its group of four has a non-zero one
+#if defined(SNAPSHOT_DELTA_SSE2)
+	for(; Size >= 4; Size -= 4)
+	{
+		const __m128i Diff = _mm_loadu_si128((const __m128i *)pDiff);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(Diff, _mm_setzero_si128())) == 0xffff)
+			*pDataRate += 4;
+		else
+			for(int i = 0; i < 4; i++)
+				*pDataRate += DiffDataRate(pDiff[i]);
+		_mm_storeu_si128((__m128i *)pOut, _mm_add_epi32(_mm_loadu_si128((const __m128i *)pPast), Diff));
+		pOut += 4;
+		pPast += 4;
+		pDiff += 4;
+	}
+#elif defined(SNAPSHOT_DELTA_NEON)
+	for(; Size >= 4; Size -= 4)
+	{
+		const uint32x4_t Diff = vld1q_u32((const uint32_t *)pDiff);
+		if(vmaxvq_u32(Diff) == 0)
+			*pDataRate += 4;
+		else
+			for(int i = 0; i < 4; i++)
+				*pDataRate += DiffDataRate(pDiff[i]);
+		vst1q_u32((uint32_t *)pOut, vaddq_u32(vld1q_u32((const uint32_t *)pPast), Diff));
+		pOut += 4;
+		pPast += 4;
+		pDiff += 4;
+	}
+#endif
+	UndiffItemScalar(pPast, pDiff, pOut, Size, pDataRate);
+}
+
 CSnapshotDelta::CSnapshotDelta()
 {
 	mem_zero(m_aItemSizes, sizeof(m_aItemSizes));
@@ -291,7 +385,7 @@ const CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta() const
 }
 
 // TODO: OPT: this should be made much faster
-int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData)
+int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData) const
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_aData;
@@ -301,31 +395,47 @@ int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, vo
 	pDelta->m_NumTempItems = 0;
 
 	CItemList aHashlist[HASHLIST_SIZE];
-	GenerateHash(aHashlist, pTo);
+	const bool CompleteTo = GenerateHash(aHashlist, pTo);
 
-	// pack deleted stuff
+	int aPastIndices[CSnapshot::MAX_ITEMS];
+	const int NumItems = pTo->NumItems();
+	std::fill(aPastIndices, aPastIndices + NumItems, -1);
+
+	// pack deleted stuff, the same lookup finds the previous indices
+	// of the items that are still there
+	short aFromBucketSizes[HASHLIST_SIZE] = {0};
+	bool CompleteFrom = true;
 	for(int i = 0; i < pFrom->NumItems(); i++)
 	{
 		const CSnapshotItem *pFromItem = pFrom->GetItem(i);
-		if(GetItemIndexHashed(pFromItem->Key(), aHashlist) == -1)
+		const size_t HashId = CalcHashId(pFromItem->Key());
+		if(++aFromBucketSizes[HashId] > HASHLIST_BUCKET_SIZE)
+			CompleteFrom = false;
+		const int Index = GetItemIndexHashed(pFromItem->Key(), HashId, aHashlist);
+		if(Index == -1)
 		{
 			// deleted
 			pDelta->m_NumDeletedItems++;
 			*pData = pFromItem->Key();
 			pData++;
 		}
+		else if(aPastIndices[Index] == -1)
+			aPastIndices[Index] = i;
 	}
 
-	GenerateHash(aHashlist, pFrom);
-
-	// fetch previous indices
-	// we do this as a separate pass because it helps the cache
-	int aPastIndices[CSnapshot::MAX_ITEMS];
-	const int NumItems = pTo->NumItems();
-	for(int i = 0; i < NumItems; i++)
+	// with duplicate keys or full buckets the shortcut above doesn't find
+	// the same previous items as a lookup in the old snapshot would
+	if(!CompleteTo || !CompleteFrom)
 	{
-		const CSnapshotItem *pCurItem = pTo->GetItem(i); // O(1) .. O(n)
-		aPastIndices[i] = GetItemIndexHashed(pCurItem->Key(), aHashlist); // O(n) .. O(n^n)
+		GenerateHash(aHashlist, pFrom);
+
+		// fetch previous indices
+		// we do this as a separate pass because it helps the cache
+		for(int i = 0; i < NumItems; i++)
+		{
+			const CSnapshotItem *pCurItem = pTo->GetItem(i); // O(1) .. O(n)
+			aPastIndices[i] = GetItemIndexHashed(pCurItem->Key(), aHashlist); // O(n) .. O(n^n)
+		}
 	}
 
 	for(int i = 0; i < NumItems; i++)
@@ -611,10 +721,38 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 
 // CSnapshotStorage
 
-void CSnapshotStorage::Init()
+static constexpr size_t SNAPSHOT_STORAGE_ALIGNMENT = 8;
+
+static size_t SnapshotStorageAlign(size_t Size)
+{
+	return (Size + SNAPSHOT_STORAGE_ALIGNMENT - 1) & ~(SNAPSHOT_STORAGE_ALIGNMENT - 1);
+}
+
+// holder, snapshot and alt snapshot share one block
+static size_t SnapshotStorageBlockSize(size_t DataSize, size_t AltDataSize)
+{
+	return SnapshotStorageAlign(sizeof(CSnapshotStorage::CHolder)) + SnapshotStorageAlign(DataSize) + SnapshotStorageAlign(AltDataSize);
+}
+
+CSnapshotStorage::CSnapshotStorage()
 {
 	m_pFirst = nullptr;
 	m_pLast = nullptr;
+	m_pArena = nullptr;
+	m_ArenaSize = 0;
+	m_pRetiredArena = nullptr;
+	m_RetiredArenaSize = 0;
+	Init();
+}
+
+CSnapshotStorage::~CSnapshotStorage()
+{
+	PurgeAll();
+}
+
+void CSnapshotStorage::Init()
+{
+	PurgeAll();
 }
 
 void CSnapshotStorage::PurgeAll()
@@ -622,12 +760,15 @@ void CSnapshotStorage::PurgeAll()
 	while(m_pFirst)
 	{
 		CHolder *pNext = m_pFirst->m_pNext;
-		free(m_pFirst->m_pSnap);
-		free(m_pFirst->m_pAltSnap);
-		free(m_pFirst);
+		FreeHolder(m_pFirst);
 		m_pFirst = pNext;
 	}
 	m_pLast = nullptr;
+
+	FreeArenas();
+	m_NumHeapFallbacks = 0;
+	m_NumUnindexed = 0;
+	std::fill(std::begin(m_apTickIndex), std::end(m_apTickIndex), nullptr);
 }
 
 void CSnapshotStorage::PurgeUntil(int Tick)
@@ -639,9 +780,7 @@ void CSnapshotStorage::PurgeUntil(int Tick)
 		CHolder *pNext = pHolder->m_pNext;
 		if(pHolder->m_Tick >= Tick)
 			return; // no more to remove
-		free(pHolder->m_pSnap);
-		free(pHolder->m_pAltSnap);
-		free(pHolder);
+		FreeHolder(pHolder);
 
 		// did we come to the end of the list?
 		if(!pNext)
@@ -662,17 +801,19 @@ void CSnapshotStorage::Add(int Tick, int64_t Tagtime, size_t DataSize, const voi
 	dbg_assert(DataSize <= (size_t)CSnapshot::MAX_SIZE, "Snapshot data size invalid");
 	dbg_assert(AltDataSize <= (size_t)CSnapshot::MAX_SIZE, "Alt snapshot data size invalid");
 
-	CHolder *pHolder = static_cast<CHolder *>(malloc(sizeof(CHolder)));
+	const size_t HolderSize = SnapshotStorageAlign(sizeof(CHolder));
+	const size_t SnapSize = SnapshotStorageAlign(DataSize);
+	CHolder *pHolder = static_cast<CHolder *>(AllocHolder(SnapshotStorageBlockSize(DataSize, AltDataSize)));
 	pHolder->m_Tick = Tick;
 	pHolder->m_Tagtime = Tagtime;
 
-	pHolder->m_pSnap = static_cast<CSnapshot *>(malloc(DataSize));
+	pHolder->m_pSnap = reinterpret_cast<CSnapshot *>(reinterpret_cast<char *>(pHolder) + HolderSize);
 	mem_copy(pHolder->m_pSnap, pData, DataSize);
 	pHolder->m_SnapSize = DataSize;
 
 	if(AltDataSize) // create alternative if wanted
 	{
-		pHolder->m_pAltSnap = static_cast<CSnapshot *>(malloc(AltDataSize));
+		pHolder->m_pAltSnap = reinterpret_cast<CSnapshot *>(reinterpret_cast<char *>(pHolder) + HolderSize + SnapSize);
 		mem_copy(pHolder->m_pAltSnap, pAltData, AltDataSize);
 		pHolder->m_AltSnapSize = AltDataSize;
 	}
@@ -690,29 +831,169 @@ void CSnapshotStorage::Add(int Tick, int64_t Tagtime, size_t DataSize, const voi
 	else
 		m_pFirst = pHolder;
 	m_pLast = pHolder;
+
+	// keep the oldest holder for duplicate ticks, like the list walk in Get
+	CHolder *&pIndexed = m_apTickIndex[Tick & (TICK_INDEX_SIZE - 1)];
+	if(pIndexed && pIndexed->m_Tick == Tick)
+	{
+		m_NumUnindexed++;
+	}
+	else
+	{
+		if(pIndexed)
+			m_NumUnindexed++;
+		pIndexed = pHolder;
+	}
 }
 
 int CSnapshotStorage::Get(int Tick, int64_t *pTagtime, const CSnapshot **ppData, const CSnapshot **ppAltData) const
 {
-	CHolder *pHolder = m_pFirst;
+	const CHolder *pHolder = m_apTickIndex[Tick & (TICK_INDEX_SIZE - 1)];
+	if(!pHolder || pHolder->m_Tick != Tick)
+	{
+		pHolder = nullptr;
+		// the index can only miss a stored tick if another holder took its
+		// slot, fall back to walking the list in that case
+		if(m_NumUnindexed > 0)
+		{
+			for(const CHolder *pCur = m_pFirst; pCur; pCur = pCur->m_pNext)
+			{
+				if(pCur->m_Tick == Tick)
+				{
+					pHolder = pCur;
+					break;
+				}
+			}
+		}
+		if(!pHolder)
+			return -1;
+	}
 
-	while(pHolder)
+	if(pTagtime)
+		*pTagtime = pHolder->m_Tagtime;
+	if(ppData)
+		*ppData = pHolder->m_pSnap;
+	if(ppAltData)
+		*ppAltData = pHolder->m_pAltSnap;
+	return pHolder->m_SnapSize;
+}
+
+void *CSnapshotStorage::AllocArena(size_t Size)
+{
+	if(!m_pArena)
+		return nullptr;
+
+	if(m_NumArenaBlocks == 0)
 	{
-		if(pHolder->m_Tick == Tick)
+		m_ArenaHead = 0;
+		m_ArenaTail = 0;
+	}
+
+	// blocks are appended at the head and purged in order from the tail
+	size_t Offset;
+	if(m_NumArenaBlocks == 0 || m_ArenaHead > m_ArenaTail)
+	{
+		// free space is [head, size) and [0, tail)
+		if(m_ArenaSize - m_ArenaHead >= Size)
+			Offset = m_ArenaHead;
+		else if(m_ArenaTail >= Size)
+			Offset = 0;
+		else
+			return nullptr;
+	}
+	else
+	{
+		// wrapped around, free space is [head, tail)
+		if(m_ArenaTail - m_ArenaHead >= Size)
+			Offset = m_ArenaHead;
+		else
+			return nullptr;
+	}
+
+	m_ArenaHead = Offset + Size;
+	m_NumArenaBlocks++;
+	return m_pArena + Offset;
+}
+
+void *CSnapshotStorage::AllocHolder(size_t Size)
+{
+	void *pBlock = AllocArena(Size);
+	if(pBlock)
+		return pBlock;
+
+	// grow the arena, the old one stays alive until its snapshots are purged
+	if(!m_pRetiredArena && m_ArenaSize < (size_t)ARENA_MAX_SIZE)
+	{
+		size_t NewSize = m_ArenaSize ? m_ArenaSize * 2 : (size_t)ARENA_INITIAL_SIZE;
+		while(NewSize < Size && NewSize < (size_t)ARENA_MAX_SIZE)
+			NewSize *= 2;
+		if(m_pArena && m_NumArenaBlocks > 0)
+		{
+			m_pRetiredArena = m_pArena;
+			m_RetiredArenaSize = m_ArenaSize;
+			m_NumRetiredArenaBlocks = m_NumArenaBlocks;
+		}
+		else
 		{
-			if(pTagtime)
-				*pTagtime = pHolder->m_Tagtime;
-			if(ppData)
-				*ppData = pHolder->m_pSnap;
-			if(ppAltData)
-				*ppAltData = pHolder->m_pAltSnap;
-			return pHolder->m_SnapSize;
+			free(m_pArena);
 		}
+		m_pArena = static_cast<char *>(malloc(NewSize));
+		m_ArenaSize = NewSize;
+		m_NumArenaBlocks = 0;
 
-		pHolder = pHolder->m_pNext;
+		pBlock = AllocArena(Size);
+		if(pBlock)
+			return pBlock;
 	}
 
-	return -1;
+	m_NumHeapFallbacks++;
+	return malloc(Size);
+}
+
+void CSnapshotStorage::FreeHolder(CHolder *pHolder)
+{
+	CHolder *&pIndexed = m_apTickIndex[pHolder->m_Tick & (TICK_INDEX_SIZE - 1)];
+	if(pIndexed == pHolder)
+		pIndexed = nullptr;
+	else
+		m_NumUnindexed--;
+
+	char *pBlock = reinterpret_cast<char *>(pHolder);
+	if(m_pArena && pBlock >= m_pArena && pBlock < m_pArena + m_ArenaSize)
+	{
+		// blocks are purged in insertion order, so this is the oldest block
+		m_ArenaTail = (pBlock - m_pArena) + SnapshotStorageBlockSize(pHolder->m_SnapSize, pHolder->m_AltSnapSize);
+		m_NumArenaBlocks--;
+	}
+	else if(m_pRetiredArena && pBlock >= m_pRetiredArena && pBlock < m_pRetiredArena + m_RetiredArenaSize)
+	{
+		m_NumRetiredArenaBlocks--;
+		if(m_NumRetiredArenaBlocks == 0)
+		{
+			free(m_pRetiredArena);
+			m_pRetiredArena = nullptr;
+			m_RetiredArenaSize = 0;
+		}
+	}
+	else
+	{
+		free(pHolder);
+	}
+}
+
+void CSnapshotStorage::FreeArenas()
+{
+	free(m_pArena);
+	m_pArena = nullptr;
+	m_ArenaSize = 0;
+	m_ArenaHead = 0;
+	m_ArenaTail = 0;
+	m_NumArenaBlocks = 0;
+
+	free(m_pRetiredArena);
+	m_pRetiredArena = nullptr;
+	m_RetiredArenaSize = 0;
+	m_NumRetiredArenaBlocks = 0;
 }
 
 // CSnapshotBuilder
@@ -862,3 +1143,54 @@ void *CSnapshotBuilder::NewItem(int Type, int Id, int Size)
 	mem_zero(pObj->Data(), Size);
 	return pObj->Data();
 }
+
+// CSnapshotItemBuffer
+CSnapshotItemBuffer::CSnapshotItemBuffer()
+{
+	Clear();
+}
+
+void CSnapshotItemBuffer::Clear()
+{
+	m_DataSize = 0;
+	m_NumItems = 0;
+}
+
+void *CSnapshotItemBuffer::NewItem(int Type, int Id, int Size)
+{
+	if(Id == -1)
+	{
+		return nullptr;
+	}
+
+	if(m_NumItems >= CSnapshot::MAX_ITEMS || m_DataSize + Size > CSnapshot::MAX_SIZE)
+	{
+		return nullptr;
+	}
+
+	CItem &Item = m_aItems[m_NumItems];
+	Item.m_Type = Type;
+	Item.m_Id = Id;
+	Item.m_Size = Size;
+	Item.m_Offset = m_DataSize;
+	m_DataSize += Size;
+	m_NumItems++;
+
+	void *pData = m_aData + Item.m_Offset;
+	mem_zero(pData, Size);
+	return pData;
+}
+
+void CSnapshotItemBuffer::AddToBuilder(CSnapshotBuilder *pBuilder, int First, int Num) const
+{
+	dbg_assert(First >= 0 && Num >= 0 && First + Num <= m_NumItems, "item range out of bounds");
+	for(int i = First; i < First + Num; i++)
+	{
+		const CItem &Item = m_aItems[i];
+		void *pData = pBuilder->NewItem(Item.m_Type, Item.m_Id, Item.m_Size);
+		if(pData)
+		{
+			mem_copy(pData, m_aData + Item.m_Offset, Item.m_Size);
+		}
+	}
+}
@@ -97,10 +97,12 @@ private:
 	uint64_t m_aSnapshotDataUpdates[CSnapshot::MAX_TYPE + 1];
 	CData m_Empty;
 
-	static void UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, uint64_t *pDataRate);
-
 public:
+	// the vectorized versions must produce the same output as the scalar ones
 	static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size);
+	static int DiffItemScalar(const int *pPast, const int *pCurrent, int *pOut, int Size);
+	static void UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, uint64_t *pDataRate);
+	static void UndiffItemScalar(const int *pPast, const int *pDiff, int *pOut, int Size, uint64_t *pDataRate);
 	CSnapshotDelta();
 	CSnapshotDelta(const CSnapshotDelta &Old);
 	uint64_t GetDataRate(int Index) const { return m_aSnapshotDataRate[Index]; }
@@ -108,7 +110,7 @@ public:
 	void SetStaticsize(int ItemType, size_t Size);
 	void SetStaticsize7(int ItemType, size_t Size);
 	const CData *EmptyDelta() const;
-	int CreateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData);
+	int CreateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData) const;
 	int UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const void *pSrcData, int DataSize, bool Sixup);
 	int DebugDumpDelta(const void *pSrcData, int DataSize);
 };
@@ -134,16 +136,56 @@ public:
 		CSnapshot *m_pAltSnap;
 	};
 
+	enum
+	{
+		// holders, snapshots and alt snapshots are stored back to back in a ring
+		// arena, which grows by doubling up to the maximum size. Snapshots that
+		// do not fit are allocated on the heap instead.
+		ARENA_INITIAL_SIZE = 256 * 1024,
+		ARENA_MAX_SIZE = 16 * 1024 * 1024,
+		// must be a power of two, should cover the retention window (3 seconds)
+		TICK_INDEX_SIZE = 256,
+	};
+
 	CHolder *m_pFirst;
 	CHolder *m_pLast;
 
-	CSnapshotStorage() { Init(); }
-	~CSnapshotStorage() { PurgeAll(); }
+	CSnapshotStorage();
+	~CSnapshotStorage();
+	CSnapshotStorage(const CSnapshotStorage &) = delete;
+	CSnapshotStorage &operator=(const CSnapshotStorage &) = delete;
+
 	void Init();
 	void PurgeAll();
 	void PurgeUntil(int Tick);
 	void Add(int Tick, int64_t Tagtime, size_t DataSize, const void *pData, size_t AltDataSize, const void *pAltData);
 	int Get(int Tick, int64_t *pTagtime, const CSnapshot **ppData, const CSnapshot **ppAltData) const;
+
+	size_t ArenaSize() const { return m_ArenaSize; }
+	int NumHeapFallbacks() const { return m_NumHeapFallbacks; }
+
+private:
+	char *m_pArena;
+	size_t m_ArenaSize;
+	size_t m_ArenaHead;
+	size_t m_ArenaTail;
+	int m_NumArenaBlocks;
+
+	// previous arena after growing, freed once all of its snapshots are purged
+	char *m_pRetiredArena;
+	size_t m_RetiredArenaSize;
+	int m_NumRetiredArenaBlocks;
+
+	int m_NumHeapFallbacks;
+
+	CHolder *m_apTickIndex[TICK_INDEX_SIZE];
+	// number of stored holders that lost their index slot to another tick
+	int m_NumUnindexed;
+
+	void *AllocArena(size_t Size);
+	void *AllocHolder(size_t Size);
+	void FreeHolder(CHolder *pHolder);
+	void FreeArenas();
 };
 
 class CSnapshotBuilder
@@ -182,4 +224,36 @@ public:
 	int Finish(void *pSnapdata);
 };
 
+// CSnapshotItemBuffer
+
+// Holds snap items with their external types, so that items can be built
+// once and then added to the snapshots of several clients.
+class CSnapshotItemBuffer
+{
+	class CItem
+	{
+	public:
+		int m_Type;
+		int m_Id;
+		int m_Size;
+		int m_Offset;
+	};
+
+	char m_aData[CSnapshot::MAX_SIZE];
+	int m_DataSize;
+
+	CItem m_aItems[CSnapshot::MAX_ITEMS];
+	int m_NumItems;
+
+public:
+	CSnapshotItemBuffer();
+
+	void Clear();
+	void *NewItem(int Type, int Id, int Size);
+	int NumItems() const { return m_NumItems; }
+
+	// adds the items [First, First + Num) to the builder
+	void AddToBuilder(CSnapshotBuilder *pBuilder, int First, int Num) const;
+};
+
 #endif // ENGINE_SNAPSHOT_H
@@ -0,0 +1,126 @@
+#include "sound_mix.h"
+
+#include <base/system.h>
+
+#include <algorithm>
+#include <limits>
+
+// SSE2 is part of amd64 and NEON of arm64, so neither needs a runtime check
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOUND_MIX_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SOUND_MIX_NEON 1
+#endif
+
+// the old `((Value * MasterVolume) / 101) >> 8` in floating point, which
+// cannot overflow and has the same result in every lane
+static float MasterScale(int MasterVolume)
+{
+	return MasterVolume / (101.0f * 256.0f);
+}
+
+void MixVoice(int *pMix, const short *pSamples, int Channels, unsigned Frames, int VolumeL, int VolumeR)
+{
+	dbg_assert(VolumeL >= std::numeric_limits<short>::min() && VolumeL <= std::numeric_limits<short>::max() &&
+			   VolumeR >= std::numeric_limits<short>::min() && VolumeR <= std::numeric_limits<short>::max(),
+		"volume out of range");
+#if defined(SOUND_MIX_SSE2)
+	// 16 bit multiplications, the high and low halves are interleaved to the
+	// 32 bit products
+	const __m128i Volume = _mm_set_epi16(VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL);
+	for(; Frames >= 4; Frames -= 4)
+	{
+		__m128i In;
+		if(Channels == 1)
+		{
+			In = _mm_loadl_epi64((const __m128i *)pSamples);
+			In = _mm_unpacklo_epi16(In, In);
+		}
+		else
+		{
+			In = _mm_loadu_si128((const __m128i *)pSamples);
+		}
+		const __m128i Low = _mm_mullo_epi16(In, Volume);
+		const __m128i High = _mm_mulhi_epi16(In, Volume);
+		_mm_storeu_si128((__m128i *)pMix, _mm_add_epi32(_mm_loadu_si128((const __m128i *)pMix), _mm_unpacklo_epi16(Low, High)));
+		_mm_storeu_si128((__m128i *)(pMix + 4), _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pMix + 4)), _mm_unpackhi_epi16(Low, High)));
+		pSamples += 4 * Channels;
+		pMix += 8;
+	}
+#elif defined(SOUND_MIX_NEON)
+	const int16_t aVolume[4] = {(int16_t)VolumeL, (int16_t)VolumeR, (int16_t)VolumeL, (int16_t)VolumeR};
+	const int16x4_t Volume = vld1_s16(aVolume);
+	for(; Frames >= 4; Frames -= 4)
+	{
+		int16x4_t InLow, InHigh;
+		if(Channels == 1)
+		{
+			const int16x4_t In = vld1_s16(pSamples);
+			const int16x4x2_t Zipped = vzip_s16(In, In);
+			InLow = Zipped.val[0];
+			InHigh = Zipped.val[1];
+		}
+		else
+		{
+			const int16x8_t In = vld1q_s16(pSamples);
+			InLow = vget_low_s16(In);
+			InHigh = vget_high_s16(In);
+		}
+		vst1q_s32(pMix, vmlal_s16(vld1q_s32(pMix), InLow, Volume));
+		vst1q_s32(pMix + 4, vmlal_s16(vld1q_s32(pMix + 4), InHigh, Volume));
+		pSamples += 4 * Channels;
+		pMix += 8;
+	}
+#endif
+	MixVoiceScalar(pMix, pSamples, Channels, Frames, VolumeL, VolumeR);
+}
+
+void MixVoiceScalar(int *pMix, const short *pSamples, int Channels, unsigned Frames, int VolumeL, int VolumeR)
+{
+	// mono samples are played on both channels
+	const short *pInL = pSamples;
+	const short *pInR = pSamples + Channels - 1;
+	for(unsigned i = 0; i < Frames; i++)
+	{
+		*pMix++ += (*pInL) * VolumeL;
+		*pMix++ += (*pInR) * VolumeR;
+		pInL += Channels;
+		pInR += Channels;
+	}
+}
+
+void ClampMix(short *pOut, const int *pMix, unsigned Num, int MasterVolume)
+{
+#if defined(SOUND_MIX_SSE2)
+	const __m128 Scale = _mm_set1_ps(MasterScale(MasterVolume));
+	for(; Num >= 8; Num -= 8)
+	{
+		const __m128i Low = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)pMix)), Scale));
+		const __m128i High = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(pMix + 4))), Scale));
+		// saturates to the range of `short`
+		_mm_storeu_si128((__m128i *)pOut, _mm_packs_epi32(Low, High));
+		pMix += 8;
+		pOut += 8;
+	}
+#elif defined(SOUND_MIX_NEON)
+	const float Scale = MasterScale(MasterVolume);
+	for(; Num >= 8; Num -= 8)
+	{
+		const int32x4_t Low = vcvtq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(pMix)), Scale));
+		const int32x4_t High = vcvtq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(pMix + 4)), Scale));
+		vst1q_s16(pOut, vcombine_s16(vqmovn_s32(Low), vqmovn_s32(High)));
+		pMix += 8;
+		pOut += 8;
+	}
+#endif
+	ClampMixScalar(pOut, pMix, Num, MasterVolume);
+}
+
+void ClampMixScalar(short *pOut, const int *pMix, unsigned Num, int MasterVolume)
+{
+	const float Scale = MasterScale(MasterVolume);
+	for(unsigned i = 0; i < Num; i++)
+		pOut[i] = std::clamp<int>((int)((float)pMix[i] * Scale), std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+}
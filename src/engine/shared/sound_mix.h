@@ -0,0 +1,31 @@
+#ifndef ENGINE_SHARED_SOUND_MIX_H
+#define ENGINE_SHARED_SOUND_MIX_H
+
+// the vectorized versions must produce the same output as the scalar ones
+
+/**
+ * Adds the frames of a voice to an interleaved stereo mix buffer.
+ *
+ * @param pMix Mix buffer with `2 * Frames` values.
+ * @param pSamples Samples of the first frame to mix.
+ * @param Channels `1` for mono samples, `2` for interleaved stereo samples.
+ * @param Frames Number of frames to mix.
+ * @param VolumeL Volume of the left channel, must fit in a `short`.
+ * @param VolumeR Volume of the right channel, must fit in a `short`.
+ */
+void MixVoice(int *pMix, const short *pSamples, int Channels, unsigned Frames, int VolumeL, int VolumeR);
+void MixVoiceScalar(int *pMix, const short *pSamples, int Channels, unsigned Frames, int VolumeL, int VolumeR);
+
+/**
+ * Applies the master volume to the mix buffer and clamps the values to the
+ * range of the output samples.
+ *
+ * @param pOut Output samples.
+ * @param pMix Mix buffer, with the sample values scaled by up to `255 * 255`.
+ * @param Num Number of values, two per stereo frame.
+ * @param MasterVolume Volume from `0` to `100`.
+ */
+void ClampMix(short *pOut, const int *pMix, unsigned Num, int MasterVolume);
+void ClampMixScalar(short *pOut, const int *pMix, unsigned Num, int MasterVolume);
+
+#endif
@@ -75,6 +75,9 @@ void CDebugHud::RenderNetCorrections()
 	str_format(aBuf, sizeof(aBuf), "%d", GameClient()->m_Snap.m_pLocalCharacter->m_Angle);
 	RenderRow("Angle:", aBuf);
 
+	str_format(aBuf, sizeof(aBuf), "%d / %d", GameClient()->PredictionNumSimulatedTicks(), GameClient()->PredictionNumReusedTicks());
+	RenderRow("Predicted ticks (sim / reused):", aBuf);
+
 	str_format(aBuf, sizeof(aBuf), "%d", GameClient()->NetobjNumCorrections());
 	RenderRow("Netobj corrections", aBuf);
 	RenderRow(" on:", GameClient()->NetobjCorrectedOn());
@@ -10,6 +10,15 @@
 
 #include <game/client/gameclient.h>
 
+// SSE2 is part of amd64 and NEON of arm64, so neither needs a runtime check
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PARTICLES_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PARTICLES_NEON 1
+#endif
+
 CParticles::CParticles()
 {
 	OnReset();
@@ -23,18 +32,88 @@ CParticles::CParticles()
 void CParticles::OnReset()
 {
 	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
+	for(auto &Group : m_aGroups)
+		Group.Clear();
+	m_NumParticles = 0;
+}
+
+void CParticles::CGroup::Add(const CParticle &Part, float Life)
+{
+	m_vPosX.push_back(Part.m_Pos.x);
+	m_vPosY.push_back(Part.m_Pos.y);
+	m_vVelX.push_back(Part.m_Vel.x);
+	m_vVelY.push_back(Part.m_Vel.y);
+	m_vGravity.push_back(Part.m_Gravity);
+	m_vFriction.push_back(Part.m_Friction);
+	m_vLife.push_back(Life);
+	m_vLifeSpan.push_back(Part.m_LifeSpan);
+	m_vRot.push_back(Part.m_Rot);
+	m_vRotspeed.push_back(Part.m_Rotspeed);
+	m_vCollides.push_back(Part.m_Collides);
+
+	m_vSpr.push_back(Part.m_Spr);
+	m_vStartSize.push_back(Part.m_StartSize);
+	m_vEndSize.push_back(Part.m_EndSize);
+	m_vUseAlphaFading.push_back(Part.m_UseAlphaFading);
+	m_vStartAlpha.push_back(Part.m_StartAlpha);
+	m_vEndAlpha.push_back(Part.m_EndAlpha);
+	m_vColor.push_back(Part.m_Color);
+}
+
+template<typename T>
+static void CompactArray(std::vector<T> &v, const bool *pKeep)
+{
+	size_t Kept = 0;
+	for(size_t i = 0; i < v.size(); i++)
 	{
-		m_aParticles[i].m_PrevPart = i - 1;
-		m_aParticles[i].m_NextPart = i + 1;
+		if(pKeep[i])
+			v[Kept++] = v[i];
 	}
+	v.resize(Kept);
+}
 
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES - 1].m_NextPart = -1;
-	m_FirstFree = 0;
+void CParticles::CGroup::Clear()
+{
+	m_vPosX.clear();
+	m_vPosY.clear();
+	m_vVelX.clear();
+	m_vVelY.clear();
+	m_vGravity.clear();
+	m_vFriction.clear();
+	m_vLife.clear();
+	m_vLifeSpan.clear();
+	m_vRot.clear();
+	m_vRotspeed.clear();
+	m_vCollides.clear();
+	m_vSpr.clear();
+	m_vStartSize.clear();
+	m_vEndSize.clear();
+	m_vUseAlphaFading.clear();
+	m_vStartAlpha.clear();
+	m_vEndAlpha.clear();
+	m_vColor.clear();
+}
 
-	for(int &FirstPart : m_aFirstPart)
-		FirstPart = -1;
+void CParticles::CGroup::Compact(const bool *pKeep)
+{
+	CompactArray(m_vPosX, pKeep);
+	CompactArray(m_vPosY, pKeep);
+	CompactArray(m_vVelX, pKeep);
+	CompactArray(m_vVelY, pKeep);
+	CompactArray(m_vGravity, pKeep);
+	CompactArray(m_vFriction, pKeep);
+	CompactArray(m_vLife, pKeep);
+	CompactArray(m_vLifeSpan, pKeep);
+	CompactArray(m_vRot, pKeep);
+	CompactArray(m_vRotspeed, pKeep);
+	CompactArray(m_vCollides, pKeep);
+	CompactArray(m_vSpr, pKeep);
+	CompactArray(m_vStartSize, pKeep);
+	CompactArray(m_vEndSize, pKeep);
+	CompactArray(m_vUseAlphaFading, pKeep);
+	CompactArray(m_vStartAlpha, pKeep);
+	CompactArray(m_vEndAlpha, pKeep);
+	CompactArray(m_vColor, pKeep);
 }
 
 void CParticles::Add(int Group, CParticle *pPart, float TimePassed)
@@ -51,27 +130,78 @@ void CParticles::Add(int Group, CParticle *pPart, float TimePassed)
 			return;
 	}
 
-	if(m_FirstFree == -1)
+	if(m_NumParticles == MAX_PARTICLES)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
+	m_aGroups[Group].Add(*pPart, TimePassed);
+	m_NumParticles++;
+}
 
-	// copy data
-	m_aParticles[Id] = *pPart;
+// the part of the update without branches, advances Num particles starting at Index
+static void IntegrateParticlesScalar(int Index, int Num, float *pVelX, float *pVelY, const float *pGravity, const float *pFriction, int FrictionCount,
+	const float *pPosX, const float *pPosY, float *pTargetX, float *pTargetY, float *pLife, float *pRot, const float *pRotspeed, float TimePassed)
+{
+	for(int i = Index; i < Index + Num; i++)
+	{
+		pVelY[i] += pGravity[i] * TimePassed;
+
+		for(int f = 0; f < FrictionCount; f++) // apply friction
+		{
+			pVelX[i] *= pFriction[i];
+			pVelY[i] *= pFriction[i];
+		}
 
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
+		pTargetX[i] = pPosX[i] + pVelX[i] * TimePassed;
+		pTargetY[i] = pPosY[i] + pVelY[i] * TimePassed;
 
-	// set some parameters
-	m_aParticles[Id].m_Life = TimePassed;
+		pLife[i] += TimePassed;
+		pRot[i] += TimePassed * pRotspeed[i];
+	}
+}
+
+static void IntegrateParticles(int Num, float *pVelX, float *pVelY, const float *pGravity, const float *pFriction, int FrictionCount,
+	const float *pPosX, const float *pPosY, float *pTargetX, float *pTargetY, float *pLife, float *pRot, const float *pRotspeed, float TimePassed)
+{
+	int i = 0;
+#if defined(PARTICLES_SSE2)
+	const __m128 Time = _mm_set1_ps(TimePassed);
+	for(; i + 4 <= Num; i += 4)
+	{
+		const __m128 Friction = _mm_loadu_ps(pFriction + i);
+		__m128 VelX = _mm_loadu_ps(pVelX + i);
+		__m128 VelY = _mm_add_ps(_mm_loadu_ps(pVelY + i), _mm_mul_ps(_mm_loadu_ps(pGravity + i), Time));
+		for(int f = 0; f < FrictionCount; f++)
+		{
+			VelX = _mm_mul_ps(VelX, Friction);
+			VelY = _mm_mul_ps(VelY, Friction);
+		}
+		_mm_storeu_ps(pVelX + i, VelX);
+		_mm_storeu_ps(pVelY + i, VelY);
+		_mm_storeu_ps(pTargetX + i, _mm_add_ps(_mm_loadu_ps(pPosX + i), _mm_mul_ps(VelX, Time)));
+		_mm_storeu_ps(pTargetY + i, _mm_add_ps(_mm_loadu_ps(pPosY + i), _mm_mul_ps(VelY, Time)));
+		_mm_storeu_ps(pLife + i, _mm_add_ps(_mm_loadu_ps(pLife + i), Time));
+		_mm_storeu_ps(pRot + i, _mm_add_ps(_mm_loadu_ps(pRot + i), _mm_mul_ps(Time, _mm_loadu_ps(pRotspeed + i))));
+	}
+#elif defined(PARTICLES_NEON)
+	for(; i + 4 <= Num; i += 4)
+	{
+		const float32x4_t Friction = vld1q_f32(pFriction + i);
+		float32x4_t VelX = vld1q_f32(pVelX + i);
+		float32x4_t VelY = vaddq_f32(vld1q_f32(pVelY + i), vmulq_n_f32(vld1q_f32(pGravity + i), TimePassed));
+		for(int f = 0; f < FrictionCount; f++)
+		{
+			VelX = vmulq_f32(VelX, Friction);
+			VelY = vmulq_f32(VelY, Friction);
+		}
+		vst1q_f32(pVelX + i, VelX);
+		vst1q_f32(pVelY + i, VelY);
+		vst1q_f32(pTargetX + i, vaddq_f32(vld1q_f32(pPosX + i), vmulq_n_f32(VelX, TimePassed)));
+		vst1q_f32(pTargetY + i, vaddq_f32(vld1q_f32(pPosY + i), vmulq_n_f32(VelY, TimePassed)));
+		vst1q_f32(pLife + i, vaddq_f32(vld1q_f32(pLife + i), vdupq_n_f32(TimePassed)));
+		vst1q_f32(pRot + i, vaddq_f32(vld1q_f32(pRot + i), vmulq_n_f32(vld1q_f32(pRotspeed + i), TimePassed)));
+	}
+#endif
+	IntegrateParticlesScalar(i, Num - i, pVelX, pVelY, pGravity, pFriction, FrictionCount, pPosX, pPosY, pTargetX, pTargetY, pLife, pRot, pRotspeed, TimePassed);
 }
 
 void CParticles::Update(float TimePassed)
@@ -91,54 +221,49 @@ void CParticles::Update(float TimePassed)
 		m_FrictionFraction -= 0.05f;
 	}
 
-	for(int &FirstPart : m_aFirstPart)
+	for(auto &Group : m_aGroups)
 	{
-		int i = FirstPart;
-		while(i != -1)
+		const int Num = Group.Num();
+		if(Num == 0)
+			continue;
+
+		float *pPosX = Group.m_vPosX.data();
+		float *pPosY = Group.m_vPosY.data();
+		float *pVelX = Group.m_vVelX.data();
+		float *pVelY = Group.m_vVelY.data();
+		IntegrateParticles(Num, pVelX, pVelY, Group.m_vGravity.data(), Group.m_vFriction.data(), FrictionCount,
+			pPosX, pPosY, m_aTargetX, m_aTargetY, Group.m_vLife.data(), Group.m_vRot.data(), Group.m_vRotspeed.data(), TimePassed);
+
+		// move the points, only the ones that hit something need the full collision
+		Collision()->CheckPoints(m_aTargetX, m_aTargetY, Num, m_aSolid);
+		int NumKept = 0;
+		for(int i = 0; i < Num; i++)
 		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity * TimePassed;
-
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
-
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel * TimePassed;
-			if(m_aParticles[i].m_Collides)
+			if(m_aSolid[i] && Group.m_vCollides[i])
 			{
-				Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, random_float(0.1f, 1.0f), nullptr);
+				vec2 Pos = vec2(pPosX[i], pPosY[i]);
+				vec2 Vel = vec2(pVelX[i], pVelY[i]) * TimePassed;
+				Collision()->MovePoint(&Pos, &Vel, random_float(0.1f, 1.0f), nullptr);
+				pPosX[i] = Pos.x;
+				pPosY[i] = Pos.y;
+				pVelX[i] = Vel.x * (1.0f / TimePassed);
+				pVelY[i] = Vel.y * (1.0f / TimePassed);
 			}
 			else
 			{
-				m_aParticles[i].m_Pos += Vel;
+				pPosX[i] = m_aTargetX[i];
+				pPosY[i] = m_aTargetY[i];
 			}
-			m_aParticles[i].m_Vel = Vel * (1.0f / TimePassed);
-
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
 
 			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
-			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					FirstPart = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
-			}
+			m_aKeep[i] = Group.m_vLife[i] <= Group.m_vLifeSpan[i];
+			NumKept += m_aKeep[i];
+		}
 
-			i = Next;
+		if(NumKept < Num)
+		{
+			Group.Compact(m_aKeep);
+			m_NumParticles -= Num - NumKept;
 		}
 	}
 }
@@ -218,11 +343,13 @@ void CParticles::RenderGroup(int Group)
 		ParticleQuadContainerIndex = m_ExtraParticleQuadContainerIndex;
 	}
 
+	// the newest particles are drawn first
+	const CGroup &Parts = m_aGroups[Group];
+	const int Num = Parts.Num();
+
 	// don't use the buffer methods here, else the old renderer gets many draw calls
 	if(Graphics()->IsQuadContainerBufferingEnabled())
 	{
-		int i = m_aFirstPart[Group];
-
 		static IGraphics::SRenderSpriteInfo s_aParticleRenderInfo[MAX_PARTICLES];
 
 		int CurParticleRenderCount = 0;
@@ -231,71 +358,67 @@ void CParticles::RenderGroup(int Group)
 		ColorRGBA LastColor;
 		int LastQuadOffset = 0;
 
-		if(i != -1)
+		if(Num > 0)
 		{
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
+			const int i = Num - 1;
+			float Alpha = Parts.m_vColor[i].a;
+			if(Parts.m_vUseAlphaFading[i])
 			{
-				float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
+				float a = Parts.m_vLife[i] / Parts.m_vLifeSpan[i];
+				Alpha = mix(Parts.m_vStartAlpha[i], Parts.m_vEndAlpha[i], a);
 			}
-			LastColor.r = m_aParticles[i].m_Color.r;
-			LastColor.g = m_aParticles[i].m_Color.g;
-			LastColor.b = m_aParticles[i].m_Color.b;
+			LastColor.r = Parts.m_vColor[i].r;
+			LastColor.g = Parts.m_vColor[i].g;
+			LastColor.b = Parts.m_vColor[i].b;
 			LastColor.a = Alpha;
 
 			Graphics()->SetColor(
-				m_aParticles[i].m_Color.r,
-				m_aParticles[i].m_Color.g,
-				m_aParticles[i].m_Color.b,
+				Parts.m_vColor[i].r,
+				Parts.m_vColor[i].g,
+				Parts.m_vColor[i].b,
 				Alpha);
 
-			LastQuadOffset = m_aParticles[i].m_Spr;
+			LastQuadOffset = Parts.m_vSpr[i];
 		}
 
-		while(i != -1)
+		for(int i = Num - 1; i >= 0; i--)
 		{
-			int QuadOffset = m_aParticles[i].m_Spr;
-			float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-			vec2 p = m_aParticles[i].m_Pos;
-			float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
+			int QuadOffset = Parts.m_vSpr[i];
+			float a = Parts.m_vLife[i] / Parts.m_vLifeSpan[i];
+			vec2 p = vec2(Parts.m_vPosX[i], Parts.m_vPosY[i]);
+			float Size = mix(Parts.m_vStartSize[i], Parts.m_vEndSize[i], a);
+			float Alpha = Parts.m_vColor[i].a;
+			if(Parts.m_vUseAlphaFading[i])
 			{
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
+				Alpha = mix(Parts.m_vStartAlpha[i], Parts.m_vEndAlpha[i], a);
 			}
 
 			// the current position, respecting the size, is inside the viewport, render it, else ignore
 			if(ParticleIsVisibleOnScreen(p, Size))
 			{
-				if((size_t)CurParticleRenderCount == gs_GraphicsMaxParticlesRenderCount || LastColor.r != m_aParticles[i].m_Color.r || LastColor.g != m_aParticles[i].m_Color.g || LastColor.b != m_aParticles[i].m_Color.b || LastColor.a != Alpha || LastQuadOffset != QuadOffset)
+				const ColorRGBA &Color = Parts.m_vColor[i];
+				if((size_t)CurParticleRenderCount == gs_GraphicsMaxParticlesRenderCount || LastColor.r != Color.r || LastColor.g != Color.g || LastColor.b != Color.b || LastColor.a != Alpha || LastQuadOffset != QuadOffset)
 				{
 					Graphics()->TextureSet(aParticles[LastQuadOffset - FirstParticleOffset]);
 					Graphics()->RenderQuadContainerAsSpriteMultiple(ParticleQuadContainerIndex, LastQuadOffset - FirstParticleOffset, CurParticleRenderCount, s_aParticleRenderInfo);
 					CurParticleRenderCount = 0;
 					LastQuadOffset = QuadOffset;
 
-					Graphics()->SetColor(
-						m_aParticles[i].m_Color.r,
-						m_aParticles[i].m_Color.g,
-						m_aParticles[i].m_Color.b,
-						Alpha);
+					Graphics()->SetColor(Color.r, Color.g, Color.b, Alpha);
 
-					LastColor.r = m_aParticles[i].m_Color.r;
-					LastColor.g = m_aParticles[i].m_Color.g;
-					LastColor.b = m_aParticles[i].m_Color.b;
+					LastColor.r = Color.r;
+					LastColor.g = Color.g;
+					LastColor.b = Color.b;
 					LastColor.a = Alpha;
 				}
 
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Pos[0] = p.x;
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Pos[1] = p.y;
 				s_aParticleRenderInfo[CurParticleRenderCount].m_Scale = Size;
-				s_aParticleRenderInfo[CurParticleRenderCount].m_Rotation = m_aParticles[i].m_Rot;
+				s_aParticleRenderInfo[CurParticleRenderCount].m_Rotation = Parts.m_vRot[i];
 
 				++CurParticleRenderCount;
 			}
-
-			i = m_aParticles[i].m_NextPart;
 		}
 
 		Graphics()->TextureSet(aParticles[LastQuadOffset - FirstParticleOffset]);
@@ -303,42 +426,38 @@ void CParticles::RenderGroup(int Group)
 	}
 	else
 	{
-		int i = m_aFirstPart[Group];
-
 		Graphics()->BlendNormal();
 		Graphics()->WrapClamp();
 
-		while(i != -1)
+		for(int i = Num - 1; i >= 0; i--)
 		{
-			float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-			vec2 p = m_aParticles[i].m_Pos;
-			float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
-			float Alpha = m_aParticles[i].m_Color.a;
-			if(m_aParticles[i].m_UseAlphaFading)
+			float a = Parts.m_vLife[i] / Parts.m_vLifeSpan[i];
+			vec2 p = vec2(Parts.m_vPosX[i], Parts.m_vPosY[i]);
+			float Size = mix(Parts.m_vStartSize[i], Parts.m_vEndSize[i], a);
+			float Alpha = Parts.m_vColor[i].a;
+			if(Parts.m_vUseAlphaFading[i])
 			{
-				Alpha = mix(m_aParticles[i].m_StartAlpha, m_aParticles[i].m_EndAlpha, a);
+				Alpha = mix(Parts.m_vStartAlpha[i], Parts.m_vEndAlpha[i], a);
 			}
 
 			// the current position, respecting the size, is inside the viewport, render it, else ignore
 			if(ParticleIsVisibleOnScreen(p, Size))
 			{
-				Graphics()->TextureSet(aParticles[m_aParticles[i].m_Spr - FirstParticleOffset]);
+				Graphics()->TextureSet(aParticles[Parts.m_vSpr[i] - FirstParticleOffset]);
 				Graphics()->QuadsBegin();
 
-				Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+				Graphics()->QuadsSetRotation(Parts.m_vRot[i]);
 
 				Graphics()->SetColor(
-					m_aParticles[i].m_Color.r,
-					m_aParticles[i].m_Color.g,
-					m_aParticles[i].m_Color.b,
+					Parts.m_vColor[i].r,
+					Parts.m_vColor[i].g,
+					Parts.m_vColor[i].b,
 					Alpha);
 
 				IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
 				Graphics()->QuadsDraw(&QuadItem, 1);
 				Graphics()->QuadsEnd();
 			}
-
-			i = m_aParticles[i].m_NextPart;
 		}
 		Graphics()->WrapNormal();
 		Graphics()->BlendNormal();
@@ -6,6 +6,9 @@
 #include <base/vmath.h>
 #include <game/client/component.h>
 
+#include <cstdint>
+#include <vector>
+
 // particles
 struct CParticle
 {
@@ -53,11 +56,6 @@ struct CParticle
 	ColorRGBA m_Color;
 
 	bool m_Collides;
-
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
 };
 
 class CParticles : public CComponent
@@ -93,9 +91,49 @@ private:
 		MAX_PARTICLES = 1024 * 8,
 	};
 
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	// the particles of a group as structure of arrays, so that the update
+	// works on contiguous floats. The alive particles are packed at the
+	// front in the order they were added.
+	class CGroup
+	{
+	public:
+		// integrated every frame
+		std::vector<float> m_vPosX;
+		std::vector<float> m_vPosY;
+		std::vector<float> m_vVelX;
+		std::vector<float> m_vVelY;
+		std::vector<float> m_vGravity;
+		std::vector<float> m_vFriction;
+		std::vector<float> m_vLife;
+		std::vector<float> m_vLifeSpan;
+		std::vector<float> m_vRot;
+		std::vector<float> m_vRotspeed;
+		std::vector<uint8_t> m_vCollides;
+
+		// only read when rendering
+		std::vector<int> m_vSpr;
+		std::vector<float> m_vStartSize;
+		std::vector<float> m_vEndSize;
+		std::vector<uint8_t> m_vUseAlphaFading;
+		std::vector<float> m_vStartAlpha;
+		std::vector<float> m_vEndAlpha;
+		std::vector<ColorRGBA> m_vColor;
+
+		int Num() const { return m_vPosX.size(); }
+		void Add(const CParticle &Part, float Life);
+		void Clear();
+		// removes the particles that are not kept, without changing the order of the others
+		void Compact(const bool *pKeep);
+	};
+
+	CGroup m_aGroups[NUM_GROUPS];
+	int m_NumParticles = 0;
+
+	// per particle scratch space of the update
+	float m_aTargetX[MAX_PARTICLES];
+	float m_aTargetY[MAX_PARTICLES];
+	bool m_aSolid[MAX_PARTICLES];
+	bool m_aKeep[MAX_PARTICLES];
 
 	float m_FrictionFraction = 0.0f;
 	int64_t m_LastRenderTime = 0;
@@ -1576,10 +1576,8 @@ void CMenus::RenderSettingsTClientWarList(CUIRect MainView)
 	{
 		if(s_pSelectedEntry && s_pSelectedType && (str_comp(s_aEntryName, "") != 0 || str_comp(s_aEntryClan, "") != 0))
 		{
-			str_copy(s_pSelectedEntry->m_aName, s_aEntryName);
-			str_copy(s_pSelectedEntry->m_aClan, s_aEntryClan);
-			str_copy(s_pSelectedEntry->m_aReason, s_aEntryReason);
-			s_pSelectedEntry->m_pWarType = s_pSelectedType;
+			CWarList &WarList = GameClient()->m_WarList;
+			WarList.UpdateWarEntry(s_pSelectedEntry - WarList.m_vWarEntries.data(), s_aEntryName, s_aEntryClan, s_aEntryReason, s_pSelectedType);
 		}
 	}
 	if(DoButtonLineSize_Menu(&s_AddButton, TCLocalize("Add Entry"), 0, &ButtonR, LineSize))
@@ -9,17 +9,6 @@
 
 #include "outlines.h"
 
-// The order of this is the order of priority for outlines
-enum
-{
-	OUTLINE_NONE = 0,
-	OUTLINE_UNFREEZE,
-	OUTLINE_FREEZE,
-	OUTLINE_TELE,
-	OUTLINE_KILL,
-	OUTLINE_SOLID,
-};
-
 enum class OutlineLayer
 {
 	GAME,
@@ -101,8 +90,32 @@ public:
 // The order of this determines order of priority into the one map (tele + freeze = tele)
 static constexpr COutLineLayer OUTLINE_LAYERS[] = {{OutlineLayer::TELE}, {OutlineLayer::GAME}, {OutlineLayer::FRONT}};
 
+class COutlineConfig
+{
+public:
+	const int &m_Enable;
+	const int &m_Width;
+	const unsigned int &m_Color;
+};
+
+static COutlineConfig GetOutlineConfig(int Type)
+{
+	if(Type == OUTLINE_SOLID)
+		return {g_Config.m_TcOutlineSolid, g_Config.m_TcOutlineWidthSolid, g_Config.m_TcOutlineColorSolid};
+	if(Type == OUTLINE_FREEZE)
+		return {g_Config.m_TcOutlineFreeze, g_Config.m_TcOutlineWidthFreeze, g_Config.m_TcOutlineColorFreeze};
+	if(Type == OUTLINE_UNFREEZE)
+		return {g_Config.m_TcOutlineUnfreeze, g_Config.m_TcOutlineWidthUnfreeze, g_Config.m_TcOutlineColorUnfreeze};
+	if(Type == OUTLINE_KILL)
+		return {g_Config.m_TcOutlineKill, g_Config.m_TcOutlineWidthKill, g_Config.m_TcOutlineColorKill};
+	if(Type == OUTLINE_TELE)
+		return {g_Config.m_TcOutlineTele, g_Config.m_TcOutlineWidthTele, g_Config.m_TcOutlineColorTele};
+	dbg_assert(false, "Invalid value for Type %d", Type);
+}
+
 void COutlines::OnMapLoad()
 {
+	UnloadVisuals();
 	if(m_pMapData)
 	{
 		delete[] m_pMapData;
@@ -131,6 +144,179 @@ void COutlines::OnMapLoad()
 	{
 		pLayer->SetData(GameClient(), m_pMapData, m_MapDataSize);
 	}
+
+	// Build the enabled outlines now, the others when they get enabled
+	if(Graphics()->IsTileBufferingEnabled())
+	{
+		for(int Type = OUTLINE_NONE + 1; Type < NUM_OUTLINES; Type++)
+		{
+			const COutlineConfig Config = GetOutlineConfig(Type);
+			if(Config.m_Enable && Config.m_Width > 0)
+				BuildVisuals(Type, Config.m_Width);
+		}
+	}
+}
+
+int COutlines::GetTile(int x, int y) const
+{
+	x = std::clamp(x, 0, m_MapDataSize.x - 1);
+	y = std::clamp(y, 0, m_MapDataSize.y - 1);
+	return m_pMapData[y * m_MapDataSize.x + x];
+}
+
+int COutlines::GetQuads(int x, int y, int Type, int Width, IGraphics::CQuadItem *pQuads) const
+{
+	const float Scale = 32.0f;
+
+	// Find neighbours
+	const bool aNeighbors[8] = {
+		GetTile(x - 1, y - 1) >= Type,
+		GetTile(x - 0, y - 1) >= Type,
+		GetTile(x + 1, y - 1) >= Type,
+		GetTile(x - 1, y + 0) >= Type,
+		GetTile(x + 1, y + 0) >= Type,
+		GetTile(x - 1, y + 1) >= Type,
+		GetTile(x + 0, y + 1) >= Type,
+		GetTile(x + 1, y + 1) >= Type,
+	};
+	// Figure out edges
+	int NumQuads = 0;
+	// Lone corners first
+	if(!aNeighbors[0] && aNeighbors[1] && aNeighbors[3])
+		pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Width, Width);
+	if(!aNeighbors[2] && aNeighbors[1] && aNeighbors[4])
+		pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Width, y * Scale, Width, Width);
+	if(!aNeighbors[5] && aNeighbors[3] && aNeighbors[6])
+		pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Scale - Width, Width, Width);
+	if(!aNeighbors[7] && aNeighbors[6] && aNeighbors[4])
+		pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Width, y * Scale + Scale - Width, Width, Width);
+	// Top
+	if(!aNeighbors[1])
+		pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Scale, Width);
+	// Bottom
+	if(!aNeighbors[6])
+		pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Scale - Width, Scale, Width);
+	// Left
+	if(!aNeighbors[3])
+	{
+		if(aNeighbors[1] && aNeighbors[6])
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Width, Scale);
+		else if(aNeighbors[6])
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Width, Width, Scale - Width);
+		else if(aNeighbors[1])
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Width, Scale - Width);
+		else
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Width, Width, Scale - Width * 2.0f);
+	}
+	// Right
+	if(!aNeighbors[4])
+	{
+		if(aNeighbors[1] && aNeighbors[6])
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Width, y * Scale, Width, Scale);
+		else if(aNeighbors[6])
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Width, y * Scale + Width, Width, Scale - Width);
+		else if(aNeighbors[1])
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Width, y * Scale, Width, Scale - Width);
+		else
+			pQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Width, y * Scale + Width, Width, Scale - Width * 2.0f);
+	}
+	return NumQuads;
+}
+
+void COutlines::BuildVisuals(int Type, int Width)
+{
+	COutlineVisuals &Visuals = m_aVisuals[Type];
+	Graphics()->DeleteBufferContainer(Visuals.m_BufferContainerIndex);
+	Visuals.m_Width = Width;
+	Visuals.m_vFirstQuad.clear();
+	Visuals.m_vFirstQuad.reserve((size_t)m_MapDataSize.x * m_MapDataSize.y + 1);
+
+	// the same layout as the untextured tile layers: only the positions of the corners
+	std::vector<CGraphicTile> vTiles;
+	for(int y = 0; y < m_MapDataSize.y; y++)
+	{
+		for(int x = 0; x < m_MapDataSize.x; x++)
+		{
+			Visuals.m_vFirstQuad.push_back(vTiles.size());
+			if(GetTile(x, y) != Type)
+				continue;
+			IGraphics::CQuadItem aQuads[8];
+			const int NumQuads = GetQuads(x, y, Type, Width, aQuads);
+			for(int i = 0; i < NumQuads; i++)
+			{
+				const IGraphics::CQuadItem &Quad = aQuads[i];
+				CGraphicTile &Tile = vTiles.emplace_back();
+				Tile.m_TopLeft = vec2(Quad.m_X, Quad.m_Y);
+				Tile.m_TopRight = vec2(Quad.m_X + Quad.m_Width, Quad.m_Y);
+				Tile.m_BottomRight = vec2(Quad.m_X + Quad.m_Width, Quad.m_Y + Quad.m_Height);
+				Tile.m_BottomLeft = vec2(Quad.m_X, Quad.m_Y + Quad.m_Height);
+			}
+		}
+	}
+	Visuals.m_vFirstQuad.push_back(vTiles.size());
+	if(vTiles.empty())
+		return;
+
+	const size_t UploadDataSize = vTiles.size() * sizeof(CGraphicTile);
+	void *pUploadData = malloc(UploadDataSize);
+	mem_copy(pUploadData, vTiles.data(), UploadDataSize);
+	const int BufferObjectIndex = Graphics()->CreateBufferObject(UploadDataSize, pUploadData, 0, true);
+
+	SBufferContainerInfo ContainerInfo;
+	ContainerInfo.m_Stride = 0;
+	ContainerInfo.m_VertBufferBindingIndex = BufferObjectIndex;
+	ContainerInfo.m_vAttributes.emplace_back();
+	SBufferContainerInfo::SAttribute *pAttr = &ContainerInfo.m_vAttributes.back();
+	pAttr->m_DataTypeCount = 2;
+	pAttr->m_Type = GRAPHICS_TYPE_FLOAT;
+	pAttr->m_Normalized = false;
+	pAttr->m_pOffset = nullptr;
+	pAttr->m_FuncType = 0;
+	Visuals.m_BufferContainerIndex = Graphics()->CreateBufferContainer(&ContainerInfo);
+	Graphics()->IndicesNumRequiredNotify(vTiles.size() * 6);
+}
+
+void COutlines::UnloadVisuals()
+{
+	for(auto &Visuals : m_aVisuals)
+	{
+		Graphics()->DeleteBufferContainer(Visuals.m_BufferContainerIndex);
+		Visuals.m_Width = 0;
+		Visuals.m_vFirstQuad.clear();
+	}
+}
+
+void COutlines::RenderVisuals(int Type, ColorRGBA Color)
+{
+	const COutlineVisuals &Visuals = m_aVisuals[Type];
+	if(Visuals.m_BufferContainerIndex == -1)
+		return;
+
+	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+	Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+	const int X0 = std::max((int)std::floor(ScreenX0 / 32), 0);
+	const int Y0 = std::max((int)std::floor(ScreenY0 / 32), 0);
+	const int X1 = std::min((int)std::ceil(ScreenX1 / 32), m_MapDataSize.x);
+	const int Y1 = std::min((int)std::ceil(ScreenY1 / 32), m_MapDataSize.y);
+	if(X0 >= X1 || Y0 >= Y1)
+		return;
+
+	// the quads of the visible part of each row are contiguous
+	std::vector<char *> vpIndexOffsets;
+	std::vector<unsigned int> vDrawCounts;
+	vpIndexOffsets.reserve(Y1 - Y0);
+	vDrawCounts.reserve(Y1 - Y0);
+	for(int y = Y0; y < Y1; y++)
+	{
+		const unsigned First = Visuals.m_vFirstQuad[y * m_MapDataSize.x + X0];
+		const unsigned End = Visuals.m_vFirstQuad[y * m_MapDataSize.x + X1];
+		if(End == First)
+			continue;
+		vpIndexOffsets.push_back((char *)((uintptr_t)First * 6 * sizeof(unsigned int)));
+		vDrawCounts.push_back((End - First) * 6);
+	}
+	if(!vpIndexOffsets.empty())
+		Graphics()->RenderTileLayer(Visuals.m_BufferContainerIndex, Color, vpIndexOffsets.data(), vDrawCounts.data(), vpIndexOffsets.size());
 }
 
 void COutlines::OnRender()
@@ -144,6 +330,28 @@ void COutlines::OnRender()
 	if(!g_Config.m_TcOutline)
 		return;
 
+	if(!Graphics()->IsTileBufferingEnabled())
+	{
+		RenderQuads();
+		return;
+	}
+
+	Graphics()->TextureClear();
+	Graphics()->BlendNormal();
+	for(int Type = OUTLINE_NONE + 1; Type < NUM_OUTLINES; Type++)
+	{
+		const COutlineConfig Config = GetOutlineConfig(Type);
+		if(!Config.m_Enable || Config.m_Width <= 0)
+			continue;
+		// the colour is only a uniform, the width needs new quads
+		if(m_aVisuals[Type].m_Width != Config.m_Width)
+			BuildVisuals(Type, Config.m_Width);
+		RenderVisuals(Type, color_cast<ColorRGBA>(ColorHSLA(Config.m_Color, true)));
+	}
+}
+
+void COutlines::RenderQuads()
+{
 	const float Scale = 32.0f;
 
 	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
@@ -163,12 +371,6 @@ void COutlines::OnRender()
 		EndY -= EdgeY / 2;
 	}
 
-	auto GetTile = [&](int x, int y) {
-		x = std::clamp(x, 0, m_MapDataSize.x - 1);
-		y = std::clamp(y, 0, m_MapDataSize.y - 1);
-		return m_pMapData[y * m_MapDataSize.x + x];
-	};
-
 	Graphics()->TextureClear();
 	Graphics()->QuadsBegin();
 
@@ -179,81 +381,11 @@ void COutlines::OnRender()
 			const int Type = GetTile(x, y);
 			if(Type == OUTLINE_NONE)
 				continue;
-			class COutlineConfig
-			{
-			public:
-				const int &m_Enable;
-				const int &m_Width;
-				const unsigned int &m_Color;
-			};
-			const COutlineConfig Config = [&]() -> COutlineConfig {
-				if(Type == OUTLINE_SOLID)
-					return {g_Config.m_TcOutlineSolid, g_Config.m_TcOutlineWidthSolid, g_Config.m_TcOutlineColorSolid};
-				if(Type == OUTLINE_FREEZE)
-					return {g_Config.m_TcOutlineFreeze, g_Config.m_TcOutlineWidthFreeze, g_Config.m_TcOutlineColorFreeze};
-				if(Type == OUTLINE_UNFREEZE)
-					return {g_Config.m_TcOutlineUnfreeze, g_Config.m_TcOutlineWidthUnfreeze, g_Config.m_TcOutlineColorUnfreeze};
-				if(Type == OUTLINE_KILL)
-					return {g_Config.m_TcOutlineKill, g_Config.m_TcOutlineWidthKill, g_Config.m_TcOutlineColorKill};
-				if(Type == OUTLINE_TELE)
-					return {g_Config.m_TcOutlineTele, g_Config.m_TcOutlineWidthTele, g_Config.m_TcOutlineColorTele};
-				dbg_assert(false, "Invalid value for Type at %d, %d/%d, %d", x, y, m_MapDataSize.x, m_MapDataSize.y);
-			}();
+			const COutlineConfig Config = GetOutlineConfig(Type);
 			if(!Config.m_Enable || Config.m_Width <= 0)
 				continue;
-			// Find neighbours
-			const bool aNeighbors[8] = {
-				GetTile(x - 1, y - 1) >= Type,
-				GetTile(x - 0, y - 1) >= Type,
-				GetTile(x + 1, y - 1) >= Type,
-				GetTile(x - 1, y + 0) >= Type,
-				GetTile(x + 1, y + 0) >= Type,
-				GetTile(x - 1, y + 1) >= Type,
-				GetTile(x + 0, y + 1) >= Type,
-				GetTile(x + 1, y + 1) >= Type,
-			};
-			// Figure out edges
 			IGraphics::CQuadItem aQuads[8];
-			int NumQuads = 0;
-			// Lone corners first
-			if(!aNeighbors[0] && aNeighbors[1] && aNeighbors[3])
-				aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Config.m_Width, Config.m_Width);
-			if(!aNeighbors[2] && aNeighbors[1] && aNeighbors[4])
-				aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Config.m_Width, y * Scale, Config.m_Width, Config.m_Width);
-			if(!aNeighbors[5] && aNeighbors[3] && aNeighbors[6])
-				aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Scale - Config.m_Width, Config.m_Width, Config.m_Width);
-			if(!aNeighbors[7] && aNeighbors[6] && aNeighbors[4])
-				aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Config.m_Width, y * Scale + Scale - Config.m_Width, Config.m_Width, Config.m_Width);
-			// Top
-			if(!aNeighbors[1])
-				aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Scale, Config.m_Width);
-			// Bottom
-			if(!aNeighbors[6])
-				aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Scale - Config.m_Width, Scale, Config.m_Width);
-			// Left
-			if(!aNeighbors[3])
-			{
-				if(aNeighbors[1] && aNeighbors[6])
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Config.m_Width, Scale);
-				else if(aNeighbors[6])
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Config.m_Width, Config.m_Width, Scale - Config.m_Width);
-				else if(aNeighbors[1])
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale, Config.m_Width, Scale - Config.m_Width);
-				else
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale, y * Scale + Config.m_Width, Config.m_Width, Scale - Config.m_Width * 2.0f);
-			}
-			// Right
-			if(!aNeighbors[4])
-			{
-				if(aNeighbors[1] && aNeighbors[6])
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Config.m_Width, y * Scale, Config.m_Width, Scale);
-				else if(aNeighbors[6])
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Config.m_Width, y * Scale + Config.m_Width, Config.m_Width, Scale - Config.m_Width);
-				else if(aNeighbors[1])
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Config.m_Width, y * Scale, Config.m_Width, Scale - Config.m_Width);
-				else
-					aQuads[NumQuads++] = IGraphics::CQuadItem(x * Scale + Scale - Config.m_Width, y * Scale + Config.m_Width, Config.m_Width, Scale - Config.m_Width * 2.0f);
-			}
+			const int NumQuads = GetQuads(x, y, Type, Config.m_Width, aQuads);
 			if(NumQuads <= 0)
 				continue;
 			Graphics()->SetColor(color_cast<ColorRGBA>(ColorHSLA(Config.m_Color, true)));
@@ -1,17 +1,52 @@
 #ifndef GAME_CLIENT_COMPONENTS_TCLIENT_OUTLINES_H
 #define GAME_CLIENT_COMPONENTS_TCLIENT_OUTLINES_H
 
+#include <engine/graphics.h>
+
 #include <game/client/component.h>
 
+#include <vector>
+
 class CTile;
 class CTeleTile;
 
+// The order of this is the order of priority for outlines
+enum
+{
+	OUTLINE_NONE = 0,
+	OUTLINE_UNFREEZE,
+	OUTLINE_FREEZE,
+	OUTLINE_TELE,
+	OUTLINE_KILL,
+	OUTLINE_SOLID,
+	NUM_OUTLINES,
+};
+
 class COutlines : public CComponent
 {
 private:
 	ivec2 m_MapDataSize;
 	int *m_pMapData = nullptr;
 
+	// the quads of one outline type, built once and drawn from a tile buffer
+	class COutlineVisuals
+	{
+	public:
+		int m_BufferContainerIndex = -1;
+		// the width the quads were built with, 0 if they were not built
+		int m_Width = 0;
+		// the index of the first quad of every tile, row by row, and the number of quads at the end
+		std::vector<unsigned> m_vFirstQuad;
+	};
+	COutlineVisuals m_aVisuals[NUM_OUTLINES];
+
+	int GetTile(int x, int y) const;
+	int GetQuads(int x, int y, int Type, int Width, IGraphics::CQuadItem *pQuads) const;
+	void BuildVisuals(int Type, int Width);
+	void UnloadVisuals();
+	void RenderVisuals(int Type, ColorRGBA Color);
+	void RenderQuads();
+
 public:
 	int Sizeof() const override { return sizeof(*this); }
 	void OnMapLoad() override;
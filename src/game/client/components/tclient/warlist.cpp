@@ -8,6 +8,8 @@
 
 #include "warlist.h"
 
+#include <algorithm>
+
 void CWarList::OnNewSnapshot()
 {
 	UpdateWarPlayers();
@@ -212,10 +214,13 @@ void CWarList::UpdateWarEntry(int Index, const char *pName, const char *pClan, c
 {
 	if(Index >= 0 && Index < static_cast<int>(m_vWarEntries.size()))
 	{
+		UnindexWarEntry(Index);
 		str_copy(m_vWarEntries[Index].m_aName, pName);
 		str_copy(m_vWarEntries[Index].m_aClan, pClan);
 		str_copy(m_vWarEntries[Index].m_aReason, pReason);
 		m_vWarEntries[Index].m_pWarType = pType;
+		IndexWarEntry(Index);
+		m_WarPlayersDirty = true;
 	}
 }
 
@@ -228,6 +233,7 @@ void CWarList::UpsertWarType(int Index, const char *pType, ColorRGBA Color)
 	{
 		str_copy(m_WarTypes[Index]->m_aWarName, pType);
 		m_WarTypes[Index]->m_Color = Color;
+		m_WarPlayersDirty = true;
 	}
 	else
 	{
@@ -258,6 +264,8 @@ void CWarList::AddWarEntry(const char *pName, const char *pClan, const char *pRe
 	if(!g_Config.m_TcWarListAllowDuplicates)
 		RemoveWarEntryDuplicates(pName, pClan);
 	m_vWarEntries.push_back(Entry);
+	IndexWarEntry(m_vWarEntries.size() - 1);
+	m_WarPlayersDirty = true;
 }
 
 void CWarList::RemoveWarEntryDuplicates(const char *pName, const char *pClan)
@@ -265,17 +273,23 @@ void CWarList::RemoveWarEntryDuplicates(const char *pName, const char *pClan)
 	if(str_comp(pName, "") == 0 && str_comp(pClan, "") == 0)
 		return;
 
-	for(auto it = m_vWarEntries.begin(); it != m_vWarEntries.end();)
-	{
-		bool IsDuplicate =
-			(str_comp(it->m_aName, pName) == 0) &&
-			(str_comp(it->m_aClan, pClan) == 0);
+	// every duplicate is in the index of its name, or of its clan if it has no name
+	const bool ByName = str_comp(pName, "") != 0;
+	const auto &Index = ByName ? m_NameIndex : m_ClanIndex;
+	const auto It = Index.find(ByName ? pName : pClan);
+	if(It == Index.end())
+		return;
 
-		if(IsDuplicate)
-			it = m_vWarEntries.erase(it);
-		else
-			++it;
+	std::vector<int> vDuplicates;
+	for(int EntryIndex : It->second)
+	{
+		const CWarEntry &Entry = m_vWarEntries[EntryIndex];
+		if(str_comp(Entry.m_aName, pName) == 0 && str_comp(Entry.m_aClan, pClan) == 0)
+			vDuplicates.push_back(EntryIndex);
 	}
+	// back to front, so that the remaining indices stay valid
+	for(auto Duplicate = vDuplicates.rbegin(); Duplicate != vDuplicates.rend(); ++Duplicate)
+		RemoveWarEntry(*Duplicate);
 }
 
 void CWarList::AddWarType(const char *pType, ColorRGBA Color)
@@ -293,23 +307,100 @@ void CWarList::AddWarType(const char *pType, ColorRGBA Color)
 	{
 		Type->m_Color = Color;
 	}
+	m_WarPlayersDirty = true;
 }
 
 void CWarList::RemoveWarEntry(const char *pName, const char *pClan, const char *pType)
 {
-	CWarType *pWarType = FindWarType(pType);
-	CWarEntry Entry(pWarType, pName, pClan, "");
-	auto it = std::find(m_vWarEntries.begin(), m_vWarEntries.end(), Entry);
-	if(it != m_vWarEntries.end())
-		m_vWarEntries.erase(it);
+	const int Index = FindWarEntryIndex(pName, pClan, FindWarType(pType));
+	if(Index >= 0)
+		RemoveWarEntry(Index);
 }
 
 void CWarList::RemoveWarEntry(CWarEntry *Entry)
 {
-	auto it = std::find_if(m_vWarEntries.begin(), m_vWarEntries.end(),
-		[Entry](const CWarEntry &WarEntry) { return &WarEntry == Entry; });
-	if(it != m_vWarEntries.end())
-		m_vWarEntries.erase(it);
+	if(Entry >= m_vWarEntries.data() && Entry < m_vWarEntries.data() + m_vWarEntries.size())
+		RemoveWarEntry(Entry - m_vWarEntries.data());
+}
+
+void CWarList::RemoveWarEntry(int Index)
+{
+	if(Index < 0 || Index >= static_cast<int>(m_vWarEntries.size()))
+		return;
+
+	UnindexWarEntry(Index);
+	m_vWarEntries.erase(m_vWarEntries.begin() + Index);
+	// the entries behind the removed one move one index down
+	for(auto *pIndex : {&m_NameIndex, &m_ClanIndex})
+	{
+		for(auto &[Key, vIndices] : *pIndex)
+		{
+			for(auto It = std::upper_bound(vIndices.begin(), vIndices.end(), Index); It != vIndices.end(); ++It)
+				--*It;
+		}
+	}
+	m_WarPlayersDirty = true;
+}
+
+void CWarList::IndexWarEntry(int Index)
+{
+	const CWarEntry &Entry = m_vWarEntries[Index];
+	if(Entry.m_aName[0] != '\0')
+	{
+		std::vector<int> &vIndices = m_NameIndex[Entry.m_aName];
+		vIndices.insert(std::lower_bound(vIndices.begin(), vIndices.end(), Index), Index);
+	}
+	if(Entry.m_aClan[0] != '\0')
+	{
+		std::vector<int> &vIndices = m_ClanIndex[Entry.m_aClan];
+		vIndices.insert(std::lower_bound(vIndices.begin(), vIndices.end(), Index), Index);
+	}
+}
+
+void CWarList::UnindexWarEntry(int Index)
+{
+	const CWarEntry &Entry = m_vWarEntries[Index];
+	const auto Unindex = [Index](std::unordered_map<std::string, std::vector<int>> &Map, const char *pKey) {
+		if(pKey[0] == '\0')
+			return;
+		const auto It = Map.find(pKey);
+		if(It == Map.end())
+			return;
+		std::vector<int> &vIndices = It->second;
+		const auto Found = std::lower_bound(vIndices.begin(), vIndices.end(), Index);
+		if(Found != vIndices.end() && *Found == Index)
+			vIndices.erase(Found);
+		if(vIndices.empty())
+			Map.erase(It);
+	};
+	Unindex(m_NameIndex, Entry.m_aName);
+	Unindex(m_ClanIndex, Entry.m_aClan);
+}
+
+int CWarList::FindWarEntryIndex(const char *pName, const char *pClan, const CWarType *pType) const
+{
+	// same as comparing with CWarEntry::operator==, first match wins
+	int Result = -1;
+	const auto Search = [&](const std::unordered_map<std::string, std::vector<int>> &Map, const char *pKey) {
+		if(pKey[0] == '\0')
+			return;
+		const auto It = Map.find(pKey);
+		if(It == Map.end())
+			return;
+		for(int Index : It->second)
+		{
+			if(Result >= 0 && Index >= Result)
+				break;
+			if(m_vWarEntries[Index].m_pWarType == pType)
+			{
+				Result = Index;
+				break;
+			}
+		}
+	};
+	Search(m_NameIndex, pName);
+	Search(m_ClanIndex, pClan);
+	return Result;
 }
 
 void CWarList::RemoveWarType(const char *pType)
@@ -333,6 +424,7 @@ void CWarList::RemoveWarType(const char *pType)
 			}
 		}
 		m_WarTypes.erase(it);
+		m_WarPlayersDirty = true;
 	}
 }
 
@@ -349,12 +441,9 @@ CWarType *CWarList::FindWarType(const char *pType)
 
 CWarEntry *CWarList::FindWarEntry(const char *pName, const char *pClan, const char *pType)
 {
-	CWarType *pWarType = FindWarType(pType);
-	CWarEntry Entry(pWarType, pName, pClan, "");
-	auto it = std::find(m_vWarEntries.begin(), m_vWarEntries.end(), Entry);
-
-	if(it != m_vWarEntries.end())
-		return &(*it);
+	const int Index = FindWarEntryIndex(pName, pClan, FindWarType(pType));
+	if(Index >= 0)
+		return &m_vWarEntries[Index];
 	else
 		return nullptr;
 }
@@ -414,42 +503,85 @@ void CWarList::SortWarEntries()
 
 void CWarList::UpdateWarPlayers()
 {
-	for(int i = 0; i < (int)m_WarTypes.size(); ++i)
-		m_WarTypes[i]->m_Index = i;
+	if(m_WarPlayersDirty)
+	{
+		for(int i = 0; i < (int)m_WarTypes.size(); ++i)
+			m_WarTypes[i]->m_Index = i;
+	}
 
 	for(int i = 0; i < MAX_CLIENTS; ++i)
 	{
-		if(!GameClient()->m_aClients[i].m_Active)
+		const CGameClient::CClientData &Client = GameClient()->m_aClients[i];
+		CWarDataCache &WarData = m_WarPlayers[i];
+		if(!Client.m_Active)
+		{
+			// active clients always have a name, so this is matched again once it joins
+			WarData.m_aName[0] = '\0';
 			continue;
+		}
 
-		m_WarPlayers[i].m_WarName = false;
-		m_WarPlayers[i].m_WarClan = false;
-		memset(m_WarPlayers[i].m_aReason, 0, sizeof(m_WarPlayers[i].m_aReason));
-		m_WarPlayers[i].m_NameColor = ColorRGBA(1.0f, 1.0f, 1.0f, 1.0f);
-		m_WarPlayers[i].m_ClanColor = ColorRGBA(1.0f, 1.0f, 1.0f, 1.0f);
-		m_WarPlayers[i].m_WarGroupMatches.clear();
-		m_WarPlayers[i].m_WarGroupMatches.resize((int)m_WarTypes.size(), false);
+		// only match players whose name or clan changed, unless the list changed
+		if(!m_WarPlayersDirty && str_comp(WarData.m_aName, Client.m_aName) == 0 && str_comp(WarData.m_aClan, Client.m_aClan) == 0)
+			continue;
 
-		for(CWarEntry &Entry : m_vWarEntries)
+		str_copy(WarData.m_aName, Client.m_aName);
+		str_copy(WarData.m_aClan, Client.m_aClan);
+		UpdateWarPlayer(i);
+	}
+	m_WarPlayersDirty = false;
+}
+
+void CWarList::UpdateWarPlayer(int ClientId)
+{
+	CWarDataCache &WarData = m_WarPlayers[ClientId];
+	WarData.m_WarName = false;
+	WarData.m_WarClan = false;
+	WarData.m_aReason[0] = '\0';
+	WarData.m_NameColor = ColorRGBA(1.0f, 1.0f, 1.0f, 1.0f);
+	WarData.m_ClanColor = ColorRGBA(1.0f, 1.0f, 1.0f, 1.0f);
+	WarData.m_WarGroupMatches.assign(m_WarTypes.size(), false);
+
+	static const std::vector<int> s_vNone;
+	const auto Lookup = [](const std::unordered_map<std::string, std::vector<int>> &Map, const char *pKey) -> const std::vector<int> & {
+		if(pKey[0] == '\0')
+			return s_vNone;
+		const auto It = Map.find(pKey);
+		return It == Map.end() ? s_vNone : It->second;
+	};
+	const std::vector<int> &vNameMatches = Lookup(m_NameIndex, WarData.m_aName);
+	const std::vector<int> &vClanMatches = Lookup(m_ClanIndex, WarData.m_aClan);
+
+	// go through the matching entries in list order, the last one decides
+	// the color, and an entry matching name and clan counts as a name war
+	auto NameIt = vNameMatches.begin();
+	auto ClanIt = vClanMatches.begin();
+	while(NameIt != vNameMatches.end() || ClanIt != vClanMatches.end())
+	{
+		const bool IsName = ClanIt == vClanMatches.end() || (NameIt != vNameMatches.end() && *NameIt <= *ClanIt);
+		const int Index = IsName ? *NameIt : *ClanIt;
+		const CWarEntry &Entry = m_vWarEntries[Index];
+		if(IsName)
 		{
-			if(str_comp(GameClient()->m_aClients[i].m_aName, Entry.m_aName) == 0 && str_comp(Entry.m_aName, "") != 0)
-			{
-				str_copy(m_WarPlayers[i].m_aReason, Entry.m_aReason);
-				m_WarPlayers[i].m_WarName = true;
-				m_WarPlayers[i].m_NameColor = Entry.m_pWarType->m_Color;
-				m_WarPlayers[i].m_WarGroupMatches[Entry.m_pWarType->m_Index] = true;
-			}
-			else if(str_comp(GameClient()->m_aClients[i].m_aClan, Entry.m_aClan) == 0 && str_comp(Entry.m_aClan, "") != 0)
-			{
-				// Name war reason has priority over clan war reason
-				if(!m_WarPlayers[i].m_WarName)
-					str_copy(m_WarPlayers[i].m_aReason, Entry.m_aReason);
+			if(ClanIt != vClanMatches.end() && *ClanIt == Index)
+				++ClanIt;
+			++NameIt;
 
-				m_WarPlayers[i].m_WarClan = true;
-				m_WarPlayers[i].m_ClanColor = Entry.m_pWarType->m_Color;
-				m_WarPlayers[i].m_WarGroupMatches[Entry.m_pWarType->m_Index] = true;
-			}
+			str_copy(WarData.m_aReason, Entry.m_aReason);
+			WarData.m_WarName = true;
+			WarData.m_NameColor = Entry.m_pWarType->m_Color;
+		}
+		else
+		{
+			++ClanIt;
+
+			// Name war reason has priority over clan war reason
+			if(!WarData.m_WarName)
+				str_copy(WarData.m_aReason, Entry.m_aReason);
+
+			WarData.m_WarClan = true;
+			WarData.m_ClanColor = Entry.m_pWarType->m_Color;
 		}
+		WarData.m_WarGroupMatches[Entry.m_pWarType->m_Index] = true;
 	}
 }
 
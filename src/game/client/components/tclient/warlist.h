@@ -5,6 +5,10 @@
 #include <engine/shared/protocol.h>
 #include <game/client/component.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 enum
 {
 	MAX_WARLIST_TYPE_LENGTH = 16,
@@ -81,6 +85,10 @@ public:
 	std::vector<char> m_WarGroupMatches = {false, false, false};
 
 	char m_aReason[MAX_WARLIST_REASON_LENGTH] = "";
+
+	// the name and clan this was matched against, empty for inactive clients
+	char m_aName[MAX_NAME_LENGTH] = "";
+	char m_aClan[MAX_CLAN_LENGTH] = "";
 };
 
 class CWarList : public CComponent
@@ -132,6 +140,17 @@ class CWarList : public CComponent
 
 	static void ConfigSaveCallback(IConfigManager *pConfigManager, void *pUserData);
 
+	// indices into m_vWarEntries by name and by clan, each list ascending
+	std::unordered_map<std::string, std::vector<int>> m_NameIndex;
+	std::unordered_map<std::string, std::vector<int>> m_ClanIndex;
+	// set when entries or types change, so that all players are matched again
+	bool m_WarPlayersDirty = true;
+
+	void IndexWarEntry(int Index);
+	void UnindexWarEntry(int Index);
+	int FindWarEntryIndex(const char *pName, const char *pClan, const CWarType *pType) const;
+	void UpdateWarPlayer(int ClientId);
+
 public:
 	CWarList();
 	~CWarList();
@@ -147,9 +166,8 @@ public:
 	CWarType *m_pWarTypeNone = m_WarTypes[0];
 
 	// Duplicate war entries ARE allowed
+	// Only change them through the functions below, they keep the name and clan index up to date
 	std::vector<CWarEntry> m_vWarEntries;
-	// TODO: create an unordered map for war clans and war names, to speed up updating the WarPlayers cache
-	// It should be updated when m_WarList changes
 
 	CWarDataCache m_WarPlayers[MAX_CLIENTS];
 
@@ -695,6 +695,7 @@ void CGameClient::OnReset()
 
 	m_Teams.Reset();
 	m_GameWorld.Clear();
+	m_GameWorldVersion++;
 	m_GameWorld.m_WorldConfig.m_InfiniteAmmo = true;
 	m_PredictedWorld.CopyWorld(&m_GameWorld);
 	m_PrevPredictedWorld.CopyWorld(&m_PredictedWorld);
@@ -1150,6 +1151,7 @@ void CGameClient::OnMessage(int MsgId, CUnpacker *pUnpacker, int Conn, bool Dumm
 			if(CCharacter *pChar = m_GameWorld.GetCharacterById(pMsg->m_Victim))
 				pChar->ResetPrediction();
 			m_GameWorld.ReleaseHooked(pMsg->m_Victim);
+			m_GameWorldVersion++;
 		}
 
 		// if we are spectating a static id set (team 0) and somebody killed, and its not a guy in solo, we remove him from the list
@@ -1195,6 +1197,7 @@ void CGameClient::OnMessage(int MsgId, CUnpacker *pUnpacker, int Conn, bool Dumm
 				m_GameWorld.ReleaseHooked(i);
 			}
 		}
+		m_GameWorldVersion++;
 		std::stable_sort(vStrongWeakSorted.begin(), vStrongWeakSorted.end(), [](auto &Left, auto &Right) { return Left.second > Right.second; });
 		for(auto Id : vStrongWeakSorted)
 		{
@@ -2349,6 +2352,8 @@ void CGameClient::OnNewSnapshot()
 
 	SnapCollectEntities(); // creates a collection that associates EntityEx snap items with the entities they belong to
 
+	// the tunings, switchers and entities of m_GameWorld are updated from the snapshot
+	m_GameWorldVersion++;
 	UpdateLocalTuning();
 	m_IsDummySwapping = 0;
 	if(Client()->State() != IClient::STATE_DEMOPLAYBACK)
@@ -2372,12 +2377,96 @@ void CGameClient::UpdateEditorIngameMoved()
 	}
 }
 
+void CGameClient::CollectPredictionInputs(int FirstTick, int LastTick, bool Dummy)
+{
+	const auto &&AppendInts = [&](const void *pData, int Size) {
+		const int *pInts = (const int *)pData;
+		m_vPredictionInputs.insert(m_vPredictionInputs.end(), pInts, pInts + Size / sizeof(int));
+	};
+	const auto &&AppendInput = [&](const int *pInput) {
+		m_vPredictionInputs.push_back(pInput != nullptr);
+		if(pInput)
+			AppendInts(pInput, sizeof(CNetObj_PlayerInput));
+	};
+
+	m_vPredictionInputs.clear();
+	m_vPredictionInputEnds.clear();
+
+	// state that OnPredict applies to the copy of m_GameWorld
+	m_vPredictionInputs.push_back(m_GameWorldVersion);
+	m_vPredictionInputs.push_back(FirstTick);
+	m_vPredictionInputs.push_back(Dummy);
+	m_vPredictionInputs.push_back(m_IsDummySwapping);
+	m_vPredictionInputs.push_back(m_Snap.m_LocalClientId);
+	m_vPredictionInputs.push_back(PredictDummy() ? m_PredictedDummyId : -1);
+	m_vPredictionInputs.push_back(g_Config.m_ClPredictFreeze);
+	m_vPredictionInputs.push_back(g_Config.m_ClAntiPingPreInput);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_vPredictionInputs.push_back((m_Snap.m_aCharacters[i].m_Active ? 1 : 0) | (IsOtherTeam(i) ? 2 : 0));
+
+	for(int Tick = FirstTick; Tick <= LastTick; Tick++)
+	{
+		AppendInput(Client()->GetInput(Tick, m_IsDummySwapping));
+		if(PredictDummy())
+			AppendInput(Client()->GetInput(Tick, m_IsDummySwapping ^ 1));
+		if(g_Config.m_ClAntiPingPreInput)
+		{
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				const CNetMsg_Sv_PreInput &PreInput = m_aClients[i].m_aPreInputs[Tick % 200];
+				if(PreInput.m_IntendedTick != Tick)
+					continue;
+				m_vPredictionInputs.push_back(i);
+				AppendInts(&PreInput, sizeof(PreInput));
+			}
+		}
+		m_vPredictionInputEnds.push_back(m_vPredictionInputs.size());
+	}
+}
+
+CGameClient::CPredictionCheckpoint *CGameClient::FindPredictionCheckpoint(int FirstTick, int LastTick)
+{
+	CPredictionCheckpoint *pBest = nullptr;
+	for(CPredictionCheckpoint &Checkpoint : m_aPredictionCheckpoints)
+	{
+		if(Checkpoint.m_Tick == -1)
+			continue;
+		// checkpoints that don't match the inputs of this frame are dropped
+		// even if they might match again, the predicted positions of their
+		// ticks are overwritten now
+		bool Valid = Checkpoint.m_Tick >= FirstTick && Checkpoint.m_Tick <= LastTick;
+		if(Valid)
+			Valid = (int)Checkpoint.m_vInputs.size() == m_vPredictionInputEnds[Checkpoint.m_Tick - FirstTick] &&
+				mem_comp(Checkpoint.m_vInputs.data(), m_vPredictionInputs.data(), Checkpoint.m_vInputs.size() * sizeof(int)) == 0;
+		if(!Valid)
+			Checkpoint.m_Tick = -1;
+		else if(!pBest || Checkpoint.m_Tick > pBest->m_Tick)
+			pBest = &Checkpoint;
+	}
+	return pBest;
+}
+
+void CGameClient::StorePredictionCheckpoint(int FirstTick, int Tick)
+{
+	CPredictionCheckpoint *pCheckpoint = &m_aPredictionCheckpoints[0];
+	for(CPredictionCheckpoint &Checkpoint : m_aPredictionCheckpoints)
+		if(Checkpoint.m_Tick < pCheckpoint->m_Tick)
+			pCheckpoint = &Checkpoint;
+
+	pCheckpoint->m_World.CopyCheckpoint(&m_PredictedWorld, pCheckpoint->m_vpParents);
+	pCheckpoint->m_vInputs.assign(m_vPredictionInputs.begin(), m_vPredictionInputs.begin() + m_vPredictionInputEnds[Tick - FirstTick]);
+	pCheckpoint->m_Tick = Tick;
+}
+
 void CGameClient::OnPredict()
 {
 	// store the previous values so we can detect prediction errors
 	CCharacterCore BeforePrevChar = m_PredictedPrevChar;
 	CCharacterCore BeforeChar = m_PredictedChar;
 
+	m_NumSimulatedPredictionTicks = 0;
+	m_NumReusedPredictionTicks = 0;
+
 	// we can't predict without our own id or own character
 	if(m_Snap.m_LocalClientId == -1 || !m_Snap.m_aCharacters[m_Snap.m_LocalClientId].m_Active)
 		return;
@@ -2404,23 +2493,50 @@ void CGameClient::OnPredict()
 
 	// init
 	bool Dummy = g_Config.m_ClDummy ^ m_IsDummySwapping;
-	m_PredictedWorld.CopyWorld(&m_GameWorld);
 
-	// don't predict inactive players, or entities from other teams
-	for(int i = 0; i < MAX_CLIENTS; i++)
-		if(CCharacter *pChar = m_PredictedWorld.GetCharacterById(i))
-			if((!m_Snap.m_aCharacters[i].m_Active && pChar->m_SnapTicks > 10) || IsOtherTeam(i))
-				pChar->Destroy();
+	int FinalTickRegular = Client()->PredGameTick(g_Config.m_ClDummy); // The vanilla final tick disregarding fast input
+	int FinalTickSelf = FinalTickRegular + g_Config.m_TcFastInput; // the final tick for just our local tee
+	int FinalTickOthers = FinalTickSelf; // the final tick for all other tees
+	if(g_Config.m_TcFastInput && !g_Config.m_TcFastInputOthers)
+		FinalTickOthers = FinalTickSelf - g_Config.m_TcFastInput;
 
-	CProjectile *pProjNext = nullptr;
-	for(CProjectile *pProj = (CProjectile *)m_PredictedWorld.FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProj; pProj = pProjNext)
+	// resume from the newest checkpoint whose inputs did not change. the
+	// ticks from FinalTickRegular on store state for the current frame and
+	// the last ticks can move in freeze, so they are always simulated
+	const int FirstTick = Client()->GameTick(g_Config.m_ClDummy) + 1;
+	int LastCheckpointTick = FinalTickRegular - 1;
+	if(g_Config.m_ClPredictFreeze == 2)
+		LastCheckpointTick = minimum(LastCheckpointTick, FinalTickRegular - 2 - FinalTickRegular % 2);
+	CollectPredictionInputs(FirstTick, LastCheckpointTick, Dummy);
+	CPredictionCheckpoint *pCheckpoint = FindPredictionCheckpoint(FirstTick, LastCheckpointTick);
+	int StartTick = FirstTick;
+	if(pCheckpoint)
+	{
+		m_PredictedWorld.CopyWorld(&pCheckpoint->m_World, &m_GameWorld, pCheckpoint->m_vpParents);
+		StartTick = pCheckpoint->m_Tick + 1;
+	}
+	else
 	{
-		pProjNext = (CProjectile *)pProj->TypeNext();
-		if(IsOtherTeam(pProj->GetOwner()))
+		m_PredictedWorld.CopyWorld(&m_GameWorld);
+
+		// don't predict inactive players, or entities from other teams
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			if(CCharacter *pChar = m_PredictedWorld.GetCharacterById(i))
+				if((!m_Snap.m_aCharacters[i].m_Active && pChar->m_SnapTicks > 10) || IsOtherTeam(i))
+					pChar->Destroy();
+
+		CProjectile *pProjNext = nullptr;
+		for(CProjectile *pProj = (CProjectile *)m_PredictedWorld.FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProj; pProj = pProjNext)
 		{
-			pProj->Destroy();
+			pProjNext = (CProjectile *)pProj->TypeNext();
+			if(IsOtherTeam(pProj->GetOwner()))
+			{
+				pProj->Destroy();
+			}
 		}
 	}
+	m_NumSimulatedPredictionTicks = maximum(0, FinalTickSelf - StartTick + 1);
+	m_NumReusedPredictionTicks = StartTick - FirstTick;
 
 	CCharacter *pLocalChar = m_PredictedWorld.GetCharacterById(m_Snap.m_LocalClientId);
 	if(!pLocalChar)
@@ -2433,13 +2549,7 @@ void CGameClient::OnPredict()
 	// predict
 	// prediction actually happens here
 
-	int FinalTickRegular = Client()->PredGameTick(g_Config.m_ClDummy); // The vanilla final tick disregarding fast input
-	int FinalTickSelf = FinalTickRegular + g_Config.m_TcFastInput; // the final tick for just our local tee
-	int FinalTickOthers = FinalTickSelf; // the final tick for all other tees
-	if(g_Config.m_TcFastInput && !g_Config.m_TcFastInputOthers)
-		FinalTickOthers = FinalTickSelf - g_Config.m_TcFastInput;
-
-	for(int Tick = Client()->GameTick(g_Config.m_ClDummy) + 1; Tick <= FinalTickSelf; Tick++)
+	for(int Tick = StartTick; Tick <= FinalTickSelf; Tick++)
 	{
 		// fetch the previous characters
 		if(Tick == FinalTickSelf)
@@ -2551,6 +2661,9 @@ void CGameClient::OnPredict()
 
 		m_PredictedWorld.Tick();
 
+		if(Tick == LastCheckpointTick)
+			StorePredictionCheckpoint(FirstTick, Tick);
+
 		// fetch the current characters
 		if(Tick == FinalTickSelf)
 		{
@@ -4893,6 +5006,7 @@ void CGameClient::ConTuneParam(IConsole::IResult *pResult, void *pUserData)
 	{
 		float NewValue = pResult->GetFloat(1);
 		pSelf->TuningList()[0].Set(pParamName, NewValue);
+		pSelf->m_GameWorldVersion++;
 	}
 }
 
@@ -4904,7 +5018,10 @@ void CGameClient::ConTuneZone(IConsole::IResult *pResult, void *pUserData)
 	float NewValue = pResult->GetFloat(2);
 
 	if(List >= 0 && List < NUM_TUNEZONES)
+	{
 		pSelf->TuningList()[List].Set(pParamName, NewValue);
+		pSelf->m_GameWorldVersion++;
+	}
 }
 
 void CGameClient::ConMapbug(IConsole::IResult *pResult, void *pUserData)
@@ -4915,6 +5032,7 @@ void CGameClient::ConMapbug(IConsole::IResult *pResult, void *pUserData)
 	switch(pSelf->m_MapBugs.Update(pMapBugName))
 	{
 	case EMapBugUpdate::OK:
+		pSelf->m_GameWorldVersion++;
 		break;
 	case EMapBugUpdate::OVERRIDDEN:
 		log_debug("mapbugs", "map-internal setting overridden by database");
@@ -338,6 +338,8 @@ public:
 		return m_NetObjHandler.NumObjCorrections();
 	}
 	const char *NetobjCorrectedOn() { return m_NetObjHandler.CorrectedObjOn(); }
+	int PredictionNumSimulatedTicks() const { return m_NumSimulatedPredictionTicks; }
+	int PredictionNumReusedTicks() const { return m_NumReusedPredictionTicks; }
 
 	bool m_SuppressEvents;
 	bool m_NewTick;
@@ -939,6 +941,34 @@ private:
 
 	int m_PredictedDummyId;
 	int m_IsDummySwapping;
+
+	// states of m_PredictedWorld from earlier frames, so that OnPredict
+	// only simulates the ticks after the newest one that is still valid
+	class CPredictionCheckpoint
+	{
+	public:
+		CGameWorld m_World;
+		std::vector<CEntity *> m_vpParents;
+		// prefix of m_vPredictionInputs up to m_Tick when it was stored
+		std::vector<int> m_vInputs;
+		int m_Tick = -1;
+	};
+	enum
+	{
+		NUM_PREDICTION_CHECKPOINTS = 4,
+	};
+	CPredictionCheckpoint m_aPredictionCheckpoints[NUM_PREDICTION_CHECKPOINTS];
+	// incremented whenever m_GameWorld changes, which invalidates all checkpoints
+	int m_GameWorldVersion = 0;
+	// everything besides m_GameWorld that the predicted ticks depend on,
+	// m_vPredictionInputEnds has the size after each tick
+	std::vector<int> m_vPredictionInputs;
+	std::vector<int> m_vPredictionInputEnds;
+	int m_NumSimulatedPredictionTicks = 0;
+	int m_NumReusedPredictionTicks = 0;
+	void CollectPredictionInputs(int FirstTick, int LastTick, bool Dummy);
+	CPredictionCheckpoint *FindPredictionCheckpoint(int FirstTick, int LastTick);
+	void StorePredictionCheckpoint(int FirstTick, int Tick);
 	CCharOrder m_CharOrder;
 	int m_aSwitchStateTeam[NUM_DUMMIES];
 
@@ -6,6 +6,7 @@
 #include <base/vmath.h>
 
 #include <game/alloc.h>
+#include <game/entity_grid.h>
 
 #include "gameworld.h"
 
@@ -17,6 +18,7 @@ private:
 	friend CGameWorld; // entity list handling
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
+	CEntityGridNode m_GridNode;
 
 protected:
 	CGameWorld *m_pGameWorld;
@@ -40,6 +42,9 @@ public:
 	CEntity *TypePrev() { return m_pPrevTypeEntity; }
 	const vec2 &GetPos() const { return m_Pos; }
 	float GetProximityRadius() const { return m_ProximityRadius; }
+	CEntityGridNode &GridNode() { return m_GridNode; }
+	// keeps the spatial index of the world up to date, unlike writing m_Pos
+	void SetPos(vec2 Pos);
 	virtual bool CanCollide(int ClientId) { return true; }
 
 	virtual void Destroy() { delete this; }
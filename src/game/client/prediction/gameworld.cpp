@@ -61,23 +61,40 @@ CEntity *CGameWorld::FindLast(int Type)
 	return pLast;
 }
 
+template<typename F>
+void CGameWorld::ForEachEntityNear(int Type, vec2 Min, vec2 Max, F &&Callback)
+{
+	CEntityGrid<CEntity> *pGrid = Grid(Type);
+	if(pGrid && pGrid->Query(Min, Max, m_vpGridCandidates))
+	{
+		for(CEntity *pEnt : m_vpGridCandidates)
+			if(!Callback(pEnt))
+				return;
+		return;
+	}
+
+	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		if(!Callback(pEnt))
+			return;
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
 	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
-	{
+	ForEachEntityNear(Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), [&](CEntity *pEnt) {
 		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
 		{
 			if(ppEnts)
 				ppEnts[Num] = pEnt;
 			Num++;
 			if(Num == Max)
-				break;
+				return false;
 		}
-	}
+		return true;
+	});
 
 	return Num;
 }
@@ -113,6 +130,9 @@ void CGameWorld::InsertEntity(CEntity *pEnt, bool Last)
 		pEnt->m_pNextTypeEntity = nullptr;
 	}
 
+	if(CEntityGrid<CEntity> *pGrid = Grid(pEnt->m_ObjType))
+		pGrid->Insert(pEnt, Last);
+
 	if(pEnt->m_ObjType == ENTTYPE_CHARACTER)
 	{
 		auto *pChar = (CCharacter *)pEnt;
@@ -147,6 +167,9 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = nullptr;
 	pEnt->m_pPrevTypeEntity = nullptr;
 
+	if(CEntityGrid<CEntity> *pGrid = Grid(pEnt->m_ObjType))
+		pGrid->Remove(pEnt);
+
 	if(pEnt->m_pParent)
 	{
 		if(m_IsValidCopy && m_pParent && m_pParent->m_pChild == this)
@@ -161,6 +184,12 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 	}
 }
 
+void CGameWorld::OnEntityMoved(CEntity *pEnt)
+{
+	if(CEntityGrid<CEntity> *pGrid = Grid(pEnt->m_ObjType))
+		pGrid->Move(pEnt);
+}
+
 void CGameWorld::RemoveCharacter(CCharacter *pChar)
 {
 	int Id = pChar->GetCid();
@@ -257,17 +286,17 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CEntity *pClosest = nullptr;
 
-	CEntity *pEntity = FindFirst(Type);
-	for(; pEntity; pEntity = pEntity->TypeNext())
-	{
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x) - Radius, minimum(Pos0.y, Pos1.y) - Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x) + Radius, maximum(Pos0.y, Pos1.y) + Radius);
+	ForEachEntityNear(Type, Min, Max, [&](CEntity *pEntity) {
 		if(pEntity == pNotThis)
-			continue;
+			return true;
 
 		if(pThisOnly && pEntity != pThisOnly)
-			continue;
+			return true;
 
 		if(CollideWith != -1 && !pEntity->CanCollide(CollideWith))
-			continue;
+			return true;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pEntity->m_Pos, IntersectPos))
@@ -284,7 +313,8 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 				}
 			}
 		}
-	}
+		return true;
+	});
 
 	return pClosest;
 }
@@ -292,11 +322,12 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CEntity *pNotThis)
 {
 	std::vector<CCharacter *> vpCharacters;
-	CCharacter *pChr = (CCharacter *)FindFirst(CGameWorld::ENTTYPE_CHARACTER);
-	for(; pChr; pChr = (CCharacter *)pChr->TypeNext())
-	{
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x) - Radius, minimum(Pos0.y, Pos1.y) - Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x) + Radius, maximum(Pos0.y, Pos1.y) + Radius);
+	ForEachEntityNear(ENTTYPE_CHARACTER, Min, Max, [&](CEntity *pEnt) {
+		CCharacter *pChr = (CCharacter *)pEnt;
 		if(pChr == pNotThis)
-			continue;
+			return true;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pChr->m_Pos, IntersectPos))
@@ -307,7 +338,8 @@ std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1
 				vpCharacters.push_back(pChr);
 			}
 		}
-	}
+		return true;
+	});
 	return vpCharacters;
 }
 
@@ -589,7 +621,8 @@ void CGameWorld::NetObjEnd()
 				if(CCharacter *pHookedChar = GetCharacterById(pChar->m_Core.HookedPlayer()))
 					if(pHookedChar->m_MarkedForDestroy)
 					{
-						pHookedChar->m_Pos = pHookedChar->m_Core.m_Pos = pChar->m_Core.m_HookPos;
+						pHookedChar->m_Core.m_Pos = pChar->m_Core.m_HookPos;
+						pHookedChar->SetPos(pHookedChar->m_Core.m_Pos);
 						pHookedChar->ResetVelocity();
 						mem_zero(&pHookedChar->m_SavedInput, sizeof(pHookedChar->m_SavedInput));
 						pHookedChar->m_SavedInput.m_TargetY = -1;
@@ -631,8 +664,8 @@ void CGameWorld::CopyWorldClean(CGameWorld *pFrom)
 	m_pTuningList = pFrom->m_pTuningList;
 	m_Teams = pFrom->m_Teams;
 	m_Core.m_vSwitchers = pFrom->m_Core.m_vSwitchers;
-	// delete the previous entities
-	Clear();
+	// take the previous entities out of the world
+	RecycleEntities();
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
 		m_apCharacters[i] = 0;
@@ -641,19 +674,11 @@ void CGameWorld::CopyWorldClean(CGameWorld *pFrom)
 	// copy and add the new entities
 	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
 	{
+		if(Type == ENTTYPE_PLASMA)
+			continue;
 		for(CEntity *pEnt = pFrom->FindLast(Type); pEnt; pEnt = pEnt->TypePrev())
 		{
-			CEntity *pCopy = 0;
-			if(Type == ENTTYPE_PROJECTILE)
-				pCopy = new CProjectile(*((CProjectile *)pEnt));
-			else if(Type == ENTTYPE_LASER)
-				pCopy = new CLaser(*((CLaser *)pEnt));
-			else if(Type == ENTTYPE_DRAGGER)
-				pCopy = new CDragger(*((CDragger *)pEnt));
-			else if(Type == ENTTYPE_CHARACTER)
-				pCopy = new CCharacter(*((CCharacter *)pEnt));
-			else if(Type == ENTTYPE_PICKUP)
-				pCopy = new CPickup(*((CPickup *)pEnt));
+			CEntity *pCopy = CopyEntity(pEnt, Type);
 			if(pCopy)
 			{
 				pCopy->m_pParent = nullptr;
@@ -669,11 +694,87 @@ void CGameWorld::CopyWorld(CGameWorld *pFrom)
 	if(pFrom == this || !pFrom)
 		return;
 	m_IsValidCopy = false;
-	m_pParent = pFrom;
+	SetParent(pFrom);
+	CopyState(pFrom);
+	// copy and add the new entities
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		for(CEntity *pEnt = pFrom->FindLast(Type); pEnt; pEnt = pEnt->TypePrev())
+		{
+			CEntity *pCopy = CopyEntity(pEnt, Type);
+			if(pCopy)
+			{
+				pCopy->m_pParent = pEnt;
+				pEnt->m_pChild = pCopy;
+				this->InsertEntity(pCopy);
+			}
+		}
+	}
+	m_IsValidCopy = true;
+}
+
+void CGameWorld::CopyCheckpoint(CGameWorld *pFrom, std::vector<CEntity *> &vpParents)
+{
+	if(pFrom == this || !pFrom)
+		return;
+	m_IsValidCopy = false;
+	CopyState(pFrom);
+	vpParents.clear();
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		for(CEntity *pEnt = pFrom->FindLast(Type); pEnt; pEnt = pEnt->TypePrev())
+		{
+			CEntity *pCopy = CopyEntity(pEnt, Type);
+			if(pCopy)
+			{
+				// the parents are only remembered, the checkpoint must not
+				// touch them when its entities are removed
+				pCopy->m_pParent = nullptr;
+				pCopy->m_pChild = nullptr;
+				this->InsertEntity(pCopy);
+				vpParents.push_back(pEnt->m_pParent);
+			}
+		}
+	}
+}
+
+void CGameWorld::CopyWorld(CGameWorld *pCheckpoint, CGameWorld *pParent, const std::vector<CEntity *> &vpParents)
+{
+	if(pCheckpoint == this || !pCheckpoint || !pParent)
+		return;
+	m_IsValidCopy = false;
+	SetParent(pParent);
+	CopyState(pCheckpoint);
+	size_t ParentIndex = 0;
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		for(CEntity *pEnt = pCheckpoint->FindLast(Type); pEnt; pEnt = pEnt->TypePrev())
+		{
+			CEntity *pCopy = CopyEntity(pEnt, Type);
+			if(pCopy)
+			{
+				CEntity *pParentEnt = vpParents[ParentIndex++];
+				pCopy->m_pParent = pParentEnt;
+				pCopy->m_pChild = nullptr;
+				if(pParentEnt)
+					pParentEnt->m_pChild = pCopy;
+				this->InsertEntity(pCopy);
+			}
+		}
+	}
+	m_IsValidCopy = true;
+}
+
+void CGameWorld::SetParent(CGameWorld *pParent)
+{
+	m_pParent = pParent;
 	if(m_pParent->m_pChild && m_pParent->m_pChild != this)
 		m_pParent->m_pChild->m_IsValidCopy = false;
-	pFrom->m_pChild = this;
+	pParent->m_pChild = this;
+}
 
+void CGameWorld::CopyState(CGameWorld *pFrom)
+{
 	m_GameTick = pFrom->m_GameTick;
 	m_pCollision = pFrom->m_pCollision;
 	m_WorldConfig = pFrom->m_WorldConfig;
@@ -685,40 +786,13 @@ void CGameWorld::CopyWorld(CGameWorld *pFrom)
 	m_pMapBugs = pFrom->m_pMapBugs;
 	m_Teams = pFrom->m_Teams;
 	m_Core.m_vSwitchers = pFrom->m_Core.m_vSwitchers;
-	// delete the previous entities
-	Clear();
+	// take the previous entities out of the world
+	RecycleEntities();
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
 		m_apCharacters[i] = nullptr;
 		m_Core.m_apCharacters[i] = nullptr;
 	}
-	// copy and add the new entities
-	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
-	{
-		for(CEntity *pEnt = pFrom->FindLast(Type); pEnt; pEnt = pEnt->TypePrev())
-		{
-			CEntity *pCopy = nullptr;
-			if(Type == ENTTYPE_PROJECTILE)
-				pCopy = new CProjectile(*((CProjectile *)pEnt));
-			else if(Type == ENTTYPE_LASER)
-				pCopy = new CLaser(*((CLaser *)pEnt));
-			else if(Type == ENTTYPE_DRAGGER)
-				pCopy = new CDragger(*((CDragger *)pEnt));
-			else if(Type == ENTTYPE_CHARACTER)
-				pCopy = new CCharacter(*((CCharacter *)pEnt));
-			else if(Type == ENTTYPE_PICKUP)
-				pCopy = new CPickup(*((CPickup *)pEnt));
-			else if(Type == ENTTYPE_PLASMA)
-				pCopy = new CPlasma(*((CPlasma *)pEnt));
-			if(pCopy)
-			{
-				pCopy->m_pParent = pEnt;
-				pEnt->m_pChild = pCopy;
-				this->InsertEntity(pCopy);
-			}
-		}
-	}
-	m_IsValidCopy = true;
 }
 
 CEntity *CGameWorld::FindMatch(int ObjId, int ObjType, const void *pObjData)
@@ -811,6 +885,60 @@ void CGameWorld::Clear()
 	for(auto &pFirstEntityType : m_apFirstEntityTypes)
 		while(pFirstEntityType)
 			delete pFirstEntityType; // NOLINT(clang-analyzer-cplusplus.NewDelete)
+	ClearSpareEntities();
+}
+
+void CGameWorld::RecycleEntities()
+{
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		while(CEntity *pEnt = m_apFirstEntityTypes[Type])
+		{
+			// same as deleting it, but keep the memory
+			RemoveEntity(pEnt);
+			if(Type == ENTTYPE_CHARACTER)
+				RemoveCharacter((CCharacter *)pEnt);
+			m_avpSpareEntities[Type].push_back(pEnt);
+		}
+	}
+}
+
+void CGameWorld::ClearSpareEntities()
+{
+	for(auto &vpSpareEntities : m_avpSpareEntities)
+	{
+		for(CEntity *pEnt : vpSpareEntities)
+			delete pEnt;
+		vpSpareEntities.clear();
+	}
+}
+
+template<typename T>
+T *CGameWorld::RecycledCopy(const T *pFrom, int Type)
+{
+	if(m_avpSpareEntities[Type].empty())
+		return new T(*pFrom);
+	T *pCopy = (T *)m_avpSpareEntities[Type].back();
+	m_avpSpareEntities[Type].pop_back();
+	*pCopy = *pFrom;
+	return pCopy;
+}
+
+CEntity *CGameWorld::CopyEntity(const CEntity *pFrom, int Type)
+{
+	if(Type == ENTTYPE_PROJECTILE)
+		return RecycledCopy((const CProjectile *)pFrom, Type);
+	else if(Type == ENTTYPE_LASER)
+		return RecycledCopy((const CLaser *)pFrom, Type);
+	else if(Type == ENTTYPE_DRAGGER)
+		return RecycledCopy((const CDragger *)pFrom, Type);
+	else if(Type == ENTTYPE_CHARACTER)
+		return RecycledCopy((const CCharacter *)pFrom, Type);
+	else if(Type == ENTTYPE_PICKUP)
+		return RecycledCopy((const CPickup *)pFrom, Type);
+	else if(Type == ENTTYPE_PLASMA)
+		return RecycledCopy((const CPlasma *)pFrom, Type);
+	return nullptr;
 }
 
 bool CGameWorld::EmulateBug(int Bug) const
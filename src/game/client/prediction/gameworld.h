@@ -3,6 +3,7 @@
 #ifndef GAME_CLIENT_PREDICTION_GAMEWORLD_H
 #define GAME_CLIENT_PREDICTION_GAMEWORLD_H
 
+#include <game/entity_grid.h>
 #include <game/gamecore.h>
 #include <game/teamscore.h>
 
@@ -46,6 +47,7 @@ public:
 	void InsertEntity(CEntity *pEntity, bool Last = false);
 	void RemoveEntity(CEntity *pEntity);
 	void RemoveCharacter(CCharacter *pChar);
+	void OnEntityMoved(CEntity *pEntity);
 	void Tick();
 
 	// DDRace
@@ -100,6 +102,10 @@ public:
 	void NetObjEnd();
 	void CopyWorld(CGameWorld *pFrom);
 	void CopyWorldClean(CGameWorld *pFrom); // TClient
+	// a checkpoint is an unlinked copy that remembers the parents of the
+	// entities of pFrom, copying it back links it to those parents again
+	void CopyCheckpoint(CGameWorld *pFrom, std::vector<CEntity *> &vpParents);
+	void CopyWorld(CGameWorld *pCheckpoint, CGameWorld *pParent, const std::vector<CEntity *> &vpParents);
 	CEntity *FindMatch(int ObjId, int ObjType, const void *pObjData);
 	void Clear();
 
@@ -114,10 +120,32 @@ public:
 
 private:
 	void RemoveEntities();
+	void SetParent(CGameWorld *pParent);
+	void CopyState(CGameWorld *pFrom);
+
+	// entities of the previous copy are assigned the state of the next
+	// one instead of being deleted and allocated again
+	std::vector<CEntity *> m_avpSpareEntities[NUM_ENTTYPES];
+	void RecycleEntities();
+	void ClearSpareEntities();
+	template<typename T>
+	T *RecycledCopy(const T *pFrom, int Type);
+	CEntity *CopyEntity(const CEntity *pFrom, int Type);
 
 	CEntity *m_pNextTraverseEntity = nullptr;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
+	// spatial index of the characters, the only type queried by position
+	CEntityGrid<CEntity> m_CharacterGrid;
+	std::vector<CEntity *> m_vpGridCandidates;
+
+	CEntityGrid<CEntity> *Grid(int Type) { return Type == ENTTYPE_CHARACTER ? &m_CharacterGrid : nullptr; }
+
+	// calls Callback in entity list order until it returns false, skipping
+	// entities that are not close to the box if Type has a grid
+	template<typename F>
+	void ForEachEntityNear(int Type, vec2 Min, vec2 Max, F &&Callback);
+
 	CCharacter *m_apCharacters[MAX_CLIENTS];
 };
 
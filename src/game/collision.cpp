@@ -7,6 +7,7 @@
 #include <antibot/antibot_data.h>
 
 #include <cmath>
+#include <limits>
 #include <engine/map.h>
 
 #include <game/collision.h>
@@ -119,6 +120,10 @@ void CCollision::Init(class CLayers *pLayers)
 		}
 	}
 
+	m_vTileInfos.resize((size_t)m_Width * m_Height);
+	for(int i = 0; i < m_Width * m_Height; i++)
+		m_vTileInfos[i] = CalculateTileInfo(i);
+
 	if(m_pTele)
 	{
 		for(int i = 0; i < m_Width * m_Height; i++)
@@ -157,6 +162,7 @@ void CCollision::Unload()
 
 	m_HighestSwitchNumber = 0;
 
+	m_vTileInfos.clear();
 	m_TeleIns.clear();
 	m_TeleOuts.clear();
 	m_TeleCheckOuts.clear();
@@ -282,22 +288,11 @@ int CCollision::GetMoveRestrictions(CALLBACK_SWITCHACTIVE pfnSwitchActive, void
 		{
 			ModMapIndex = OverrideCenterTileIndex;
 		}
-		for(int Front = 0; Front < 2; Front++)
-		{
-			int Tile;
-			int Flags;
-			if(!Front)
-			{
-				Tile = GetTileIndex(ModMapIndex);
-				Flags = GetTileFlags(ModMapIndex);
-			}
-			else
-			{
-				Tile = GetFrontTileIndex(ModMapIndex);
-				Flags = GetFrontTileFlags(ModMapIndex);
-			}
-			Restrictions |= ::GetMoveRestrictions(d, Tile, Flags);
-		}
+		const uint32_t Info = m_vTileInfos[ModMapIndex];
+		if(d == MR_DIR_HERE)
+			Restrictions |= (Info >> TILEINFO_RESTRICTIONS_HERE_SHIFT) & TILEINFO_RESTRICTIONS_MASK;
+		else
+			Restrictions |= (Info >> TILEINFO_RESTRICTIONS_SHIFT) & GetMoveRestrictionsMask(d);
 		if(pfnSwitchActive)
 		{
 			CDoorTile DoorTile;
@@ -312,23 +307,169 @@ int CCollision::GetMoveRestrictions(CALLBACK_SWITCHACTIVE pfnSwitchActive, void
 	return Restrictions;
 }
 
+template<typename TTile>
+static bool StopperNext(const TTile *pTiles, int Left, int Right, int Below, int Above)
+{
+	if((pTiles[Right].m_Index == TILE_STOP && pTiles[Right].m_Flags == ROTATION_270) || (pTiles[Left].m_Index == TILE_STOP && pTiles[Left].m_Flags == ROTATION_90))
+		return true;
+	if((pTiles[Below].m_Index == TILE_STOP && pTiles[Below].m_Flags == ROTATION_0) || (pTiles[Above].m_Index == TILE_STOP && pTiles[Above].m_Flags == ROTATION_180))
+		return true;
+	if(pTiles[Right].m_Index == TILE_STOPA || pTiles[Left].m_Index == TILE_STOPA || ((pTiles[Right].m_Index == TILE_STOPS || pTiles[Left].m_Index == TILE_STOPS)))
+		return true;
+	if(pTiles[Below].m_Index == TILE_STOPA || pTiles[Above].m_Index == TILE_STOPA || ((pTiles[Below].m_Index == TILE_STOPS || pTiles[Above].m_Index == TILE_STOPS) && pTiles[Below].m_Flags | ROTATION_180 | ROTATION_0))
+		return true;
+	return false;
+}
+
+uint32_t CCollision::CalculateTileInfo(int Index) const
+{
+	uint32_t Info = 0;
+	const int Tile = m_pTiles[Index].m_Index;
+	const int Front = m_pFront ? m_pFront[Index].m_Index : (int)TILE_AIR;
+
+	if(Tile >= TILE_SOLID && Tile <= TILE_NOLASER)
+		Info |= Tile << TILEINFO_GAME_SHIFT;
+	if(Front == TILE_DEATH || Front == TILE_NOLASER)
+		Info |= Front << TILEINFO_FRONT_SHIFT;
+	if(Tile == TILE_SOLID || Tile == TILE_NOHOOK)
+		Info |= TILEINFO_SOLID;
+	if(Tile == TILE_THROUGH || Front == TILE_THROUGH)
+		Info |= TILEINFO_THROUGH;
+	if(Front == TILE_THROUGH_ALL || Front == TILE_THROUGH_CUT)
+		Info |= TILEINFO_FRONT_THROUGH;
+	if(Tile == TILE_THROUGH_ALL || Front == TILE_THROUGH_ALL)
+		Info |= TILEINFO_THROUGH_ALL;
+	if(Tile == TILE_THROUGH_DIR)
+		Info |= TILEINFO_THROUGH_DIR;
+	if(Front == TILE_THROUGH_DIR)
+		Info |= TILEINFO_FRONT_THROUGH_DIR;
+
+	if((Tile >= TILE_FREEZE && Tile <= TILE_TELE_LASER_DISABLE) || (Tile >= TILE_LFREEZE && Tile <= TILE_LUNFREEZE) ||
+		(Front >= TILE_FREEZE && Front <= TILE_TELE_LASER_DISABLE) || (Front >= TILE_LFREEZE && Front <= TILE_LUNFREEZE) ||
+		(m_pTele && (m_pTele[Index].m_Type == TILE_TELEIN || m_pTele[Index].m_Type == TILE_TELEINEVIL || m_pTele[Index].m_Type == TILE_TELECHECKINEVIL || m_pTele[Index].m_Type == TILE_TELECHECK || m_pTele[Index].m_Type == TILE_TELECHECKIN)) ||
+		(m_pSpeedup && m_pSpeedup[Index].m_Force > 0) ||
+		(m_pSwitch && m_pSwitch[Index].m_Type) ||
+		(m_pTune && m_pTune[Index].m_Type))
+		Info |= TILEINFO_EXISTS;
+
+	const int Left = (Index - 1 > 0) ? Index - 1 : Index;
+	const int Right = (Index + 1 < m_Width * m_Height) ? Index + 1 : Index;
+	const int Below = (Index + m_Width < m_Width * m_Height) ? Index + m_Width : Index;
+	const int Above = (Index - m_Width > 0) ? Index - m_Width : Index;
+	if(StopperNext(m_pTiles, Left, Right, Below, Above) || (m_pFront && StopperNext(m_pFront, Left, Right, Below, Above)))
+		Info |= TILEINFO_EXISTS_NEXT;
+
+	const int TileRestrictions = ::GetMoveRestrictionsRaw(MR_DIR_HERE, Tile, m_pTiles[Index].m_Flags);
+	const int FrontRestrictions = m_pFront ? ::GetMoveRestrictionsRaw(MR_DIR_HERE, Front, m_pFront[Index].m_Flags) : 0;
+	Info |= (TileRestrictions | FrontRestrictions) << TILEINFO_RESTRICTIONS_SHIFT;
+	Info |= ((Tile == TILE_STOP ? TileRestrictions : 0) | (Front == TILE_STOP ? FrontRestrictions : 0)) << TILEINFO_RESTRICTIONS_HERE_SHIFT;
+	return Info;
+}
+
+void CCollision::UpdateTileInfos(int Index)
+{
+	// TILEINFO_EXISTS_NEXT depends on the neighbours
+	for(int Neighbour : {Index, Index - 1, Index + 1, Index - m_Width, Index + m_Width})
+		if(Neighbour >= 0 && Neighbour < m_Width * m_Height)
+			m_vTileInfos[Neighbour] = CalculateTileInfo(Neighbour);
+}
+
 int CCollision::GetTile(int x, int y) const
 {
 	if(!m_pTiles)
 		return 0;
+	return (TileInfo(x, y) >> TILEINFO_GAME_SHIFT) & TILEINFO_TILE_MASK;
+}
 
-	int Nx = std::clamp(x / 32, 0, m_Width - 1);
-	int Ny = std::clamp(y / 32, 0, m_Height - 1);
-	int pos = Ny * m_Width + Nx;
+template<typename THitTile>
+bool CCollision::IntersectTiles(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, THitTile &&HitTile) const
+{
+	// Amanatides-Woo traversal. A position is in the tile
+	// round_to_int(Pos) / 32, so the tile borders are at 32 * n - 0.5.
+	// NaN would never cross a border, so the loop would not end.
+	if(!std::isfinite(Pos0.x) || !std::isfinite(Pos0.y) || !std::isfinite(Pos1.x) || !std::isfinite(Pos1.y))
+	{
+		if(pOutCollision)
+			*pOutCollision = Pos1;
+		if(pOutBeforeCollision)
+			*pOutBeforeCollision = Pos1;
+		return false;
+	}
+	const vec2 Delta = Pos1 - Pos0;
+	const float Length = length(Delta);
+	int x = (int)std::floor((Pos0.x + 0.5f) / 32.0f);
+	int y = (int)std::floor((Pos0.y + 0.5f) / 32.0f);
+	const int StepX = Delta.x < 0 ? -1 : 1;
+	const int StepY = Delta.y < 0 ? -1 : 1;
+	// the next borders are computed from the tile instead of summing up
+	// the steps, that drifts by whole units on rays through the map
+	auto NextBorder = [](int Tile, int Step, float Start, float Dir) {
+		if(Dir == 0)
+			return std::numeric_limits<float>::infinity();
+		return ((Tile + (Step > 0)) * 32.0f - 0.5f - Start) / Dir;
+	};
+	float NextX = NextBorder(x, StepX, Pos0.x, Delta.x);
+	float NextY = NextBorder(y, StepY, Pos0.y, Delta.y);
+
+	float t = 0.0f;
+	int LastIndex = -1;
+	while(true)
+	{
+		// outside of the map, consecutive tiles clamp to the same one
+		const int Index = std::clamp(y, 0, m_Height - 1) * m_Width + std::clamp(x, 0, m_Width - 1);
+		// x * 32 + 15 lies in the tile without clamping, so that the
+		// through offsets of the hook behave like for the sampled points
+		if(Index != LastIndex && HitTile(x * 32 + 15, y * 32 + 15))
+		{
+			// move the collision a bit into the tile, the border itself
+			// rounds to the previous tile when going left or up
+			const float Hit = Length > 0.0f ? minimum(t + 0.01f / Length, 1.0f) : 0.0f;
+			const float Before = Length > 0.0f ? maximum(Hit - 1.0f / Length, 0.0f) : 0.0f;
+			if(pOutCollision)
+				*pOutCollision = Pos0 + Delta * Hit;
+			if(pOutBeforeCollision)
+				*pOutBeforeCollision = Pos0 + Delta * Before;
+			return true;
+		}
+		LastIndex = Index;
 
-	if(m_pTiles[pos].m_Index >= TILE_SOLID && m_pTiles[pos].m_Index <= TILE_NOLASER)
-		return m_pTiles[pos].m_Index;
-	return 0;
+		if(NextX < NextY)
+		{
+			t = NextX;
+			x += StepX;
+			NextX = NextBorder(x, StepX, Pos0.x, Delta.x);
+		}
+		else
+		{
+			t = NextY;
+			y += StepY;
+			NextY = NextBorder(y, StepY, Pos0.y, Delta.y);
+		}
+		if(t > 1.0f)
+			break;
+	}
+	if(pOutCollision)
+		*pOutCollision = Pos1;
+	if(pOutBeforeCollision)
+		*pOutBeforeCollision = Pos1;
+	return false;
 }
 
 // TODO: rewrite this smarter!
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
+	if(g_Config.m_SvExactIntersect)
+	{
+		int Hit = 0;
+		IntersectTiles(Pos0, Pos1, pOutCollision, pOutBeforeCollision, [&](int x, int y) {
+			if(!IsSolid(x, y))
+				return false;
+			Hit = GetTile(x, y);
+			return true;
+		});
+		return Hit;
+	}
+
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
 	vec2 Last = Pos0;
@@ -360,6 +501,38 @@ int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *p
 
 int CCollision::IntersectLineTeleHook(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr) const
 {
+	if(g_Config.m_SvExactIntersect)
+	{
+		int dx = 0, dy = 0;
+		ThroughOffset(Pos0, Pos1, &dx, &dy);
+		int Hit = 0;
+		if(pTeleNr)
+			*pTeleNr = 0;
+		IntersectTiles(Pos0, Pos1, pOutCollision, pOutBeforeCollision, [&](int x, int y) {
+			if(pTeleNr)
+			{
+				int Index = GetPureMapIndex(x, y);
+				*pTeleNr = g_Config.m_SvOldTeleportHook ? IsTeleport(Index) : IsTeleportHook(Index);
+				if(*pTeleNr)
+				{
+					Hit = TILE_TELEINHOOK;
+					return true;
+				}
+			}
+			if(IsSolid(x, y))
+			{
+				if(!IsThrough(x, y, dx, dy, Pos0, Pos1))
+					Hit = GetTile(x, y);
+			}
+			else if(IsHookBlocker(x, y, Pos0, Pos1))
+			{
+				Hit = TILE_NOHOOK;
+			}
+			return Hit != 0;
+		});
+		return Hit;
+	}
+
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
 	vec2 Last = Pos0;
@@ -420,6 +593,34 @@ int CCollision::IntersectLineTeleHook(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision,
 
 int CCollision::IntersectLineTeleWeapon(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr) const
 {
+	if(g_Config.m_SvExactIntersect)
+	{
+		int Hit = 0;
+		bool Collided = false;
+		if(pTeleNr)
+			*pTeleNr = 0;
+		IntersectTiles(Pos0, Pos1, pOutCollision, pOutBeforeCollision, [&](int x, int y) {
+			if(pTeleNr)
+			{
+				int Index = GetPureMapIndex(x, y);
+				*pTeleNr = g_Config.m_SvOldTeleportWeapons ? IsTeleport(Index) : IsTeleportWeapon(Index);
+				if(*pTeleNr)
+				{
+					Hit = TILE_TELEINWEAPON;
+					Collided = true;
+					return true;
+				}
+			}
+			if(IsSolid(x, y))
+			{
+				Hit = GetTile(x, y);
+				Collided = true;
+			}
+			return Collided;
+		});
+		return Hit;
+	}
+
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
 	vec2 Last = Pos0;
@@ -505,6 +706,18 @@ void CCollision::MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, i
 	}
 }
 
+void CCollision::CheckPoints(const float *pX, const float *pY, int Num, bool *pOutSolid) const
+{
+	if(!m_pTiles)
+	{
+		std::fill(pOutSolid, pOutSolid + Num, false);
+		return;
+	}
+	// the lookups do not depend on each other, so their cache misses overlap
+	for(int i = 0; i < Num; i++)
+		pOutSolid[i] = (TileInfo(round_to_int(pX[i]), round_to_int(pY[i])) & TILEINFO_SOLID) != 0;
+}
+
 bool CCollision::TestBox(vec2 Pos, vec2 Size) const
 {
 	Size *= 0.5f;
@@ -598,32 +811,37 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, vec2 Elast
 
 int CCollision::IsSolid(int x, int y) const
 {
-	int index = GetTile(x, y);
-	return index == TILE_SOLID || index == TILE_NOHOOK;
+	if(!m_pTiles)
+		return 0;
+	return (TileInfo(x, y) & TILEINFO_SOLID) != 0;
 }
 
 bool CCollision::IsThrough(int x, int y, int OffsetX, int OffsetY, vec2 Pos0, vec2 Pos1) const
 {
 	int pos = GetPureMapIndex(x, y);
-	if(m_pFront && (m_pFront[pos].m_Index == TILE_THROUGH_ALL || m_pFront[pos].m_Index == TILE_THROUGH_CUT))
+	const uint32_t Info = m_vTileInfos[pos];
+	if(Info & TILEINFO_FRONT_THROUGH)
 		return true;
-	if(m_pFront && m_pFront[pos].m_Index == TILE_THROUGH_DIR && ((m_pFront[pos].m_Flags == ROTATION_0 && Pos0.y > Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_90 && Pos0.x < Pos1.x) || (m_pFront[pos].m_Flags == ROTATION_180 && Pos0.y < Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_270 && Pos0.x > Pos1.x)))
+	if((Info & TILEINFO_FRONT_THROUGH_DIR) && ((m_pFront[pos].m_Flags == ROTATION_0 && Pos0.y > Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_90 && Pos0.x < Pos1.x) || (m_pFront[pos].m_Flags == ROTATION_180 && Pos0.y < Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_270 && Pos0.x > Pos1.x)))
 		return true;
 	int offpos = GetPureMapIndex(x + OffsetX, y + OffsetY);
-	return m_pTiles[offpos].m_Index == TILE_THROUGH || (m_pFront && m_pFront[offpos].m_Index == TILE_THROUGH);
+	return m_vTileInfos[offpos] & TILEINFO_THROUGH;
 }
 
 bool CCollision::IsHookBlocker(int x, int y, vec2 Pos0, vec2 Pos1) const
 {
 	int pos = GetPureMapIndex(x, y);
-	if(m_pTiles[pos].m_Index == TILE_THROUGH_ALL || (m_pFront && m_pFront[pos].m_Index == TILE_THROUGH_ALL))
+	const uint32_t Info = m_vTileInfos[pos];
+	if(!(Info & (TILEINFO_THROUGH_ALL | TILEINFO_THROUGH_DIR | TILEINFO_FRONT_THROUGH_DIR)))
+		return false;
+	if(Info & TILEINFO_THROUGH_ALL)
 		return true;
-	if(m_pTiles[pos].m_Index == TILE_THROUGH_DIR && ((m_pTiles[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) ||
+	if((Info & TILEINFO_THROUGH_DIR) && ((m_pTiles[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) ||
 								(m_pTiles[pos].m_Flags == ROTATION_90 && Pos0.x > Pos1.x) ||
 								(m_pTiles[pos].m_Flags == ROTATION_180 && Pos0.y > Pos1.y) ||
 								(m_pTiles[pos].m_Flags == ROTATION_270 && Pos0.x < Pos1.x)))
 		return true;
-	if(m_pFront && m_pFront[pos].m_Index == TILE_THROUGH_DIR && ((m_pFront[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_90 && Pos0.x > Pos1.x) || (m_pFront[pos].m_Flags == ROTATION_180 && Pos0.y > Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_270 && Pos0.x < Pos1.x)))
+	if((Info & TILEINFO_FRONT_THROUGH_DIR) && ((m_pFront[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_90 && Pos0.x > Pos1.x) || (m_pFront[pos].m_Flags == ROTATION_180 && Pos0.y > Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_270 && Pos0.x < Pos1.x)))
 		return true;
 	return false;
 }
@@ -841,20 +1059,10 @@ bool CCollision::TileExists(int Index) const
 	if(Index < 0)
 		return false;
 
-	if((m_pTiles[Index].m_Index >= TILE_FREEZE && m_pTiles[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (m_pTiles[Index].m_Index >= TILE_LFREEZE && m_pTiles[Index].m_Index <= TILE_LUNFREEZE))
-		return true;
-	if(m_pFront && ((m_pFront[Index].m_Index >= TILE_FREEZE && m_pFront[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (m_pFront[Index].m_Index >= TILE_LFREEZE && m_pFront[Index].m_Index <= TILE_LUNFREEZE)))
-		return true;
-	if(m_pTele && (m_pTele[Index].m_Type == TILE_TELEIN || m_pTele[Index].m_Type == TILE_TELEINEVIL || m_pTele[Index].m_Type == TILE_TELECHECKINEVIL || m_pTele[Index].m_Type == TILE_TELECHECK || m_pTele[Index].m_Type == TILE_TELECHECKIN))
-		return true;
-	if(m_pSpeedup && m_pSpeedup[Index].m_Force > 0)
+	if(m_vTileInfos[Index] & (TILEINFO_EXISTS | TILEINFO_EXISTS_NEXT))
 		return true;
 	if(m_pDoor && m_pDoor[Index].m_Index)
 		return true;
-	if(m_pSwitch && m_pSwitch[Index].m_Type)
-		return true;
-	if(m_pTune && m_pTune[Index].m_Type)
-		return true;
 	return TileExistsNext(Index);
 }
 
@@ -862,42 +1070,15 @@ bool CCollision::TileExistsNext(int Index) const
 {
 	if(Index < 0)
 		return false;
+	if(m_vTileInfos[Index] & TILEINFO_EXISTS_NEXT)
+		return true;
+	if(!m_pDoor)
+		return false;
 	int TileOnTheLeft = (Index - 1 > 0) ? Index - 1 : Index;
 	int TileOnTheRight = (Index + 1 < m_Width * m_Height) ? Index + 1 : Index;
 	int TileBelow = (Index + m_Width < m_Width * m_Height) ? Index + m_Width : Index;
 	int TileAbove = (Index - m_Width > 0) ? Index - m_Width : Index;
-
-	if((m_pTiles[TileOnTheRight].m_Index == TILE_STOP && m_pTiles[TileOnTheRight].m_Flags == ROTATION_270) || (m_pTiles[TileOnTheLeft].m_Index == TILE_STOP && m_pTiles[TileOnTheLeft].m_Flags == ROTATION_90))
-		return true;
-	if((m_pTiles[TileBelow].m_Index == TILE_STOP && m_pTiles[TileBelow].m_Flags == ROTATION_0) || (m_pTiles[TileAbove].m_Index == TILE_STOP && m_pTiles[TileAbove].m_Flags == ROTATION_180))
-		return true;
-	if(m_pTiles[TileOnTheRight].m_Index == TILE_STOPA || m_pTiles[TileOnTheLeft].m_Index == TILE_STOPA || ((m_pTiles[TileOnTheRight].m_Index == TILE_STOPS || m_pTiles[TileOnTheLeft].m_Index == TILE_STOPS)))
-		return true;
-	if(m_pTiles[TileBelow].m_Index == TILE_STOPA || m_pTiles[TileAbove].m_Index == TILE_STOPA || ((m_pTiles[TileBelow].m_Index == TILE_STOPS || m_pTiles[TileAbove].m_Index == TILE_STOPS) && m_pTiles[TileBelow].m_Flags | ROTATION_180 | ROTATION_0))
-		return true;
-	if(m_pFront)
-	{
-		if(m_pFront[TileOnTheRight].m_Index == TILE_STOPA || m_pFront[TileOnTheLeft].m_Index == TILE_STOPA || ((m_pFront[TileOnTheRight].m_Index == TILE_STOPS || m_pFront[TileOnTheLeft].m_Index == TILE_STOPS)))
-			return true;
-		if(m_pFront[TileBelow].m_Index == TILE_STOPA || m_pFront[TileAbove].m_Index == TILE_STOPA || ((m_pFront[TileBelow].m_Index == TILE_STOPS || m_pFront[TileAbove].m_Index == TILE_STOPS) && m_pFront[TileBelow].m_Flags | ROTATION_180 | ROTATION_0))
-			return true;
-		if((m_pFront[TileOnTheRight].m_Index == TILE_STOP && m_pFront[TileOnTheRight].m_Flags == ROTATION_270) || (m_pFront[TileOnTheLeft].m_Index == TILE_STOP && m_pFront[TileOnTheLeft].m_Flags == ROTATION_90))
-			return true;
-		if((m_pFront[TileBelow].m_Index == TILE_STOP && m_pFront[TileBelow].m_Flags == ROTATION_0) || (m_pFront[TileAbove].m_Index == TILE_STOP && m_pFront[TileAbove].m_Flags == ROTATION_180))
-			return true;
-	}
-	if(m_pDoor)
-	{
-		if(m_pDoor[TileOnTheRight].m_Index == TILE_STOPA || m_pDoor[TileOnTheLeft].m_Index == TILE_STOPA || ((m_pDoor[TileOnTheRight].m_Index == TILE_STOPS || m_pDoor[TileOnTheLeft].m_Index == TILE_STOPS)))
-			return true;
-		if(m_pDoor[TileBelow].m_Index == TILE_STOPA || m_pDoor[TileAbove].m_Index == TILE_STOPA || ((m_pDoor[TileBelow].m_Index == TILE_STOPS || m_pDoor[TileAbove].m_Index == TILE_STOPS) && m_pDoor[TileBelow].m_Flags | ROTATION_180 | ROTATION_0))
-			return true;
-		if((m_pDoor[TileOnTheRight].m_Index == TILE_STOP && m_pDoor[TileOnTheRight].m_Flags == ROTATION_270) || (m_pDoor[TileOnTheLeft].m_Index == TILE_STOP && m_pDoor[TileOnTheLeft].m_Flags == ROTATION_90))
-			return true;
-		if((m_pDoor[TileBelow].m_Index == TILE_STOP && m_pDoor[TileBelow].m_Flags == ROTATION_0) || (m_pDoor[TileAbove].m_Index == TILE_STOP && m_pDoor[TileAbove].m_Flags == ROTATION_180))
-			return true;
-	}
-	return false;
+	return StopperNext(m_pDoor, TileOnTheLeft, TileOnTheRight, TileBelow, TileAbove);
 }
 
 int CCollision::GetMapIndex(vec2 Pos) const
@@ -1040,12 +1221,7 @@ int CCollision::GetFrontTile(int x, int y) const
 {
 	if(!m_pFront)
 		return 0;
-	int Nx = std::clamp(x / 32, 0, m_Width - 1);
-	int Ny = std::clamp(y / 32, 0, m_Height - 1);
-	if(m_pFront[Ny * m_Width + Nx].m_Index == TILE_DEATH || m_pFront[Ny * m_Width + Nx].m_Index == TILE_NOLASER)
-		return m_pFront[Ny * m_Width + Nx].m_Index;
-	else
-		return 0;
+	return (TileInfo(x, y) >> TILEINFO_FRONT_SHIFT) & TILEINFO_TILE_MASK;
 }
 
 int CCollision::Entity(int x, int y, int Layer) const
@@ -1080,6 +1256,7 @@ void CCollision::SetCollisionAt(float x, float y, int Index)
 	int Ny = std::clamp(round_to_int(y) / 32, 0, m_Height - 1);
 
 	m_pTiles[Ny * m_Width + Nx].m_Index = Index;
+	UpdateTileInfos(Ny * m_Width + Nx);
 }
 
 void CCollision::SetDoorCollisionAt(float x, float y, int Type, int Flags, int Number)
@@ -1140,6 +1317,20 @@ void ThroughOffset(vec2 Pos0, vec2 Pos1, int *pOffsetX, int *pOffsetY)
 
 int CCollision::IntersectNoLaser(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
+	if(g_Config.m_SvExactIntersect)
+	{
+		int Hit = 0;
+		IntersectTiles(Pos0, Pos1, pOutCollision, pOutBeforeCollision, [&](int x, int y) {
+			const int Tile = GetTile(x, y);
+			const int Front = GetFrontTile(x, y);
+			if(Tile != TILE_SOLID && Tile != TILE_NOHOOK && Tile != TILE_NOLASER && Front != TILE_NOLASER)
+				return false;
+			Hit = Front == TILE_NOLASER ? Front : Tile;
+			return true;
+		});
+		return Hit;
+	}
+
 	float d = distance(Pos0, Pos1);
 	vec2 Last = Pos0;
 
@@ -1171,6 +1362,18 @@ int CCollision::IntersectNoLaser(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2
 
 int CCollision::IntersectNoLaserNoWalls(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
+	if(g_Config.m_SvExactIntersect)
+	{
+		int Hit = 0;
+		IntersectTiles(Pos0, Pos1, pOutCollision, pOutBeforeCollision, [&](int x, int y) {
+			if(!IsNoLaser(x, y) && !IsFrontNoLaser(x, y))
+				return false;
+			Hit = IsNoLaser(x, y) ? GetTile(x, y) : GetFrontTile(x, y);
+			return true;
+		});
+		return Hit;
+	}
+
 	float d = distance(Pos0, Pos1);
 	vec2 Last = Pos0;
 
@@ -1200,6 +1403,26 @@ int CCollision::IntersectNoLaserNoWalls(vec2 Pos0, vec2 Pos1, vec2 *pOutCollisio
 
 int CCollision::IntersectAir(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
+	if(g_Config.m_SvExactIntersect)
+	{
+		int Hit = 0;
+		IntersectTiles(Pos0, Pos1, pOutCollision, pOutBeforeCollision, [&](int x, int y) {
+			const int Tile = GetTile(x, y);
+			const int Front = GetFrontTile(x, y);
+			if(!Tile && !Front)
+			{
+				Hit = -1;
+				return true;
+			}
+			if(Tile != TILE_SOLID && Tile != TILE_NOHOOK)
+				return false;
+			// like below, solid tiles return the front tile
+			Hit = Front;
+			return true;
+		});
+		return Hit;
+	}
+
 	float d = distance(Pos0, Pos1);
 	vec2 Last = Pos0;
 
@@ -6,6 +6,8 @@
 #include <base/vmath.h>
 #include <engine/shared/protocol.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -42,6 +44,8 @@ public:
 
 	bool CheckPoint(float x, float y) const { return IsSolid(round_to_int(x), round_to_int(y)); }
 	bool CheckPoint(vec2 Pos) const { return CheckPoint(Pos.x, Pos.y); }
+	// CheckPoint for many points at once, for callers that keep the coordinates in separate arrays
+	void CheckPoints(const float *pX, const float *pY, int Num, bool *pOutSolid) const;
 	int GetCollisionAt(float x, float y) const { return GetTile(round_to_int(x), round_to_int(y)); }
 	int GetWidth() const { return m_Width; }
 	int GetHeight() const { return m_Height; }
@@ -146,6 +150,48 @@ public:
 private:
 	CLayers *m_pLayers;
 
+	// properties of the static layers that the hot queries need, packed
+	// per tile so that they only have to do one load instead of reading
+	// the game, front and other layers and comparing tile indices
+	enum
+	{
+		// game and front tile if it is one of TILE_SOLID to TILE_NOLASER
+		TILEINFO_GAME_SHIFT = 0,
+		TILEINFO_FRONT_SHIFT = 3,
+		TILEINFO_TILE_MASK = 7,
+		TILEINFO_SOLID = 1 << 6,
+		// TILE_THROUGH in the game or front layer
+		TILEINFO_THROUGH = 1 << 7,
+		// TILE_THROUGH_ALL or TILE_THROUGH_CUT in the front layer
+		TILEINFO_FRONT_THROUGH = 1 << 8,
+		// TILE_THROUGH_ALL in the game or front layer
+		TILEINFO_THROUGH_ALL = 1 << 9,
+		TILEINFO_THROUGH_DIR = 1 << 10,
+		TILEINFO_FRONT_THROUGH_DIR = 1 << 11,
+		// TileExists and TileExistsNext without the doors
+		TILEINFO_EXISTS = 1 << 12,
+		TILEINFO_EXISTS_NEXT = 1 << 13,
+		// CANTMOVE_* of the stoppers of the tile, and of the one way
+		// stoppers that also restrict moving away from them
+		TILEINFO_RESTRICTIONS_SHIFT = 16,
+		TILEINFO_RESTRICTIONS_HERE_SHIFT = 20,
+		TILEINFO_RESTRICTIONS_MASK = 15,
+	};
+	std::vector<uint32_t> m_vTileInfos;
+	uint32_t CalculateTileInfo(int Index) const;
+	void UpdateTileInfos(int Index);
+	uint32_t TileInfo(int x, int y) const
+	{
+		int Nx = std::clamp(x / 32, 0, m_Width - 1);
+		int Ny = std::clamp(y / 32, 0, m_Height - 1);
+		return m_vTileInfos[Ny * m_Width + Nx];
+	}
+
+	// walks the tiles that the segment from Pos0 to Pos1 crosses, in
+	// order, and stops at the first one for which HitTile returns true
+	template<typename THitTile>
+	bool IntersectTiles(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, THitTile &&HitTile) const;
+
 	int m_Width;
 	int m_Height;
 
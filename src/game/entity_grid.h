@@ -0,0 +1,192 @@
+#ifndef GAME_ENTITY_GRID_H
+#define GAME_ENTITY_GRID_H
+
+#include <base/vmath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+	Class: CEntityGridNode
+		Position of an entity in a CEntityGrid. Copies of an entity
+		are not part of any grid until they are inserted.
+*/
+class CEntityGridNode
+{
+	template<typename TEntity>
+	friend class CEntityGrid;
+
+	int m_Bucket = -1;
+	int m_BucketIndex = -1;
+	int64_t m_Order = 0;
+
+public:
+	CEntityGridNode() = default;
+	CEntityGridNode(const CEntityGridNode &Other) {}
+	CEntityGridNode &operator=(const CEntityGridNode &Other) { return *this; }
+};
+
+/*
+	Class: CEntityGrid
+		Spatial hash over the positions of the entities of one type.
+		Queries return the entities in the order of the entity list
+		of the world, so that they find the same entities as a scan
+		of the list and physics stay deterministic.
+
+		TEntity needs m_Pos, GetProximityRadius() and a CEntityGridNode
+		returned by GridNode().
+*/
+template<typename TEntity>
+class CEntityGrid
+{
+	enum
+	{
+		CELL_SIZE = 256,
+		NUM_BUCKETS = 1024,
+		// larger coordinates share the outermost cells
+		MAX_CELL = 1 << 20,
+	};
+
+	// positions can be slightly outside of a query box due to float rounding
+	static constexpr float QUERY_MARGIN = 1.0f;
+
+	std::vector<TEntity *> m_avpBuckets[NUM_BUCKETS];
+	std::vector<int> m_vQueryBuckets;
+	int m_NumEntities = 0;
+	int64_t m_FirstOrder = 0;
+	int64_t m_LastOrder = 0;
+	float m_MaxProximityRadius = 0.0f;
+
+	static int Cell(float Coordinate)
+	{
+		const float Cell = std::floor(Coordinate / CELL_SIZE);
+		// also catches NaN
+		if(!(Cell > -MAX_CELL))
+			return -MAX_CELL;
+		if(!(Cell < MAX_CELL))
+			return MAX_CELL;
+		return (int)Cell;
+	}
+
+	static int Bucket(int CellX, int CellY)
+	{
+		return (int)(((unsigned)CellX * 73856093u ^ (unsigned)CellY * 19349663u) % NUM_BUCKETS);
+	}
+
+	static int Bucket(vec2 Pos)
+	{
+		return Bucket(Cell(Pos.x), Cell(Pos.y));
+	}
+
+	void Link(TEntity *pEnt, int BucketIndex)
+	{
+		CEntityGridNode &Node = pEnt->GridNode();
+		Node.m_Bucket = BucketIndex;
+		Node.m_BucketIndex = m_avpBuckets[BucketIndex].size();
+		m_avpBuckets[BucketIndex].push_back(pEnt);
+	}
+
+	bool Unlink(TEntity *pEnt)
+	{
+		CEntityGridNode &Node = pEnt->GridNode();
+		if(Node.m_Bucket == -1)
+			return false;
+		std::vector<TEntity *> &vpBucket = m_avpBuckets[Node.m_Bucket];
+		if(Node.m_BucketIndex >= (int)vpBucket.size() || vpBucket[Node.m_BucketIndex] != pEnt)
+			return false;
+		vpBucket[Node.m_BucketIndex] = vpBucket.back();
+		vpBucket[Node.m_BucketIndex]->GridNode().m_BucketIndex = Node.m_BucketIndex;
+		vpBucket.pop_back();
+		Node.m_Bucket = -1;
+		Node.m_BucketIndex = -1;
+		return true;
+	}
+
+public:
+	int NumEntities() const { return m_NumEntities; }
+
+	void Clear()
+	{
+		for(auto &vpBucket : m_avpBuckets)
+		{
+			for(TEntity *pEnt : vpBucket)
+				pEnt->GridNode().m_Bucket = -1;
+			vpBucket.clear();
+		}
+		m_NumEntities = 0;
+	}
+
+	// Last must match where the entity is inserted into the entity list
+	void Insert(TEntity *pEnt, bool Last)
+	{
+		Link(pEnt, Bucket(pEnt->m_Pos));
+		pEnt->GridNode().m_Order = Last ? ++m_LastOrder : --m_FirstOrder;
+		m_MaxProximityRadius = std::max(m_MaxProximityRadius, pEnt->GetProximityRadius());
+		m_NumEntities++;
+	}
+
+	void Remove(TEntity *pEnt)
+	{
+		if(Unlink(pEnt))
+			m_NumEntities--;
+	}
+
+	// has to be called whenever m_Pos of an inserted entity changes
+	void Move(TEntity *pEnt)
+	{
+		const CEntityGridNode &Node = pEnt->GridNode();
+		if(Node.m_Bucket == -1)
+			return;
+		const int NewBucket = Bucket(pEnt->m_Pos);
+		if(NewBucket == Node.m_Bucket)
+			return;
+		Unlink(pEnt);
+		Link(pEnt, NewBucket);
+	}
+
+	/*
+		Function: Query
+			Finds the entities that might be closer than their proximity
+			radius to the box.
+
+		Arguments:
+			Min - Top left corner of the box.
+			Max - Bottom right corner of the box.
+			vpResult - Filled with the candidates in entity list order.
+
+		Returns:
+			False if the box covers so many cells that scanning the
+			entity list is cheaper. vpResult is unchanged then.
+	*/
+	bool Query(vec2 Min, vec2 Max, std::vector<TEntity *> &vpResult)
+	{
+		const float Expand = m_MaxProximityRadius + QUERY_MARGIN;
+		const int MinX = Cell(Min.x - Expand);
+		const int MinY = Cell(Min.y - Expand);
+		const int MaxX = Cell(Max.x + Expand);
+		const int MaxY = Cell(Max.y + Expand);
+		const int64_t NumCells = ((int64_t)MaxX - MinX + 1) * ((int64_t)MaxY - MinY + 1);
+		if(NumCells > m_NumEntities || NumCells > NUM_BUCKETS)
+			return false;
+
+		// several cells can share a bucket
+		m_vQueryBuckets.clear();
+		for(int y = MinY; y <= MaxY; y++)
+			for(int x = MinX; x <= MaxX; x++)
+				m_vQueryBuckets.push_back(Bucket(x, y));
+		std::sort(m_vQueryBuckets.begin(), m_vQueryBuckets.end());
+		m_vQueryBuckets.erase(std::unique(m_vQueryBuckets.begin(), m_vQueryBuckets.end()), m_vQueryBuckets.end());
+
+		vpResult.clear();
+		for(int BucketIndex : m_vQueryBuckets)
+			vpResult.insert(vpResult.end(), m_avpBuckets[BucketIndex].begin(), m_avpBuckets[BucketIndex].end());
+		std::sort(vpResult.begin(), vpResult.end(), [](TEntity *pA, TEntity *pB) {
+			return pA->GridNode().m_Order < pB->GridNode().m_Order;
+		});
+		return true;
+	}
+};
+
+#endif
@@ -18,6 +18,24 @@ const char *CTuningParams::ms_apNames[] =
 #undef MACRO_TUNING_PARAM
 };
 
+// Conservative test used to skip players before the team checks and the exact
+// distance checks. The loops still visit every player, this only makes
+// rejecting a distant one cheaper. The box is widened by a margin that covers
+// the rounding of those checks, so skipping a player never changes the result.
+static constexpr float PAIR_FILTER_MARGIN = 1.0f;
+
+static bool OutsideBox(vec2 Pos, vec2 Min, vec2 Max)
+{
+	return Pos.x < Min.x || Pos.x > Max.x || Pos.y < Min.y || Pos.y > Max.y;
+}
+
+static void BoundingBox(vec2 A, vec2 B, float Radius, vec2 *pMin, vec2 *pMax)
+{
+	const float Extent = Radius + PAIR_FILTER_MARGIN;
+	*pMin = vec2(minimum(A.x, B.x) - Extent, minimum(A.y, B.y) - Extent);
+	*pMax = vec2(maximum(A.x, B.x) + Extent, maximum(A.y, B.y) + Extent);
+}
+
 bool CTuningParams::Set(int Index, float Value)
 {
 	if(Index < 0 || Index >= Num())
@@ -348,10 +366,15 @@ void CCharacterCore::Tick(bool UseInput, bool DoDeferredTick)
 		if(!m_HookHitDisabled && m_pWorld && m_Tuning.m_PlayerHooking && (m_HookState == HOOK_FLYING || !m_NewHook))
 		{
 			float Distance = 0.0f;
+			// only players close to the hook's path can be hit
+			vec2 BoxMin, BoxMax;
+			BoundingBox(m_HookPos, NewPos, PhysicalSize() + 2.0f, &BoxMin, &BoxMax);
 			for(int i = 0; i < MAX_CLIENTS; i++)
 			{
 				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
-				if(!pCharCore || pCharCore == this || (!(m_Super || pCharCore->m_Super) && ((m_Id != -1 && !m_pTeams->CanCollide(i, m_Id)) || pCharCore->m_Solo || m_Solo)))
+				if(!pCharCore || pCharCore == this || OutsideBox(pCharCore->m_Pos, BoxMin, BoxMax))
+					continue;
+				if(!(m_Super || pCharCore->m_Super) && ((m_Id != -1 && !m_pTeams->CanCollide(i, m_Id)) || pCharCore->m_Solo || m_Solo))
 					continue;
 
 				vec2 ClosestPoint;
@@ -461,12 +484,18 @@ void CCharacterCore::TickDeferred()
 {
 	if(m_pWorld)
 	{
+		// apart from the hooked player, only players within collision range are affected
+		vec2 BoxMin, BoxMax;
+		BoundingBox(m_Pos, m_Pos, PhysicalSize() * 1.25f, &BoxMin, &BoxMax);
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
 			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 			if(!pCharCore)
 				continue;
 
+			if(i != m_HookedPlayer && OutsideBox(pCharCore->m_Pos, BoxMin, BoxMax))
+				continue;
+
 			if(pCharCore == this || (m_Id != -1 && !m_pTeams->CanCollide(m_Id, i)))
 				continue; // make sure that we don't nudge our self
 
@@ -568,19 +597,31 @@ void CCharacterCore::Move()
 		float Distance = distance(m_Pos, NewPos);
 		if(Distance > 0)
 		{
-			int End = Distance + 1;
+			// the other players don't move meanwhile, so find the ones that
+			// can be hit along the way once instead of for every step
+			vec2 BoxMin, BoxMax;
+			BoundingBox(m_Pos, NewPos, PhysicalSize(), &BoxMin, &BoxMax);
+			int aCandidates[MAX_CLIENTS];
+			int NumCandidates = 0;
+			for(int p = 0; p < MAX_CLIENTS; p++)
+			{
+				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
+				if(!pCharCore || pCharCore == this || OutsideBox(pCharCore->m_Pos, BoxMin, BoxMax))
+					continue;
+				if((!(pCharCore->m_Super || m_Super) && (m_Solo || pCharCore->m_Solo || pCharCore->m_CollisionDisabled || (m_Id != -1 && !m_pTeams->CanCollide(m_Id, p)))))
+					continue;
+				aCandidates[NumCandidates++] = p;
+			}
+
+			int End = NumCandidates > 0 ? Distance + 1 : 0;
 			vec2 LastPos = m_Pos;
 			for(int i = 0; i < End; i++)
 			{
 				float a = i / Distance;
 				vec2 Pos = mix(m_Pos, NewPos, a);
-				for(int p = 0; p < MAX_CLIENTS; p++)
+				for(int c = 0; c < NumCandidates; c++)
 				{
-					CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
-					if(!pCharCore || pCharCore == this)
-						continue;
-					if((!(pCharCore->m_Super || m_Super) && (m_Solo || pCharCore->m_Solo || pCharCore->m_CollisionDisabled || (m_Id != -1 && !m_pTeams->CanCollide(m_Id, p)))))
-						continue;
+					CCharacterCore *pCharCore = m_pWorld->m_apCharacters[aCandidates[c]];
 					float D = distance(Pos, pCharCore->m_Pos);
 					if(D < PhysicalSize())
 					{
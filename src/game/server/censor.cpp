@@ -0,0 +1,177 @@
+#include "censor.h"
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <algorithm>
+
+CCensorList::CCensorList()
+{
+	Clear();
+}
+
+void CCensorList::Clear()
+{
+	m_vWords.clear();
+	m_vNodes.clear();
+	m_vNodes.emplace_back();
+	m_Naive = false;
+}
+
+void CCensorList::Add(const char *pWord)
+{
+	m_vWords.push_back({pWord, 0});
+}
+
+int CCensorList::Child(int Node, int Codepoint) const
+{
+	const std::vector<std::pair<int, int>> &vNext = m_vNodes[Node].m_vNext;
+	const auto It = std::lower_bound(vNext.begin(), vNext.end(), Codepoint, [](const std::pair<int, int> &Next, int Cp) { return Next.first < Cp; });
+	if(It == vNext.end() || It->first != Codepoint)
+		return -1;
+	return It->second;
+}
+
+int CCensorList::Step(int Node, int Codepoint) const
+{
+	while(true)
+	{
+		const int Next = Child(Node, Codepoint);
+		if(Next >= 0)
+			return Next;
+		if(Node == 0)
+			return 0;
+		Node = m_vNodes[Node].m_Fail;
+	}
+}
+
+void CCensorList::Build()
+{
+	m_vNodes.clear();
+	m_vNodes.emplace_back();
+	m_Naive = false;
+
+	for(int i = 0; i < (int)m_vWords.size(); i++)
+	{
+		// empty words never mask anything
+		if(m_vWords[i].m_Word.empty())
+			continue;
+		int Node = 0;
+		int NumCodepoints = 0;
+		const char *pCur = m_vWords[i].m_Word.c_str();
+		while(*pCur)
+		{
+			const int Codepoint = str_utf8_tolower_codepoint(str_utf8_decode(&pCur));
+			if(Codepoint == '*')
+				m_Naive = true;
+			int Next = Child(Node, Codepoint);
+			if(Next < 0)
+			{
+				Next = m_vNodes.size();
+				std::vector<std::pair<int, int>> &vNext = m_vNodes[Node].m_vNext;
+				vNext.insert(std::lower_bound(vNext.begin(), vNext.end(), std::pair<int, int>(Codepoint, Next)), {Codepoint, Next});
+				m_vNodes.emplace_back();
+			}
+			Node = Next;
+			NumCodepoints++;
+		}
+		m_vWords[i].m_NumCodepoints = NumCodepoints;
+		m_vNodes[Node].m_vWords.push_back(i);
+	}
+
+	// fail links in breadth first order, so the fail node of a parent is
+	// always done before its children
+	std::vector<int> vQueue = {0};
+	for(size_t i = 0; i < vQueue.size(); i++)
+	{
+		const int Node = vQueue[i];
+		for(const auto &[Codepoint, Next] : m_vNodes[Node].m_vNext)
+		{
+			const int Fail = Node == 0 ? 0 : Step(m_vNodes[Node].m_Fail, Codepoint);
+			m_vNodes[Next].m_Fail = Fail;
+			m_vNodes[Next].m_OutputLink = m_vNodes[Fail].m_vWords.empty() ? m_vNodes[Fail].m_OutputLink : Fail;
+			vQueue.push_back(Next);
+		}
+	}
+}
+
+void CCensorList::Censor(char *pMessage) const
+{
+	if(m_Naive)
+	{
+		CensorNaive(pMessage);
+		return;
+	}
+
+	class CMatch
+	{
+	public:
+		int m_Word;
+		int m_Start;
+		int m_End;
+	};
+	std::vector<CMatch> vMatches;
+	// the byte offset of every codepoint
+	std::vector<int> vOffsets;
+
+	int Node = 0;
+	const char *pCur = pMessage;
+	while(*pCur)
+	{
+		vOffsets.push_back(pCur - pMessage);
+		Node = Step(Node, str_utf8_tolower_codepoint(str_utf8_decode(&pCur)));
+		for(int Output = m_vNodes[Node].m_vWords.empty() ? m_vNodes[Node].m_OutputLink : Node; Output >= 0; Output = m_vNodes[Output].m_OutputLink)
+		{
+			for(int Word : m_vNodes[Output].m_vWords)
+				vMatches.push_back({Word, vOffsets[vOffsets.size() - m_vWords[Word].m_NumCodepoints], (int)(pCur - pMessage)});
+		}
+	}
+	if(vMatches.empty())
+		return;
+
+	// a lowercase codepoint can have another length than the original one,
+	// the mask has the length of the word and could then end in the middle
+	// of a codepoint, which changes how the rest of the message is searched
+	for(const CMatch &Match : vMatches)
+	{
+		if(Match.m_End - Match.m_Start != (int)m_vWords[Match.m_Word].m_Word.length())
+		{
+			CensorNaive(pMessage);
+			return;
+		}
+	}
+
+	// the matches of each word are found in order, and a word does not match
+	// anything that was already masked, because none of the words has a `*`
+	std::stable_sort(vMatches.begin(), vMatches.end(), [](const CMatch &a, const CMatch &b) { return a.m_Word < b.m_Word; });
+	for(const CMatch &Match : vMatches)
+	{
+		char *pStart = pMessage + Match.m_Start;
+		char *pEnd = pMessage + Match.m_End;
+		if(std::find(pStart, pEnd, '*') == pEnd)
+			std::fill(pStart, pEnd, '*');
+	}
+}
+
+void CCensorList::CensorNaive(char *pMessage) const
+{
+	const int Length = str_length(pMessage);
+	for(const CWord &Word : m_vWords)
+	{
+		char *pCurLoc = pMessage;
+		do
+		{
+			pCurLoc = (char *)str_utf8_find_nocase(pCurLoc, Word.m_Word.c_str());
+			if(pCurLoc)
+			{
+				// the word can be longer than the match, don't mask the terminator
+				const int MaskLength = minimum((int)Word.m_Word.length(), Length - (int)(pCurLoc - pMessage));
+				for(int i = 0; i < MaskLength; i++)
+				{
+					pCurLoc[i] = '*';
+				}
+				pCurLoc++;
+			}
+		} while(pCurLoc);
+	}
+}
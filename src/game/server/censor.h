@@ -0,0 +1,55 @@
+#ifndef GAME_SERVER_CENSOR_H
+#define GAME_SERVER_CENSOR_H
+
+#include <string>
+#include <vector>
+
+// The censor list compiled into an Aho-Corasick automaton over lowercase
+// codepoints, so a message is searched for all words in one pass. The result
+// is the same as masking the words one after the other with
+// `str_utf8_find_nocase`, which `CensorNaive` still does.
+class CCensorList
+{
+	class CNode
+	{
+	public:
+		// sorted by codepoint
+		std::vector<std::pair<int, int>> m_vNext;
+		int m_Fail = 0;
+		// the next node on the fail chain where words end, -1 if there is none
+		int m_OutputLink = -1;
+		// the words ending in this node
+		std::vector<int> m_vWords;
+	};
+
+	class CWord
+	{
+	public:
+		std::string m_Word;
+		int m_NumCodepoints;
+	};
+
+	std::vector<CWord> m_vWords;
+	std::vector<CNode> m_vNodes;
+	// words with a `*` can match what an earlier word masked, which the
+	// automaton cannot reproduce
+	bool m_Naive = false;
+
+	int Child(int Node, int Codepoint) const;
+	int Step(int Node, int Codepoint) const;
+
+public:
+	CCensorList();
+
+	void Clear();
+	// the words are masked in the order they were added
+	void Add(const char *pWord);
+	// must be called after adding the words and before censoring
+	void Build();
+	int Size() const { return m_vWords.size(); }
+
+	void Censor(char *pMessage) const;
+	void CensorNaive(char *pMessage) const;
+};
+
+#endif
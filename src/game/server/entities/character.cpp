@@ -70,7 +70,7 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 	m_IsBlueTeleGunTeleport = false;
 
 	m_pPlayer = pPlayer;
-	m_Pos = Pos;
+	SetPos(Pos);
 
 	mem_zero(&m_LatestPrevPrevInput, sizeof(m_LatestPrevPrevInput));
 	m_LatestPrevPrevInput.m_TargetY = -1;
@@ -848,7 +848,7 @@ void CCharacter::TickDeferred()
 	bool StuckAfterMove = Collision()->TestBox(m_Core.m_Pos, CCharacterCore::PhysicalSizeVec2());
 	m_Core.Quantize();
 	bool StuckAfterQuant = Collision()->TestBox(m_Core.m_Pos, CCharacterCore::PhysicalSizeVec2());
-	m_Pos = m_Core.m_Pos;
+	SetPos(m_Core.m_Pos);
 
 	if(!StuckBefore && (StuckAfterMove || StuckAfterQuant))
 	{
@@ -912,8 +912,7 @@ void CCharacter::TickDeferred()
 
 	if(m_pPlayer->GetTeam() == TEAM_SPECTATORS)
 	{
-		m_Pos.x = m_Input.m_TargetX;
-		m_Pos.y = m_Input.m_TargetY;
+		SetPos(vec2(m_Input.m_TargetX, m_Input.m_TargetY));
 	}
 
 	// update the m_SendCore if needed
@@ -187,11 +187,20 @@ void CPickup::Snap(int SnappingClient)
 	GameServer()->SnapPickup(CSnapContext(SnappingClientVersion, Sixup, SnappingClient), GetId(), m_Pos, m_Type, m_Subtype, m_Number, m_Flags);
 }
 
+bool CPickup::SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility)
+{
+	pVisibility->m_aClipPos[0] = m_Pos;
+	pVisibility->m_NumClipPos = 1;
+
+	GameServer()->SnapPickup(Context, GetId(), m_Pos, m_Type, m_Subtype, m_Number, m_Flags);
+	return true;
+}
+
 void CPickup::Move()
 {
 	if(Server()->Tick() % (int)(Server()->TickSpeed() * 0.15f) == 0)
 	{
 		GameServer()->Collision()->MoverSpeed(m_Pos.x, m_Pos.y, &m_Core);
-		m_Pos += m_Core;
+		SetPos(m_Pos + m_Core);
 	}
 }
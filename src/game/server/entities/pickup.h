@@ -16,6 +16,7 @@ public:
 	void Tick() override;
 	void TickPaused() override;
 	void Snap(int SnappingClient) override;
+	bool SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility) override;
 
 	int Type() const { return m_Type; }
 	int Subtype() const { return m_Subtype; }
@@ -364,6 +364,27 @@ void CProjectile::Snap(int SnappingClient)
 	}
 }
 
+bool CProjectile::SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility)
+{
+	dbg_assert(Context.GetClientVersion() >= VERSION_DDNET_ENTITY_NETOBJS, "shared projectiles require the DDNet entity netobjs");
+
+	float Ct = (Server()->Tick() - m_StartTick) / (float)Server()->TickSpeed();
+	pVisibility->m_aClipPos[0] = GetPos(Ct);
+	pVisibility->m_NumClipPos = 1;
+
+	if(m_Owner >= 0)
+	{
+		CCharacter *pOwnerChar = GameServer()->GetPlayerChar(m_Owner);
+		if(pOwnerChar && pOwnerChar->IsAlive())
+			pVisibility->m_ViewerMask = pOwnerChar->TeamMask();
+	}
+
+	CNetObj_DDNetProjectile *pDDNetProjectile = Server()->SnapNewItem<CNetObj_DDNetProjectile>(GetId());
+	if(pDDNetProjectile)
+		FillExtraInfo(pDDNetProjectile);
+	return true;
+}
+
 void CProjectile::SwapClients(int Client1, int Client2)
 {
 	m_Owner = m_Owner == Client1 ? Client2 : m_Owner == Client2 ? Client1 : m_Owner;
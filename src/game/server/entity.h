@@ -12,6 +12,7 @@
 
 class CCollision;
 class CGameContext;
+struct CSnapContext;
 
 /*
 	Class: Entity
@@ -39,6 +40,8 @@ private:
 	*/
 	float m_ProximityRadius;
 
+	CEntityGridNode m_GridNode;
+
 protected:
 	/* State */
 	bool m_MarkedForDestroy;
@@ -75,6 +78,14 @@ public: // TODO: Maybe make protected
 	CEntity *TypePrev() { return m_pPrevTypeEntity; }
 	const vec2 &GetPos() const { return m_Pos; }
 	float GetProximityRadius() const { return m_ProximityRadius; }
+	CEntityGridNode &GridNode() { return m_GridNode; }
+
+	/*
+		Function: SetPos
+			Moves the entity. Use this instead of writing m_Pos so
+			that the position queries of the world find the entity.
+	*/
+	void SetPos(vec2 Pos);
 
 	/* Other functions */
 
@@ -123,6 +134,23 @@ public: // TODO: Maybe make protected
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: SnapShared
+			Called once per tick to create the items of the entity for
+			all clients that use the DDNet entity netobjs. The items are
+			then added to the snapshot of every such client that passes
+			the network clipping and viewer mask in pVisibility.
+
+		Arguments:
+			Context - Snap context of the shared items.
+			pVisibility - Clip positions and viewer mask to fill in.
+
+		Returns:
+			False if the entity does not support this and has to be
+			snapped per client with Snap.
+	*/
+	virtual bool SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility) { return false; }
+
 	/*
 		Function: SwapClients
 			Called when two players have swapped their client ids.
@@ -15,6 +15,7 @@
 #include <engine/server/server.h>
 #include <engine/shared/config.h>
 #include <engine/shared/datafile.h>
+#include <engine/shared/gzip.h>
 #include <engine/shared/json.h>
 #include <engine/shared/linereader.h>
 #include <engine/shared/memheap.h>
@@ -126,6 +127,7 @@ void CGameContext::Construct(int Resetting)
 
 	m_aDeleteTempfile[0] = 0;
 	m_TeeHistorianActive = false;
+	m_pTeeHistorianGzip = nullptr;
 }
 
 void CGameContext::Destruct(int Resetting)
@@ -196,7 +198,10 @@ void CGameContext::Clear()
 void CGameContext::TeeHistorianWrite(const void *pData, int DataSize, void *pUser)
 {
 	CGameContext *pSelf = (CGameContext *)pUser;
-	aio_write(pSelf->m_pTeeHistorianFile, pData, DataSize);
+	if(pSelf->m_pTeeHistorianGzip)
+		pSelf->m_pTeeHistorianGzip->Write(pData, DataSize);
+	else
+		aio_write(pSelf->m_pTeeHistorianFile, pData, DataSize);
 }
 
 void CGameContext::CommandCallback(int ClientId, int FlagMask, const char *pCmd, IConsole::IResult *pResult, void *pUser)
@@ -1037,7 +1042,7 @@ void CGameContext::OnTick()
 
 	if(m_TeeHistorianActive)
 	{
-		int Error = aio_error(m_pTeeHistorianFile);
+		int Error = m_pTeeHistorianGzip ? m_pTeeHistorianGzip->Error() : aio_error(m_pTeeHistorianFile);
 		if(Error)
 		{
 			dbg_msg("teehistorian", "error writing to file, err=%d", Error);
@@ -2079,23 +2084,7 @@ void *CGameContext::PreProcessMsg(int *pMsgId, CUnpacker *pUnpacker, int ClientI
 void CGameContext::CensorMessage(char *pCensoredMessage, const char *pMessage, int Size)
 {
 	str_copy(pCensoredMessage, pMessage, Size);
-
-	for(auto &Item : m_vCensorlist)
-	{
-		char *pCurLoc = pCensoredMessage;
-		do
-		{
-			pCurLoc = (char *)str_utf8_find_nocase(pCurLoc, Item.c_str());
-			if(pCurLoc)
-			{
-				for(int i = 0; i < (int)Item.length(); i++)
-				{
-					pCurLoc[i] = '*';
-				}
-				pCurLoc++;
-			}
-		} while(pCurLoc);
-	}
+	m_Censorlist.Censor(pCensoredMessage);
 }
 
 void CGameContext::OnMessage(int MsgId, CUnpacker *pUnpacker, int ClientId)
@@ -4058,7 +4047,7 @@ void CGameContext::OnInit(const void *pPersistentData)
 		FormatUuid(m_GameUuid, aGameUuid, sizeof(aGameUuid));
 
 		char aFilename[IO_MAX_PATH_LENGTH];
-		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian", aGameUuid);
+		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian%s", aGameUuid, g_Config.m_SvTeeHistorianCompress ? ".gz" : "");
 
 		IOHANDLE THFile = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
 		if(!THFile)
@@ -4071,7 +4060,23 @@ void CGameContext::OnInit(const void *pPersistentData)
 		{
 			dbg_msg("teehistorian", "recording to '%s'", aFilename);
 		}
-		m_pTeeHistorianFile = aio_new(THFile);
+		if(g_Config.m_SvTeeHistorianCompress)
+		{
+			m_pTeeHistorianGzip = new CGzipWriter();
+			if(!m_pTeeHistorianGzip->Open(THFile))
+			{
+				dbg_msg("teehistorian", "failed to start compressing '%s'", aFilename);
+				delete m_pTeeHistorianGzip;
+				m_pTeeHistorianGzip = nullptr;
+				m_TeeHistorianActive = false;
+				Server()->SetErrorShutdown("teehistorian open error");
+				return;
+			}
+		}
+		else
+		{
+			m_pTeeHistorianFile = aio_new(THFile);
+		}
 
 		char aVersion[128];
 		if(GIT_SHORTREV_HASH)
@@ -4404,15 +4409,32 @@ void CGameContext::OnShutdown(void *pPersistentData)
 	if(m_TeeHistorianActive)
 	{
 		m_TeeHistorian.Finish();
-		aio_close(m_pTeeHistorianFile);
-		aio_wait(m_pTeeHistorianFile);
-		int Error = aio_error(m_pTeeHistorianFile);
+		int Error;
+		if(m_pTeeHistorianGzip)
+		{
+			m_pTeeHistorianGzip->Close();
+			Error = m_pTeeHistorianGzip->Error();
+		}
+		else
+		{
+			aio_close(m_pTeeHistorianFile);
+			aio_wait(m_pTeeHistorianFile);
+			Error = aio_error(m_pTeeHistorianFile);
+		}
 		if(Error)
 		{
 			dbg_msg("teehistorian", "error closing file, err=%d", Error);
 			Server()->SetErrorShutdown("teehistorian close error");
 		}
-		aio_free(m_pTeeHistorianFile);
+		if(m_pTeeHistorianGzip)
+		{
+			delete m_pTeeHistorianGzip;
+			m_pTeeHistorianGzip = nullptr;
+		}
+		else
+		{
+			aio_free(m_pTeeHistorianFile);
+		}
 	}
 
 	// Stop any demos being recorded.
@@ -5174,13 +5196,14 @@ void CGameContext::ReadCensorList()
 {
 	const char *pCensorFilename = "censorlist.txt";
 	CLineReader LineReader;
-	m_vCensorlist.clear();
+	m_Censorlist.Clear();
 	if(LineReader.OpenFile(Storage()->OpenFile(pCensorFilename, IOFLAG_READ, IStorage::TYPE_ALL)))
 	{
 		while(const char *pLine = LineReader.Get())
 		{
-			m_vCensorlist.emplace_back(pLine);
+			m_Censorlist.Add(pLine);
 		}
+		m_Censorlist.Build();
 	}
 	else
 	{
@@ -13,6 +13,7 @@
 #include <game/mapbugs.h>
 #include <game/voting.h>
 
+#include "censor.h"
 #include "eventhandler.h"
 #include "gameworld.h"
 #include "teehistorian.h"
@@ -44,6 +45,7 @@
 */
 
 class CCharacter;
+class CGzipWriter;
 class IConfigManager;
 class CConfig;
 class CHeap;
@@ -117,11 +119,13 @@ class CGameContext : public IGameServer
 	CNetObjHandler m_NetObjHandler;
 	CTuningParams m_Tuning;
 	CTuningParams m_aTuningList[NUM_TUNEZONES];
-	std::vector<std::string> m_vCensorlist;
+	CCensorList m_Censorlist;
 
 	bool m_TeeHistorianActive;
 	CTeeHistorian m_TeeHistorian;
 	ASYNCIO *m_pTeeHistorianFile;
+	// used instead of m_pTeeHistorianFile with sv_tee_historian_compress
+	CGzipWriter *m_pTeeHistorianGzip;
 	CUuid m_GameUuid;
 	CMapBugs m_MapBugs;
 	CPrng m_Prng;
@@ -8,6 +8,7 @@
 #include "gamecontroller.h"
 
 #include <engine/shared/config.h>
+#include <engine/shared/snapshot.h>
 
 #include <algorithm>
 #include <utility>
@@ -47,23 +48,49 @@ CEntity *CGameWorld::FindFirst(int Type)
 	return Type < 0 || Type >= NUM_ENTTYPES ? nullptr : m_apFirstEntityTypes[Type];
 }
 
+CEntityGrid<CEntity> *CGameWorld::Grid(int Type)
+{
+	if(Type == ENTTYPE_CHARACTER)
+		return &m_CharacterGrid;
+	if(Type == ENTTYPE_PICKUP)
+		return &m_PickupGrid;
+	return nullptr;
+}
+
+template<typename F>
+void CGameWorld::ForEachEntityNear(int Type, vec2 Min, vec2 Max, F &&Callback)
+{
+	CEntityGrid<CEntity> *pGrid = Grid(Type);
+	if(pGrid && pGrid->Query(Min, Max, m_vpGridCandidates))
+	{
+		for(CEntity *pEnt : m_vpGridCandidates)
+			if(!Callback(pEnt))
+				return;
+		return;
+	}
+
+	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		if(!Callback(pEnt))
+			return;
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
 	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
-	{
+	ForEachEntityNear(Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), [&](CEntity *pEnt) {
 		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
 		{
 			if(ppEnts)
 				ppEnts[Num] = pEnt;
 			Num++;
 			if(Num == Max)
-				break;
+				return false;
 		}
-	}
+		return true;
+	});
 
 	return Num;
 }
@@ -81,6 +108,11 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = nullptr;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	if(CEntityGrid<CEntity> *pGrid = Grid(pEnt->m_ObjType))
+		pGrid->Insert(pEnt, false);
+
+	m_SharedSnapTick = -1;
 }
 
 void CGameWorld::RemoveEntity(CEntity *pEnt)
@@ -103,6 +135,17 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = nullptr;
 	pEnt->m_pPrevTypeEntity = nullptr;
+
+	if(CEntityGrid<CEntity> *pGrid = Grid(pEnt->m_ObjType))
+		pGrid->Remove(pEnt);
+
+	m_SharedSnapTick = -1;
+}
+
+void CGameWorld::OnEntityMoved(CEntity *pEnt)
+{
+	if(CEntityGrid<CEntity> *pGrid = Grid(pEnt->m_ObjType))
+		pGrid->Move(pEnt);
 }
 
 //
@@ -115,6 +158,12 @@ void CGameWorld::Snap(int SnappingClient)
 		pEnt = m_pNextTraverseEntity;
 	}
 
+	if(UseSharedSnap(SnappingClient))
+	{
+		SnapShared(SnappingClient);
+		return;
+	}
+
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 	{
 		if(i == ENTTYPE_CHARACTER)
@@ -129,6 +178,71 @@ void CGameWorld::Snap(int SnappingClient)
 	}
 }
 
+bool CGameWorld::UseSharedSnap(int SnappingClient) const
+{
+	// the shared items are created for the newest netobjs, which only
+	// differ between clients before VERSION_DDNET_ENTITY_NETOBJS
+	return m_pConfig->m_SvSharedSnap &&
+	       !m_pServer->IsSixup(SnappingClient) &&
+	       m_pServer->GetClientVersion(SnappingClient) >= VERSION_DDNET_ENTITY_NETOBJS;
+}
+
+void CGameWorld::BuildSharedSnap()
+{
+	if(!m_pSharedSnapItems)
+		m_pSharedSnapItems = std::make_unique<CSnapshotItemBuffer>();
+	m_pSharedSnapItems->Clear();
+	m_vSharedSnapEntities.clear();
+
+	const CSnapContext Context(m_pServer->GetClientVersion(SERVER_DEMO_CLIENT), false, SERVER_DEMO_CLIENT);
+	m_pServer->SnapSetCapture(m_pSharedSnapItems.get());
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
+		if(i == ENTTYPE_CHARACTER)
+			continue;
+
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		{
+			CSharedSnapEntity Entity;
+			Entity.m_FirstItem = m_pSharedSnapItems->NumItems();
+			Entity.m_pEntity = pEnt->SnapShared(Context, &Entity.m_Visibility) ? nullptr : pEnt;
+			Entity.m_NumItems = m_pSharedSnapItems->NumItems() - Entity.m_FirstItem;
+			m_vSharedSnapEntities.push_back(Entity);
+		}
+	}
+	m_pServer->SnapSetCapture(nullptr);
+
+	m_SharedSnapTick = m_pServer->Tick();
+}
+
+void CGameWorld::SnapShared(int SnappingClient)
+{
+	if(m_SharedSnapTick != m_pServer->Tick())
+		BuildSharedSnap();
+
+	for(const CSharedSnapEntity &Entity : m_vSharedSnapEntities)
+	{
+		if(Entity.m_pEntity)
+		{
+			Entity.m_pEntity->Snap(SnappingClient);
+			continue;
+		}
+		if(!Entity.m_NumItems)
+			continue;
+
+		const CSnapVisibility &Visibility = Entity.m_Visibility;
+		if(SnappingClient != SERVER_DEMO_CLIENT && !Visibility.m_ViewerMask.test(SnappingClient))
+			continue;
+		bool Clipped = Visibility.m_NumClipPos > 0;
+		for(int i = 0; i < Visibility.m_NumClipPos && Clipped; i++)
+			Clipped = NetworkClipped(m_pGameServer, SnappingClient, Visibility.m_aClipPos[i]);
+		if(Clipped)
+			continue;
+
+		m_pServer->SnapAddCaptured(m_pSharedSnapItems.get(), Entity.m_FirstItem, Entity.m_NumItems);
+	}
+}
+
 void CGameWorld::Reset()
 {
 	// reset all entities
@@ -291,17 +405,17 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CEntity *pClosest = nullptr;
 
-	CEntity *pEntity = FindFirst(Type);
-	for(; pEntity; pEntity = pEntity->TypeNext())
-	{
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x) - Radius, minimum(Pos0.y, Pos1.y) - Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x) + Radius, maximum(Pos0.y, Pos1.y) + Radius);
+	ForEachEntityNear(Type, Min, Max, [&](CEntity *pEntity) {
 		if(pEntity == pNotThis)
-			continue;
+			return true;
 
 		if(pThisOnly && pEntity != pThisOnly)
-			continue;
+			return true;
 
 		if(CollideWith != -1 && !pEntity->CanCollide(CollideWith))
-			continue;
+			return true;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pEntity->m_Pos, IntersectPos))
@@ -318,7 +432,8 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 				}
 			}
 		}
-	}
+		return true;
+	});
 
 	return pClosest;
 }
@@ -329,11 +444,10 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 	float ClosestRange = Radius * 2;
 	CCharacter *pClosest = nullptr;
 
-	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
-	{
+	ForEachEntityNear(ENTTYPE_CHARACTER, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), [&](CEntity *pEnt) {
+		CCharacter *p = (CCharacter *)pEnt;
 		if(p == pNotThis)
-			continue;
+			return true;
 
 		float Len = distance(Pos, p->m_Pos);
 		if(Len < p->m_ProximityRadius + Radius)
@@ -344,7 +458,8 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 				pClosest = p;
 			}
 		}
-	}
+		return true;
+	});
 
 	return pClosest;
 }
@@ -352,11 +467,12 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CEntity *pNotThis)
 {
 	std::vector<CCharacter *> vpCharacters;
-	CCharacter *pChr = (CCharacter *)FindFirst(CGameWorld::ENTTYPE_CHARACTER);
-	for(; pChr; pChr = (CCharacter *)pChr->TypeNext())
-	{
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x) - Radius, minimum(Pos0.y, Pos1.y) - Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x) + Radius, maximum(Pos0.y, Pos1.y) + Radius);
+	ForEachEntityNear(ENTTYPE_CHARACTER, Min, Max, [&](CEntity *pEnt) {
+		CCharacter *pChr = (CCharacter *)pEnt;
 		if(pChr == pNotThis)
-			continue;
+			return true;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pChr->m_Pos, IntersectPos))
@@ -367,7 +483,8 @@ std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1
 				vpCharacters.push_back(pChr);
 			}
 		}
-	}
+		return true;
+	});
 	return vpCharacters;
 }
 
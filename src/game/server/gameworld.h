@@ -3,14 +3,17 @@
 #ifndef GAME_SERVER_GAMEWORLD_H
 #define GAME_SERVER_GAMEWORLD_H
 
+#include <game/entity_grid.h>
 #include <game/gamecore.h>
 
 #include "save.h"
 
+#include <memory>
 #include <vector>
 
 class CEntity;
 class CCharacter;
+class CSnapshotItemBuffer;
 
 /*
 	Class: Game World
@@ -30,6 +33,20 @@ public:
 		NUM_ENTTYPES
 	};
 
+	/*
+		Class: CSnapVisibility
+			Describes which clients see the items that an entity
+			created in CEntity::SnapShared.
+	*/
+	class CSnapVisibility
+	{
+	public:
+		// the items are clipped if all positions are network clipped
+		vec2 m_aClipPos[2];
+		int m_NumClipPos = 0;
+		CClientMask m_ViewerMask = CClientMask().set();
+	};
+
 private:
 	void Reset();
 	void RemoveEntities();
@@ -37,6 +54,38 @@ private:
 	CEntity *m_pNextTraverseEntity = nullptr;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
+	// spatial index of the entity types that are queried by position
+	CEntityGrid<CEntity> m_CharacterGrid;
+	CEntityGrid<CEntity> m_PickupGrid;
+	std::vector<CEntity *> m_vpGridCandidates;
+
+	CEntityGrid<CEntity> *Grid(int Type);
+
+	// calls Callback in entity list order until it returns false, skipping
+	// entities that are not close to the box if Type has a grid
+	template<typename F>
+	void ForEachEntityNear(int Type, vec2 Min, vec2 Max, F &&Callback);
+
+	class CSharedSnapEntity
+	{
+	public:
+		// entities that do not support shared snapping are snapped per client
+		CEntity *m_pEntity;
+		CSnapVisibility m_Visibility;
+		int m_FirstItem;
+		int m_NumItems;
+	};
+
+	// non-character entities snapped once per tick for all clients using
+	// the DDNet entity netobjs, see UseSharedSnap
+	std::vector<CSharedSnapEntity> m_vSharedSnapEntities;
+	std::unique_ptr<CSnapshotItemBuffer> m_pSharedSnapItems;
+	int m_SharedSnapTick = -1;
+
+	bool UseSharedSnap(int SnappingClient) const;
+	void BuildSharedSnap();
+	void SnapShared(int SnappingClient);
+
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
 	class IServer *m_pServer;
@@ -141,6 +190,16 @@ public:
 	*/
 	void RemoveEntity(CEntity *pEntity);
 
+	/*
+		Function: OnEntityMoved
+			Updates the spatial index after the position of an
+			entity changed, see CEntity::SetPos.
+
+		Arguments:
+			pEntity - Entity that moved
+	*/
+	void OnEntityMoved(CEntity *pEntity);
+
 	void RemoveEntitiesFromPlayer(int PlayerId);
 	void RemoveEntitiesFromPlayers(int PlayerIds[], int NumPlayers);
 
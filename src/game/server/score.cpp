@@ -33,7 +33,8 @@ void CScore::ExecPlayerThread(
 	const char *pThreadName,
 	int ClientId,
 	const char *pName,
-	int Offset)
+	int Offset,
+	CScoreResultCache::EQuery CacheQuery)
 {
 	auto pResult = NewSqlPlayerResult(ClientId);
 	if(pResult == nullptr)
@@ -45,6 +46,19 @@ void CScore::ExecPlayerThread(
 	str_copy(Tmp->m_aRequestingPlayer, Server()->ClientName(ClientId), sizeof(Tmp->m_aRequestingPlayer));
 	Tmp->m_Offset = Offset;
 
+	if(CacheQuery != CScoreResultCache::QUERY_NONE)
+	{
+		Tmp->m_pCache = m_pCache;
+		Tmp->m_CacheQuery = CacheQuery;
+		Tmp->m_CacheGeneration = m_pCache->Generation();
+		if(m_pCache->Find(Tmp.get(), pResult.get()))
+		{
+			pResult->m_Success = true;
+			pResult->m_Completed = true;
+			return;
+		}
+	}
+
 	m_pPool->Execute(pFuncPtr, std::move(Tmp), pThreadName);
 }
 
@@ -117,6 +131,14 @@ void CScore::LoadBestTime()
 
 	auto Tmp = std::make_unique<CSqlLoadBestTimeRequest>(LoadBestTimeResult);
 	str_copy(Tmp->m_aMap, Server()->GetMapName(), sizeof(Tmp->m_aMap));
+	Tmp->m_pCache = m_pCache;
+	Tmp->m_CacheGeneration = m_pCache->Generation();
+	if(m_pCache->Find(Tmp.get(), LoadBestTimeResult.get()))
+	{
+		LoadBestTimeResult->m_Success = true;
+		LoadBestTimeResult->m_Completed = true;
+		return;
+	}
 	m_pPool->Execute(CScoreWorker::LoadBestTime, std::move(Tmp), "load best time");
 }
 
@@ -141,7 +163,7 @@ void CScore::MapInfo(int ClientId, const char *pMapName)
 {
 	if(RateLimitPlayer(ClientId))
 		return;
-	ExecPlayerThread(CScoreWorker::MapInfo, "map info", ClientId, pMapName, 0);
+	ExecPlayerThread(CScoreWorker::MapInfo, "map info", ClientId, pMapName, 0, CScoreResultCache::QUERY_MAP_INFO);
 }
 
 void CScore::SaveScore(int ClientId, int TimeTicks, const char *pTimestamp, const float aTimeCp[NUM_CHECKPOINTS], bool NotEligible)
@@ -165,6 +187,8 @@ void CScore::SaveScore(int ClientId, int TimeTicks, const char *pTimestamp, cons
 	str_copy(Tmp->m_aTimestamp, pTimestamp, sizeof(Tmp->m_aTimestamp));
 	for(int i = 0; i < NUM_CHECKPOINTS; i++)
 		Tmp->m_aCurrentTimeCp[i] = aTimeCp[i];
+	Tmp->m_pCache = m_pCache;
+	m_pCache->BeginWrite(Tmp->m_aMap);
 
 	m_pPool->ExecuteWrite(CScoreWorker::SaveScore, std::move(Tmp), "save score");
 }
@@ -191,6 +215,8 @@ void CScore::SaveTeamScore(int Team, int *pClientIds, unsigned int Size, int Tim
 	FormatUuid(GameServer()->GameUuid(), Tmp->m_aGameUuid, sizeof(Tmp->m_aGameUuid));
 	str_copy(Tmp->m_aMap, Server()->GetMapName(), sizeof(Tmp->m_aMap));
 	Tmp->m_TeamrankUuid = RandomUuid();
+	Tmp->m_pCache = m_pCache;
+	m_pCache->BeginWrite(Tmp->m_aMap);
 
 	m_pPool->ExecuteWrite(CScoreWorker::SaveTeamScore, std::move(Tmp), "save team score");
 }
@@ -213,14 +239,14 @@ void CScore::ShowTop(int ClientId, int Offset)
 {
 	if(RateLimitPlayer(ClientId))
 		return;
-	ExecPlayerThread(CScoreWorker::ShowTop, "show top5", ClientId, "", Offset);
+	ExecPlayerThread(CScoreWorker::ShowTop, "show top5", ClientId, "", Offset, CScoreResultCache::QUERY_TOP);
 }
 
 void CScore::ShowTeamTop5(int ClientId, int Offset)
 {
 	if(RateLimitPlayer(ClientId))
 		return;
-	ExecPlayerThread(CScoreWorker::ShowTeamTop5, "show team top5", ClientId, "", Offset);
+	ExecPlayerThread(CScoreWorker::ShowTeamTop5, "show team top5", ClientId, "", Offset, CScoreResultCache::QUERY_TEAM_TOP5);
 }
 
 void CScore::ShowPlayerTeamTop5(int ClientId, const char *pName, int Offset)
@@ -248,14 +274,14 @@ void CScore::ShowPoints(int ClientId, const char *pName)
 {
 	if(RateLimitPlayer(ClientId))
 		return;
-	ExecPlayerThread(CScoreWorker::ShowPoints, "show points", ClientId, pName, 0);
+	ExecPlayerThread(CScoreWorker::ShowPoints, "show points", ClientId, pName, 0, CScoreResultCache::QUERY_POINTS);
 }
 
 void CScore::ShowTopPoints(int ClientId, int Offset)
 {
 	if(RateLimitPlayer(ClientId))
 		return;
-	ExecPlayerThread(CScoreWorker::ShowTopPoints, "show top points", ClientId, "", Offset);
+	ExecPlayerThread(CScoreWorker::ShowTopPoints, "show top points", ClientId, "", Offset, CScoreResultCache::QUERY_TOP_POINTS);
 }
 
 void CScore::RandomMap(int ClientId, int Stars)
@@ -15,6 +15,8 @@ class CScore
 {
 	CPlayerData m_aPlayerData[MAX_CLIENTS];
 	CDbConnectionPool *m_pPool;
+	// shared with the requests, which can outlive this
+	std::shared_ptr<CScoreResultCache> m_pCache = std::make_shared<CScoreResultCache>();
 
 	CGameContext *GameServer() const { return m_pGameServer; }
 	IServer *Server() const { return m_pServer; }
@@ -27,13 +29,14 @@ class CScore
 
 	// returns new SqlResult bound to the player, if no current Thread is active for this player
 	std::shared_ptr<CScorePlayerResult> NewSqlPlayerResult(int ClientId);
-	// Creates for player database requests
+	// Creates for player database requests, answers them from the cache if CacheQuery is set
 	void ExecPlayerThread(
 		bool (*pFuncPtr)(IDbConnection *, const ISqlData *, char *pError, int ErrorSize),
 		const char *pThreadName,
 		int ClientId,
 		const char *pName,
-		int Offset);
+		int Offset,
+		CScoreResultCache::EQuery CacheQuery = CScoreResultCache::QUERY_NONE);
 
 	// returns true if the player should be rate limited
 	bool RateLimitPlayer(int ClientId);
@@ -15,6 +15,12 @@ static const CUuid UUID_NO_SAVE_ID =
 	{{0x6b, 0x40, 0x7e, 0x81, 0x8b, 0x77, 0x3e, 0x04,
 		0xa2, 0x07, 0x8d, 0xa1, 0x7f, 0x37, 0xd0, 0x00}};
 
+static void AddToCache(const CSqlPlayerRequest *pData, const CScorePlayerResult *pResult, const char *pMap)
+{
+	if(pData->m_pCache)
+		pData->m_pCache->Add(pData, pResult, pMap);
+}
+
 CScorePlayerResult::CScorePlayerResult()
 {
 	SetVariant(Variant::DIRECT);
@@ -53,6 +59,153 @@ void CScorePlayerResult::SetVariant(Variant v)
 	}
 }
 
+bool CScoreResultCache::Find(const CSqlPlayerRequest *pRequest, CScorePlayerResult *pResult)
+{
+	const CLockScope LockScope(m_Lock);
+	const CEntry *pEntry = FindEntry(Key(pRequest));
+	if(pEntry == nullptr)
+		return false;
+	pResult->m_MessageKind = pEntry->m_MessageKind;
+	mem_copy(pResult->m_Data.m_aaMessages, pEntry->m_aaMessages, sizeof(pResult->m_Data.m_aaMessages));
+	return true;
+}
+
+bool CScoreResultCache::Find(const CSqlLoadBestTimeRequest *pRequest, CScoreLoadBestTimeResult *pResult)
+{
+	const CLockScope LockScope(m_Lock);
+	const CEntry *pEntry = FindEntry(Key(pRequest));
+	if(pEntry == nullptr)
+		return false;
+	pResult->m_CurrentRecord = pEntry->m_BestTime;
+	return true;
+}
+
+void CScoreResultCache::Add(const CSqlPlayerRequest *pRequest, const CScorePlayerResult *pResult, const char *pMap)
+{
+	const CLockScope LockScope(m_Lock);
+	CEntry *pEntry = AddEntry(Key(pRequest), pRequest->m_CacheGeneration, pMap);
+	if(pEntry == nullptr)
+		return;
+	pEntry->m_MessageKind = pResult->m_MessageKind;
+	mem_copy(pEntry->m_aaMessages, pResult->m_Data.m_aaMessages, sizeof(pEntry->m_aaMessages));
+}
+
+void CScoreResultCache::Add(const CSqlLoadBestTimeRequest *pRequest, const CScoreLoadBestTimeResult *pResult)
+{
+	const CLockScope LockScope(m_Lock);
+	CEntry *pEntry = AddEntry(Key(pRequest), pRequest->m_CacheGeneration, pRequest->m_aMap);
+	if(pEntry == nullptr)
+		return;
+	pEntry->m_BestTime = pResult->m_CurrentRecord;
+}
+
+void CScoreResultCache::BeginWrite(const char *pMap)
+{
+	const CLockScope LockScope(m_Lock);
+	m_PendingWrites++;
+	Invalidate(pMap);
+}
+
+void CScoreResultCache::EndWrite(const char *pMap)
+{
+	const CLockScope LockScope(m_Lock);
+	dbg_assert(m_PendingWrites > 0, "ending a write that didn't begin");
+	m_PendingWrites--;
+	// queries that started during the write might have read the old results
+	Invalidate(pMap);
+}
+
+uint64_t CScoreResultCache::Generation()
+{
+	const CLockScope LockScope(m_Lock);
+	return m_Generation;
+}
+
+int CScoreResultCache::Size()
+{
+	const CLockScope LockScope(m_Lock);
+	return m_Entries.size();
+}
+
+std::string CScoreResultCache::Key(const CSqlPlayerRequest *pRequest)
+{
+	char aKey[512];
+	switch(pRequest->m_CacheQuery)
+	{
+	case QUERY_TOP:
+	case QUERY_TEAM_TOP5:
+		str_format(aKey, sizeof(aKey), "%d %d %s\n%s", pRequest->m_CacheQuery, pRequest->m_Offset, pRequest->m_aServer, pRequest->m_aMap);
+		break;
+	case QUERY_TOP_POINTS:
+		str_format(aKey, sizeof(aKey), "%d %d", pRequest->m_CacheQuery, pRequest->m_Offset);
+		break;
+	case QUERY_POINTS:
+	case QUERY_MAP_INFO:
+		// the messages contain the requesting player
+		str_format(aKey, sizeof(aKey), "%d %s\n%s", pRequest->m_CacheQuery, pRequest->m_aRequestingPlayer, pRequest->m_aName);
+		break;
+	default:
+		dbg_assert(false, "query %d can't be cached", pRequest->m_CacheQuery);
+	}
+	return aKey;
+}
+
+std::string CScoreResultCache::Key(const CSqlLoadBestTimeRequest *pRequest)
+{
+	char aKey[MAX_MAP_LENGTH + 16];
+	str_format(aKey, sizeof(aKey), "%d %s", QUERY_BEST_TIME, pRequest->m_aMap);
+	return aKey;
+}
+
+const CScoreResultCache::CEntry *CScoreResultCache::FindEntry(const std::string &Key)
+{
+	auto It = m_Entries.find(Key);
+	if(It == m_Entries.end())
+		return nullptr;
+	if(It->second.m_Expires <= time_get())
+	{
+		m_Entries.erase(It);
+		return nullptr;
+	}
+	return &It->second;
+}
+
+CScoreResultCache::CEntry *CScoreResultCache::AddEntry(std::string Key, uint64_t Generation, const char *pMap)
+{
+	if(g_Config.m_SvSqlCacheTtl == 0 || m_PendingWrites > 0 || Generation != m_Generation)
+		return nullptr;
+	const int64_t Now = time_get();
+	if(m_Entries.size() >= MAX_ENTRIES)
+	{
+		std::erase_if(m_Entries, [Now](const auto &Entry) { return Entry.second.m_Expires <= Now; });
+		if(m_Entries.size() >= MAX_ENTRIES)
+			return nullptr;
+	}
+	CEntry &Entry = m_Entries[std::move(Key)];
+	Entry.m_Map = pMap != nullptr ? pMap : "";
+	Entry.m_Expires = Now + g_Config.m_SvSqlCacheTtl * time_freq();
+	return &Entry;
+}
+
+void CScoreResultCache::Invalidate(const char *pMap)
+{
+	m_Generation++;
+	// scores also award points, so the results that depend on them are dropped too
+	std::erase_if(m_Entries, [pMap](const auto &Entry) { return Entry.second.m_Map.empty() || Entry.second.m_Map == pMap; });
+}
+
+CSqlScoreData::~CSqlScoreData()
+{
+	if(m_pCache)
+		m_pCache->EndWrite(m_aMap);
+}
+
+CSqlTeamScoreData::~CSqlTeamScoreData()
+{
+	if(m_pCache)
+		m_pCache->EndWrite(m_aMap);
+}
+
 CTeamrank::CTeamrank() :
 	m_NumNames(0)
 {
@@ -166,6 +319,8 @@ bool CScoreWorker::LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGame
 	{
 		pResult->m_CurrentRecord = pSqlServer->GetFloat(1);
 	}
+	if(pData->m_pCache)
+		pData->m_pCache->Add(pData, pResult);
 
 	return true;
 }
@@ -480,6 +635,7 @@ bool CScoreWorker::MapInfo(IDbConnection *pSqlServer, const ISqlData *pGameData,
 			Finishes, Finishes == 1 ? "finish" : "finishes",
 			Finishers, Finishers == 1 ? "tee" : "tees",
 			aMedianString, aOwnFinishesString);
+		AddToCache(pData, pResult, aMap);
 	}
 	else
 	{
@@ -1072,6 +1228,8 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	if(!g_Config.m_SvRegionalRankings)
 	{
 		str_copy(pResult->m_Data.m_aaMessages[Line], "-----------------------------------------", sizeof(pResult->m_Data.m_aaMessages[Line]));
+		if(End)
+			AddToCache(pData, pResult, pData->m_aMap);
 		return End;
 	}
 
@@ -1103,6 +1261,8 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 		Line++;
 	}
 
+	if(End)
+		AddToCache(pData, pResult, pData->m_aMap);
 	return End;
 }
 
@@ -1171,6 +1331,7 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 	if(!g_Config.m_SvRegionalRankings)
 	{
 		str_copy(paMessages[Line], "-------------------------------", sizeof(paMessages[Line]));
+		AddToCache(pData, pResult, pData->m_aMap);
 		return true;
 	}
 
@@ -1200,6 +1361,7 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 			return false;
 		}
 	}
+	AddToCache(pData, pResult, pData->m_aMap);
 	return true;
 }
 
@@ -1452,6 +1614,7 @@ bool CScoreWorker::ShowPoints(IDbConnection *pSqlServer, const ISqlData *pGameDa
 		str_format(paMessages[0], sizeof(paMessages[0]),
 			"%s has not collected any points so far", pData->m_aName);
 	}
+	AddToCache(pData, pResult, nullptr);
 	return true;
 }
 
@@ -1500,6 +1663,7 @@ bool CScoreWorker::ShowTopPoints(IDbConnection *pSqlServer, const ISqlData *pGam
 		return false;
 	}
 	str_copy(paMessages[Line], "-------------------------------", sizeof(paMessages[Line]));
+	AddToCache(pData, pResult, nullptr);
 
 	return true;
 }
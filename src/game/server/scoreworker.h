@@ -1,12 +1,15 @@
 #ifndef GAME_SERVER_SCOREWORKER_H
 #define GAME_SERVER_SCOREWORKER_H
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <base/lock.h>
 #include <engine/map.h>
 #include <engine/server/databases/connection_pool.h>
 #include <engine/shared/protocol.h>
@@ -16,6 +19,8 @@
 
 class IDbConnection;
 class IGameController;
+struct CSqlLoadBestTimeRequest;
+struct CSqlPlayerRequest;
 
 enum
 {
@@ -72,6 +77,66 @@ struct CScoreLoadBestTimeResult : ISqlResult
 	float m_CurrentRecord;
 };
 
+// Results of the leaderboard queries, which only change when a score is
+// saved. Saving a score drops the results of its map and the points, other
+// servers writing to the same database are covered by sv_sql_cache_ttl.
+class CScoreResultCache
+{
+public:
+	enum EQuery
+	{
+		QUERY_NONE = -1,
+		QUERY_TOP,
+		QUERY_TEAM_TOP5,
+		QUERY_POINTS,
+		QUERY_TOP_POINTS,
+		QUERY_MAP_INFO,
+		QUERY_BEST_TIME,
+	};
+
+	enum
+	{
+		MAX_ENTRIES = 256,
+	};
+
+	// called on the main thread, copies a cached result and returns true if there is one
+	bool Find(const CSqlPlayerRequest *pRequest, CScorePlayerResult *pResult) EXCLUDES(m_Lock);
+	bool Find(const CSqlLoadBestTimeRequest *pRequest, CScoreLoadBestTimeResult *pResult) EXCLUDES(m_Lock);
+	// called on the database threads after a successful query, pMap is the
+	// map the result depends on or nullptr if it only depends on the points
+	void Add(const CSqlPlayerRequest *pRequest, const CScorePlayerResult *pResult, const char *pMap) EXCLUDES(m_Lock);
+	void Add(const CSqlLoadBestTimeRequest *pRequest, const CScoreLoadBestTimeResult *pResult) EXCLUDES(m_Lock);
+
+	// results of queries that overlap with writing a score of the map are not added
+	void BeginWrite(const char *pMap) EXCLUDES(m_Lock);
+	void EndWrite(const char *pMap) EXCLUDES(m_Lock);
+	// requests must be created with the current generation to be added
+	uint64_t Generation() EXCLUDES(m_Lock);
+	int Size() EXCLUDES(m_Lock);
+
+private:
+	struct CEntry
+	{
+		// empty for results that only depend on the points
+		std::string m_Map;
+		int64_t m_Expires;
+		CScorePlayerResult::Variant m_MessageKind;
+		char m_aaMessages[CScorePlayerResult::MAX_MESSAGES][512];
+		float m_BestTime;
+	};
+
+	static std::string Key(const CSqlPlayerRequest *pRequest);
+	static std::string Key(const CSqlLoadBestTimeRequest *pRequest);
+	const CEntry *FindEntry(const std::string &Key) REQUIRES(m_Lock);
+	CEntry *AddEntry(std::string Key, uint64_t Generation, const char *pMap) REQUIRES(m_Lock);
+	void Invalidate(const char *pMap) REQUIRES(m_Lock);
+
+	CLock m_Lock;
+	std::unordered_map<std::string, CEntry> m_Entries GUARDED_BY(m_Lock);
+	uint64_t m_Generation GUARDED_BY(m_Lock) = 0;
+	int m_PendingWrites GUARDED_BY(m_Lock) = 0;
+};
+
 struct CSqlLoadBestTimeRequest : ISqlData
 {
 	CSqlLoadBestTimeRequest(std::shared_ptr<CScoreLoadBestTimeResult> pResult) :
@@ -81,6 +146,10 @@ struct CSqlLoadBestTimeRequest : ISqlData
 
 	// current map
 	char m_aMap[MAX_MAP_LENGTH];
+
+	// set if the result should be added to the cache
+	std::shared_ptr<CScoreResultCache> m_pCache;
+	uint64_t m_CacheGeneration = 0;
 };
 
 struct CSqlPlayerRequest : ISqlData
@@ -98,6 +167,11 @@ struct CSqlPlayerRequest : ISqlData
 	// relevant for /top5 kind of requests
 	int m_Offset;
 	char m_aServer[5];
+
+	// set if the result should be added to the cache
+	std::shared_ptr<CScoreResultCache> m_pCache;
+	CScoreResultCache::EQuery m_CacheQuery = CScoreResultCache::QUERY_NONE;
+	uint64_t m_CacheGeneration = 0;
 };
 
 struct CScoreRandomMapResult : ISqlResult
@@ -132,6 +206,8 @@ struct CSqlScoreData : ISqlData
 		ISqlData(std::move(pResult))
 	{
 	}
+	// ends the write of the cache after the score was written to all databases
+	~CSqlScoreData() override;
 
 	char m_aMap[MAX_MAP_LENGTH];
 	char m_aGameUuid[UUID_MAXSTRSIZE];
@@ -144,6 +220,7 @@ struct CSqlScoreData : ISqlData
 	int m_Num;
 	bool m_Search;
 	char m_aRequestingPlayer[MAX_NAME_LENGTH];
+	std::shared_ptr<CScoreResultCache> m_pCache;
 };
 
 struct CScoreSaveResult : ISqlResult
@@ -176,6 +253,8 @@ struct CSqlTeamScoreData : ISqlData
 		ISqlData(nullptr)
 	{
 	}
+	// ends the write of the cache after the score was written to all databases
+	~CSqlTeamScoreData() override;
 
 	char m_aGameUuid[UUID_MAXSTRSIZE];
 	char m_aMap[MAX_MAP_LENGTH];
@@ -184,6 +263,7 @@ struct CSqlTeamScoreData : ISqlData
 	unsigned int m_Size;
 	char m_aaNames[MAX_CLIENTS][MAX_NAME_LENGTH];
 	CUuid m_TeamrankUuid;
+	std::shared_ptr<CScoreResultCache> m_pCache;
 };
 
 struct CSqlTeamSaveData : ISqlData
@@ -79,6 +79,7 @@ void CTeeHistorian::Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCal
 	}
 	m_pfnWriteCallback = pfnWriteCallback;
 	m_pWriteCallbackUserdata = pUser;
+	m_vBuffer.clear();
 
 	WriteHeader(pGameInfo);
 
@@ -393,7 +394,24 @@ void CTeeHistorian::RecordTeamPractice(int Team, bool Practice)
 
 void CTeeHistorian::Write(const void *pData, int DataSize)
 {
-	m_pfnWriteCallback(pData, DataSize, m_pWriteCallbackUserdata);
+	// only the header and records before the first tick are written
+	// outside of ticks, pass them on directly
+	if(m_State == STATE_START || m_State == STATE_BEFORE_TICK)
+	{
+		Flush();
+		m_pfnWriteCallback(pData, DataSize, m_pWriteCallbackUserdata);
+		return;
+	}
+	const unsigned char *pBytes = static_cast<const unsigned char *>(pData);
+	m_vBuffer.insert(m_vBuffer.end(), pBytes, pBytes + DataSize);
+}
+
+void CTeeHistorian::Flush()
+{
+	if(m_vBuffer.empty())
+		return;
+	m_pfnWriteCallback(m_vBuffer.data(), m_vBuffer.size(), m_pWriteCallbackUserdata);
+	m_vBuffer.clear();
 }
 
 void CTeeHistorian::EnsureTickWritten()
@@ -733,6 +751,7 @@ void CTeeHistorian::EndTick()
 {
 	dbg_assert(m_State == STATE_BEFORE_ENDTICK, "invalid teehistorian state");
 	m_State = STATE_BEFORE_TICK;
+	Flush();
 }
 
 void CTeeHistorian::RecordDDNetVersionOld(int ClientId, int DDNetVersion)
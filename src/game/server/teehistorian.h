@@ -7,6 +7,7 @@
 #include <generated/protocol.h>
 
 #include <ctime>
+#include <vector>
 
 class CConfig;
 class CTuningParams;
@@ -103,6 +104,7 @@ private:
 	void EnsureTickWritten();
 	void WriteTick();
 	void Write(const void *pData, int DataSize);
+	void Flush();
 
 	enum
 	{
@@ -136,6 +138,8 @@ private:
 
 	WRITE_CALLBACK m_pfnWriteCallback;
 	void *m_pWriteCallbackUserdata;
+	// records of the current tick, passed to the write callback at once
+	std::vector<unsigned char> m_vBuffer;
 
 	int m_State;
 
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <game/prng.h>
+#include <game/server/censor.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+static std::string Censored(const CCensorList &Censorlist, const char *pMessage, bool Naive = false)
+{
+	char aBuf[256];
+	str_copy(aBuf, pMessage);
+	if(Naive)
+		Censorlist.CensorNaive(aBuf);
+	else
+		Censorlist.Censor(aBuf);
+	return aBuf;
+}
+
+static std::string RandomText(CPrng &Prng, int MinParts, int MaxParts)
+{
+	// overlapping words, codepoints with lowercase versions of another
+	// length (the kelvin sign), invalid UTF-8 and masks already in the text
+	static const char *const s_apParts[] = {"a", "b", "A", "B", "ab", "k", "K", "\xE2\x84\xAA", "\xC3\xA4", "\xC3\x84", "\xC3\x9F", " ", "*", "\xC3", "\x80", "\xE2\x84"};
+	std::string Text;
+	const int NumParts = MinParts + Prng.RandomBits() % (MaxParts - MinParts + 1);
+	for(int i = 0; i < NumParts; i++)
+		Text += s_apParts[Prng.RandomBits() % std::size(s_apParts)];
+	return Text;
+}
+
+TEST(Censor, Simple)
+{
+	CCensorList Censorlist;
+	Censorlist.Add("bad");
+	Censorlist.Add("\xC3\xA4rger");
+	Censorlist.Add("");
+	Censorlist.Build();
+	EXPECT_EQ(Censored(Censorlist, "nothing to see"), "nothing to see");
+	EXPECT_EQ(Censored(Censorlist, "BaD words are bad"), "*** words are ***");
+	EXPECT_EQ(Censored(Censorlist, "so much \xC3\x84RGER"), "so much ******");
+	EXPECT_EQ(Censored(Censorlist, ""), "");
+
+	Censorlist.Clear();
+	Censorlist.Build();
+	EXPECT_EQ(Censored(Censorlist, "BaD words are bad"), "BaD words are bad");
+}
+
+TEST(Censor, Overlapping)
+{
+	CCensorList Censorlist;
+	Censorlist.Add("ab");
+	Censorlist.Add("ba");
+	Censorlist.Build();
+	// earlier words win, masked text is not matched again
+	EXPECT_EQ(Censored(Censorlist, "aba"), "**a");
+	EXPECT_EQ(Censored(Censorlist, "bab"), "b**");
+	EXPECT_EQ(Censored(Censorlist, "abbaab"), "******");
+}
+
+TEST(Censor, SameAsNaive)
+{
+	CPrng Prng;
+	uint64_t aSeed[2] = {1, 2};
+	Prng.Seed(aSeed);
+	for(int List = 0; List < 200; List++)
+	{
+		CCensorList Censorlist;
+		const int NumWords = 1 + Prng.RandomBits() % 8;
+		for(int i = 0; i < NumWords; i++)
+			Censorlist.Add(RandomText(Prng, 0, 3).c_str());
+		Censorlist.Build();
+		for(int Message = 0; Message < 50; Message++)
+		{
+			const std::string Text = RandomText(Prng, 0, 40);
+			ASSERT_EQ(Censored(Censorlist, Text.c_str()), Censored(Censorlist, Text.c_str(), true)) << "list " << List << " message " << Message;
+		}
+	}
+}
+
+// a list of a few thousand words like the public ones, and chat messages
+// which mostly contain none of them
+static void RealisticCensorList(CCensorList &Censorlist, std::vector<std::string> &vMessages, int NumMessages)
+{
+	CPrng Prng;
+	uint64_t aSeed[2] = {3, 4};
+	Prng.Seed(aSeed);
+	auto RandomWord = [&](int MinLength, int MaxLength) {
+		std::string Word;
+		const int Length = MinLength + Prng.RandomBits() % (MaxLength - MinLength + 1);
+		for(int i = 0; i < Length; i++)
+			Word += (char)('a' + Prng.RandomBits() % 26);
+		return Word;
+	};
+	std::vector<std::string> vWords;
+	for(int i = 0; i < 2000; i++)
+	{
+		vWords.push_back(RandomWord(4, 10));
+		Censorlist.Add(vWords.back().c_str());
+	}
+	Censorlist.Build();
+
+	for(int i = 0; i < NumMessages; i++)
+	{
+		std::string Message;
+		while(Message.length() < 80)
+		{
+			if(Prng.RandomBits() % 20 == 0)
+				Message += vWords[Prng.RandomBits() % vWords.size()];
+			else
+				Message += RandomWord(1, 8);
+			Message += ' ';
+		}
+		vMessages.push_back(Message);
+	}
+}
+
+TEST(Censor, SameAsNaiveLargeList)
+{
+	CCensorList Censorlist;
+	std::vector<std::string> vMessages;
+	RealisticCensorList(Censorlist, vMessages, 20);
+	for(const std::string &Message : vMessages)
+		EXPECT_EQ(Censored(Censorlist, Message.c_str()), Censored(Censorlist, Message.c_str(), true));
+}
+
+TEST(Censor, DISABLED_Benchmark)
+{
+	CCensorList Censorlist;
+	std::vector<std::string> vMessages;
+	RealisticCensorList(Censorlist, vMessages, 200);
+
+	auto Run = [&](bool Naive, std::vector<std::string> &vResults) {
+		const std::chrono::nanoseconds Start = time_get_nanoseconds();
+		for(const std::string &Message : vMessages)
+			vResults.push_back(Censored(Censorlist, Message.c_str(), Naive));
+		return time_get_nanoseconds() - Start;
+	};
+	std::vector<std::string> vNaive, vAutomaton;
+	const std::chrono::nanoseconds Naive = Run(true, vNaive);
+	const std::chrono::nanoseconds Automaton = Run(false, vAutomaton);
+	EXPECT_EQ(vAutomaton, vNaive);
+	dbg_msg("censor", "%d words, %d messages: naive=%.3fms automaton=%.3fms",
+		Censorlist.Size(), (int)vMessages.size(),
+		std::chrono::duration<double, std::milli>(Naive).count(),
+		std::chrono::duration<double, std::milli>(Automaton).count());
+}
@@ -0,0 +1,616 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/hash_ctxt.h>
+#include <base/system.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+#include <game/prng.h>
+#include <game/teamscore.h>
+
+#include <chrono>
+#include <limits>
+
+static const char *const TEST_MAPS[] = {"coverage", "Tutorial", "Sunny Side Up", "Gold Mine", "ctf1", "dm1"};
+
+class CCollisionMap
+{
+public:
+	CTestInfo m_TestInfo;
+	std::unique_ptr<IKernel> m_pKernel;
+	std::unique_ptr<IStorage> m_pStorage;
+	IEngineMap *m_pMap;
+	CLayers m_Layers;
+	CCollision m_Collision;
+
+	bool Load(const char *pName)
+	{
+		m_pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+		m_TestInfo.m_DeleteTestStorageFilesOnSuccess = true;
+		m_pStorage = m_TestInfo.CreateTestStorage();
+		if(!m_pStorage)
+			return false;
+		m_pKernel->RegisterInterface(m_pStorage.get(), false);
+		m_pMap = CreateEngineMap();
+		m_pKernel->RegisterInterface(m_pMap);
+
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "maps/%s.map", pName);
+		if(!m_pMap->Load(aPath))
+			return false;
+		m_Layers.Init(m_pMap, true);
+		m_Collision.Init(&m_Layers);
+		return true;
+	}
+
+	~CCollisionMap()
+	{
+		m_Collision.Unload();
+		if(m_pMap)
+			m_pMap->Unload();
+	}
+};
+
+// the queries as they were before the tile infos, reading the layers directly
+static int LegacyGetTile(const CCollision &Collision, int x, int y)
+{
+	int Nx = std::clamp(x / 32, 0, Collision.GetWidth() - 1);
+	int Ny = std::clamp(y / 32, 0, Collision.GetHeight() - 1);
+	int Index = Collision.GameLayer()[Ny * Collision.GetWidth() + Nx].m_Index;
+	return Index >= TILE_SOLID && Index <= TILE_NOLASER ? Index : 0;
+}
+
+static int LegacyGetFrontTile(const CCollision &Collision, int x, int y)
+{
+	if(!Collision.FrontLayer())
+		return 0;
+	int Nx = std::clamp(x / 32, 0, Collision.GetWidth() - 1);
+	int Ny = std::clamp(y / 32, 0, Collision.GetHeight() - 1);
+	int Index = Collision.FrontLayer()[Ny * Collision.GetWidth() + Nx].m_Index;
+	return Index == TILE_DEATH || Index == TILE_NOLASER ? Index : 0;
+}
+
+static bool LegacyIsSolid(const CCollision &Collision, int x, int y)
+{
+	int Index = LegacyGetTile(Collision, x, y);
+	return Index == TILE_SOLID || Index == TILE_NOHOOK;
+}
+
+static bool LegacyIsThrough(const CCollision &Collision, int x, int y, int OffsetX, int OffsetY, vec2 Pos0, vec2 Pos1)
+{
+	const CTile *pTiles = Collision.GameLayer();
+	const CTile *pFront = Collision.FrontLayer();
+	int pos = Collision.GetPureMapIndex(x, y);
+	if(pFront && (pFront[pos].m_Index == TILE_THROUGH_ALL || pFront[pos].m_Index == TILE_THROUGH_CUT))
+		return true;
+	if(pFront && pFront[pos].m_Index == TILE_THROUGH_DIR && ((pFront[pos].m_Flags == ROTATION_0 && Pos0.y > Pos1.y) || (pFront[pos].m_Flags == ROTATION_90 && Pos0.x < Pos1.x) || (pFront[pos].m_Flags == ROTATION_180 && Pos0.y < Pos1.y) || (pFront[pos].m_Flags == ROTATION_270 && Pos0.x > Pos1.x)))
+		return true;
+	int offpos = Collision.GetPureMapIndex(x + OffsetX, y + OffsetY);
+	return pTiles[offpos].m_Index == TILE_THROUGH || (pFront && pFront[offpos].m_Index == TILE_THROUGH);
+}
+
+static bool LegacyIsHookBlocker(const CCollision &Collision, int x, int y, vec2 Pos0, vec2 Pos1)
+{
+	const CTile *pTiles = Collision.GameLayer();
+	const CTile *pFront = Collision.FrontLayer();
+	int pos = Collision.GetPureMapIndex(x, y);
+	if(pTiles[pos].m_Index == TILE_THROUGH_ALL || (pFront && pFront[pos].m_Index == TILE_THROUGH_ALL))
+		return true;
+	if(pTiles[pos].m_Index == TILE_THROUGH_DIR && ((pTiles[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) || (pTiles[pos].m_Flags == ROTATION_90 && Pos0.x > Pos1.x) || (pTiles[pos].m_Flags == ROTATION_180 && Pos0.y > Pos1.y) || (pTiles[pos].m_Flags == ROTATION_270 && Pos0.x < Pos1.x)))
+		return true;
+	if(pFront && pFront[pos].m_Index == TILE_THROUGH_DIR && ((pFront[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) || (pFront[pos].m_Flags == ROTATION_90 && Pos0.x > Pos1.x) || (pFront[pos].m_Flags == ROTATION_180 && Pos0.y > Pos1.y) || (pFront[pos].m_Flags == ROTATION_270 && Pos0.x < Pos1.x)))
+		return true;
+	return false;
+}
+
+static bool LegacyStopperNext(const CTile *pTiles, int Left, int Right, int Below, int Above)
+{
+	if((pTiles[Right].m_Index == TILE_STOP && pTiles[Right].m_Flags == ROTATION_270) || (pTiles[Left].m_Index == TILE_STOP && pTiles[Left].m_Flags == ROTATION_90))
+		return true;
+	if((pTiles[Below].m_Index == TILE_STOP && pTiles[Below].m_Flags == ROTATION_0) || (pTiles[Above].m_Index == TILE_STOP && pTiles[Above].m_Flags == ROTATION_180))
+		return true;
+	if(pTiles[Right].m_Index == TILE_STOPA || pTiles[Left].m_Index == TILE_STOPA || pTiles[Right].m_Index == TILE_STOPS || pTiles[Left].m_Index == TILE_STOPS)
+		return true;
+	if(pTiles[Below].m_Index == TILE_STOPA || pTiles[Above].m_Index == TILE_STOPA || pTiles[Below].m_Index == TILE_STOPS || pTiles[Above].m_Index == TILE_STOPS)
+		return true;
+	return false;
+}
+
+// without doors
+static bool LegacyTileExists(const CCollision &Collision, int Index)
+{
+	const CTile *pTiles = Collision.GameLayer();
+	const CTile *pFront = Collision.FrontLayer();
+	const CTeleTile *pTele = Collision.TeleLayer();
+	const CSpeedupTile *pSpeedup = Collision.SpeedupLayer();
+	const CSwitchTile *pSwitch = Collision.SwitchLayer();
+	const CTuneTile *pTune = Collision.TuneLayer();
+	if((pTiles[Index].m_Index >= TILE_FREEZE && pTiles[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (pTiles[Index].m_Index >= TILE_LFREEZE && pTiles[Index].m_Index <= TILE_LUNFREEZE))
+		return true;
+	if(pFront && ((pFront[Index].m_Index >= TILE_FREEZE && pFront[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (pFront[Index].m_Index >= TILE_LFREEZE && pFront[Index].m_Index <= TILE_LUNFREEZE)))
+		return true;
+	if(pTele && (pTele[Index].m_Type == TILE_TELEIN || pTele[Index].m_Type == TILE_TELEINEVIL || pTele[Index].m_Type == TILE_TELECHECKINEVIL || pTele[Index].m_Type == TILE_TELECHECK || pTele[Index].m_Type == TILE_TELECHECKIN))
+		return true;
+	if(pSpeedup && pSpeedup[Index].m_Force > 0)
+		return true;
+	if(pSwitch && pSwitch[Index].m_Type)
+		return true;
+	if(pTune && pTune[Index].m_Type)
+		return true;
+	const int Size = Collision.GetWidth() * Collision.GetHeight();
+	const int Left = (Index - 1 > 0) ? Index - 1 : Index;
+	const int Right = (Index + 1 < Size) ? Index + 1 : Index;
+	const int Below = (Index + Collision.GetWidth() < Size) ? Index + Collision.GetWidth() : Index;
+	const int Above = (Index - Collision.GetWidth() > 0) ? Index - Collision.GetWidth() : Index;
+	return LegacyStopperNext(pTiles, Left, Right, Below, Above) || (pFront && LegacyStopperNext(pFront, Left, Right, Below, Above));
+}
+
+static int LegacyMoveRestrictions(int Direction, int Tile, int Flags)
+{
+	Flags &= TILEFLAG_XFLIP | TILEFLAG_YFLIP | TILEFLAG_ROTATE;
+	int Result = 0;
+	if(Tile == TILE_STOP)
+	{
+		const int aRotations[] = {CANTMOVE_DOWN, CANTMOVE_LEFT, CANTMOVE_UP, CANTMOVE_RIGHT};
+		if(Flags == ROTATION_0 || Flags == ROTATION_90 || Flags == ROTATION_180 || Flags == ROTATION_270)
+			Result = aRotations[(Flags == ROTATION_90) + 2 * (Flags == ROTATION_180) + 3 * (Flags == ROTATION_270)];
+		else if(Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_0)))
+			Result = CANTMOVE_UP;
+		else if(Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_90)))
+			Result = CANTMOVE_RIGHT;
+		else if(Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_180)))
+			Result = CANTMOVE_DOWN;
+		else if(Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_270)))
+			Result = CANTMOVE_LEFT;
+		// one way stoppers also block moving away from them
+		if(Direction == 0)
+			return Result;
+	}
+	else if(Tile == TILE_STOPS)
+	{
+		if(Flags == ROTATION_0 || Flags == ROTATION_180 || Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_0)) || Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_180)))
+			Result = CANTMOVE_DOWN | CANTMOVE_UP;
+		else if(Flags == ROTATION_90 || Flags == ROTATION_270 || Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_90)) || Flags == (static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_270)))
+			Result = CANTMOVE_LEFT | CANTMOVE_RIGHT;
+	}
+	else if(Tile == TILE_STOPA)
+	{
+		Result = CANTMOVE_LEFT | CANTMOVE_RIGHT | CANTMOVE_UP | CANTMOVE_DOWN;
+	}
+	const int aMasks[] = {0, CANTMOVE_RIGHT, CANTMOVE_DOWN, CANTMOVE_LEFT, CANTMOVE_UP};
+	return Result & aMasks[Direction];
+}
+
+static int LegacyGetMoveRestrictions(const CCollision &Collision, vec2 Pos, float Distance)
+{
+	const vec2 aDirections[] = {vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(-1, 0), vec2(0, -1)};
+	int Restrictions = 0;
+	for(int d = 0; d < 5; d++)
+	{
+		int Index = Collision.GetPureMapIndex(Pos + aDirections[d] * Distance);
+		Restrictions |= LegacyMoveRestrictions(d, Collision.GetTileIndex(Index), Collision.GetTileFlags(Index));
+		Restrictions |= LegacyMoveRestrictions(d, Collision.GetFrontTileIndex(Index), Collision.GetFrontTileFlags(Index));
+	}
+	return Restrictions;
+}
+
+static void ExpectSameAsLegacy(const CCollision &Collision, const char *pMap)
+{
+	const int Width = Collision.GetWidth();
+	const int Height = Collision.GetHeight();
+	for(int Index = 0; Index < Width * Height; Index++)
+	{
+		ASSERT_EQ(Collision.TileExists(Index), LegacyTileExists(Collision, Index)) << pMap << " index " << Index;
+	}
+
+	CPrng Prng;
+	uint64_t aSeed[2] = {(uint64_t)Width, (uint64_t)Height};
+	Prng.Seed(aSeed);
+	for(int i = 0; i < 100000; i++)
+	{
+		// also some positions outside of the map
+		const int x = (int)(Prng.RandomBits() % ((Width + 4) * 32)) - 64;
+		const int y = (int)(Prng.RandomBits() % ((Height + 4) * 32)) - 64;
+		const vec2 Pos0(x, y);
+		const vec2 Pos1(x + (int)(Prng.RandomBits() % 129) - 64, y + (int)(Prng.RandomBits() % 129) - 64);
+		int OffsetX, OffsetY;
+		ThroughOffset(Pos0, Pos1, &OffsetX, &OffsetY);
+
+		ASSERT_EQ(Collision.GetTile(x, y), LegacyGetTile(Collision, x, y)) << pMap << " " << x << " " << y;
+		ASSERT_EQ(Collision.GetFrontTile(x, y), LegacyGetFrontTile(Collision, x, y)) << pMap << " " << x << " " << y;
+		ASSERT_EQ((bool)Collision.IsSolid(x, y), LegacyIsSolid(Collision, x, y)) << pMap << " " << x << " " << y;
+		ASSERT_EQ(Collision.IsThrough(x, y, OffsetX, OffsetY, Pos0, Pos1), LegacyIsThrough(Collision, x, y, OffsetX, OffsetY, Pos0, Pos1)) << pMap << " " << x << " " << y;
+		ASSERT_EQ(Collision.IsHookBlocker(x, y, Pos0, Pos1), LegacyIsHookBlocker(Collision, x, y, Pos0, Pos1)) << pMap << " " << x << " " << y;
+		ASSERT_EQ(Collision.GetMoveRestrictions(Pos0), LegacyGetMoveRestrictions(Collision, Pos0, 18.0f)) << pMap << " " << x << " " << y;
+	}
+}
+
+TEST(Collision, SameAsLayers)
+{
+	for(const char *pMap : TEST_MAPS)
+	{
+		CCollisionMap Map;
+		ASSERT_TRUE(Map.Load(pMap)) << pMap;
+		ExpectSameAsLegacy(Map.m_Collision, pMap);
+	}
+}
+
+TEST(Collision, SetCollisionAt)
+{
+	CCollisionMap Map;
+	ASSERT_TRUE(Map.Load("coverage"));
+	CCollision &Collision = Map.m_Collision;
+
+	// laser doors change the game layer at runtime
+	CPrng Prng;
+	uint64_t aSeed[2] = {1, 2};
+	Prng.Seed(aSeed);
+	const int aTiles[] = {TILE_AIR, TILE_SOLID, TILE_NOHOOK, TILE_STOPA, TILE_STOP, TILE_FREEZE, TILE_THROUGH_ALL};
+	for(int i = 0; i < 200; i++)
+	{
+		const float x = Prng.RandomBits() % (Collision.GetWidth() * 32);
+		const float y = Prng.RandomBits() % (Collision.GetHeight() * 32);
+		Collision.SetCollisionAt(x, y, aTiles[Prng.RandomBits() % std::size(aTiles)]);
+	}
+	ExpectSameAsLegacy(Collision, "coverage");
+}
+
+TEST(Collision, CheckPoints)
+{
+	for(const char *pMap : TEST_MAPS)
+	{
+		CCollisionMap Map;
+		ASSERT_TRUE(Map.Load(pMap)) << pMap;
+		const CCollision &Collision = Map.m_Collision;
+
+		// also outside of the map and between the tiles
+		CPrng Prng;
+		uint64_t aSeed[2] = {5, 6};
+		Prng.Seed(aSeed);
+		const int NumPoints = 10000;
+		std::vector<float> vX, vY;
+		for(int i = 0; i < NumPoints; i++)
+		{
+			vX.push_back((int)(Prng.RandomBits() % ((Collision.GetWidth() + 4) * 32)) - 64 + (Prng.RandomBits() % 100) / 100.0f);
+			vY.push_back((int)(Prng.RandomBits() % ((Collision.GetHeight() + 4) * 32)) - 64 + (Prng.RandomBits() % 100) / 100.0f);
+		}
+		bool aSolid[NumPoints];
+		Collision.CheckPoints(vX.data(), vY.data(), NumPoints, aSolid);
+		for(int i = 0; i < NumPoints; i++)
+			ASSERT_EQ(aSolid[i], Collision.CheckPoint(vX[i], vY[i])) << pMap << " " << vX[i] << " " << vY[i];
+	}
+}
+
+TEST(Collision, DISABLED_Benchmark)
+{
+	for(const char *pMap : TEST_MAPS)
+	{
+		CCollisionMap Map;
+		ASSERT_TRUE(Map.Load(pMap)) << pMap;
+		const CCollision &Collision = Map.m_Collision;
+
+		const int NumQueries = 1000000;
+		std::vector<vec2> vPositions;
+		CPrng Prng;
+		uint64_t aSeed[2] = {3, 4};
+		Prng.Seed(aSeed);
+		for(int i = 0; i < NumQueries; i++)
+			vPositions.emplace_back(Prng.RandomBits() % (Collision.GetWidth() * 32), Prng.RandomBits() % (Collision.GetHeight() * 32));
+
+		int64_t LegacySolid = 0;
+		std::chrono::nanoseconds Start = time_get_nanoseconds();
+		for(vec2 Pos : vPositions)
+			LegacySolid += LegacyIsSolid(Collision, round_to_int(Pos.x), round_to_int(Pos.y));
+		const std::chrono::nanoseconds LegacyCheck = time_get_nanoseconds() - Start;
+
+		int64_t Solid = 0;
+		Start = time_get_nanoseconds();
+		for(vec2 Pos : vPositions)
+			Solid += Collision.CheckPoint(Pos);
+		const std::chrono::nanoseconds Check = time_get_nanoseconds() - Start;
+		EXPECT_EQ(Solid, LegacySolid);
+
+		int64_t LegacyRestrictions = 0;
+		Start = time_get_nanoseconds();
+		for(vec2 Pos : vPositions)
+			LegacyRestrictions += LegacyGetMoveRestrictions(Collision, Pos, 18.0f);
+		const std::chrono::nanoseconds LegacyMove = time_get_nanoseconds() - Start;
+
+		int64_t Restrictions = 0;
+		Start = time_get_nanoseconds();
+		for(vec2 Pos : vPositions)
+			Restrictions += Collision.GetMoveRestrictions(Pos);
+		const std::chrono::nanoseconds Move = time_get_nanoseconds() - Start;
+		EXPECT_EQ(Restrictions, LegacyRestrictions);
+
+		int64_t Exists = 0;
+		Start = time_get_nanoseconds();
+		for(vec2 Pos : vPositions)
+			Exists += Collision.GetMapIndex(Pos);
+		const std::chrono::nanoseconds MapIndex = time_get_nanoseconds() - Start;
+		EXPECT_NE(Exists, 0);
+
+		dbg_msg("collision", "%s, %d queries: CheckPoint legacy=%.3fms new=%.3fms, GetMoveRestrictions legacy=%.3fms new=%.3fms, GetMapIndex=%.3fms",
+			pMap, NumQueries,
+			std::chrono::duration<double, std::milli>(LegacyCheck).count(),
+			std::chrono::duration<double, std::milli>(Check).count(),
+			std::chrono::duration<double, std::milli>(LegacyMove).count(),
+			std::chrono::duration<double, std::milli>(Move).count(),
+			std::chrono::duration<double, std::milli>(MapIndex).count());
+	}
+}
+
+struct CIntersectResult
+{
+	int m_Hit;
+	int m_TeleNr;
+	vec2 m_Collision;
+	vec2 m_BeforeCollision;
+};
+
+static const char *const INTERSECT_NAMES[] = {"IntersectLine", "IntersectLineTeleWeapon", "IntersectLineTeleHook", "IntersectNoLaser", "IntersectNoLaserNoWalls", "IntersectAir"};
+
+static CIntersectResult Intersect(const CCollision &Collision, int Function, bool Exact, vec2 Pos0, vec2 Pos1)
+{
+	g_Config.m_SvExactIntersect = Exact;
+	CIntersectResult Result = {0, 0, vec2(), vec2()};
+	vec2 *pCol = &Result.m_Collision;
+	vec2 *pBefore = &Result.m_BeforeCollision;
+	switch(Function)
+	{
+	case 0: Result.m_Hit = Collision.IntersectLine(Pos0, Pos1, pCol, pBefore); break;
+	case 1: Result.m_Hit = Collision.IntersectLineTeleWeapon(Pos0, Pos1, pCol, pBefore, &Result.m_TeleNr); break;
+	case 2: Result.m_Hit = Collision.IntersectLineTeleHook(Pos0, Pos1, pCol, pBefore, &Result.m_TeleNr); break;
+	case 3: Result.m_Hit = Collision.IntersectNoLaser(Pos0, Pos1, pCol, pBefore); break;
+	case 4: Result.m_Hit = Collision.IntersectNoLaserNoWalls(Pos0, Pos1, pCol, pBefore); break;
+	case 5: Result.m_Hit = Collision.IntersectAir(Pos0, Pos1, pCol, pBefore); break;
+	}
+	g_Config.m_SvExactIntersect = 0;
+	return Result;
+}
+
+// whether the sampled version reported a collision, it sets both positions to Pos1 otherwise
+static bool Collided(const CIntersectResult &Result, vec2 Pos1)
+{
+	return Result.m_Collision != Pos1 || Result.m_BeforeCollision != Pos1;
+}
+
+TEST(Collision, ExactIntersectAxisAligned)
+{
+	// along the axes, the sampled versions visit every tile that the
+	// segment overlaps by at least a unit, so both must find the same tile
+	for(const char *pMap : TEST_MAPS)
+	{
+		CCollisionMap Map;
+		ASSERT_TRUE(Map.Load(pMap)) << pMap;
+		const CCollision &Collision = Map.m_Collision;
+		const int Width = Collision.GetWidth();
+		const int Height = Collision.GetHeight();
+
+		CPrng Prng;
+		uint64_t aSeed[2] = {5, 6};
+		Prng.Seed(aSeed);
+		for(int i = 0; i < 2000; i++)
+		{
+			// from tile center to tile center, also outside of the map
+			const int x0 = (int)(Prng.RandomBits() % (Width + 4)) - 2;
+			const int y0 = (int)(Prng.RandomBits() % (Height + 4)) - 2;
+			int x1 = x0;
+			int y1 = y0;
+			// the sampled IntersectNoLaser* don't check anything for empty segments
+			while(x1 == x0 && y1 == y0)
+			{
+				if(i % 2)
+					x1 = (int)(Prng.RandomBits() % (Width + 4)) - 2;
+				else
+					y1 = (int)(Prng.RandomBits() % (Height + 4)) - 2;
+			}
+			const vec2 Pos0(x0 * 32 + 16, y0 * 32 + 16);
+			const vec2 Pos1(x1 * 32 + 16, y1 * 32 + 16);
+
+			for(int Function = 0; Function < (int)std::size(INTERSECT_NAMES); Function++)
+			{
+				const CIntersectResult Sampled = Intersect(Collision, Function, false, Pos0, Pos1);
+				const CIntersectResult Exact = Intersect(Collision, Function, true, Pos0, Pos1);
+				ASSERT_EQ(Exact.m_Hit, Sampled.m_Hit) << pMap << " " << INTERSECT_NAMES[Function] << " " << i;
+				ASSERT_EQ(Exact.m_TeleNr, Sampled.m_TeleNr) << pMap << " " << INTERSECT_NAMES[Function] << " " << i;
+				ASSERT_EQ(Collided(Exact, Pos1), Collided(Sampled, Pos1)) << pMap << " " << INTERSECT_NAMES[Function] << " " << i;
+				if(Collided(Sampled, Pos1))
+				{
+					ASSERT_EQ(Collision.GetPureMapIndex(Exact.m_Collision), Collision.GetPureMapIndex(Sampled.m_Collision)) << pMap << " " << INTERSECT_NAMES[Function] << " " << i;
+					ASSERT_LE(distance(Pos0, Exact.m_BeforeCollision), distance(Pos0, Exact.m_Collision));
+				}
+			}
+		}
+	}
+}
+
+TEST(Collision, ExactIntersectNeverLater)
+{
+	// in other directions, the sampled versions can step over the
+	// corner of a tile, the exact versions must never hit later
+	for(const char *pMap : TEST_MAPS)
+	{
+		CCollisionMap Map;
+		ASSERT_TRUE(Map.Load(pMap)) << pMap;
+		const CCollision &Collision = Map.m_Collision;
+		const int Width = Collision.GetWidth();
+		const int Height = Collision.GetHeight();
+
+		CPrng Prng;
+		uint64_t aSeed[2] = {7, 8};
+		Prng.Seed(aSeed);
+		for(int i = 0; i < 2000; i++)
+		{
+			const vec2 Pos0(Prng.RandomBits() % (Width * 32), Prng.RandomBits() % (Height * 32));
+			const vec2 Pos1 = Pos0 + vec2((int)(Prng.RandomBits() % 1601) - 800, (int)(Prng.RandomBits() % 1601) - 800) / 2.0f;
+
+			for(int Function = 0; Function < (int)std::size(INTERSECT_NAMES); Function++)
+			{
+				const CIntersectResult Sampled = Intersect(Collision, Function, false, Pos0, Pos1);
+				const CIntersectResult Exact = Intersect(Collision, Function, true, Pos0, Pos1);
+				if(!Collided(Sampled, Pos1))
+					continue;
+				ASSERT_TRUE(Collided(Exact, Pos1)) << pMap << " " << INTERSECT_NAMES[Function] << " " << i;
+				ASSERT_LE(distance(Pos0, Exact.m_Collision), distance(Pos0, Sampled.m_Collision) + 0.02f) << pMap << " " << INTERSECT_NAMES[Function] << " " << i;
+				if(Collision.GetPureMapIndex(Exact.m_Collision) == Collision.GetPureMapIndex(Sampled.m_Collision))
+				{
+					ASSERT_EQ(Exact.m_Hit, Sampled.m_Hit) << pMap << " " << INTERSECT_NAMES[Function] << " " << i;
+				}
+			}
+		}
+	}
+}
+
+TEST(Collision, ExactIntersectNotFinite)
+{
+	CCollisionMap Map;
+	ASSERT_TRUE(Map.Load(TEST_MAPS[0])) << TEST_MAPS[0];
+	const float NaN = std::numeric_limits<float>::quiet_NaN();
+	const float Inf = std::numeric_limits<float>::infinity();
+	const vec2 Pos(100.0f, 100.0f);
+	for(const auto &[Pos0, Pos1] : {std::pair(vec2(NaN, 0.0f), Pos), std::pair(Pos, vec2(0.0f, NaN)), std::pair(Pos, vec2(Inf, 0.0f))})
+	{
+		for(int Function = 0; Function < (int)std::size(INTERSECT_NAMES); Function++)
+		{
+			const CIntersectResult Exact = Intersect(Map.m_Collision, Function, true, Pos0, Pos1);
+			EXPECT_EQ(Exact.m_Hit, 0) << INTERSECT_NAMES[Function];
+		}
+	}
+}
+
+TEST(Collision, DISABLED_ExactIntersectBenchmark)
+{
+	for(const char *pMap : TEST_MAPS)
+	{
+		CCollisionMap Map;
+		ASSERT_TRUE(Map.Load(pMap)) << pMap;
+		const CCollision &Collision = Map.m_Collision;
+
+		// long laser rays through the whole map
+		const int NumRays = 2000;
+		std::vector<std::pair<vec2, vec2>> vRays;
+		CPrng Prng;
+		uint64_t aSeed[2] = {9, 10};
+		Prng.Seed(aSeed);
+		for(int i = 0; i < NumRays; i++)
+		{
+			const vec2 Pos0(Prng.RandomBits() % (Collision.GetWidth() * 32), Prng.RandomBits() % (Collision.GetHeight() * 32));
+			const vec2 Pos1(Prng.RandomBits() % (Collision.GetWidth() * 32), Prng.RandomBits() % (Collision.GetHeight() * 32));
+			vRays.emplace_back(Pos0, Pos1);
+		}
+
+		std::chrono::nanoseconds aDurations[2];
+		int64_t aHits[2] = {0, 0};
+		for(int Exact = 0; Exact < 2; Exact++)
+		{
+			g_Config.m_SvExactIntersect = Exact;
+			const std::chrono::nanoseconds Start = time_get_nanoseconds();
+			for(const auto &[Pos0, Pos1] : vRays)
+				aHits[Exact] += Collision.IntersectLineTeleWeapon(Pos0, Pos1, nullptr, nullptr) != 0;
+			aDurations[Exact] = time_get_nanoseconds() - Start;
+		}
+		g_Config.m_SvExactIntersect = 0;
+
+		dbg_msg("collision", "%s, %d rays: IntersectLineTeleWeapon sampled=%.3fms exact=%.3fms (hits %d/%d)",
+			pMap, NumRays,
+			std::chrono::duration<double, std::milli>(aDurations[0]).count(),
+			std::chrono::duration<double, std::milli>(aDurations[1]).count(),
+			(int)aHits[0], (int)aHits[1]);
+	}
+}
+
+// The pair loops of the character cores must not change the simulation. The
+// hash was taken with the plain loops over all players, before they skipped
+// distant ones.
+TEST(CharacterCore, SameStateHash)
+{
+	CCollisionMap Map;
+	ASSERT_TRUE(Map.Load("dm1"));
+	CWorldCore World;
+	CTeamsCore Teams;
+	CPrng Prng;
+	uint64_t aSeed[2] = {5, 6};
+	Prng.Seed(aSeed);
+	auto Random = [&](int Min, int Max) { return Min + (int)(Prng.RandomBits() % (Max - Min + 1)); };
+
+	// every fourth slot is empty, the rest crowd the middle of the map
+	std::vector<CCharacterCore> vCores(MAX_CLIENTS);
+	const vec2 Center = vec2(Map.m_Collision.GetWidth() * 16.0f, Map.m_Collision.GetHeight() * 16.0f);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(i % 4 == 3)
+			continue;
+		CCharacterCore &Core = vCores[i];
+		Core.Init(&World, &Map.m_Collision, &Teams);
+		Core.Reset();
+		Core.m_Id = i;
+		Core.m_Pos = Center + vec2(Random(-300, 300), Random(-150, 150));
+		Teams.Team(i, i % 3);
+		Teams.SetSolo(i, i % 11 == 0);
+		Core.m_Solo = i % 11 == 0;
+		Core.m_Super = i % 17 == 0;
+		Core.m_CollisionDisabled = i % 13 == 0;
+		Core.m_HookHitDisabled = i % 19 == 0;
+		World.m_apCharacters[i] = &Core;
+	}
+
+	SHA256_CTX Sha256Ctx;
+	sha256_init(&Sha256Ctx);
+	int NumHooked = 0;
+	for(int Tick = 0; Tick < 1000; Tick++)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(!World.m_apCharacters[i])
+				continue;
+			CCharacterCore &Core = vCores[i];
+			CNetObj_PlayerInput &Input = Core.m_Input;
+			if(Random(0, 7) == 0)
+			{
+				// mostly aim at another player, to hook them
+				const CCharacterCore *pTarget = World.m_apCharacters[Random(0, MAX_CLIENTS - 1)];
+				const vec2 Target = pTarget && Random(0, 3) != 0 ? pTarget->m_Pos - Core.m_Pos : vec2(Random(-300, 300), Random(-300, 300));
+				Input.m_Direction = Random(-1, 1);
+				Input.m_TargetX = Target.x;
+				Input.m_TargetY = Target.y;
+				Input.m_Jump = Random(0, 3) == 0;
+				Input.m_Hook = Random(0, 2) != 0;
+			}
+			// with and without the weak hook
+			Core.Tick(true, i % 2 == 0);
+			// like the teleporters between the ticks of the players
+			if(Random(0, 499) == 0)
+				Core.m_Pos = Center + vec2(Random(-300, 300), Random(-150, 150));
+		}
+		for(int i = 1; i < MAX_CLIENTS; i += 2)
+		{
+			if(World.m_apCharacters[i])
+				vCores[i].TickDeferred();
+		}
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(!World.m_apCharacters[i])
+				continue;
+			vCores[i].Move();
+			vCores[i].Quantize();
+			CNetObj_CharacterCore ObjCore;
+			vCores[i].Write(&ObjCore);
+			sha256_update(&Sha256Ctx, &ObjCore, sizeof(ObjCore));
+			NumHooked += vCores[i].HookedPlayer() != -1;
+		}
+	}
+	// the hooks must have hit players, or the test would not cover much
+	EXPECT_GT(NumHooked, 1000);
+
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(sha256_finish(&Sha256Ctx), aSha256, sizeof(aSha256));
+	EXPECT_STREQ(aSha256, "9d9f070817c1a11f6ed678b7fc60cd04cd90e8b9f923a25721585a0bdfc3c0d6");
+}
@@ -1,11 +1,16 @@
 #include "test.h"
 #include <gtest/gtest.h>
+#include <chrono>
 #include <memory>
 
+#include <base/system.h>
+
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 #include <game/mapitems_ex.h>
 
+#include <zlib.h>
+
 TEST(Datafile, ExtendedType)
 {
 	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
@@ -109,3 +114,221 @@ TEST(Datafile, StringData)
 		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
 	}
 }
+
+TEST(Datafile, HashesAndData)
+{
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating local storage";
+
+	CTestInfo Info;
+
+	int aInts[64];
+	for(int i = 0; i < (int)std::size(aInts); i++)
+		aInts[i] = i * i;
+
+	{
+		CDataFileWriter Writer;
+		ASSERT_TRUE(Writer.Open(pStorage.get(), Info.m_aFilename));
+		EXPECT_EQ(Writer.AddData(sizeof(aInts), aInts), 0);
+		EXPECT_EQ(Writer.AddDataString("Abc"), 1);
+		Writer.Finish();
+	}
+
+	void *pFileData;
+	unsigned FileSize;
+	ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_ALL, &pFileData, &FileSize));
+	const SHA256_DIGEST ExpectedSha256 = sha256(pFileData, FileSize);
+	const unsigned ExpectedCrc = crc32(0, static_cast<const unsigned char *>(pFileData), FileSize);
+	free(pFileData);
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		EXPECT_EQ(Reader.MapSize(), (int)FileSize);
+		EXPECT_EQ(Reader.Sha256(), ExpectedSha256);
+		EXPECT_EQ(Reader.Crc(), ExpectedCrc);
+
+		ASSERT_EQ(Reader.GetDataSize(0), (int)sizeof(aInts));
+		EXPECT_EQ(mem_comp(Reader.GetDataSwapped(0), aInts, sizeof(aInts)), 0);
+		Reader.UnloadData(0);
+		EXPECT_EQ(mem_comp(Reader.GetData(0), aInts, sizeof(aInts)), 0);
+
+		char *pReplacement = static_cast<char *>(malloc(4));
+		str_copy(pReplacement, "Xyz", 4);
+		Reader.ReplaceData(1, pReplacement, 4);
+		EXPECT_STREQ(Reader.GetDataString(1), "Xyz");
+
+		Reader.Close();
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST(Datafile, RewriteWhileOpen)
+{
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating local storage";
+
+	CTestInfo Info;
+
+	auto Write = [&](const char *pString) {
+		CDataFileWriter Writer;
+		if(!Writer.Open(pStorage.get(), Info.m_aFilename))
+			return false;
+		Writer.AddDataString(pString);
+		Writer.Finish();
+		return true;
+	};
+	ASSERT_TRUE(Write("old"));
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		const SHA256_DIGEST Sha256 = Reader.Sha256();
+		char *pData = static_cast<char *>(Reader.GetData(0));
+		ASSERT_STREQ(pData, "old");
+
+		// the hashes are of the file, not of the data handed out
+		pData[0] = 'x';
+		EXPECT_EQ(Reader.Sha256(), Sha256);
+
+		// the open file is replaced, not overwritten
+		ASSERT_TRUE(Write("new"));
+		EXPECT_STREQ(Reader.GetDataString(0), "xld");
+		EXPECT_EQ(Reader.Sha256(), Sha256);
+
+		// an unfinished writer leaves the file as it was
+		{
+			CDataFileWriter Writer;
+			ASSERT_TRUE(Writer.Open(pStorage.get(), Info.m_aFilename));
+		}
+
+		CDataFileReader NewReader;
+		ASSERT_TRUE(NewReader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		EXPECT_STREQ(NewReader.GetDataString(0), "new");
+		EXPECT_NE(NewReader.Sha256(), Sha256);
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST(Datafile, UncompressedVersion3)
+{
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating local storage";
+
+	CTestInfo Info;
+
+	// header, one data offset and 16 bytes of uncompressed data
+	const int aData[] = {1, 2, 3, 4};
+	const int aFile[] = {
+		'D' | 'A' << 8 | 'T' << 16 | 'A' << 24,
+		3, // version
+		40, // size
+		24, // swaplen
+		0, // num item types
+		0, // num items
+		1, // num raw data
+		0, // item size
+		sizeof(aData), // data size
+		0, // data offset
+		aData[0], aData[1], aData[2], aData[3]};
+	{
+		IOHANDLE File = pStorage->OpenFile(Info.m_aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		EXPECT_EQ(io_write(File, aFile, sizeof(aFile)), sizeof(aFile));
+		io_close(File);
+	}
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		EXPECT_EQ(Reader.NumData(), 1);
+		ASSERT_EQ(Reader.GetDataSize(0), (int)sizeof(aData));
+		EXPECT_EQ(mem_comp(Reader.GetDataSwapped(0), aData, sizeof(aData)), 0);
+		Reader.UnloadData(0);
+		EXPECT_EQ(mem_comp(Reader.GetData(0), aData, sizeof(aData)), 0);
+		EXPECT_EQ(Reader.Sha256(), sha256(aFile, sizeof(aFile)));
+		Reader.Close();
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+static void CompareParallelCompression(bool PrintDurations)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr);
+
+	const char *apMaps[] = {"coverage", "Tutorial", "Sunny Side Up", "Gold Mine", "LearnToPlay", "ctf1", "dm1"};
+	for(const char *pMap : apMaps)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "maps/%s.map", pMap);
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), aPath, IStorage::TYPE_ALL)) << pMap;
+
+		std::chrono::nanoseconds aDurations[2];
+		void *apResults[2];
+		unsigned aResultSizes[2];
+		for(int Parallel = 0; Parallel < 2; Parallel++)
+		{
+			char aFilename[IO_MAX_PATH_LENGTH];
+			str_format(aFilename, sizeof(aFilename), "%s-%d.map", pMap, Parallel);
+			CDataFileWriter Writer;
+			ASSERT_TRUE(Writer.Open(pStorage.get(), aFilename));
+			for(int Index = 0; Index < Reader.NumItems(); Index++)
+			{
+				int Type, Id;
+				CUuid Uuid;
+				const void *pItem = Reader.GetItem(Index, &Type, &Id, &Uuid);
+				if(Type != ITEMTYPE_EX)
+					Writer.AddItem(Type, Id, Reader.GetItemSize(Index), pItem, &Uuid);
+			}
+			for(int Index = 0; Index < Reader.NumData(); Index++)
+				Writer.AddData(Reader.GetDataSize(Index), Reader.GetData(Index));
+
+			const std::chrono::nanoseconds Start = time_get_nanoseconds();
+			Writer.Finish(Parallel ? 4 : 1);
+			aDurations[Parallel] = time_get_nanoseconds() - Start;
+			ASSERT_TRUE(pStorage->ReadFile(aFilename, IStorage::TYPE_SAVE, &apResults[Parallel], &aResultSizes[Parallel]));
+			pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE);
+		}
+		Reader.Close();
+
+		// the output must not depend on the number of threads
+		ASSERT_EQ(aResultSizes[0], aResultSizes[1]) << pMap;
+		EXPECT_EQ(mem_comp(apResults[0], apResults[1], aResultSizes[0]), 0) << pMap;
+		free(apResults[0]);
+		free(apResults[1]);
+
+		if(PrintDurations)
+		{
+			dbg_msg("datafile", "%s, %u bytes: Finish serial=%.3fms parallel=%.3fms",
+				pMap, aResultSizes[0],
+				std::chrono::duration<double, std::milli>(aDurations[0]).count(),
+				std::chrono::duration<double, std::milli>(aDurations[1]).count());
+		}
+	}
+}
+
+TEST(Datafile, ParallelCompressionSameFile)
+{
+	CompareParallelCompression(false);
+}
+
+TEST(Datafile, DISABLED_ParallelCompressionBenchmark)
+{
+	CompareParallelCompression(true);
+}
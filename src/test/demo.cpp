@@ -0,0 +1,197 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+static const int FIRST_TICK = 100;
+static const int NUM_TICKS = 3000;
+
+class CDemoTestListener : public CDemoPlayer::IListener
+{
+public:
+	CDemoPlayer *m_pDemoPlayer;
+	int m_NumSnapshots = 0;
+	int m_NumMessages = 0;
+	int m_NumWrongSnapshots = 0;
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		const CSnapshot *pSnap = (CSnapshot *)pData;
+		const int *pTick = (const int *)pSnap->FindItem(1, 0);
+		if(!pTick || *pTick != m_pDemoPlayer->Info()->m_Info.m_CurrentTick)
+			m_NumWrongSnapshots++;
+		m_NumSnapshots++;
+	}
+
+	void OnDemoPlayerMessage(void *pData, int Size) override
+	{
+		m_NumMessages++;
+	}
+};
+
+// the recorders share the delta like the ones of the server
+static void RecordDemos(IStorage *pStorage, const std::vector<std::string> &vFilenames, bool Async)
+{
+	CSnapshotDelta SnapshotDelta;
+	std::vector<std::unique_ptr<CDemoRecorder>> vpRecorders;
+	unsigned char aMapData[] = {'m', 'a', 'p'};
+	for(const std::string &Filename : vFilenames)
+	{
+		vpRecorders.push_back(std::make_unique<CDemoRecorder>(&SnapshotDelta));
+		ASSERT_EQ(vpRecorders.back()->Start(pStorage, nullptr, Filename.c_str(), "0.6 626fce9a778df4d4", "dm1", SHA256_ZEROED, 0, "server", sizeof(aMapData), aMapData, nullptr, nullptr, nullptr, Async), 0);
+	}
+
+	for(int Tick = FIRST_TICK; Tick < FIRST_TICK + NUM_TICKS; Tick++)
+	{
+		CSnapshotBuilder Builder;
+		Builder.Init();
+		*(int *)Builder.NewItem(1, 0, sizeof(int)) = Tick;
+		char aSnapshot[CSnapshot::MAX_SIZE];
+		const int Size = Builder.Finish(aSnapshot);
+		for(auto &pRecorder : vpRecorders)
+		{
+			pRecorder->RecordSnapshot(Tick, aSnapshot, Size);
+			if(Tick % 10 == 0)
+				pRecorder->RecordMessage("message", 8);
+		}
+	}
+	for(auto &pRecorder : vpRecorders)
+		EXPECT_EQ(pRecorder->Stop(IDemoRecorder::EStopMode::KEEP_FILE), 0);
+}
+
+static void RecordDemo(IStorage *pStorage, const char *pFilename, bool Async = false)
+{
+	RecordDemos(pStorage, {pFilename}, Async);
+}
+
+TEST(Demo, KeyFrameIndex)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr);
+	CNetBase::Init();
+
+	RecordDemo(pStorage.get(), "indexed.demo");
+	ASSERT_FALSE(HasFatalFailure());
+
+	// the same demo without the index, like the ones recorded before it existed
+	void *pIndexed;
+	unsigned IndexedSize;
+	ASSERT_TRUE(pStorage->ReadFile("indexed.demo", IStorage::TYPE_SAVE, &pIndexed, &IndexedSize));
+	ASSERT_GT(IndexedSize, 32u);
+	const unsigned char *pFooter = (const unsigned char *)pIndexed + IndexedSize - 32;
+	const int64_t IndexOffset = ((int64_t)bytes_be_to_uint(pFooter + 16) << 32) | bytes_be_to_uint(pFooter + 20);
+	ASSERT_GT(IndexOffset, 0);
+	ASSERT_LT(IndexOffset, IndexedSize);
+	{
+		IOHANDLE File = pStorage->OpenFile("plain.demo", IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_write(File, pIndexed, IndexOffset);
+		io_close(File);
+	}
+
+	CSnapshotDelta SnapshotDelta;
+	std::vector<CDemoKeyFrame> vScannedKeyFrames;
+	{
+		CDemoPlayer Player(&SnapshotDelta, false);
+		ASSERT_EQ(Player.Load(pStorage.get(), nullptr, "plain.demo", IStorage::TYPE_SAVE), 0);
+		EXPECT_FALSE(Player.HasKeyFrameIndex());
+		EXPECT_TRUE(Player.KeyFramesComplete());
+		vScannedKeyFrames = Player.KeyFrames();
+		Player.Stop();
+	}
+	EXPECT_GE(vScannedKeyFrames.size(), (size_t)NUM_TICKS / (5 * SERVER_TICK_SPEED));
+
+	{
+		CDemoPlayer Player(&SnapshotDelta, false);
+		ASSERT_EQ(Player.Load(pStorage.get(), nullptr, "indexed.demo", IStorage::TYPE_SAVE), 0);
+		EXPECT_TRUE(Player.HasKeyFrameIndex());
+		EXPECT_EQ(Player.Info()->m_Info.m_FirstTick, FIRST_TICK);
+		EXPECT_EQ(Player.Info()->m_Info.m_LastTick, FIRST_TICK + NUM_TICKS - 1);
+		ASSERT_EQ(Player.KeyFrames().size(), vScannedKeyFrames.size());
+		for(size_t i = 0; i < vScannedKeyFrames.size(); i++)
+		{
+			EXPECT_EQ(Player.KeyFrames()[i].m_Tick, vScannedKeyFrames[i].m_Tick);
+			EXPECT_EQ(Player.KeyFrames()[i].m_Filepos, vScannedKeyFrames[i].m_Filepos);
+		}
+
+		// the index at the end must not disturb the playback
+		CDemoTestListener Listener;
+		Listener.m_pDemoPlayer = &Player;
+		Player.SetListener(&Listener);
+		Player.Play();
+		while(Player.IsPlaying() && !Player.BaseInfo()->m_Paused)
+			Player.Update(false);
+		EXPECT_TRUE(Player.IsPlaying()) << Player.ErrorMessage();
+		EXPECT_EQ(Listener.m_NumSnapshots, NUM_TICKS);
+		EXPECT_EQ(Listener.m_NumMessages, NUM_TICKS / 10);
+		EXPECT_EQ(Listener.m_NumWrongSnapshots, 0);
+
+		EXPECT_EQ(Player.SetPos(FIRST_TICK + 2000), 0);
+		EXPECT_EQ(Player.Info()->m_NextTick, FIRST_TICK + 2000);
+		Player.Stop();
+	}
+
+	// retro-fitting the index gives the same file
+	CDemoEditor Editor;
+	Editor.Init(&SnapshotDelta, nullptr, pStorage.get());
+	EXPECT_TRUE(Editor.AddKeyFrameIndex("plain.demo"));
+	void *pPlain;
+	unsigned PlainSize;
+	ASSERT_TRUE(pStorage->ReadFile("plain.demo", IStorage::TYPE_SAVE, &pPlain, &PlainSize));
+	ASSERT_EQ(PlainSize, IndexedSize);
+	EXPECT_EQ(mem_comp(pPlain, pIndexed, IndexedSize), 0);
+	EXPECT_TRUE(Editor.AddKeyFrameIndex("plain.demo"));
+	free(pPlain);
+	free(pIndexed);
+
+	pStorage->RemoveFile("indexed.demo", IStorage::TYPE_SAVE);
+	pStorage->RemoveFile("plain.demo", IStorage::TYPE_SAVE);
+}
+
+TEST(Demo, AsyncRecorder)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr);
+	CNetBase::Init();
+
+	RecordDemo(pStorage.get(), "sync.demo", false);
+	// several at once, they share the writer thread
+	const std::vector<std::string> vAsync = {"async0.demo", "async1.demo", "async2.demo"};
+	RecordDemos(pStorage.get(), vAsync, true);
+	ASSERT_FALSE(HasFatalFailure());
+
+	void *pSync;
+	unsigned SyncSize;
+	ASSERT_TRUE(pStorage->ReadFile("sync.demo", IStorage::TYPE_SAVE, &pSync, &SyncSize));
+	ASSERT_GT(SyncSize, sizeof(CDemoHeader));
+	for(const std::string &Filename : vAsync)
+	{
+		// the same except for the timestamp in the header
+		void *pAsync;
+		unsigned AsyncSize;
+		ASSERT_TRUE(pStorage->ReadFile(Filename.c_str(), IStorage::TYPE_SAVE, &pAsync, &AsyncSize));
+		EXPECT_EQ(SyncSize, AsyncSize) << Filename;
+		if(SyncSize == AsyncSize)
+		{
+			EXPECT_EQ(mem_comp((char *)pSync + sizeof(CDemoHeader), (char *)pAsync + sizeof(CDemoHeader), SyncSize - sizeof(CDemoHeader)), 0) << Filename;
+		}
+		free(pAsync);
+		pStorage->RemoveFile(Filename.c_str(), IStorage::TYPE_SAVE);
+	}
+	free(pSync);
+
+	pStorage->RemoveFile("sync.demo", IStorage::TYPE_SAVE);
+}
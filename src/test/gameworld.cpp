@@ -19,8 +19,10 @@
 #include <generated/protocol.h>
 
 #include <game/server/entities/character.h>
+#include <game/server/entities/projectile.h>
 #include <game/server/gamecontext.h>
 #include <game/server/gameworld.h>
+#include <game/prng.h>
 #include <game/version.h>
 
 #include <memory>
@@ -239,7 +241,7 @@ TEST_F(CTestGameWorld, IntersectEntity)
 
 	vec2 CloserToFromButTooFarFromLine = vec2(11, 11 + Radius + pChrLeft->GetProximityRadius());
 	pChrLeft->SetPosition(CloserToFromButTooFarFromLine);
-	pChrLeft->m_Pos = CloserToFromButTooFarFromLine;
+	pChrLeft->SetPos(CloserToFromButTooFarFromLine);
 
 	pIntersectedChar = (CCharacter *)GameServer()->m_World.IntersectEntity(
 		vec2(10, 10), // intersect from
@@ -253,6 +255,108 @@ TEST_F(CTestGameWorld, IntersectEntity)
 	EXPECT_EQ(pIntersectedChar, pChrRight);
 }
 
+TEST_F(CTestGameWorld, EntityGridSameAsScan)
+{
+	CGameWorld &World = GameServer()->m_World;
+	CPrng Prng;
+	uint64_t aSeed[2] = {7, 8};
+	Prng.Seed(aSeed);
+	const auto RandomPos = [&]() {
+		return vec2((int)(Prng.RandomBits() % 4000) - 500, (int)(Prng.RandomBits() % 4000) - 500);
+	};
+
+	CNetObj_PlayerInput Input = {};
+	std::vector<CCharacter *> vpCharacters;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CCharacter *pChr = new(i) CCharacter(&World, Input);
+		pChr->SetPos(RandomPos());
+		World.InsertEntity(pChr);
+		vpCharacters.push_back(pChr);
+	}
+
+	for(int Round = 0; Round < 500; Round++)
+	{
+		// move some characters, also far away and back
+		for(int i = 0; i < 8; i++)
+		{
+			CCharacter *pChr = vpCharacters[Prng.RandomBits() % vpCharacters.size()];
+			pChr->SetPos(Round % 50 == 0 ? vec2(1e9f, -1e9f) : RandomPos());
+		}
+		// re-insert one to change the list order
+		CCharacter *pReinserted = vpCharacters[Prng.RandomBits() % vpCharacters.size()];
+		World.RemoveEntity(pReinserted);
+		World.InsertEntity(pReinserted);
+
+		const vec2 Pos = RandomPos();
+		const vec2 To = Round % 2 ? Pos + vec2((int)(Prng.RandomBits() % 800) - 400, (int)(Prng.RandomBits() % 800) - 400) : RandomPos();
+		const float Radius = Round % 10 == 0 ? 2000.0f : (float)(Prng.RandomBits() % 300);
+
+		std::vector<CEntity *> vpExpected;
+		for(CEntity *pEnt = World.FindFirst(CGameWorld::ENTTYPE_CHARACTER); pEnt; pEnt = pEnt->TypeNext())
+			if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->GetProximityRadius())
+				vpExpected.push_back(pEnt);
+		CEntity *apEnts[MAX_CLIENTS];
+		const int Num = World.FindEntities(Pos, Radius, apEnts, MAX_CLIENTS, CGameWorld::ENTTYPE_CHARACTER);
+		ASSERT_EQ(std::vector<CEntity *>(apEnts, apEnts + Num), vpExpected);
+
+		std::vector<CCharacter *> vpExpectedOnLine;
+		CCharacter *pExpectedClosest = nullptr;
+		float ClosestLen = distance(Pos, To) * 100.0f;
+		vec2 ExpectedIntersectPos;
+		for(CEntity *pEnt = World.FindFirst(CGameWorld::ENTTYPE_CHARACTER); pEnt; pEnt = pEnt->TypeNext())
+		{
+			vec2 IntersectPos;
+			if(closest_point_on_line(Pos, To, pEnt->m_Pos, IntersectPos) && distance(pEnt->m_Pos, IntersectPos) < pEnt->GetProximityRadius() + Radius)
+			{
+				vpExpectedOnLine.push_back((CCharacter *)pEnt);
+				if(distance(Pos, IntersectPos) < ClosestLen)
+				{
+					ClosestLen = distance(Pos, IntersectPos);
+					pExpectedClosest = (CCharacter *)pEnt;
+					ExpectedIntersectPos = IntersectPos;
+				}
+			}
+		}
+		ASSERT_EQ(World.IntersectedCharacters(Pos, To, Radius), vpExpectedOnLine);
+		vec2 IntersectPos;
+		ASSERT_EQ(World.IntersectCharacter(Pos, To, Radius, IntersectPos), pExpectedClosest);
+		if(pExpectedClosest)
+		{
+			ASSERT_EQ(IntersectPos, ExpectedIntersectPos);
+		}
+	}
+}
+
+TEST_F(CTestGameWorld, SharedSnap)
+{
+	int ClientId = 0;
+	bool Afk = true;
+	int LastWhisperTo = -1;
+	GameServer()->CreatePlayer(ClientId, TEAM_RED, Afk, LastWhisperTo);
+	CPlayer *pPlayer = GameServer()->m_apPlayers[ClientId];
+	pPlayer->ForceSpawn(vec2(0, 0));
+	ASSERT_NE(pPlayer->GetCharacter(), nullptr);
+	new CProjectile(&GameServer()->m_World, WEAPON_GUN, ClientId, vec2(64, 64), vec2(1, 0), 100, false, false, -1, vec2(0, 0));
+	new CProjectile(&GameServer()->m_World, WEAPON_GUN, -1, vec2(128, 64), vec2(0, 1), 100, false, false, -1, vec2(0, 0));
+	ASSERT_NE(GameServer()->m_World.FindFirst(CGameWorld::ENTTYPE_PICKUP), nullptr);
+
+	const auto BuildSnap = [&](bool Shared, char *pData) {
+		m_pServer->Config()->m_SvSharedSnap = Shared;
+		m_pServer->m_SnapshotBuilder.Init();
+		GameServer()->OnSnap(SERVER_DEMO_CLIENT, true);
+		return m_pServer->m_SnapshotBuilder.Finish(pData);
+	};
+	char aPerClient[CSnapshot::MAX_SIZE];
+	char aShared[CSnapshot::MAX_SIZE];
+	// the first snapshot registers the extended item types
+	BuildSnap(false, aPerClient);
+	const int PerClientSize = BuildSnap(false, aPerClient);
+	const int SharedSize = BuildSnap(true, aShared);
+	ASSERT_EQ(PerClientSize, SharedSize);
+	EXPECT_EQ(mem_comp(aPerClient, aShared, PerClientSize), 0);
+}
+
 TEST_F(CTestGameWorld, BasicTick)
 {
 	int ClientId = 0;
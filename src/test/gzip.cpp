@@ -0,0 +1,88 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/gzip.h>
+#include <game/prng.h>
+
+#include <string>
+#include <vector>
+
+static std::vector<unsigned char> ReadAll(const char *pFilename)
+{
+	std::vector<unsigned char> vData;
+	CGzipReader Reader;
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	EXPECT_TRUE(File);
+	if(!File || !Reader.Open(File))
+		return vData;
+	unsigned char aBuffer[1000];
+	int Size;
+	while((Size = Reader.Read(aBuffer, sizeof(aBuffer))) > 0)
+		vData.insert(vData.end(), aBuffer, aBuffer + Size);
+	EXPECT_EQ(Size, 0);
+	return vData;
+}
+
+TEST(Gzip, Roundtrip)
+{
+	CTestInfo Info;
+	std::vector<unsigned char> vExpected;
+	CPrng Prng;
+	uint64_t aSeed[2] = {1, 2};
+	Prng.Seed(aSeed);
+	{
+		CGzipWriter Writer;
+		ASSERT_TRUE(Writer.Open(io_open(Info.m_aFilename, IOFLAG_WRITE)));
+		// many small writes like the teehistorian ticks, compressible data
+		for(int i = 0; i < 10000; i++)
+		{
+			unsigned char aChunk[64];
+			const unsigned Size = Prng.RandomBits() % sizeof(aChunk);
+			for(unsigned j = 0; j < Size; j++)
+				aChunk[j] = Prng.RandomBits() % 4;
+			Writer.Write(aChunk, Size);
+			vExpected.insert(vExpected.end(), aChunk, aChunk + Size);
+		}
+		Writer.Close();
+		EXPECT_EQ(Writer.Error(), 0);
+	}
+
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	EXPECT_LT(io_length(File), (int64_t)vExpected.size() / 2);
+	io_close(File);
+	EXPECT_EQ(ReadAll(Info.m_aFilename), vExpected);
+	fs_remove(Info.m_aFilename);
+}
+
+TEST(Gzip, Empty)
+{
+	CTestInfo Info;
+	{
+		CGzipWriter Writer;
+		ASSERT_TRUE(Writer.Open(io_open(Info.m_aFilename, IOFLAG_WRITE)));
+	}
+	EXPECT_TRUE(ReadAll(Info.m_aFilename).empty());
+	fs_remove(Info.m_aFilename);
+}
+
+TEST(Gzip, Concatenated)
+{
+	CTestInfo Info;
+	const char aFirst[] = "first stream";
+	const char aSecond[] = "second stream";
+	{
+		CGzipWriter Writer;
+		ASSERT_TRUE(Writer.Open(io_open(Info.m_aFilename, IOFLAG_WRITE)));
+		Writer.Write(aFirst, str_length(aFirst));
+	}
+	{
+		CGzipWriter Writer;
+		ASSERT_TRUE(Writer.Open(io_open(Info.m_aFilename, IOFLAG_APPEND)));
+		Writer.Write(aSecond, str_length(aSecond));
+	}
+	std::vector<unsigned char> vData = ReadAll(Info.m_aFilename);
+	EXPECT_EQ(std::string(vData.begin(), vData.end()), "first streamsecond stream");
+	fs_remove(Info.m_aFilename);
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/server/info_workers.h>
+#include <engine/shared/masterserver.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+#if defined(CONF_FAMILY_UNIX)
+TEST(InfoWorkers, AnswerOrForward)
+{
+	// too large for the stack
+	auto pNetServer = std::make_unique<CNetServer>();
+	CNetServer &NetServer = *pNetServer;
+	NETADDR BindAddr = {};
+	BindAddr.type = NETTYPE_IPV4;
+	ASSERT_FALSE(net_addr_from_str(&BindAddr, "127.0.0.1"));
+	do
+	{
+		BindAddr.port = secure_rand() % 64511 + 1024;
+	} while(!NetServer.Open(BindAddr, nullptr, 1, 1, true));
+
+	CInfoWorkers Workers;
+	ASSERT_TRUE(Workers.Start(BindAddr, 2, &NetServer));
+	auto pInfo = std::make_shared<CInfoWorkers::CServerInfo>();
+	for(int SendClients = 0; SendClients < 2; SendClients++)
+		pInfo->m_avChunks[SERVERINFO_VANILLA * 2 + SendClients].push_back({'i', 'n', 'f', 'o', 0});
+	Workers.SetServerInfo(pInfo);
+
+	// the kernel distributes the senders between the sockets, so each request
+	// is either answered by a worker or reaches the net server
+	const int NumClients = 16;
+	NETSOCKET apClients[NumClients];
+	NETADDR ClientBindAddr = {};
+	ClientBindAddr.type = NETTYPE_IPV4;
+	for(int i = 0; i < NumClients; i++)
+	{
+		apClients[i] = net_udp_create(ClientBindAddr);
+		ASSERT_TRUE(apClients[i]);
+		CPacker Packer;
+		Packer.Reset();
+		Packer.AddRaw(SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO));
+		Packer.AddRaw("\x2a", 1); // token
+		CNetBase::SendPacketConnless(apClients[i], &BindAddr, Packer.Data(), Packer.Size(), false, nullptr);
+	}
+
+	int Answered = 0;
+	for(auto &pClient : apClients)
+	{
+		if(!net_socket_read_wait(pClient, 200ms))
+			continue;
+		NETADDR Addr;
+		unsigned char *pData;
+		const int Bytes = net_udp_recv(pClient, &Addr, &pData);
+		ASSERT_GT(Bytes, 6 + (int)sizeof(SERVERBROWSE_INFO));
+		EXPECT_EQ(mem_comp(pData + 6, SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO)), 0);
+		EXPECT_EQ(Addr, BindAddr);
+		Answered++;
+	}
+
+	int Received = 0;
+	CNetChunk Chunk;
+	SECURITY_TOKEN ResponseToken;
+	while(NetServer.Recv(&Chunk, &ResponseToken))
+	{
+		EXPECT_EQ(Chunk.m_ClientId, -1);
+		EXPECT_EQ(mem_comp(Chunk.m_pData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)), 0);
+		Received++;
+	}
+	EXPECT_EQ(Answered + Received, NumClients);
+	EXPECT_GT(Answered, 0);
+
+	// everything that is not an info request is forwarded
+	for(auto &pClient : apClients)
+		CNetBase::SendPacketConnless(pClient, &BindAddr, "ping", 4, false, nullptr);
+	Received = 0;
+	const int64_t Deadline = time_get() + time_freq() * 5;
+	while(Received < NumClients && time_get() < Deadline)
+	{
+		if(!NetServer.HasForwardedPackets())
+			net_socket_read_wait(NetServer.Socket(), 10ms);
+		while(NetServer.Recv(&Chunk, &ResponseToken))
+		{
+			EXPECT_EQ(Chunk.m_DataSize, 4);
+			EXPECT_EQ(mem_comp(Chunk.m_pData, "ping", 4), 0);
+			Received++;
+		}
+	}
+	EXPECT_EQ(Received, NumClients);
+
+	for(auto &pClient : apClients)
+		net_udp_close(pClient);
+	Workers.Stop();
+	NetServer.Close();
+}
+
+TEST(InfoWorkers, ForwardedPackets)
+{
+	auto pNetServer = std::make_unique<CNetServer>();
+	CNetServer &NetServer = *pNetServer;
+	NETADDR BindAddr = {};
+	BindAddr.type = NETTYPE_IPV4;
+	ASSERT_FALSE(net_addr_from_str(&BindAddr, "127.0.0.1"));
+	do
+	{
+		BindAddr.port = secure_rand() % 64511 + 1024;
+	} while(!NetServer.Open(BindAddr, nullptr, 1, 1, true));
+
+	// a forwarded packet ends the wait of the game thread
+	NETADDR Addr = BindAddr;
+	Addr.port++;
+	static const unsigned char s_aPing[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 'p', 'i', 'n', 'g'};
+	const std::chrono::nanoseconds Start = time_get_nanoseconds();
+	std::thread Forwarder([&]() {
+		std::this_thread::sleep_for(50ms);
+		NetServer.ForwardPacket(Addr, s_aPing, sizeof(s_aPing));
+	});
+	EXPECT_EQ(net_socket_read_wait(NetServer.Socket(), 10s), 1);
+	EXPECT_LT(time_get_nanoseconds() - Start, 5s);
+	Forwarder.join();
+	EXPECT_TRUE(NetServer.HasForwardedPackets());
+
+	// the queue is bounded
+	for(size_t i = 0; i < CNetServer::MAX_FORWARDED_PACKETS + 10; i++)
+		NetServer.ForwardPacket(Addr, s_aPing, sizeof(s_aPing));
+	size_t Received = 0;
+	CNetChunk Chunk;
+	SECURITY_TOKEN ResponseToken;
+	while(NetServer.Recv(&Chunk, &ResponseToken))
+		Received++;
+	EXPECT_EQ(Received, CNetServer::MAX_FORWARDED_PACKETS);
+	EXPECT_FALSE(NetServer.HasForwardedPackets());
+	NetServer.Close();
+}
+#endif
@@ -52,3 +52,57 @@ TEST(Net, Ipv4AndIpv6Work)
 	net_udp_close(Socket1);
 	net_udp_close(Socket2);
 }
+
+TEST(Net, SendBatching)
+{
+	NETADDR Bindaddr = {};
+	NETSOCKET Socket1;
+	NETSOCKET Socket2;
+
+	Bindaddr.type = NETTYPE_IPV4 | NETTYPE_IPV6;
+	Socket2 = net_udp_create(Bindaddr);
+	do
+	{
+		Bindaddr.port = secure_rand() % 64511 + 1024;
+	} while(!(Socket1 = net_udp_create(Bindaddr)));
+
+	NETADDR aTargets[2];
+	ASSERT_FALSE(net_addr_from_str(&aTargets[0], "127.0.0.1"));
+	ASSERT_FALSE(net_addr_from_str(&aTargets[1], "[::1]"));
+	aTargets[0].port = Bindaddr.port;
+	aTargets[1].port = Bindaddr.port;
+
+	// more packets than fit into the queue, alternating between IPv4 and IPv6
+	const int NumPackets = 300;
+	net_udp_set_send_batching(Socket2, true);
+	for(int i = 0; i < NumPackets; i++)
+	{
+		EXPECT_EQ(net_udp_send(Socket2, &aTargets[i % 2], &i, sizeof(i)), (int)sizeof(i));
+	}
+	net_udp_flush(Socket2);
+
+	int aNext[2] = {0, 1};
+	int Received = 0;
+	while(Received < NumPackets)
+	{
+		ASSERT_EQ(net_socket_read_wait(Socket1, 10s), 1);
+		NETADDR Addr;
+		unsigned char *pData;
+		int Bytes;
+		while((Bytes = net_udp_recv(Socket1, &Addr, &pData)) > 0)
+		{
+			ASSERT_EQ(Bytes, (int)sizeof(int));
+			const int Family = Addr.type == NETTYPE_IPV4 ? 0 : 1;
+			int Value;
+			mem_copy(&Value, pData, sizeof(Value));
+			EXPECT_EQ(Value, aNext[Family]);
+			aNext[Family] += 2;
+			Received++;
+		}
+	}
+	EXPECT_EQ(aNext[0], NumPackets);
+	EXPECT_EQ(aNext[1], NumPackets + 1);
+
+	net_udp_close(Socket1);
+	net_udp_close(Socket2);
+}
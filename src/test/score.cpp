@@ -1,3 +1,4 @@
+#include "test.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -9,6 +10,8 @@
 
 #include <sqlite3.h>
 
+#include <atomic>
+
 #if defined(CONF_TEST_MYSQL)
 int DummyMysqlInit = (MysqlInit(), 1);
 #endif
@@ -18,6 +21,210 @@ TEST(SQLite, Version)
 	ASSERT_GE(sqlite3_libversion_number(), 3025000) << "SQLite >= 3.25.0 required for Window functions";
 }
 
+TEST(SQLite, StatementCache)
+{
+	auto pConn = CreateSqliteConnection(":memory:", false);
+	char aError[256];
+	int NumUpdated;
+	ASSERT_TRUE(pConn->Connect(aError, sizeof(aError))) << aError;
+	ASSERT_TRUE(pConn->PrepareStatement("CREATE TABLE Test(Value INTEGER)", aError, sizeof(aError))) << aError;
+	ASSERT_TRUE(pConn->ExecuteUpdate(&NumUpdated, aError, sizeof(aError))) << aError;
+	for(int i = 0; i < 3; i++)
+	{
+		ASSERT_TRUE(pConn->PrepareStatement("INSERT INTO Test(Value) VALUES (?)", aError, sizeof(aError))) << aError;
+		pConn->BindInt(1, i);
+		ASSERT_TRUE(pConn->ExecuteUpdate(&NumUpdated, aError, sizeof(aError))) << aError;
+		EXPECT_EQ(NumUpdated, 1);
+	}
+
+	// preparing a statement again starts it over, even if not all rows were read
+	bool End;
+	ASSERT_TRUE(pConn->PrepareStatement("SELECT Value FROM Test ORDER BY Value", aError, sizeof(aError))) << aError;
+	ASSERT_TRUE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+	ASSERT_FALSE(End);
+	ASSERT_TRUE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+	ASSERT_FALSE(End);
+	EXPECT_EQ(pConn->GetInt(1), 1);
+	ASSERT_TRUE(pConn->PrepareStatement("SELECT COUNT(*) FROM Test", aError, sizeof(aError))) << aError;
+	ASSERT_TRUE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+	ASSERT_FALSE(End);
+	EXPECT_EQ(pConn->GetInt(1), 3);
+	ASSERT_TRUE(pConn->PrepareStatement("SELECT Value FROM Test ORDER BY Value", aError, sizeof(aError))) << aError;
+	ASSERT_TRUE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+	ASSERT_FALSE(End);
+	EXPECT_EQ(pConn->GetInt(1), 0);
+	pConn->Disconnect();
+}
+
+struct CTestCountResult : ISqlResult
+{
+	int m_Count = -1;
+};
+
+static bool TestCountRaces(IDbConnection *pSqlServer, const ISqlData *pData, char *pError, int ErrorSize)
+{
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "SELECT COUNT(*) FROM %s_race", pSqlServer->GetPrefix());
+	if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+		return false;
+	bool End;
+	if(!pSqlServer->Step(&End, pError, ErrorSize) || End)
+		return false;
+	static_cast<CTestCountResult *>(pData->m_pResult.get())->m_Count = pSqlServer->GetInt(1);
+	return true;
+}
+
+static bool TestInsertRace(IDbConnection *pSqlServer, const ISqlData *pData, Write w, char *pError, int ErrorSize)
+{
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "INSERT INTO %s_race(Map, Name, Time, Server) VALUES ('Kobra 3', 'nameless tee', 100.0, 'USA')", pSqlServer->GetPrefix());
+	int NumInserted;
+	return pSqlServer->PrepareStatement(aBuf, pError, ErrorSize) && pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize);
+}
+
+TEST(DbConnectionPool, ReadWorkers)
+{
+	CTestInfo Info;
+	char aFilename[IO_MAX_PATH_LENGTH];
+	Info.Filename(aFilename, sizeof(aFilename), ".sqlite");
+	const int OldReadWorkers = g_Config.m_SvSqlReadWorkers;
+	g_Config.m_SvSqlReadWorkers = 3;
+	{
+		CDbConnectionPool Pool;
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::READ, aFilename);
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFilename);
+
+		auto pWriteResult = std::make_shared<ISqlResult>();
+		Pool.ExecuteWrite(TestInsertRace, std::make_unique<ISqlData>(pWriteResult), "test insert");
+		while(!pWriteResult->m_Completed.load())
+			thread_yield();
+		ASSERT_TRUE(pWriteResult->m_Success);
+
+		std::vector<std::shared_ptr<CTestCountResult>> vpResults;
+		for(int i = 0; i < 32; i++)
+		{
+			vpResults.push_back(std::make_shared<CTestCountResult>());
+			Pool.Execute(TestCountRaces, std::make_unique<ISqlData>(vpResults.back()), "test count");
+		}
+		for(const auto &pResult : vpResults)
+		{
+			while(!pResult->m_Completed.load())
+				thread_yield();
+			EXPECT_TRUE(pResult->m_Success);
+			EXPECT_EQ(pResult->m_Count, 1);
+		}
+	}
+	g_Config.m_SvSqlReadWorkers = OldReadWorkers;
+	for(const char *pSuffix : {"", "-wal", "-shm"})
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "%s%s", aFilename, pSuffix);
+		fs_remove(aPath);
+	}
+}
+
+struct CTestRaceData : ISqlData
+{
+	CTestRaceData(std::shared_ptr<ISqlResult> pResult, int Time, bool Fail) :
+		ISqlData(std::move(pResult)), m_Time(Time), m_Fail(Fail) {}
+	int m_Time;
+	bool m_Fail;
+};
+
+static bool TestInsertTimedRace(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+{
+	const auto *pData = static_cast<const CTestRaceData *>(pGameData);
+	// the backup database only confirms the writes
+	if(w != Write::NORMAL)
+		return true;
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "INSERT INTO %s_race(Map, Name, Time, Server) VALUES ('Kobra 3', 'nameless tee', ?, 'USA')", pSqlServer->GetPrefix());
+	if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+		return false;
+	pSqlServer->BindInt(1, pData->m_Time);
+	int NumInserted;
+	if(!pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize))
+		return false;
+	if(pData->m_Fail)
+	{
+		str_copy(pError, "failing on purpose", ErrorSize);
+		return false;
+	}
+	return true;
+}
+
+static std::atomic_bool gs_WritesQueued;
+
+// holds up the thread that runs it, so that the writes after it are waiting
+// together when it is done
+static bool TestWaitForQueuedWrites(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+{
+	while(!gs_WritesQueued.load())
+		thread_yield();
+	return true;
+}
+
+TEST(DbConnectionPool, WriteBatch)
+{
+	CTestInfo Info;
+	char aFilename[IO_MAX_PATH_LENGTH];
+	Info.Filename(aFilename, sizeof(aFilename), ".sqlite");
+	char aBackupFilename[IO_MAX_PATH_LENGTH];
+	Info.Filename(aBackupFilename, sizeof(aBackupFilename), "-backup.sqlite");
+	const int OldWriteBatch = g_Config.m_SvSqlWriteBatch;
+	g_Config.m_SvSqlWriteBatch = 32;
+	for(bool Backup : {false, true})
+	{
+		CDbConnectionPool Pool;
+		if(Backup)
+			Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE_BACKUP, aBackupFilename);
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::READ, aFilename);
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFilename);
+
+		// the failing write only undoes its own insert, even if it is
+		// committed together with the others. With a backup database, a
+		// failing write would send the following ones there instead.
+		const int FailingWrite = Backup ? -1 : 50;
+		gs_WritesQueued = false;
+		auto pWaitResult = std::make_shared<ISqlResult>();
+		Pool.ExecuteWrite(TestWaitForQueuedWrites, std::make_unique<ISqlData>(pWaitResult), "test wait");
+		std::vector<std::shared_ptr<ISqlResult>> vpResults;
+		for(int i = 0; i < 100; i++)
+		{
+			vpResults.push_back(std::make_shared<ISqlResult>());
+			Pool.ExecuteWrite(TestInsertTimedRace, std::make_unique<CTestRaceData>(vpResults.back(), Backup * 100 + i + 1, i == FailingWrite), "test insert");
+		}
+		gs_WritesQueued = true;
+		for(int i = 0; i < 100; i++)
+		{
+			while(!vpResults[i]->m_Completed.load())
+				thread_yield();
+			EXPECT_EQ(vpResults[i]->m_Success, i != FailingWrite) << i;
+		}
+		while(!pWaitResult->m_Completed.load())
+			thread_yield();
+		EXPECT_TRUE(pWaitResult->m_Success);
+		// with a backup database, its thread runs the writes first and is held up
+		EXPECT_GT(Pool.MaxWriteBatch(Backup ? CDbConnectionPool::WRITE_BACKUP : CDbConnectionPool::WRITE), 1);
+		auto pCountResult = std::make_shared<CTestCountResult>();
+		Pool.Execute(TestCountRaces, std::make_unique<ISqlData>(pCountResult), "test count");
+		while(!pCountResult->m_Completed.load())
+			thread_yield();
+		EXPECT_TRUE(pCountResult->m_Success);
+		EXPECT_EQ(pCountResult->m_Count, Backup ? 199 : 99);
+	}
+	g_Config.m_SvSqlWriteBatch = OldWriteBatch;
+	for(const char *pFile : {aFilename, aBackupFilename})
+	{
+		for(const char *pSuffix : {"", "-wal", "-shm"})
+		{
+			char aPath[IO_MAX_PATH_LENGTH];
+			str_format(aPath, sizeof(aPath), "%s%s", pFile, pSuffix);
+			fs_remove(aPath);
+		}
+	}
+}
+
 struct Score : public testing::TestWithParam<IDbConnection *>
 {
 	Score()
@@ -145,6 +352,42 @@ TEST_P(SingleScore, Top)
 			"-----------------------------------------"});
 }
 
+TEST_P(SingleScore, TopCached)
+{
+	g_Config.m_SvRegionalRankings = false;
+	g_Config.m_SvSqlCacheTtl = 30;
+	auto pCache = std::make_shared<CScoreResultCache>();
+	m_PlayerRequest.m_pCache = pCache;
+	m_PlayerRequest.m_CacheQuery = CScoreResultCache::QUERY_TOP;
+	m_PlayerRequest.m_CacheGeneration = pCache->Generation();
+	ASSERT_TRUE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	EXPECT_EQ(pCache->Size(), 1);
+
+	auto pCachedResult = std::make_shared<CScorePlayerResult>();
+	ASSERT_TRUE(pCache->Find(&m_PlayerRequest, pCachedResult.get()));
+	ExpectLines(pCachedResult,
+		{"------------ Global Top ------------",
+			"1. nameless tee Time: 01:40.00",
+			"-----------------------------------------"});
+
+	// saving a score drops the results of the map, results read during the write are not added
+	pCache->BeginWrite("Kobra 3");
+	EXPECT_FALSE(pCache->Find(&m_PlayerRequest, pCachedResult.get()));
+	m_PlayerRequest.m_CacheGeneration = pCache->Generation();
+	ASSERT_TRUE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	EXPECT_EQ(pCache->Size(), 0);
+	pCache->EndWrite("Kobra 3");
+	ASSERT_TRUE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	EXPECT_EQ(pCache->Size(), 0);
+
+	m_PlayerRequest.m_CacheGeneration = pCache->Generation();
+	ASSERT_TRUE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	EXPECT_EQ(pCache->Size(), 1);
+	pCache->BeginWrite("Kobra 4");
+	pCache->EndWrite("Kobra 4");
+	EXPECT_EQ(pCache->Size(), 1);
+}
+
 TEST_P(SingleScore, RankRegional)
 {
 	g_Config.m_SvRegionalRankings = true;
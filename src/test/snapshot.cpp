@@ -4,8 +4,13 @@
 
 #include <engine/shared/snapshot.h>
 
+#include <game/prng.h>
 #include <generated/protocol.h>
 
+#include <chrono>
+#include <limits>
+#include <vector>
+
 TEST(Snapshot, CrcOneInt)
 {
 	CSnapshotBuilder Builder;
@@ -85,3 +90,417 @@ TEST(Snapshot, CrcOverflow)
 
 	ASSERT_EQ(pSnapshot->Crc(), 1);
 }
+
+static std::vector<char> MakeStorageTestData(int Tick, size_t Size)
+{
+	std::vector<char> vData(Size);
+	for(size_t i = 0; i < vData.size(); i++)
+		vData[i] = (char)(Tick * 31 + i);
+	return vData;
+}
+
+static void ExpectStoredTick(const CSnapshotStorage &Storage, int Tick, size_t Size, size_t AltSize)
+{
+	int64_t Tagtime;
+	const CSnapshot *pData;
+	const CSnapshot *pAltData;
+	ASSERT_EQ(Storage.Get(Tick, &Tagtime, &pData, &pAltData), (int)Size);
+	EXPECT_EQ(Tagtime, (int64_t)Tick * 1000);
+	EXPECT_EQ(mem_comp(pData, MakeStorageTestData(Tick, Size).data(), Size), 0);
+	if(AltSize)
+		EXPECT_EQ(mem_comp(pAltData, MakeStorageTestData(-Tick, AltSize).data(), AltSize), 0);
+	else
+		EXPECT_EQ(pAltData, nullptr);
+}
+
+TEST(SnapshotStorage, AddGetPurge)
+{
+	CSnapshotStorage Storage;
+	for(int Tick = 0; Tick < 10; Tick++)
+	{
+		const std::vector<char> vData = MakeStorageTestData(Tick, 100 + Tick);
+		const std::vector<char> vAltData = MakeStorageTestData(-Tick, 50 + Tick);
+		Storage.Add(Tick, (int64_t)Tick * 1000, vData.size(), vData.data(), Tick % 2 ? vAltData.size() : 0, vAltData.data());
+	}
+	for(int Tick = 0; Tick < 10; Tick++)
+		ExpectStoredTick(Storage, Tick, 100 + Tick, Tick % 2 ? 50 + Tick : 0);
+	EXPECT_EQ(Storage.Get(10, nullptr, nullptr, nullptr), -1);
+	EXPECT_EQ(Storage.Get(-1, nullptr, nullptr, nullptr), -1);
+
+	Storage.PurgeUntil(5);
+	EXPECT_EQ(Storage.m_pFirst->m_Tick, 5);
+	EXPECT_EQ(Storage.m_pLast->m_Tick, 9);
+	EXPECT_EQ(Storage.Get(4, nullptr, nullptr, nullptr), -1);
+	ExpectStoredTick(Storage, 5, 105, 55);
+
+	Storage.PurgeUntil(100);
+	EXPECT_EQ(Storage.m_pFirst, nullptr);
+	EXPECT_EQ(Storage.m_pLast, nullptr);
+	EXPECT_EQ(Storage.Get(9, nullptr, nullptr, nullptr), -1);
+}
+
+TEST(SnapshotStorage, RingWrapAround)
+{
+	CSnapshotStorage Storage;
+	const int Retention = 150;
+	for(int Tick = 0; Tick < 2000; Tick++)
+	{
+		Storage.PurgeUntil(Tick - Retention);
+		const size_t Size = 1000 + (Tick * 7919) % 3000;
+		const std::vector<char> vData = MakeStorageTestData(Tick, Size);
+		Storage.Add(Tick, (int64_t)Tick * 1000, vData.size(), vData.data(), 0, nullptr);
+		if(Tick >= Retention)
+			ExpectStoredTick(Storage, Tick - Retention, 1000 + ((Tick - Retention) * 7919) % 3000, 0);
+		ExpectStoredTick(Storage, Tick, Size, 0);
+	}
+	EXPECT_EQ(Storage.ArenaSize(), (size_t)CSnapshotStorage::ARENA_INITIAL_SIZE * 2);
+	EXPECT_EQ(Storage.NumHeapFallbacks(), 0);
+}
+
+TEST(SnapshotStorage, IndexCollisions)
+{
+	CSnapshotStorage Storage;
+	const int NumTicks = CSnapshotStorage::TICK_INDEX_SIZE * 3;
+	for(int Tick = 0; Tick < NumTicks; Tick++)
+	{
+		const std::vector<char> vData = MakeStorageTestData(Tick, 64);
+		Storage.Add(Tick, (int64_t)Tick * 1000, vData.size(), vData.data(), 0, nullptr);
+	}
+	for(int Tick = 0; Tick < NumTicks; Tick++)
+		ExpectStoredTick(Storage, Tick, 64, 0);
+
+	Storage.PurgeUntil(NumTicks - 10);
+	EXPECT_EQ(Storage.Get(NumTicks - 11, nullptr, nullptr, nullptr), -1);
+	for(int Tick = NumTicks - 10; Tick < NumTicks; Tick++)
+		ExpectStoredTick(Storage, Tick, 64, 0);
+}
+
+TEST(SnapshotStorage, DuplicateTick)
+{
+	CSnapshotStorage Storage;
+	const std::vector<char> vFirst = MakeStorageTestData(1, 64);
+	const std::vector<char> vSecond = MakeStorageTestData(2, 64);
+	Storage.Add(1, 1000, vFirst.size(), vFirst.data(), 0, nullptr);
+	Storage.Add(1, 2000, vSecond.size(), vSecond.data(), 0, nullptr);
+	ExpectStoredTick(Storage, 1, 64, 0);
+}
+
+TEST(SnapshotStorage, LargeSnapshots)
+{
+	CSnapshotStorage Storage;
+	for(int Tick = 0; Tick < 400; Tick++)
+	{
+		Storage.PurgeUntil(Tick - 150);
+		const std::vector<char> vData = MakeStorageTestData(Tick, CSnapshot::MAX_SIZE);
+		const std::vector<char> vAltData = MakeStorageTestData(-Tick, CSnapshot::MAX_SIZE);
+		Storage.Add(Tick, (int64_t)Tick * 1000, vData.size(), vData.data(), vAltData.size(), vAltData.data());
+	}
+	for(int Tick = 250; Tick < 400; Tick++)
+		ExpectStoredTick(Storage, Tick, CSnapshot::MAX_SIZE, CSnapshot::MAX_SIZE);
+	EXPECT_LE(Storage.ArenaSize(), (size_t)CSnapshotStorage::ARENA_MAX_SIZE);
+	EXPECT_GT(Storage.NumHeapFallbacks(), 0);
+}
+
+// the previous storage, one malloc per holder and snapshot and a list walk in Get
+class CLegacySnapshotStorage
+{
+	struct CHolder
+	{
+		CHolder *m_pNext;
+		int m_Tick;
+		int m_SnapSize;
+		void *m_pSnap;
+	};
+	CHolder *m_pFirst = nullptr;
+	CHolder *m_pLast = nullptr;
+
+public:
+	~CLegacySnapshotStorage() { PurgeUntil(std::numeric_limits<int>::max()); }
+	void PurgeUntil(int Tick)
+	{
+		while(m_pFirst && m_pFirst->m_Tick < Tick)
+		{
+			CHolder *pNext = m_pFirst->m_pNext;
+			free(m_pFirst->m_pSnap);
+			free(m_pFirst);
+			m_pFirst = pNext;
+		}
+		if(!m_pFirst)
+			m_pLast = nullptr;
+	}
+	void Add(int Tick, size_t DataSize, const void *pData)
+	{
+		CHolder *pHolder = static_cast<CHolder *>(malloc(sizeof(CHolder)));
+		pHolder->m_pNext = nullptr;
+		pHolder->m_Tick = Tick;
+		pHolder->m_pSnap = malloc(DataSize);
+		mem_copy(pHolder->m_pSnap, pData, DataSize);
+		pHolder->m_SnapSize = DataSize;
+		if(m_pLast)
+			m_pLast->m_pNext = pHolder;
+		else
+			m_pFirst = pHolder;
+		m_pLast = pHolder;
+	}
+	int Get(int Tick) const
+	{
+		for(const CHolder *pHolder = m_pFirst; pHolder; pHolder = pHolder->m_pNext)
+			if(pHolder->m_Tick == Tick)
+				return pHolder->m_SnapSize;
+		return -1;
+	}
+};
+
+// replays the server pattern: purge to the 3 second window, add, look up the acked tick
+template<typename TStorage, typename TAdd, typename TGet>
+static std::chrono::nanoseconds BenchmarkSnapshotStorage(int NumClients, int NumTicks, TAdd &&Add, TGet &&Get)
+{
+	std::vector<TStorage> vStorages(NumClients);
+	const std::vector<char> vData = MakeStorageTestData(0, 4096);
+	int64_t Checksum = 0;
+	const std::chrono::nanoseconds Start = time_get_nanoseconds();
+	for(int Tick = 0; Tick < NumTicks; Tick++)
+	{
+		for(auto &Storage : vStorages)
+		{
+			Storage.PurgeUntil(Tick - 150);
+			Add(Storage, Tick, vData.size() - Tick % 512, vData.data());
+			Checksum += Get(Storage, Tick - 10);
+		}
+	}
+	const std::chrono::nanoseconds Duration = time_get_nanoseconds() - Start;
+	EXPECT_NE(Checksum, 0);
+	return Duration;
+}
+
+// only timing, run it with --gtest_also_run_disabled_tests
+TEST(SnapshotStorage, DISABLED_Benchmark)
+{
+	const int NumClients = 64;
+	const int NumTicks = 500;
+	const std::chrono::nanoseconds Legacy = BenchmarkSnapshotStorage<CLegacySnapshotStorage>(
+		NumClients, NumTicks,
+		[](CLegacySnapshotStorage &Storage, int Tick, size_t Size, const void *pData) { Storage.Add(Tick, Size, pData); },
+		[](const CLegacySnapshotStorage &Storage, int Tick) { return Storage.Get(Tick); });
+	const std::chrono::nanoseconds Arena = BenchmarkSnapshotStorage<CSnapshotStorage>(
+		NumClients, NumTicks,
+		[](CSnapshotStorage &Storage, int Tick, size_t Size, const void *pData) { Storage.Add(Tick, 0, Size, pData, 0, nullptr); },
+		[](const CSnapshotStorage &Storage, int Tick) { return Storage.Get(Tick, nullptr, nullptr, nullptr); });
+	dbg_msg("snapshot_storage", "%d clients, %d ticks: legacy=%.3fms arena=%.3fms",
+		NumClients, NumTicks,
+		std::chrono::duration<double, std::milli>(Legacy).count(),
+		std::chrono::duration<double, std::milli>(Arena).count());
+}
+
+TEST(SnapshotItemBuffer, SameAsDirectBuild)
+{
+	for(bool Sixup : {false, true})
+	{
+		CSnapshotBuilder Direct;
+		Direct.Init(Sixup);
+		CSnapshotItemBuffer Buffer;
+		for(int i = 0; i < 3; i++)
+		{
+			CNetObj_DDNetPickup Pickup = {};
+			Pickup.m_X = 32 * i;
+			Pickup.m_Y = 64;
+			Pickup.m_Type = i;
+			Pickup.m_SwitchNumber = i + 1;
+			mem_copy(Direct.NewItem(CNetObj_DDNetPickup::ms_MsgId, i, sizeof(Pickup)), &Pickup, sizeof(Pickup));
+			mem_copy(Buffer.NewItem(CNetObj_DDNetPickup::ms_MsgId, i, sizeof(Pickup)), &Pickup, sizeof(Pickup));
+
+			CNetObj_Flag Flag = {};
+			Flag.m_X = i;
+			mem_copy(Direct.NewItem(CNetObj_Flag::ms_MsgId, i, sizeof(Flag)), &Flag, sizeof(Flag));
+			mem_copy(Buffer.NewItem(CNetObj_Flag::ms_MsgId, i, sizeof(Flag)), &Flag, sizeof(Flag));
+		}
+		EXPECT_EQ(Buffer.NewItem(CNetObj_Flag::ms_MsgId, -1, sizeof(CNetObj_Flag)), nullptr);
+		ASSERT_EQ(Buffer.NumItems(), 6);
+
+		CSnapshotBuilder Replayed;
+		Replayed.Init(Sixup);
+		Buffer.AddToBuilder(&Replayed, 0, 2);
+		Buffer.AddToBuilder(&Replayed, 2, 4);
+
+		char aDirect[CSnapshot::MAX_SIZE];
+		char aReplayed[CSnapshot::MAX_SIZE];
+		const int DirectSize = Direct.Finish(aDirect);
+		const int ReplayedSize = Replayed.Finish(aReplayed);
+		ASSERT_EQ(DirectSize, ReplayedSize);
+		EXPECT_EQ(mem_comp(aDirect, aReplayed, DirectSize), 0);
+	}
+}
+
+static void FillRandomItemData(CPrng &Prng, int *pData, int Size)
+{
+	for(int i = 0; i < Size; i++)
+	{
+		// mostly small changes like in real snapshots, some full range ones
+		const unsigned Bits = Prng.RandomBits();
+		if(Bits % 4 == 0)
+			pData[i] = Prng.RandomBits();
+		else if(Bits % 4 == 1)
+			pData[i] = (int)(Bits % 64) - 32;
+		else
+			pData[i] = 0;
+	}
+}
+
+TEST(SnapshotDelta, DiffItemSameAsScalar)
+{
+	CPrng Prng;
+	uint64_t aSeed[2] = {1, 2};
+	Prng.Seed(aSeed);
+	int aPast[67], aDiff[67], aOut[67], aOutScalar[67];
+	for(int Size = 0; Size <= 67; Size++)
+	{
+		for(int Round = 0; Round < 16; Round++)
+		{
+			FillRandomItemData(Prng, aPast, Size);
+			FillRandomItemData(Prng, aDiff, Size);
+			int aCurrent[67];
+			for(int i = 0; i < Size; i++)
+				aCurrent[i] = Round % 2 ? aPast[i] : (unsigned)aPast[i] + (unsigned)aDiff[i];
+
+			const int Needed = CSnapshotDelta::DiffItem(aPast, aCurrent, aOut, Size);
+			const int NeededScalar = CSnapshotDelta::DiffItemScalar(aPast, aCurrent, aOutScalar, Size);
+			ASSERT_EQ(Needed, NeededScalar);
+			ASSERT_EQ(mem_comp(aOut, aOutScalar, Size * sizeof(int)), 0);
+
+			uint64_t DataRate = 0;
+			uint64_t DataRateScalar = 0;
+			CSnapshotDelta::UndiffItem(aPast, aDiff, aOut, Size, &DataRate);
+			CSnapshotDelta::UndiffItemScalar(aPast, aDiff, aOutScalar, Size, &DataRateScalar);
+			ASSERT_EQ(DataRate, DataRateScalar);
+			ASSERT_EQ(mem_comp(aOut, aOutScalar, Size * sizeof(int)), 0);
+		}
+	}
+}
+
+// the delta format before the change scan shortcut, without static sizes
+static int LegacyCreateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData)
+{
+	auto FindKey = [](const CSnapshot *pSnap, int Key) {
+		for(int i = 0; i < pSnap->NumItems(); i++)
+			if(pSnap->GetItem(i)->Key() == Key)
+				return i;
+		return -1;
+	};
+	CSnapshotDelta::CData *pDelta = (CSnapshotDelta::CData *)pDstData;
+	int *pData = pDelta->m_aData;
+	pDelta->m_NumDeletedItems = 0;
+	pDelta->m_NumUpdateItems = 0;
+	pDelta->m_NumTempItems = 0;
+	for(int i = 0; i < pFrom->NumItems(); i++)
+	{
+		if(FindKey(pTo, pFrom->GetItem(i)->Key()) == -1)
+		{
+			pDelta->m_NumDeletedItems++;
+			*pData++ = pFrom->GetItem(i)->Key();
+		}
+	}
+	for(int i = 0; i < pTo->NumItems(); i++)
+	{
+		const CSnapshotItem *pItem = pTo->GetItem(i);
+		const int Size = pTo->GetItemSize(i) / sizeof(int32_t);
+		const int PastIndex = FindKey(pFrom, pItem->Key());
+		if(PastIndex != -1)
+		{
+			if(!CSnapshotDelta::DiffItemScalar(pFrom->GetItem(PastIndex)->Data(), pItem->Data(), pData + 3, Size))
+				continue;
+		}
+		else
+			mem_copy(pData + 3, pItem->Data(), Size * sizeof(int32_t));
+		pData[0] = pItem->Type();
+		pData[1] = pItem->Id();
+		pData[2] = Size;
+		pData += 3 + Size;
+		pDelta->m_NumUpdateItems++;
+	}
+	if(!pDelta->m_NumDeletedItems && !pDelta->m_NumUpdateItems)
+		return 0;
+	return (int)((char *)pData - (char *)pDstData);
+}
+
+static int BuildRandomSnapshot(CPrng &Prng, int NumItems, int MaxId, char *pData)
+{
+	CSnapshotBuilder Builder;
+	Builder.Init();
+	for(int i = 0; i < NumItems; i++)
+	{
+		const int Type = 1 + Prng.RandomBits() % 8;
+		const int Size = Type * 3;
+		int *pItem = (int *)Builder.NewItem(Type, Prng.RandomBits() % MaxId, Size * sizeof(int));
+		if(pItem)
+			FillRandomItemData(Prng, pItem, Size);
+	}
+	return Builder.Finish(pData);
+}
+
+TEST(SnapshotDelta, CreateDeltaSameAsLegacy)
+{
+	CPrng Prng;
+	uint64_t aSeed[2] = {3, 4};
+	Prng.Seed(aSeed);
+	CSnapshotDelta Delta;
+	for(int Round = 0; Round < 200; Round++)
+	{
+		// few ids give duplicate keys, which take the slow path
+		const int MaxId = Round % 4 == 0 ? 16 : 1024;
+		char aFrom[CSnapshot::MAX_SIZE];
+		char aTo[CSnapshot::MAX_SIZE];
+		BuildRandomSnapshot(Prng, Prng.RandomBits() % 200, MaxId, aFrom);
+		BuildRandomSnapshot(Prng, Prng.RandomBits() % 200, MaxId, aTo);
+		if(Round % 3 == 0)
+			mem_copy(aTo, aFrom, sizeof(aTo));
+
+		char aDelta[CSnapshot::MAX_SIZE];
+		char aLegacyDelta[CSnapshot::MAX_SIZE];
+		const int Size = Delta.CreateDelta((CSnapshot *)aFrom, (CSnapshot *)aTo, aDelta);
+		const int LegacySize = LegacyCreateDelta((CSnapshot *)aFrom, (CSnapshot *)aTo, aLegacyDelta);
+		ASSERT_EQ(Size, LegacySize);
+		ASSERT_EQ(mem_comp(aDelta, aLegacyDelta, Size), 0);
+	}
+}
+
+TEST(SnapshotDelta, DISABLED_Benchmark)
+{
+	// pairs of items like a character moving between two snapshots
+	CPrng Prng;
+	uint64_t aSeed[2] = {5, 6};
+	Prng.Seed(aSeed);
+	const int ItemSize = sizeof(CNetObj_Character) / sizeof(int32_t);
+	const int NumItems = 4096;
+	std::vector<int> vPast(NumItems * ItemSize);
+	std::vector<int> vCurrent(NumItems * ItemSize);
+	std::vector<int> vOut(NumItems * ItemSize);
+	std::vector<int> vUndiffed(NumItems * ItemSize);
+	FillRandomItemData(Prng, vPast.data(), vPast.size());
+	for(size_t i = 0; i < vPast.size(); i++)
+		vCurrent[i] = vPast[i] + (i % 3 == 0 ? (int)(Prng.RandomBits() % 8) : 0);
+
+	const int NumRounds = 200;
+	int64_t Checksum = 0;
+	auto Benchmark = [&](auto &&Diff, auto &&Undiff) {
+		const std::chrono::nanoseconds Start = time_get_nanoseconds();
+		uint64_t DataRate = 0;
+		for(int Round = 0; Round < NumRounds; Round++)
+		{
+			for(int i = 0; i < NumItems; i++)
+			{
+				const int Offset = i * ItemSize;
+				Checksum += Diff(&vPast[Offset], &vCurrent[Offset], &vOut[Offset], ItemSize);
+				Undiff(&vPast[Offset], &vOut[Offset], &vUndiffed[Offset], ItemSize, &DataRate);
+			}
+		}
+		Checksum += DataRate;
+		return time_get_nanoseconds() - Start;
+	};
+	const std::chrono::nanoseconds Scalar = Benchmark(CSnapshotDelta::DiffItemScalar, CSnapshotDelta::UndiffItemScalar);
+	const std::chrono::nanoseconds Vectorized = Benchmark(CSnapshotDelta::DiffItem, CSnapshotDelta::UndiffItem);
+	EXPECT_NE(Checksum, 0);
+	dbg_msg("snapshot_delta", "%d item pairs, %d rounds: scalar=%.3fms vectorized=%.3fms",
+		NumItems, NumRounds,
+		std::chrono::duration<double, std::milli>(Scalar).count(),
+		std::chrono::duration<double, std::milli>(Vectorized).count());
+}
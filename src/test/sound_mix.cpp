@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/shared/sound_mix.h>
+
+#include <chrono>
+#include <vector>
+
+static std::vector<short> MakeSamples(int Num)
+{
+	std::vector<short> vSamples(Num);
+	for(int i = 0; i < Num; i++)
+		vSamples[i] = (short)(((i * 7919) % 65536) - 32768);
+	return vSamples;
+}
+
+TEST(SoundMix, SameAsScalar)
+{
+	const std::vector<short> vSamples = MakeSamples(2 * 67);
+	for(int Channels = 1; Channels <= 2; Channels++)
+	{
+		for(unsigned Frames = 0; Frames <= 67; Frames++)
+		{
+			std::vector<int> vMix(2 * Frames, 12345);
+			std::vector<int> vMixScalar = vMix;
+			MixVoice(vMix.data(), vSamples.data(), Channels, Frames, 255, 17);
+			MixVoiceScalar(vMixScalar.data(), vSamples.data(), Channels, Frames, 255, 17);
+			ASSERT_EQ(vMix, vMixScalar);
+
+			std::vector<short> vOut(2 * Frames), vOutScalar(2 * Frames);
+			for(int MasterVolume : {0, 37, 100})
+			{
+				ClampMix(vOut.data(), vMix.data(), 2 * Frames, MasterVolume);
+				ClampMixScalar(vOutScalar.data(), vMix.data(), 2 * Frames, MasterVolume);
+				ASSERT_EQ(vOut, vOutScalar);
+			}
+		}
+	}
+}
+
+TEST(SoundMix, Clamp)
+{
+	const int aMix[] = {0, 32767 * 255 * 255, -32767 * 255 * 255, 101 * 256 * 10, -101 * 256 * 10, 101 * 256 / 100};
+	short aOut[std::size(aMix)];
+	ClampMix(aOut, aMix, std::size(aMix), 100);
+	EXPECT_EQ(aOut[0], 0);
+	EXPECT_EQ(aOut[1], 32767);
+	EXPECT_EQ(aOut[2], -32768);
+	EXPECT_NEAR(aOut[3], 1000, 1);
+	EXPECT_NEAR(aOut[4], -1000, 1);
+	EXPECT_EQ(aOut[5], 0);
+}
+
+TEST(SoundMix, DISABLED_Benchmark)
+{
+	const int NumVoices = 64;
+	const unsigned Frames = 1024;
+	const int NumCallbacks = 200;
+	const std::vector<short> vSamples = MakeSamples(2 * Frames);
+	std::vector<int> vMix(2 * Frames);
+	std::vector<short> vOut(2 * Frames);
+
+	auto Run = [&](auto &&Mix, auto &&Clamp) {
+		const std::chrono::nanoseconds Start = time_get_nanoseconds();
+		for(int Callback = 0; Callback < NumCallbacks; Callback++)
+		{
+			std::fill(vMix.begin(), vMix.end(), 0);
+			for(int Voice = 0; Voice < NumVoices; Voice++)
+				Mix(vMix.data(), vSamples.data(), 1 + Voice % 2, Frames, Voice % 256, 255 - Voice % 256);
+			Clamp(vOut.data(), vMix.data(), 2 * Frames, 100);
+		}
+		return time_get_nanoseconds() - Start;
+	};
+	const std::chrono::nanoseconds Scalar = Run(MixVoiceScalar, ClampMixScalar);
+	const std::vector<short> vOutScalar = vOut;
+	const std::chrono::nanoseconds Vectorized = Run(MixVoice, ClampMix);
+	EXPECT_EQ(vOut, vOutScalar);
+	dbg_msg("sound_mix", "%d voices, %d callbacks of %u frames: scalar=%.3fms vectorized=%.3fms",
+		NumVoices, NumCallbacks, Frames,
+		std::chrono::duration<double, std::milli>(Scalar).count(),
+		std::chrono::duration<double, std::milli>(Vectorized).count());
+}
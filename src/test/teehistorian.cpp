@@ -21,6 +21,7 @@ protected:
 	CTeeHistorian::CGameInfo m_GameInfo;
 
 	std::vector<unsigned char> m_vBuffer;
+	int m_NumWrites;
 
 	enum
 	{
@@ -93,11 +94,13 @@ protected:
 	{
 		TeeHistorian *pThis = (TeeHistorian *)pUser;
 		WriteBuffer(pThis->m_vBuffer, pData, DataSize);
+		pThis->m_NumWrites++;
 	}
 
 	void Reset(const CTeeHistorian::CGameInfo *pGameInfo)
 	{
 		m_vBuffer.clear();
+		m_NumWrites = 0;
 		m_TH.Reset(pGameInfo, Write, this);
 		m_State = STATE_NONE;
 	}
@@ -299,6 +302,29 @@ TEST_F(TeeHistorian, TickExplicitAscendingClientId)
 	Expect(EXPECTED, sizeof(EXPECTED));
 }
 
+TEST_F(TeeHistorian, WriteOncePerTick)
+{
+	const unsigned char EXPECTED[] = {
+		0x42, 0x00, 0x01, 0x02, // PLAYER_NEW cid=0 x=1 y=2
+		0x42, 0x01, 0x03, 0x04, // PLAYER_NEW cid=1 x=3 y=4
+		0x00, 0x01, 0x40, // PLAYER cid=0 dx=1 dy=-1
+		0x01, 0x01, 0x40, // PLAYER cid=1 dx=1 dy=-1
+		0x40, // FINISH
+	};
+	Tick(1);
+	Player(0, 1, 2);
+	Player(1, 3, 4);
+	const int NumHeaderWrites = m_NumWrites;
+	Tick(2);
+	EXPECT_EQ(m_NumWrites, NumHeaderWrites + 1);
+	Player(0, 2, 1);
+	Player(1, 4, 3);
+	Tick(3);
+	EXPECT_EQ(m_NumWrites, NumHeaderWrites + 2);
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
 TEST_F(TeeHistorian, TickImplicitEmpty)
 {
 	const unsigned char EXPECTED[] = {
@@ -96,3 +96,48 @@ TEST(Thread, Lock)
 	Lock.unlock();
 	thread_wait(pThread);
 }
+
+TEST(Thread, SpscQueueSingleThreaded)
+{
+	CSpscQueue<int, 4> Queue;
+	int Item;
+	EXPECT_FALSE(Queue.TryPop(&Item));
+	for(int Round = 0; Round < 3; Round++)
+	{
+		for(int i = 0; i < 4; i++)
+			EXPECT_TRUE(Queue.TryPush(Round * 4 + i));
+		EXPECT_FALSE(Queue.TryPush(-1));
+		for(int i = 0; i < 4; i++)
+		{
+			ASSERT_TRUE(Queue.TryPop(&Item));
+			EXPECT_EQ(Item, Round * 4 + i);
+		}
+		EXPECT_FALSE(Queue.TryPop(&Item));
+	}
+}
+
+static const int SPSC_QUEUE_ITEMS = 100000;
+
+static void SpscQueueProducer(void *pUser)
+{
+	CSpscQueue<int, 64> *pQueue = (CSpscQueue<int, 64> *)pUser;
+	for(int i = 0; i < SPSC_QUEUE_ITEMS; i++)
+	{
+		while(!pQueue->TryPush(i))
+			thread_yield();
+	}
+}
+
+TEST(Thread, SpscQueueMultiThreaded)
+{
+	CSpscQueue<int, 64> Queue;
+	void *pThread = thread_init(SpscQueueProducer, &Queue, "spsc producer");
+	for(int i = 0; i < SPSC_QUEUE_ITEMS; i++)
+	{
+		int Item;
+		while(!Queue.TryPop(&Item))
+			thread_yield();
+		EXPECT_EQ(Item, i);
+	}
+	thread_wait(pThread);
+}
@@ -200,6 +200,7 @@ static int ExtractDemoChat(const char *pDemoFilePath, IStorage *pStorage)
 	std::unique_ptr<CSnapshotDelta> pDemoSnapshotDelta = std::make_unique<CSnapshotDelta>();
 	CDemoPlayer DemoPlayer(pDemoSnapshotDelta.get(), false);
 
+	CNetBase::Init();
 	if(DemoPlayer.Load(pStorage, nullptr, pDemoFilePath, IStorage::TYPE_ALL_OR_ABSOLUTE) == -1)
 	{
 		log_error(TOOL_NAME, "Demo file '%s' failed to load: %s", pDemoFilePath, DemoPlayer.ErrorMessage());
@@ -213,7 +214,6 @@ static int ExtractDemoChat(const char *pDemoFilePath, IStorage *pStorage)
 	DemoPlayer.SetListener(&Listener);
 
 	const CDemoPlayer::CPlaybackInfo *pInfo = DemoPlayer.Info();
-	CNetBase::Init();
 	DemoPlayer.Play();
 
 	while(DemoPlayer.IsPlaying())
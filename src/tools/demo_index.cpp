@@ -0,0 +1,52 @@
+#include <base/logger.h>
+#include <base/system.h>
+
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <memory>
+
+static const char *TOOL_NAME = "demo_index";
+
+int main(int argc, const char *argv[])
+{
+	// Create storage before setting logger to avoid log messages from storage creation
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	if(!pStorage)
+	{
+		log_error(TOOL_NAME, "Error creating local storage");
+		return -1;
+	}
+
+	if(argc < 2)
+	{
+		log_error(TOOL_NAME, "Usage: %s <demo_filename> [<demo_filename> ...]", TOOL_NAME);
+		return -1;
+	}
+
+	CNetBase::Init();
+	std::unique_ptr<CSnapshotDelta> pDemoSnapshotDelta = std::make_unique<CSnapshotDelta>();
+	CDemoEditor DemoEditor;
+	DemoEditor.Init(pDemoSnapshotDelta.get(), nullptr, pStorage.get());
+
+	int Result = 0;
+	for(int i = 1; i < argc; i++)
+	{
+		if(DemoEditor.AddKeyFrameIndex(argv[i]))
+		{
+			log_info(TOOL_NAME, "Demo '%s' has a keyframe index", argv[i]);
+		}
+		else
+		{
+			log_error(TOOL_NAME, "Failed to add a keyframe index to demo '%s'", argv[i]);
+			Result = -1;
+		}
+	}
+	return Result;
+}
@@ -7,9 +7,15 @@
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
 static const char *TOOL_NAME = "map_resave";
 
-static int ResaveMap(const char *pSourceMap, const char *pDestinationMap, IStorage *pStorage)
+static int ResaveMap(const char *pSourceMap, const char *pDestinationMap, IStorage *pStorage, int NumThreads)
 {
 	CDataFileReader Reader;
 	if(!Reader.Open(pStorage, pSourceMap, IStorage::TYPE_ABSOLUTE))
@@ -52,19 +58,85 @@ static int ResaveMap(const char *pSourceMap, const char *pDestinationMap, IStora
 	}
 
 	Reader.Close();
-	Writer.Finish();
+	Writer.Finish(NumThreads);
 	log_info(TOOL_NAME, "Resaved '%s' to '%s'", pSourceMap, pDestinationMap);
 	return 0;
 }
 
+static int ListMapCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	if(!IsDir && str_endswith(pName, ".map"))
+	{
+		static_cast<std::vector<std::string> *>(pUser)->emplace_back(pName);
+	}
+	return 0;
+}
+
+// resaves all maps of a directory, one map per thread
+static int ResaveDirectory(const char *pSourceDirectory, const char *pDestinationDirectory, IStorage *pStorage, int NumThreads)
+{
+	std::vector<std::string> vMaps;
+	fs_listdir(pSourceDirectory, ListMapCallback, 0, &vMaps);
+	if(vMaps.empty())
+	{
+		log_error(TOOL_NAME, "No maps found in '%s'", pSourceDirectory);
+		return -1;
+	}
+	if(!pStorage->CreateFolder(pDestinationDirectory, IStorage::TYPE_SAVE))
+	{
+		log_error(TOOL_NAME, "Failed to create destination directory '%s'", pDestinationDirectory);
+		return -1;
+	}
+
+	std::atomic<size_t> Next{0};
+	std::atomic<int> Failed{0};
+	const auto &&ResaveNext = [&]() {
+		for(size_t Index = Next++; Index < vMaps.size(); Index = Next++)
+		{
+			char aSourceMap[IO_MAX_PATH_LENGTH];
+			char aDestinationMap[IO_MAX_PATH_LENGTH];
+			str_format(aSourceMap, sizeof(aSourceMap), "%s/%s", pSourceDirectory, vMaps[Index].c_str());
+			str_format(aDestinationMap, sizeof(aDestinationMap), "%s/%s", pDestinationDirectory, vMaps[Index].c_str());
+			// the maps are already resaved in parallel
+			if(ResaveMap(aSourceMap, aDestinationMap, pStorage, 1) != 0)
+			{
+				Failed++;
+			}
+		}
+	};
+	std::vector<std::thread> vThreads;
+	for(int i = 1; i < std::min<int>(NumThreads, vMaps.size()); i++)
+	{
+		vThreads.emplace_back(ResaveNext);
+	}
+	ResaveNext();
+	for(std::thread &Thread : vThreads)
+	{
+		Thread.join();
+	}
+
+	log_info(TOOL_NAME, "Resaved %d of %d maps from '%s' to '%s'", (int)vMaps.size() - Failed.load(), (int)vMaps.size(), pSourceDirectory, pDestinationDirectory);
+	return Failed.load() == 0 ? 0 : -1;
+}
+
 int main(int argc, const char **argv)
 {
 	CCmdlineFix CmdlineFix(&argc, &argv);
 	log_set_global_logger_default();
 
-	if(argc != 3)
+	// compressing and resaving directories in parallel is opt-in
+	int NumThreads = 1;
+	int FirstArg = 1;
+	if(argc == 5 && str_comp(argv[1], "-j") == 0)
 	{
-		log_error(TOOL_NAME, "Usage: %s <source map> <destination map>", TOOL_NAME);
+		NumThreads = str_toint(argv[2]);
+		FirstArg = 3;
+	}
+
+	if(argc - FirstArg != 2 || NumThreads <= 0)
+	{
+		log_error(TOOL_NAME, "Usage: %s [-j <threads>] <source map> <destination map>", TOOL_NAME);
+		log_error(TOOL_NAME, "       %s [-j <threads>] <source directory> <destination directory>", TOOL_NAME);
 		return -1;
 	}
 
@@ -75,5 +147,11 @@ int main(int argc, const char **argv)
 		return -1;
 	}
 
-	return ResaveMap(argv[1], argv[2], pStorage.get());
+	const char *pSource = argv[FirstArg];
+	const char *pDestination = argv[FirstArg + 1];
+	if(fs_is_dir(pSource))
+	{
+		return ResaveDirectory(pSource, pDestination, pStorage.get(), NumThreads);
+	}
+	return ResaveMap(pSource, pDestination, pStorage.get(), NumThreads);
 }
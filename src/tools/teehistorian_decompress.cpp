@@ -0,0 +1,68 @@
+#include <base/logger.h>
+#include <base/system.h>
+
+#include <engine/shared/gzip.h>
+
+static const char *TOOL_NAME = "teehistorian_decompress";
+
+static int Decompress(const char *pSource, const char *pDestination)
+{
+	IOHANDLE SourceFile = io_open(pSource, IOFLAG_READ);
+	if(!SourceFile)
+	{
+		log_error(TOOL_NAME, "Failed to open '%s' for reading", pSource);
+		return -1;
+	}
+	CGzipReader Reader;
+	if(!Reader.Open(SourceFile))
+	{
+		log_error(TOOL_NAME, "Failed to start decompressing '%s'", pSource);
+		return -1;
+	}
+
+	IOHANDLE DestinationFile = io_open(pDestination, IOFLAG_WRITE);
+	if(!DestinationFile)
+	{
+		log_error(TOOL_NAME, "Failed to open '%s' for writing", pDestination);
+		return -1;
+	}
+
+	int Result = 0;
+	unsigned char aBuffer[64 * 1024];
+	while(true)
+	{
+		const int Size = Reader.Read(aBuffer, sizeof(aBuffer));
+		if(Size < 0)
+		{
+			log_error(TOOL_NAME, "'%s' is corrupted", pSource);
+			Result = -1;
+			break;
+		}
+		if(Size == 0)
+			break;
+		if(io_write(DestinationFile, aBuffer, Size) != (unsigned)Size)
+		{
+			log_error(TOOL_NAME, "Failed to write to '%s'", pDestination);
+			Result = -1;
+			break;
+		}
+	}
+	io_close(DestinationFile);
+	if(Result == 0)
+		log_info(TOOL_NAME, "Decompressed '%s' to '%s'", pSource, pDestination);
+	return Result;
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	if(argc != 3)
+	{
+		log_error(TOOL_NAME, "Usage: %s <source .teehistorian.gz> <destination .teehistorian>", TOOL_NAME);
+		return -1;
+	}
+
+	return Decompress(argv[1], argv[2]);
+}